@@ -3,9 +3,22 @@
 #include <memory>
 #include <vector>
 #include <map>
+#include <set>
 #include <fstream>
 #include <cassert>
 #include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <tuple>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -24,6 +37,32 @@
 #include <assimp/Importer.hpp>  // C++ importer interface
 #include <assimp/scene.h>       // Output data structure
 #include <assimp/postprocess.h> // Post processing flags
+#include <assimp/GltfMaterial.h>
+
+#include "animation.hpp"
+#include "assimp_glm.hpp"
+#include "batch_math.hpp"
+#include "clustered_lighting.hpp"
+#include "command_list.hpp"
+#include "file_watcher.hpp"
+#include "frame_encoder.hpp"
+#include "frame_pacing.hpp"
+#include "gltf_loader.hpp"
+#include "ibl.hpp"
+#include "meshlet.hpp"
+#include "parse_utils.hpp"
+#include "path_utils.hpp"
+#include "radix_sort.hpp"
+#include "render_graph.hpp"
+#include "scene_arena.hpp"
+#include "shadow_cascades.hpp"
+#include "simulation.hpp"
+#include "skinning.hpp"
+#include "streaming.hpp"
+#include "texture_resolver.hpp"
+#include "thread_pool.hpp"
+#include "tiled_scene.hpp"
+#include "vertex_weld.hpp"
 
 inline std::string GLErrorToString(GLenum error) {
     switch (error) {
@@ -38,85 +77,6 @@ inline std::string GLErrorToString(GLenum error) {
 }
 
 
-std::string parent_path(const std::string &str) {
-    return str.substr(0, str.find_last_of("/\\")) + "/";
-}
-
-
-std::string replace_all(const std::string &str, const std::string &search, const std::string &replace) {
-    std::string result = str;
-    
-    size_t pos = 0;
-    do {
-        pos = result.find(search);
-        
-        if (pos != std::string::npos) {
-            result.replace(pos, search.size(), replace);
-        }
-    }
-    while (pos != std::string::npos);
-    
-    return result;
-};
-
-
-std::vector<std::string> split(const std::string &str, const std::string &delimiter) {
-    std::string s = str;
-    std::vector<std::string> tokens;
-    
-    size_t pos = 0;
-    std::string token;
-    while ((pos = s.find(delimiter)) != std::string::npos) {
-        token = s.substr(0, pos);
-        
-        tokens.push_back(token);
-        
-        s.erase(0, pos + delimiter.length());
-    }
-    
-    tokens.push_back(s);
-    
-    return tokens;
-}
-
-
-std::string join(const std::vector<std::string> &elements, const std::string &delimiter) {
-    std::string str;
-    
-    for (size_t i = 0; i < elements.size(); i++) {
-        if (elements[i].empty()) {
-            continue;
-        }
-        
-        str += elements[i];
-        
-        if (i < elements.size() - 1) {
-            str += delimiter;
-        }
-    }
-    
-    return str;
-}
-
-
-std::string normalize_path(const std::string &str) {
-    std::string result = str;
-    
-    std::replace(result.begin(), result.end(), '\\', '/');
-    
-    return result;
-}
-
-
-bool can_be_opened(const std::string &filePath) {
-    std::fstream fs;
-    
-    fs.open(filePath.c_str(), std::ios::in);
-    
-    return fs.is_open();
-}
-
-
 #ifndef NDEBUG
 #   define M_Assert(Expr, Msg) \
     __M_Assert(#Expr, Expr, __FILE__, __LINE__, Msg)
@@ -169,6 +129,28 @@ struct Material {
     glm::vec4 specular = {1.0f, 1.0f, 1.0f, 1.0f};
     
     GLuint diffuseTexture = 0;
+    
+    // the array diffuseTexture was packed into, with the textures of the same size and format, and its layer.
+    // zero when it isn't packed
+    GLuint diffuseArray = 0;
+    float diffuseLayer = 0.0f;
+    
+    // metallic-roughness shading, with the diffuse color and texture as the base color
+    bool pbr = false;
+    float metallic = 1.0f;
+    float roughness = 1.0f;
+    
+    // the metalness is read from the blue channel and the roughness from the green one, so the packed glTF
+    // textures and the separate grayscale ones both work
+    GLuint metallicTexture = 0;
+    GLuint roughnessTexture = 0;
+    GLuint normalTexture = 0;
+    
+    // drawn after the opaque meshes, blended back to front. the opacity and the red channel of the opacity
+    // texture multiply the alpha of the diffuse color
+    bool transparent = false;
+    float opacity = 1.0f;
+    GLuint opacityTexture = 0;
 };
 
 
@@ -204,6 +186,30 @@ GLuint createTexture(GLenum internalFormat, const unsigned width, const unsigned
 }
 
 
+// replaces the image of an existing texture, so everything referencing it sees the new one
+void updateTexture(const GLuint texture, GLenum internalFormat, const unsigned width, const unsigned height, const GLenum format, const void *data) {
+    GL_SCOPED_ERROR_CHECK
+    
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+
+// replaces the image of a layer of a texture array, with the size and format of the array
+void updateTextureLayer(const GLuint texture, const GLint layer, const unsigned width, const unsigned height, const GLenum format, const void *data) {
+    GL_SCOPED_ERROR_CHECK
+    
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, format, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+
 class TextureRepository {
 public:
     TextureRepository() {
@@ -212,7 +218,21 @@ public:
         ilutInit();
     }
     
-    GLuint getOrCreate(const std::string &filePath) {
+    ~TextureRepository() {
+        if (reloadThread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock{reloadMutex};
+                stopping = true;
+            }
+            
+            reloadCondition.notify_one();
+            reloadThread.join();
+        }
+    }
+    
+    // the packable requests, for the diffuse maps, may get a texture packed into an array already. packTextureArrays()
+    // finds its layer again, so a scene reload reuses the layers instead of packing the same images once more
+    GLuint getOrCreate(const std::string &filePath, const bool packable = false) {
         if (filePath.empty()) {
             return 0;
         }
@@ -221,7 +241,211 @@ public:
             return it->second;
         }
         
-        GLuint texture = createTexture(filePath.c_str());
+        if (auto it = packedTextureMap.find(filePath); packable && it != packedTextureMap.end()) {
+            return it->second;
+        }
+        
+        DecodedImage image;
+        
+        if (! decodeImage(filePath.c_str(), image)) {
+            return 0;
+        }
+        
+        return createTexture(filePath, image);
+    }
+    
+    // for the images embedded in a scene file. the name is only the key of the cache
+    GLuint getOrCreate(const std::string &name, const std::uint8_t *data, const size_t size, const bool packable = false) {
+        if (auto it = cachedTextureMap.find(name); it != cachedTextureMap.end()) {
+            return it->second;
+        }
+        
+        if (auto it = packedTextureMap.find(name); packable && it != packedTextureMap.end()) {
+            return it->second;
+        }
+        
+        DecodedImage image;
+        
+        if (! decodeImage(name.c_str(), image, data, size)) {
+            return 0;
+        }
+        
+        return createTexture(name, image);
+    }
+    
+    std::vector<std::string> getFilePaths() const {
+        std::vector<std::string> filePaths;
+        
+        for (const auto &[filePath, texture] : cachedTextureMap) {
+            filePaths.push_back(filePath);
+        }
+        
+        for (const auto &[filePath, texture] : packedTextureMap) {
+            if (! cachedTextureMap.count(filePath) && (filePaths.empty() || filePaths.back() != filePath)) {
+                filePaths.push_back(filePath);
+            }
+        }
+        
+        return filePaths;
+    }
+    
+    bool contains(const std::string &filePath) const {
+        return cachedTextureMap.find(filePath) != cachedTextureMap.end() || packedTextureMap.find(filePath) != packedTextureMap.end();
+    }
+    
+    // decodes the file again on a background thread, applyReloads() uploads it later
+    void reloadAsync(const std::string &filePath) {
+        {
+            std::lock_guard<std::mutex> lock{reloadMutex};
+            
+            if (std::find(pendingReloads.begin(), pendingReloads.end(), filePath) != pendingReloads.end()) {
+                return;
+            }
+            
+            pendingReloads.push_back(filePath);
+        }
+        
+        if (! reloadThread.joinable()) {
+            reloadThread = std::thread{&TextureRepository::reloadMain, this};
+        }
+        
+        reloadCondition.notify_one();
+    }
+    
+    // uploads the decoded reloads into their textures, which keep their names. call it between frames
+    size_t applyReloads() {
+        std::vector<std::pair<std::string, DecodedImage>> images;
+        
+        {
+            std::lock_guard<std::mutex> lock{reloadMutex};
+            images.swap(decodedReloads);
+        }
+        
+        for (const auto &[filePath, image] : images) {
+            bool updated = false;
+            
+            if (const auto cached = cachedTextureMap.find(filePath); cached != cachedTextureMap.end()) {
+                updateTexture(cached->second, image.internalFormat, image.width, image.height, image.format, image.pixels.data());
+                textureInfos[cached->second] = {image.width, image.height, image.internalFormat, image.format};
+                updated = true;
+            }
+            
+            // the file may have been loaded again as a 2D texture after it was packed, both are updated
+            const auto [first, last] = packedTextureMap.equal_range(filePath);
+            
+            for (auto it = first; it != last; ++it) {
+                const auto packed = packedLayers.find(it->second);
+                
+                // the layers of an array share its size and format
+                const TextureArray &array = textureArrays[packed->second.first];
+                
+                if (image.width != array.width || image.height != array.height || image.internalFormat != array.internalFormat) {
+                    std::cout << "Texture " << filePath << " changed its size or format, restart to see it" << std::endl;
+                    continue;
+                }
+                
+                updateTextureLayer(array.texture, packed->second.second, image.width, image.height, image.format, image.pixels.data());
+                updated = true;
+            }
+            
+            if (updated) {
+                std::cout << "Reloaded texture " << filePath << std::endl;
+            }
+        }
+        
+        return images.size();
+    }
+    
+    // packs the diffuse textures of the materials that share their size and format into the layers of texture
+    // arrays, so the draws switching between them only change a uniform. the packed textures keep their names,
+    // which are still the keys of the materials, but release their storage and leave the cache
+    void packTextureArrays(std::vector<Material> &materials) {
+        GL_SCOPED_ERROR_CHECK
+        
+        // the images also sampled as metalness, roughness, normals or opacity must stay 2D textures
+        std::set<GLuint> otherTextures;
+        
+        for (const Material &material : materials) {
+            otherTextures.insert({material.metallicTexture, material.roughnessTexture, material.normalTexture, material.opacityTexture});
+        }
+        
+        // the textures not packed yet, by size and format
+        std::map<std::tuple<unsigned, unsigned, GLenum>, std::vector<GLuint>> groups;
+        
+        for (const Material &material : materials) {
+            const GLuint texture = material.diffuseTexture;
+            const auto info = textureInfos.find(texture);
+            
+            if (!texture || packedLayers.count(texture) || otherTextures.count(texture) || info == textureInfos.end()) {
+                continue;
+            }
+            
+            std::vector<GLuint> &group = groups[{info->second.width, info->second.height, info->second.internalFormat}];
+            
+            if (std::find(group.begin(), group.end(), texture) == group.end()) {
+                group.push_back(texture);
+            }
+        }
+        
+        GLint maxLayers = 0;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+        
+        // a texture alone gains nothing from an array
+        for (const auto &[key, textures] : groups) {
+            for (size_t first = 0; textures.size() - first >= 2; ) {
+                const size_t count = std::min(textures.size() - first, size_t(maxLayers));
+                
+                packTextures(&textures[first], count);
+                first += count;
+            }
+        }
+        
+        // a later request for the image of a packed texture, as the map of another material or by the next
+        // scene, decodes it again instead of getting a texture without storage
+        for (auto it = cachedTextureMap.begin(); it != cachedTextureMap.end(); ) {
+            if (packedLayers.count(it->second)) {
+                packedTextureMap.insert(*it);
+                it = cachedTextureMap.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+        
+        for (Material &material : materials) {
+            const auto packed = packedLayers.find(material.diffuseTexture);
+            
+            material.diffuseArray = packed != packedLayers.end() ? textureArrays[packed->second.first].texture : 0;
+            material.diffuseLayer = packed != packedLayers.end() ? float(packed->second.second) : 0.0f;
+        }
+    }
+    
+private:
+    struct DecodedImage {
+        std::vector<std::uint8_t> pixels;
+        
+        GLenum internalFormat = GL_RGB;
+        GLenum format = GL_RGB;
+        unsigned width = 0;
+        unsigned height = 0;
+    };
+    
+    struct TextureInfo {
+        unsigned width = 0;
+        unsigned height = 0;
+        GLenum internalFormat = GL_RGB;
+        GLenum format = GL_RGB;
+    };
+    
+    struct TextureArray {
+        GLuint texture = 0;
+        unsigned width = 0;
+        unsigned height = 0;
+        GLenum internalFormat = GL_RGB;
+    };
+    
+    GLuint createTexture(const std::string &filePath, const DecodedImage &image) {
+        const GLuint texture = ::createTexture(image.internalFormat, image.width, image.height, image.format, GL_UNSIGNED_BYTE, image.pixels.data());
         
         if (! texture) {
             return 0;
@@ -230,23 +454,81 @@ public:
         std::cout << "Loaded texture " << filePath << std::endl;
         
         cachedTextureMap[filePath] = texture;
+        textureInfos[texture] = {image.width, image.height, image.internalFormat, image.format};
         
         return texture;
     }
     
-private:
-    GLuint createTexture(const char* theFileName) {
+    // copies the textures, of the same size and format, into the layers of a new array
+    void packTextures(const GLuint *textures, const size_t count) {
+        const TextureInfo &info = textureInfos[textures[0]];
+        
+        TextureArray array;
+        array.width = info.width;
+        array.height = info.height;
+        array.internalFormat = info.internalFormat;
+        
+        glGenTextures(1, &array.texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, info.internalFormat, info.width, info.height, GLsizei(count), 0, info.format, GL_UNSIGNED_BYTE, nullptr);
+        
+        // the same sampling as the 2D textures
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        
+        // the texels are copied as they are, without row padding
+        std::vector<std::uint8_t> pixels(size_t(info.width) * info.height * 4);
+        
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        
+        for (size_t layer = 0; layer < count; layer++) {
+            glBindTexture(GL_TEXTURE_2D, textures[layer]);
+            glGetTexImage(GL_TEXTURE_2D, 0, info.format, GL_UNSIGNED_BYTE, pixels.data());
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, GLint(layer), info.width, info.height, 1, info.format, GL_UNSIGNED_BYTE, pixels.data());
+            
+            // empty levels free the storage, while the name stays reserved
+            for (GLint level = 0; (info.width >> level) > 0 || (info.height >> level) > 0; level++) {
+                glTexImage2D(GL_TEXTURE_2D, level, info.internalFormat, 0, 0, 0, info.format, GL_UNSIGNED_BYTE, nullptr);
+            }
+            
+            packedLayers[textures[layer]] = {textureArrays.size(), GLint(layer)};
+        }
+        
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        
+        textureArrays.push_back(array);
+        
+        std::cout << "Packed " << count << " textures of " << info.width << "x" << info.height << " into a texture array" << std::endl;
+    }
+    
+    // decodes the file, or the encoded image when given
+    bool decodeImage(const char* theFileName, DecodedImage &image, const std::uint8_t *encoded = nullptr, const size_t encodedSize = 0) {
+        // DevIL keeps its state in globals, the reload thread can't decode at the same time as the main one
+        std::lock_guard<std::mutex> lock{decodeMutex};
+        
         ILuint imageID;
         
         ilGenImages(1, &imageID);
         ilBindImage(imageID);
          
         // If we managed to load the image, then we can start to do things with it...
-        if (! ilLoadImage(theFileName)) {
+        const ILboolean loaded = encoded ? ilLoadL(IL_TYPE_UNKNOWN, encoded, static_cast<ILuint>(encodedSize)) : ilLoadImage(theFileName);
+        
+        if (! loaded) {
             const ILenum error = ilGetError();
             std::cout << "Image load failed: \"" << theFileName << "\" - IL reports error: " << error << " - " << iluErrorString(error) << std::endl;
             
-            return 0;
+            ilDeleteImages(1, &imageID);
+            
+            return false;
         }
         
         iluFlipImage();
@@ -255,33 +537,81 @@ private:
             ILenum error = ilGetError();
             std::cout << "Image conversion failed: \"" << theFileName << "\" - IL reports error: " << error << " - " << iluErrorString(error) << std::endl;
             
-            return 0;
+            ilDeleteImages(1, &imageID);
+            
+            return false;
         }
         
         // Specify the texture specification
         const ILint bpp = ilGetInteger(IL_IMAGE_BPP);
-        const ILint width = ilGetInteger(IL_IMAGE_WIDTH);
-        const ILint height = ilGetInteger(IL_IMAGE_HEIGHT);
         const ILint format = ilGetInteger(IL_IMAGE_FORMAT);
-        const void* data = ilGetData();
+        const ILubyte* data = ilGetData();
+        
+        image.width = ilGetInteger(IL_IMAGE_WIDTH);
+        image.height = ilGetInteger(IL_IMAGE_HEIGHT);
+        image.format = format;
+        image.pixels.assign(data, data + size_t(image.width) * image.height * bpp);
         
-        GLenum internalFormat = 0;
-
         switch (bpp) {
-        case 3: internalFormat = GL_RGB; break;
-        case 4: internalFormat = GL_RGBA; break;
-        default: internalFormat = format;
+        case 3: image.internalFormat = GL_RGB; break;
+        case 4: image.internalFormat = GL_RGBA; break;
+        default: image.internalFormat = format;
         }
         
-        const GLuint texture = ::createTexture(internalFormat, width, height, format, GL_UNSIGNED_BYTE, data);
-        
         ilDeleteImages(1, &imageID);
         
-        return texture;
+        return true;
+    }
+    
+    void reloadMain() {
+        std::unique_lock<std::mutex> lock{reloadMutex};
+        
+        while (true) {
+            reloadCondition.wait(lock, [this] {
+                return stopping || !pendingReloads.empty();
+            });
+            
+            if (stopping) {
+                return;
+            }
+            
+            const std::string filePath = pendingReloads.front();
+            pendingReloads.pop_front();
+            
+            lock.unlock();
+            
+            DecodedImage image;
+            const bool decoded = decodeImage(filePath.c_str(), image);
+            
+            lock.lock();
+            
+            // the texture keeps its current image when the file can't be decoded
+            if (decoded) {
+                decodedReloads.emplace_back(filePath, std::move(image));
+            }
+        }
     }
     
 private:
     std::map<std::string, GLuint> cachedTextureMap;
+    std::map<GLuint, TextureInfo> textureInfos;
+    
+    // the packed textures out of the cache, by file, for their reloads. a file may be loaded and packed again
+    std::multimap<std::string, GLuint> packedTextureMap;
+    
+    // the packed textures, by the index of their array and their layer
+    std::vector<TextureArray> textureArrays;
+    std::map<GLuint, std::pair<size_t, GLint>> packedLayers;
+    
+    std::mutex decodeMutex;
+    
+    // background decoding of the changed files
+    std::thread reloadThread;
+    std::mutex reloadMutex;
+    std::condition_variable reloadCondition;
+    std::deque<std::string> pendingReloads;
+    std::vector<std::pair<std::string, DecodedImage>> decodedReloads;
+    bool stopping = false;
 };
 
 
@@ -304,6 +634,8 @@ GLuint createShader(const std::string &source, const GLenum type) {
         glGetShaderInfoLog(shader, 2048, &size, buffer);
         const std::string msg = buffer;
         std::cout << msg << std::endl;
+
+        glDeleteShader(shader);
         return 0;
     }
 
@@ -311,6 +643,12 @@ GLuint createShader(const std::string &source, const GLenum type) {
 }
 
 
+// every program gets the same attribute locations, so a VAO can be drawn with any of them
+const std::array<const char*, 5> VertexAttributeNames = {
+    "vertCoord", "vertNormal", "vertTexCoord", "vertBoneIndices", "vertBoneWeights"
+};
+
+
 GLuint createShaderProgram(const std::vector<GLuint> &shaders) {
     GLuint program = glCreateProgram();
 
@@ -320,6 +658,10 @@ GLuint createShaderProgram(const std::vector<GLuint> &shaders) {
 
         glAttachShader(program, shader);
     }
+    
+    for (GLuint i = 0; i < VertexAttributeNames.size(); i++) {
+        glBindAttribLocation(program, i, VertexAttributeNames[i]);
+    }
 
     glLinkProgram(program);
 
@@ -334,6 +676,8 @@ GLuint createShaderProgram(const std::vector<GLuint> &shaders) {
         const std::string msg = buffer;
         std::cout << msg << std::endl;
 
+        glDeleteProgram(program);
+
         return 0;
     }
 
@@ -366,15 +710,23 @@ GLuint createBuffer(const GLenum target, const ArrayLike &values, GLenum usage)
 }
 
 
-Material createMaterial(const std::string &parentPath, TextureRepository &textureRepository, const aiMaterial *aimaterial) {
+// the texture types sampled by the gouraud shader. references of any other type are neither resolved nor loaded
+const std::array<aiTextureType, 6> GouraudTextureTypes = {
+    aiTextureType_DIFFUSE, aiTextureType_BASE_COLOR, aiTextureType_METALNESS, aiTextureType_DIFFUSE_ROUGHNESS, aiTextureType_NORMALS,
+    aiTextureType_OPACITY
+};
+
+
+Material createMaterial(TextureResolver &textureResolver, TextureRepository &textureRepository, const aiMaterial *aimaterial) {
     if (!aimaterial) {
         return {};
     }
     
     Material material;
     
-    // extract material colors
-    aiColor3D colorAmbient, colorDiffuse, colorSpecular, colorEmissive;
+    // extract material colors. the diffuse alpha is kept, the formats with a transparency color store it there
+    aiColor3D colorAmbient, colorSpecular, colorEmissive;
+    aiColor4D colorDiffuse {0.0f, 0.0f, 0.0f, 1.0f};
 
     aimaterial->Get(AI_MATKEY_COLOR_AMBIENT, colorAmbient);
     aimaterial->Get(AI_MATKEY_COLOR_DIFFUSE, colorDiffuse);
@@ -382,76 +734,132 @@ Material createMaterial(const std::string &parentPath, TextureRepository &textur
     // aimaterial->Get(AI_MATKEY_COLOR_EMISSIVE, colorEmissive);
     
     material.ambient = glm::vec4{colorAmbient.r, colorAmbient.g, colorAmbient.b, 1.0f};
-    material.diffuse = glm::vec4{colorDiffuse.r, colorDiffuse.g, colorDiffuse.b, 1.0f};
+    material.diffuse = glm::vec4{colorDiffuse.r, colorDiffuse.g, colorDiffuse.b, colorDiffuse.a};
     material.specular = glm::vec4{colorSpecular.r, colorSpecular.g, colorSpecular.b, 1.0f};
+    aimaterial->Get(AI_MATKEY_OPACITY, material.opacity);
+    
+    // the metallic-roughness properties, as the glTF and FBX importers describe them
+    aiColor4D baseColor;
+    
+    const bool hasBaseColor = aimaterial->Get(AI_MATKEY_BASE_COLOR, baseColor) == AI_SUCCESS;
+    const bool hasMetallic = aimaterial->Get(AI_MATKEY_METALLIC_FACTOR, material.metallic) == AI_SUCCESS;
+    aimaterial->Get(AI_MATKEY_ROUGHNESS_FACTOR, material.roughness);
+    
+    if (hasBaseColor) {
+        material.diffuse = glm::vec4{baseColor.r, baseColor.g, baseColor.b, baseColor.a};
+    }
 
     // extract material textures
-    std::map<aiTextureType, std::string> textureMap {
-        { aiTextureType_AMBIENT, "" },
-        { aiTextureType_DIFFUSE, "" },
-        { aiTextureType_SPECULAR, "" },
-        { aiTextureType_AMBIENT, "" },
-        { aiTextureType_HEIGHT, "" },
-        { aiTextureType_EMISSIVE, "" },
-        { aiTextureType_NORMALS, "" },
-        { aiTextureType_SHININESS, "" },
-        { aiTextureType_OPACITY, "" },
-        { aiTextureType_DISPLACEMENT, "" },
-        { aiTextureType_LIGHTMAP, "" },
-        { aiTextureType_REFLECTION, "" },
-        { aiTextureType_BASE_COLOR, "" },
-        { aiTextureType_NORMAL_CAMERA, "" },
-        { aiTextureType_EMISSION_COLOR, "" },
-        { aiTextureType_METALNESS, "" },
-        { aiTextureType_DIFFUSE_ROUGHNESS, "" },
-        { aiTextureType_AMBIENT_OCCLUSION, "" },
-        { aiTextureType_UNKNOWN, "" },
-    };
-    
     std::cout << aimaterial->GetName().C_Str() << std::endl;
-    for (auto &pair : textureMap) {
+    for (const aiTextureType type : GouraudTextureTypes) {
         aiString fileName;
-        aimaterial->GetTexture(pair.first, 0, &fileName);
+        aimaterial->GetTexture(type, 0, &fileName);
         
         if (fileName.length == 0) {
             continue;
         }
         
-        std::string filePath = join(split(std::string{fileName.C_Str()}, "\\"), "/");
-        
-        if (filePath[0] == '/') {
-            if (! can_be_opened(filePath)) {
-                std::string textureFilePath = filePath;
-                std::string textureParentPath = parent_path(filePath);
-                
-                filePath = replace_all(filePath, parent_path(filePath), parentPath);
-            }
-        }
-        else {
-            filePath = parentPath + filePath;
-        }
-        
-        assert(can_be_opened(filePath));
+        const std::string &filePath = textureResolver.resolve(fileName.C_Str());
         
-        pair.second = filePath;
+        std::cout << "    " << type << " = " << fileName.C_Str() << " -> " << filePath << std::endl;
         
-        std::cout << "    " << pair.first << " = " << fileName.C_Str() << " -> " << filePath << std::endl;
-        // const std::string filePath = parentPath + file;
+        switch (type) {
+        case aiTextureType_DIFFUSE:
+        case aiTextureType_BASE_COLOR:
+            material.diffuseTexture = textureRepository.getOrCreate(filePath, true);
+            break;
+            
+        case aiTextureType_METALNESS:
+            material.metallicTexture = textureRepository.getOrCreate(filePath);
+            break;
+            
+        case aiTextureType_DIFFUSE_ROUGHNESS:
+            material.roughnessTexture = textureRepository.getOrCreate(filePath);
+            break;
+            
+        case aiTextureType_NORMALS:
+            material.normalTexture = textureRepository.getOrCreate(filePath);
+            break;
+            
+        case aiTextureType_OPACITY:
+            material.opacityTexture = textureRepository.getOrCreate(filePath);
+            break;
+            
+        default:
+            break;
+        }
+    }
+    
+    // the roughness factor alone doesn't tell, some importers add it to every material
+    material.pbr = hasBaseColor || hasMetallic || material.metallicTexture || material.roughnessTexture;
+    
+    if (!hasMetallic) {
+        material.metallic = material.metallicTexture ? 1.0f : 0.0f;
     }
     
-    material.diffuseTexture = textureRepository.getOrCreate(textureMap[aiTextureType_DIFFUSE]);
+    // the images are loaded as RGB, the alpha of the diffuse textures isn't known
+    material.transparent = material.opacity < 1.0f || material.diffuse.w < 1.0f || material.opacityTexture;
+    
+    // the glTF materials say it, like on the fast path: the opaque and masked ones ignore the base color alpha
+    aiString alphaMode;
+    
+    if (aimaterial->Get(AI_MATKEY_GLTF_ALPHAMODE, alphaMode) == AI_SUCCESS) {
+        material.transparent = std::string{alphaMode.C_Str()} == "BLEND";
+    }
     
     return material;
 }
 
 
 std::vector<Material> createMaterialArray(const std::string &parentPath, TextureRepository &textureRepository, const aiScene *aiscene) {
+    if (!aiscene) {
+        return {};
+    }
+    
+    TextureResolver textureResolver {parentPath};
     std::vector<Material> materials;
     
     materials.resize(aiscene->mNumMaterials);
     
     for (unsigned int i=0; i<aiscene->mNumMaterials; i++) {
-        materials[i] = createMaterial(parentPath, textureRepository, aiscene->mMaterials[i]);
+        materials[i] = createMaterial(textureResolver, textureRepository, aiscene->mMaterials[i]);
+    }
+    
+    return materials;
+}
+
+
+std::vector<Material> createMaterialArray(const std::string &filePath, TextureRepository &textureRepository, const GltfDocument &document) {
+    const std::string parentPath {parent_path(filePath)};
+    std::vector<Material> materials;
+    
+    for (const GltfMaterial &gltfMaterial : document.materials) {
+        const auto getOrCreate = [&](const int index, const bool packable) -> GLuint {
+            if (index < 0) {
+                return 0;
+            }
+            
+            const GltfImage &image = document.images[index];
+            
+            return image.uri.empty()
+                ? textureRepository.getOrCreate(filePath + "#image" + std::to_string(index), image.data, image.size, packable)
+                : textureRepository.getOrCreate(parentPath + image.uri, packable);
+        };
+        
+        Material material;
+        material.diffuse = gltfMaterial.baseColor;
+        material.diffuseTexture = getOrCreate(gltfMaterial.baseColorImage, true);
+        
+        material.pbr = true;
+        material.metallic = gltfMaterial.metallic;
+        material.roughness = gltfMaterial.roughness;
+        material.metallicTexture = material.roughnessTexture = getOrCreate(gltfMaterial.metallicRoughnessImage, false);
+        material.normalTexture = getOrCreate(gltfMaterial.normalImage, false);
+        
+        // the opaque and masked materials ignore the base color alpha
+        material.transparent = gltfMaterial.blend;
+        
+        materials.push_back(material);
     }
     
     return materials;
@@ -462,6 +870,8 @@ struct ShaderLocationMap {
     GLint coord = -1;
     GLint normal = -1;
     GLint texCoord = -1;
+    GLint boneIndices = -1;
+    GLint boneWeights = -1;
     
     GLint uModel = -1;
     GLint uView = -1;
@@ -469,13 +879,41 @@ struct ShaderLocationMap {
     
     GLint uMaterialDiffuseSamplerEnable = -1;
     GLint uMaterialDiffuseSampler = -1;
+    GLint uMaterialDiffuseArray = -1;
+    GLint uMaterialDiffuseLayer = -1;
     GLint uMaterialAmbient = -1;
     GLint uMaterialDiffuse = -1;
     GLint uMaterialSpecular = -1;
+    GLint uMaterialOpacity = -1;
+    GLint uMaterialOpacitySamplerEnable = -1;
+    GLint uMaterialOpacitySampler = -1;
+    
+    GLint uMaterialPbr = -1;
+    GLint uMaterialPbrTextures = -1;
+    GLint uMaterialMetallicSampler = -1;
+    GLint uMaterialRoughnessSampler = -1;
+    GLint uMaterialNormalSampler = -1;
+    GLint uCameraPosition = -1;
     
     GLint uLightAmbient = -1;
     GLint uLightDirection = -1;
     GLint uLightDiffuse = -1;
+    
+    GLint uClusterRanges = -1;
+    GLint uClusterLightIndices = -1;
+    GLint uLightData = -1;
+    GLint uClusterGrid = -1;
+    GLint uClusterDepthParams = -1;
+    GLint uViewportSize = -1;
+    
+    GLint uShadowMap = -1;
+    GLint uShadowMatrices = -1;
+    GLint uShadowSplits = -1;
+    
+    GLint uIrradianceMap = -1;
+    GLint uPrefilteredMap = -1;
+    GLint uPrefilteredMaxLod = -1;
+    GLint uBrdfLut = -1;
 };
 
 
@@ -488,27 +926,65 @@ ShaderLocationMap createShaderLocationMap(const GLuint program) {
     location.coord = glGetAttribLocation(program, "vertCoord");
     location.normal = glGetAttribLocation(program, "vertNormal");
     location.texCoord = glGetAttribLocation(program, "vertTexCoord");
+    location.boneIndices = glGetAttribLocation(program, "vertBoneIndices");
+    location.boneWeights = glGetAttribLocation(program, "vertBoneWeights");
     
     location.uModel = glGetUniformLocation(program, "uModel");
     location.uView = glGetUniformLocation(program, "uView");
     location.uProj = glGetUniformLocation(program, "uProj");
     
-    location.uMaterialDiffuseSamplerEnable = glGetUniformLocation(program, "uMaterialDiffuseSamplerEnable");
+    location.uMaterialDiffuseSamplerEnable = glGetUniformLocation(program, "uMaterialDiffuseSamplerEnabled");
     location.uMaterialDiffuseSampler = glGetUniformLocation(program, "uMaterialDiffuseSampler");
+    location.uMaterialDiffuseArray = glGetUniformLocation(program, "uMaterialDiffuseArray");
+    location.uMaterialDiffuseLayer = glGetUniformLocation(program, "uMaterialDiffuseLayer");
     location.uMaterialAmbient = glGetUniformLocation(program, "uMaterialAmbient");
     location.uMaterialDiffuse = glGetUniformLocation(program, "uMaterialDiffuse");
     location.uMaterialSpecular = glGetUniformLocation(program, "uMaterialSpecular");
+    location.uMaterialOpacity = glGetUniformLocation(program, "uMaterialOpacity");
+    location.uMaterialOpacitySamplerEnable = glGetUniformLocation(program, "uMaterialOpacitySamplerEnabled");
+    location.uMaterialOpacitySampler = glGetUniformLocation(program, "uMaterialOpacitySampler");
+    
+    location.uMaterialPbr = glGetUniformLocation(program, "uMaterialPbr");
+    location.uMaterialPbrTextures = glGetUniformLocation(program, "uMaterialPbrTextures");
+    location.uMaterialMetallicSampler = glGetUniformLocation(program, "uMaterialMetallicSampler");
+    location.uMaterialRoughnessSampler = glGetUniformLocation(program, "uMaterialRoughnessSampler");
+    location.uMaterialNormalSampler = glGetUniformLocation(program, "uMaterialNormalSampler");
+    location.uCameraPosition = glGetUniformLocation(program, "uCameraPosition");
     
     location.uLightAmbient = glGetUniformLocation(program, "uLightAmbient");
     location.uLightDirection = glGetUniformLocation(program, "uLightDirection");
     location.uLightDiffuse = glGetUniformLocation(program, "uLightDiffuse");
     
+    location.uClusterRanges = glGetUniformLocation(program, "uClusterRanges");
+    location.uClusterLightIndices = glGetUniformLocation(program, "uClusterLightIndices");
+    location.uLightData = glGetUniformLocation(program, "uLightData");
+    location.uClusterGrid = glGetUniformLocation(program, "uClusterGrid");
+    location.uClusterDepthParams = glGetUniformLocation(program, "uClusterDepthParams");
+    location.uViewportSize = glGetUniformLocation(program, "uViewportSize");
+    
+    location.uShadowMap = glGetUniformLocation(program, "uShadowMap");
+    location.uShadowMatrices = glGetUniformLocation(program, "uShadowMatrices");
+    location.uShadowSplits = glGetUniformLocation(program, "uShadowSplits");
+    
+    location.uIrradianceMap = glGetUniformLocation(program, "uIrradianceMap");
+    location.uPrefilteredMap = glGetUniformLocation(program, "uPrefilteredMap");
+    location.uPrefilteredMaxLod = glGetUniformLocation(program, "uPrefilteredMaxLod");
+    location.uBrdfLut = glGetUniformLocation(program, "uBrdfLut");
+    
     return location;
 }
 
 
+// meshes with at least this many triangles are split into meshlets, and culled per meshlet
+const unsigned int MeshletTriangleThreshold = 4096;
+
+
 struct Mesh {
     GLuint vao = 0;
+    
+    // positions and indices only, for the depth prepass
+    GLuint depthVao = 0;
+    
     GLenum primitiveType = GL_TRIANGLES;
     bool indexed = false;
     unsigned int count = 0;
@@ -516,6 +992,20 @@ struct Mesh {
     
     int material = -1;
     
+    // bounding sphere, in object space
+    glm::vec3 boundsCenter = {0.0f, 0.0f, 0.0f};
+    float boundsRadius = 0.0f;
+    
+    // meshlet decomposition, for large meshes only. the index buffer is ordered by meshlet
+    MeshletMesh meshlets;
+    
+    // vertex and index buffers referenced by the VAO
+    std::vector<GLuint> buffers;
+    
+    // rewritten every frame by the CPU skinning
+    GLuint coordBuffer = 0;
+    GLuint normalBuffer = 0;
+    
     Mesh() {}
     
     bool empty() const {
@@ -524,55 +1014,59 @@ struct Mesh {
 };
 
 
-Mesh createMeshVAO(const ShaderLocationMap &location, const aiMesh *mesh) {
-    if (! mesh) {
-        return {};
+// creates the VAO of a triangle list. normals and texCoords are optional, and indices may be empty for non indexed meshes.
+// deformable meshes use GL_DYNAMIC_DRAW positions and normals, and are never split in meshlets
+Mesh createMeshVAO(const ShaderLocationMap &location, const unsigned int vertexCount, const glm::vec3 *positions, const glm::vec3 *normals, const glm::vec2 *texCoords, std::vector<unsigned int> indices, const bool deformable = false) {
+    Mesh meshVAO;
+    
+    // nothing to draw. the mesh is left empty, and kept out of the instances of the scene
+    if (vertexCount == 0) {
+        return meshVAO;
     }
     
-    Mesh meshVAO;
+    assert(positions);
     
-    meshVAO.material = mesh->mMaterialIndex;
+    const GLenum usage = deformable ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
+    
+    glm::vec3 boxMin = positions[0], boxMax = positions[0];
+    
+    for (unsigned int i = 1; i < vertexCount; i++) {
+        boxMin = glm::min(boxMin, positions[i]);
+        boxMax = glm::max(boxMax, positions[i]);
+    }
+    
+    meshVAO.boundsCenter = (boxMin + boxMax) * 0.5f;
+    meshVAO.boundsRadius = glm::distance(boxMin, boxMax) * 0.5f;
     
-    GLuint coordBuffer = createBuffer(GL_ARRAY_BUFFER, mesh->mNumVertices * sizeof(aiVector3D), mesh->mVertices, GL_STATIC_DRAW);
+    GLuint coordBuffer = createBuffer(GL_ARRAY_BUFFER, vertexCount * sizeof(glm::vec3), positions, usage);
+    meshVAO.buffers.push_back(coordBuffer);
+    meshVAO.coordBuffer = coordBuffer;
     
     GLuint normalBuffer = 0;
-    if (mesh->HasNormals()) {
-        normalBuffer = createBuffer(GL_ARRAY_BUFFER, mesh->mNumVertices * sizeof(aiVector3D), mesh->mNormals, GL_STATIC_DRAW);
+    if (normals) {
+        normalBuffer = createBuffer(GL_ARRAY_BUFFER, vertexCount * sizeof(glm::vec3), normals, usage);
+        meshVAO.buffers.push_back(normalBuffer);
+        meshVAO.normalBuffer = normalBuffer;
     }
     
     GLuint texCoordBuffer = 0;
-    if (mesh->mTextureCoords[0]) {
-        assert(mesh->mNumUVComponents[0] == 2);
-        
-        std::vector<glm::vec2> texCoords;
-        texCoords.resize(mesh->mNumVertices);
-        
-        for (int i = 0; i < texCoords.size(); i++) {
-            const auto &tc = mesh->mTextureCoords[0][i];
-            
-            texCoords[i] = glm::vec2{tc.x, tc.y};
-        }
-        
-        texCoordBuffer = createBuffer(GL_ARRAY_BUFFER, texCoords, GL_STATIC_DRAW);
+    if (texCoords) {
+        texCoordBuffer = createBuffer(GL_ARRAY_BUFFER, vertexCount * sizeof(glm::vec2), texCoords, GL_STATIC_DRAW);
+        meshVAO.buffers.push_back(texCoordBuffer);
     }
     
     GLuint indexBuffer = 0;
-    if (mesh->HasFaces()) {
-        std::vector<unsigned int> indices;
-        
-        indices.reserve(mesh->mNumFaces);
-        
-        for (unsigned int j=0; j<mesh->mNumFaces; j++) {
-            const aiFace &face = mesh->mFaces[j];
-            
-            assert("This function requires the aiTriangulate postprocessing flag" && face.mNumIndices == 3);
+    if (! indices.empty()) {
+        if (!deformable && indices.size() / 3 >= MeshletTriangleThreshold) {
+            meshVAO.meshlets = buildMeshlets(positions, vertexCount, indices.data(), indices.size());
             
-            indices.push_back(face.mIndices[0]);
-            indices.push_back(face.mIndices[1]);
-            indices.push_back(face.mIndices[2]);
+            // only the meshlet ranges and bounds are needed from now on
+            indices = std::move(meshVAO.meshlets.indices);
+            meshVAO.meshlets.indices = {};
         }
         
         indexBuffer = createBuffer(GL_ELEMENT_ARRAY_BUFFER, indices, GL_STATIC_DRAW);
+        meshVAO.buffers.push_back(indexBuffer);
         
         meshVAO.indexDataType = GL_UNSIGNED_INT;
         meshVAO.indexed = true;
@@ -581,7 +1075,7 @@ Mesh createMeshVAO(const ShaderLocationMap &location, const aiMesh *mesh) {
     } else {
         meshVAO.indexDataType = GL_UNSIGNED_INT;
         meshVAO.indexed = false;
-        meshVAO.count = mesh->mNumVertices;
+        meshVAO.count = vertexCount;
         meshVAO.primitiveType = GL_TRIANGLES;
     }
     
@@ -612,6 +1106,17 @@ Mesh createMeshVAO(const ShaderLocationMap &location, const aiMesh *mesh) {
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
     }
     
+    glGenVertexArrays(1, &meshVAO.depthVao);
+    glBindVertexArray(meshVAO.depthVao);
+    
+    glEnableVertexAttribArray(location.coord);
+    glBindBuffer(GL_ARRAY_BUFFER, coordBuffer);
+    glVertexAttribPointer(location.coord, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    
+    if (indexBuffer) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    }
+    
     glBindVertexArray(0);
 
     assert(glGetError() == GL_NO_ERROR);
@@ -620,67 +1125,173 @@ Mesh createMeshVAO(const ShaderLocationMap &location, const aiMesh *mesh) {
 }
 
 
-class Scene {
-public:
-    explicit Scene(const aiScene *aiscene) {
-        visitNode(aiscene->mRootNode);
+Mesh createMeshVAO(const ShaderLocationMap &location, const aiMesh *mesh) {
+    if (! mesh) {
+        return {};
     }
     
-    std::vector<const aiNode*> getNodes() const {
-        return nodes;
-    }
+    static_assert(sizeof(aiVector3D) == sizeof(glm::vec3));
     
-private:
-    void visitNode(const aiNode *node) {
-        if (! node) {
-            return;
-        }
+    const auto positions = reinterpret_cast<const glm::vec3*>(mesh->mVertices);
+    const auto normals = mesh->HasNormals() ? reinterpret_cast<const glm::vec3*>(mesh->mNormals) : nullptr;
+    
+    std::vector<glm::vec2> texCoords;
+    if (mesh->mTextureCoords[0]) {
+        assert(mesh->mNumUVComponents[0] == 2);
+        
+        texCoords.resize(mesh->mNumVertices);
         
-        if (node->mNumMeshes > 0) {
-            nodes.push_back(node);
+        for (int i = 0; i < texCoords.size(); i++) {
+            const auto &tc = mesh->mTextureCoords[0][i];
+            
+            texCoords[i] = glm::vec2{tc.x, tc.y};
         }
+    }
+    
+    std::vector<unsigned int> indices;
+    if (mesh->HasFaces()) {
+        indices.reserve(mesh->mNumFaces * 3);
         
-        for (int i = 0; i < node->mNumChildren; i++) {
-            visitNode(node->mChildren[i]);
+        for (unsigned int j=0; j<mesh->mNumFaces; j++) {
+            const aiFace &face = mesh->mFaces[j];
+            
+            assert("This function requires the aiTriangulate postprocessing flag" && face.mNumIndices == 3);
+            
+            indices.push_back(face.mIndices[0]);
+            indices.push_back(face.mIndices[1]);
+            indices.push_back(face.mIndices[2]);
         }
     }
     
-private:
-    // nodes that have meshes
-    std::vector<const aiNode*> nodes;
-};
-
-
-inline static glm::mat4 Assimp2Glm(const aiMatrix4x4& from) {
-    return glm::mat4 (
-        (double)from.a1, (double)from.b1, (double)from.c1, (double)from.d1,
-        (double)from.a2, (double)from.b2, (double)from.c2, (double)from.d2,
-        (double)from.a3, (double)from.b3, (double)from.c3, (double)from.d3,
-        (double)from.a4, (double)from.b4, (double)from.c4, (double)from.d4
-    );
+    Mesh meshVAO = createMeshVAO(location, mesh->mNumVertices, positions, normals, texCoords.empty() ? nullptr : texCoords.data(), std::move(indices), mesh->HasBones());
+    
+    meshVAO.material = mesh->mMaterialIndex;
+    
+    return meshVAO;
 }
 
 
-inline static aiMatrix4x4 Glm2Assimp(const glm::mat4& from) {
-    return aiMatrix4x4(
-        from[0][0], from[1][0], from[2][0], from[3][0],
-        from[0][1], from[1][1], from[2][1], from[3][1],
-        from[0][2], from[1][2], from[2][2], from[3][2],
-        from[0][3], from[1][3], from[2][3], from[3][3]
-    );
+Mesh createMeshVAO(const ShaderLocationMap &location, const ChunkData &chunk, const int material) {
+    Mesh meshVAO = createMeshVAO(location, chunk.positions.size(), chunk.positions.data(), chunk.normals.data(), chunk.texCoords.data(), chunk.indices);
+    
+    meshVAO.material = material;
+    
+    return meshVAO;
 }
 
 
-glm::mat4 computeNodeTransformation(const aiNode* node) {
-    glm::mat4 transformation = glm::identity<glm::mat4>();
+// the float positions and normals without padding are uploaded straight from the mapped buffers, the
+// rest are converted first
+Mesh createMeshVAO(const ShaderLocationMap &location, const GltfPrimitive &primitive) {
+    std::vector<float> positionData, normalData, texCoordData;
+    
+    const glm::vec3 *positions = reinterpret_cast<const glm::vec3*>(primitive.positions.data);
+    if (! primitive.positions.isPackedFloat(3)) {
+        readAccessor(primitive.positions, 3, positionData);
+        positions = reinterpret_cast<const glm::vec3*>(positionData.data());
+    }
     
-    while (node != nullptr) {
-        transformation = Assimp2Glm(node->mTransformation) * transformation;
+    const glm::vec3 *normals = reinterpret_cast<const glm::vec3*>(primitive.normals.data);
+    if (! primitive.normals.empty() && ! primitive.normals.isPackedFloat(3)) {
+        readAccessor(primitive.normals, 3, normalData);
+        normals = reinterpret_cast<const glm::vec3*>(normalData.data());
+    }
+    
+    // glTF puts the origin of the texture coordinates at the top of the image, like Assimp flips them
+    const glm::vec2 *texCoords = nullptr;
+    if (! primitive.texCoords.empty()) {
+        readAccessor(primitive.texCoords, 2, texCoordData);
+        
+        for (size_t i = 1; i < texCoordData.size(); i += 2) {
+            texCoordData[i] = 1.0f - texCoordData[i];
+        }
+        
+        texCoords = reinterpret_cast<const glm::vec2*>(texCoordData.data());
+    }
+    
+    std::vector<unsigned int> indices;
+    if (! primitive.indices.empty()) {
+        readIndices(primitive.indices, indices);
+    }
+    
+    unsigned int vertexCount = primitive.positions.count;
+    
+    // glTF asks for flat normals when they are missing, so every triangle gets vertices of its own
+    std::vector<glm::vec3> flatPositions, flatNormals;
+    std::vector<glm::vec2> flatTexCoords;
+    
+    if (! normals) {
+        vertexCount = indices.empty() ? vertexCount : static_cast<unsigned int>(indices.size());
+        
+        for (unsigned int i = 0; i < vertexCount; i++) {
+            const unsigned int vertex = indices.empty() ? i : indices[i];
+            
+            flatPositions.push_back(positions[vertex]);
+            
+            if (texCoords) {
+                flatTexCoords.push_back(texCoords[vertex]);
+            }
+        }
         
-        node = node->mParent;
+        for (unsigned int i = 0; i + 2 < vertexCount; i += 3) {
+            const glm::vec3 normal = glm::cross(flatPositions[i + 1] - flatPositions[i], flatPositions[i + 2] - flatPositions[i]);
+            const float length = glm::length(normal);
+            
+            // degenerate triangles get any normal, they cover no pixels
+            flatNormals.insert(flatNormals.end(), 3, length > 0.0f ? normal / length : glm::vec3{0.0f, 0.0f, 1.0f});
+        }
+        
+        positions = flatPositions.data();
+        normals = flatNormals.data();
+        texCoords = texCoords ? flatTexCoords.data() : nullptr;
+        indices.clear();
     }
     
-    return transformation;
+    Mesh meshVAO = createMeshVAO(location, vertexCount, positions, normals, texCoords, std::move(indices));
+    
+    meshVAO.material = primitive.material;
+    
+    return meshVAO;
+}
+
+
+// uniform buffer binding point of the BonePalette block of gouraud_skinned.vert
+const GLuint BonePaletteBinding = 0;
+
+
+// adds the bone influences of a skinned mesh to its VAO, for the GPU skinning path
+void attachSkinAttributes(const ShaderLocationMap &location, Mesh &mesh, const SkinnedMesh &skin) {
+    assert(location.boneIndices >= 0);
+    assert(location.boneWeights >= 0);
+    
+    const GLuint boneIndexBuffer = createBuffer(GL_ARRAY_BUFFER, skin.boneIndices, GL_STATIC_DRAW);
+    const GLuint boneWeightBuffer = createBuffer(GL_ARRAY_BUFFER, skin.boneWeights, GL_STATIC_DRAW);
+    
+    mesh.buffers.push_back(boneIndexBuffer);
+    mesh.buffers.push_back(boneWeightBuffer);
+    
+    glBindVertexArray(mesh.vao);
+    
+    glEnableVertexAttribArray(location.boneIndices);
+    glBindBuffer(GL_ARRAY_BUFFER, boneIndexBuffer);
+    glVertexAttribIPointer(location.boneIndices, MaxBoneInfluences, GL_UNSIGNED_BYTE, 0, nullptr);
+    
+    glEnableVertexAttribArray(location.boneWeights);
+    glBindBuffer(GL_ARRAY_BUFFER, boneWeightBuffer);
+    glVertexAttribPointer(location.boneWeights, MaxBoneInfluences, GL_FLOAT, GL_FALSE, 0, nullptr);
+    
+    glBindVertexArray(0);
+    
+    assert(glGetError() == GL_NO_ERROR);
+}
+
+
+void destroyMeshVAO(Mesh &mesh) {
+    glDeleteVertexArrays(1, &mesh.vao);
+    glDeleteVertexArrays(1, &mesh.depthVao);
+    glDeleteBuffers(mesh.buffers.size(), mesh.buffers.data());
+    
+    mesh = {};
 }
 
 
@@ -721,6 +1332,50 @@ std::vector<Mesh> createMeshArray(const ShaderLocationMap &location, const aiSce
 }
 
 
+std::vector<Mesh> createMeshArray(const ShaderLocationMap &location, const GltfDocument &document) {
+    std::vector<Mesh> meshes;
+    meshes.reserve(document.primitives.size());
+    
+    for (const GltfPrimitive &primitive : document.primitives) {
+        meshes.push_back(createMeshVAO(location, primitive));
+    }
+    
+    return meshes;
+}
+
+
+// FNV-1a of the vertex and index data of the mesh, to tell which meshes changed when the scene is imported again
+std::uint64_t hashMesh(const aiMesh *mesh) {
+    std::uint64_t hash = 14695981039346656037ull;
+    
+    const auto add = [&hash](const void *data, const size_t size) {
+        const unsigned char *bytes = static_cast<const unsigned char*>(data);
+        
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    
+    add(mesh->mVertices, mesh->mNumVertices * sizeof(aiVector3D));
+    
+    if (mesh->HasNormals()) {
+        add(mesh->mNormals, mesh->mNumVertices * sizeof(aiVector3D));
+    }
+    
+    if (mesh->HasTextureCoords(0)) {
+        add(mesh->mTextureCoords[0], mesh->mNumVertices * sizeof(aiVector3D));
+    }
+    
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+        add(mesh->mFaces[i].mIndices, mesh->mFaces[i].mNumIndices * sizeof(unsigned int));
+    }
+    
+    add(&mesh->mMaterialIndex, sizeof(mesh->mMaterialIndex));
+    
+    return hash;
+}
+
+
 std::string loadTextFile(const std::string &file) {
     assert(!file.empty());
 
@@ -748,8 +1403,20 @@ GLuint createProgram(const std::string &vertFile, const std::string &fragFile) {
         createShader(loadTextFile(vertFile), GL_VERTEX_SHADER), 
         createShader(loadTextFile(fragFile), GL_FRAGMENT_SHADER)
     };
+    
+    // a reloaded shader may not compile, the caller keeps its previous program then
+    GLuint program = 0;
+    
+    if (std::all_of(shaders.begin(), shaders.end(), [](const GLuint shader) { return shader != 0; })) {
+        program = createShaderProgram(shaders);
+    }
+    
+    // the program keeps the attached shaders alive
+    for (const GLuint shader : shaders) {
+        glDeleteShader(shader);
+    }
 
-    return createShaderProgram(shaders);
+    return program;
 }
 
 
@@ -783,208 +1450,2667 @@ std::vector<GLuint> createTextureArray(const aiScene* scene, const std::string&
 }
 
 
-int main(int argc, char **argv) {
-    TextureRepository textureRepository;
+// replays command lists on the GL context. uniform slots are mapped to the locations of the program in use
+class GLCommandExecutor {
+public:
+    void addProgram(const GLuint program, const ShaderLocationMap &location) {
+        std::array<GLint, size_t(UniformSlot::Count)> &slots = programs[program];
+        
+        slots[size_t(UniformSlot::Model)] = location.uModel;
+        slots[size_t(UniformSlot::View)] = location.uView;
+        slots[size_t(UniformSlot::Proj)] = location.uProj;
+        slots[size_t(UniformSlot::MaterialAmbient)] = location.uMaterialAmbient;
+        slots[size_t(UniformSlot::MaterialDiffuse)] = location.uMaterialDiffuse;
+        slots[size_t(UniformSlot::MaterialSpecular)] = location.uMaterialSpecular;
+        slots[size_t(UniformSlot::MaterialDiffuseSamplerEnable)] = location.uMaterialDiffuseSamplerEnable;
+        slots[size_t(UniformSlot::MaterialDiffuseSampler)] = location.uMaterialDiffuseSampler;
+        slots[size_t(UniformSlot::MaterialDiffuseLayer)] = location.uMaterialDiffuseLayer;
+        slots[size_t(UniformSlot::MaterialOpacity)] = location.uMaterialOpacity;
+        slots[size_t(UniformSlot::MaterialOpacitySamplerEnable)] = location.uMaterialOpacitySamplerEnable;
+        slots[size_t(UniformSlot::MaterialPbr)] = location.uMaterialPbr;
+        slots[size_t(UniformSlot::MaterialPbrTextures)] = location.uMaterialPbrTextures;
+        slots[size_t(UniformSlot::CameraPosition)] = location.uCameraPosition;
+        slots[size_t(UniformSlot::LightDirection)] = location.uLightDirection;
+        slots[size_t(UniformSlot::LightAmbient)] = location.uLightAmbient;
+        slots[size_t(UniformSlot::LightDiffuse)] = location.uLightDiffuse;
+        slots[size_t(UniformSlot::ClusterGrid)] = location.uClusterGrid;
+        slots[size_t(UniformSlot::ClusterDepthParams)] = location.uClusterDepthParams;
+        slots[size_t(UniformSlot::ViewportSize)] = location.uViewportSize;
+        slots[size_t(UniformSlot::ShadowMatrices)] = location.uShadowMatrices;
+        slots[size_t(UniformSlot::ShadowSplits)] = location.uShadowSplits;
+    }
     
-    // Create an instance of the Importer class
-    Assimp::Importer importer;
-    // And have it read the given file with some example postprocessing
-    // Usually - if speed is not the most important aspect for you - you'll
-    // propably to request more postprocessing than we do in this example.
-    const auto flags =  aiProcess_Triangulate |
-                        aiProcess_JoinIdenticalVertices |
-                        aiProcess_GenNormals |
-                        // aiProcess_CalcTangentSpace |
-                        // aiProcess_SortByPType |
-                        aiProcess_ValidateDataStructure;
-
-    const std::string sceneFilePath = argv[1];
-    const std::string sceneFileParentPath = parent_path(sceneFilePath);
-    const aiScene *scene = importer.ReadFile(sceneFilePath, flags);
-
-    // If the import failed, report it
-    if (!scene) {
-        std::cout << importer.GetErrorString() << std::endl;
-
-        return EXIT_FAILURE;
+    void removeProgram(const GLuint program) {
+        programs.erase(program);
     }
-
-    if (! scene->HasMeshes()) {
-        std::cout << "scene doesn't have meshes" << std::endl;
-
-        return EXIT_FAILURE;
+    
+    void execute(const CommandList &commands) {
+        // the textures are also bound outside of the command lists, the bindings are only known within one
+        boundTextures.fill(UnknownTexture);
+        boundTextureArrays.fill(UnknownTexture);
+        boundBufferTextures.fill(UnknownTexture);
+        
+        for (const Command &command : commands.getCommands()) {
+            const std::uint32_t *data = commands.getData(command);
+            
+            switch (command.type) {
+            case CommandType::UseProgram:
+                assert(programs.count(command.handle));
+                
+                glUseProgram(command.handle);
+                slots = &programs[command.handle];
+                break;
+                
+            case CommandType::UniformFloat:
+                glUniform1fv(getLocation(command), 1, reinterpret_cast<const float*>(data));
+                break;
+                
+            case CommandType::UniformInt:
+                glUniform1iv(getLocation(command), 1, reinterpret_cast<const GLint*>(data));
+                break;
+                
+            case CommandType::UniformVec3:
+                glUniform3fv(getLocation(command), 1, reinterpret_cast<const float*>(data));
+                break;
+                
+            case CommandType::UniformVec4:
+                glUniform4fv(getLocation(command), 1, reinterpret_cast<const float*>(data));
+                break;
+                
+            case CommandType::UniformMat4:
+                glUniformMatrix4fv(getLocation(command), 1, GL_FALSE, reinterpret_cast<const float*>(data));
+                break;
+                
+            case CommandType::UniformMat4Array:
+                glUniformMatrix4fv(getLocation(command), command.count, GL_FALSE, reinterpret_cast<const float*>(data));
+                break;
+                
+            case CommandType::BindTexture:
+                bindTexture(GL_TEXTURE_2D, boundTextures, command);
+                break;
+            
+            case CommandType::BindTextureArray:
+                bindTexture(GL_TEXTURE_2D_ARRAY, boundTextureArrays, command);
+                break;
+                
+            case CommandType::BindBufferTexture:
+                bindTexture(GL_TEXTURE_BUFFER, boundBufferTextures, command);
+                break;
+                
+            case CommandType::Enable:
+                glEnable(getCapability(command));
+                break;
+                
+            case CommandType::Disable:
+                glDisable(getCapability(command));
+                break;
+                
+            case CommandType::DepthFunc:
+                glDepthFunc(getDepthFunc(command));
+                break;
+                
+            case CommandType::DepthWrite:
+                glDepthMask(command.slot ? GL_TRUE : GL_FALSE);
+                break;
+                
+            case CommandType::ColorWrite: {
+                const GLboolean enabled = command.slot ? GL_TRUE : GL_FALSE;
+                
+                glColorMask(enabled, enabled, enabled, enabled);
+                break;
+            }
+                
+            case CommandType::DepthBias: {
+                const float *bias = reinterpret_cast<const float*>(data);
+                
+                if (bias[0] != 0.0f || bias[1] != 0.0f) {
+                    glEnable(GL_POLYGON_OFFSET_FILL);
+                    glPolygonOffset(bias[0], bias[1]);
+                }
+                else {
+                    glDisable(GL_POLYGON_OFFSET_FILL);
+                }
+                break;
+            }
+                
+            case CommandType::BindFramebuffer:
+                glBindFramebuffer(GL_FRAMEBUFFER, command.handle);
+                glViewport(0, 0, data[0], data[1]);
+                break;
+                
+            case CommandType::Viewport:
+                // (x, y, width, height)
+                glViewport(data[0], data[1], data[2], data[3]);
+                glScissor(data[0], data[1], data[2], data[3]);
+                break;
+                
+            case CommandType::BlitDepth:
+                // (destination, width, height)
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, command.handle);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, data[0]);
+                glBlitFramebuffer(0, 0, data[1], data[2], 0, 0, data[1], data[2], GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+                break;
+                
+            case CommandType::Clear: {
+                const float *color = reinterpret_cast<const float*>(data);
+                
+                glClearColor(color[0], color[1], color[2], color[3]);
+                glClear(((command.slot & 1) ? GL_COLOR_BUFFER_BIT : 0) | ((command.slot & 2) ? GL_DEPTH_BUFFER_BIT : 0));
+                break;
+            }
+                
+            case CommandType::UpdateBuffer:
+                // the copy target works for any kind of buffer
+                glBindBuffer(GL_COPY_WRITE_BUFFER, command.handle);
+                glBufferSubData(GL_COPY_WRITE_BUFFER, 0, command.count, data);
+                break;
+                
+            case CommandType::BindUniformBuffer:
+                glBindBufferBase(GL_UNIFORM_BUFFER, command.slot, command.handle);
+                break;
+                
+            case CommandType::DrawArrays:
+                glBindVertexArray(command.handle);
+                glDrawArrays(command.primitive, 0, command.count);
+                break;
+                
+            case CommandType::DrawElements:
+                glBindVertexArray(command.handle);
+                glDrawElements(command.primitive, command.count, command.indexType, nullptr);
+                break;
+                
+            case CommandType::MultiDrawElements: {
+                const size_t indexSize = command.indexType == GL_UNSIGNED_INT ? 4 : command.indexType == GL_UNSIGNED_SHORT ? 2 : 1;
+                
+                drawCounts.clear();
+                drawOffsets.clear();
+                
+                // (offset, count) pairs
+                for (std::uint32_t i = 0; i < command.count; i++) {
+                    drawOffsets.push_back(reinterpret_cast<const void*>(data[i * 2] * indexSize));
+                    drawCounts.push_back(data[i * 2 + 1]);
+                }
+                
+                glBindVertexArray(command.handle);
+                glMultiDrawElements(command.primitive, drawCounts.data(), command.indexType, drawOffsets.data(), command.count);
+                break;
+            }
+            }
+        }
     }
-
-    Scene sceneNodes {scene};
     
-    for (int i = 0; i<scene->mNumMeshes; i++) {
-        std::cout << "Mesh: " << scene->mMeshes[i]->mName.C_Str() << std::endl;
+private:
+    GLint getLocation(const Command &command) const {
+        assert(slots);
+        
+        return (*slots)[command.slot];
     }
     
-    if (scene->mNumMeshes <= 0) {
-        std::cout << "The object doesn't have any meshes" << std::endl;
-        return EXIT_FAILURE;
+    static GLenum getDepthFunc(const Command &command) {
+        switch (DepthFunc(command.slot)) {
+        case DepthFunc::Less: return GL_LESS;
+        case DepthFunc::LessEqual: return GL_LEQUAL;
+        case DepthFunc::Equal: return GL_EQUAL;
+        }
+        
+        return GL_LESS;
     }
-
-    glfwInit();
-
-    const auto monitor = glfwGetPrimaryMonitor();
-    const GLFWvidmode* mode = glfwGetVideoMode(monitor);
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
-    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_NATIVE_CONTEXT_API);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_TRUE);
-    glfwWindowHint(GLFW_DEPTH_BITS, 24);
-    glfwWindowHint(GLFW_RED_BITS, mode->redBits);
-    glfwWindowHint(GLFW_GREEN_BITS, mode->greenBits);
-    glfwWindowHint(GLFW_BLUE_BITS, mode->blueBits);
-    glfwWindowHint(GLFW_REFRESH_RATE, mode->refreshRate);
     
-    GLFWwindow* window = glfwCreateWindow(mode->width, mode->height, "3dgraphics", nullptr, nullptr);
+    static GLenum getCapability(const Command &command) {
+        switch (RenderState(command.slot)) {
+        case RenderState::DepthTest: return GL_DEPTH_TEST;
+        case RenderState::CullFace: return GL_CULL_FACE;
+        case RenderState::Blend: return GL_BLEND;
+        case RenderState::ScissorTest: return GL_SCISSOR_TEST;
+        }
+        
+        return GL_NONE;
+    }
     
-    if (!window) {
-        std::cout << "Cant open a Window" << std::endl;
+    // skips the binds of the texture already bound to the unit, as the draws sharing a texture array do
+    template<size_t UnitCount>
+    static void bindTexture(const GLenum target, std::array<GLuint, UnitCount> &bound, const Command &command) {
+        assert(command.slot < UnitCount);
         
-        const char description[1024] = {};
+        if (bound[command.slot] == command.handle) {
+            return;
+        }
+        
+        glActiveTexture(GL_TEXTURE0 + command.slot);
+        glBindTexture(target, command.handle);
+        bound[command.slot] = command.handle;
+    }
+
+private:
+    static const GLuint UnknownTexture = 0xFFFFFFFF;
+    static const size_t TextureUnitCount = 16;
+    
+    std::map<GLuint, std::array<GLint, size_t(UniformSlot::Count)>> programs;
+    const std::array<GLint, size_t(UniformSlot::Count)> *slots = nullptr;
+    
+    // the textures bound by the command list being executed, per unit
+    std::array<GLuint, TextureUnitCount> boundTextures = {};
+    std::array<GLuint, TextureUnitCount> boundTextureArrays = {};
+    std::array<GLuint, TextureUnitCount> boundBufferTextures = {};
+    
+    // scratch storage for the multi draws
+    std::vector<GLsizei> drawCounts;
+    std::vector<const void*> drawOffsets;
+};
+
+
+// lights without attenuation, and the random lights, reach this far
+const float DefaultLightRange = 10.0f;
+
+// three texels each, they must fit with the lights of the scene in the smallest buffer texture the GL allows (65536 texels)
+const size_t MaxRandomLights = 16384;
+
+const float CameraNearPlane = 0.1f;
+const float CameraFarPlane = 100.0f;
+
+
+// per frame inputs of the render passes
+struct FrameParams {
+    glm::mat4 proj = glm::identity<glm::mat4>();
+    glm::mat4 view = glm::identity<glm::mat4>();
+    glm::vec3 cameraPosition = {0.0f, 0.0f, 0.0f};
+    
+    // (tilesX, tilesY, slices, 0), (slice scale, slice bias, 0, 0) and (width, height, x, y) of the viewport
+    glm::vec4 clusterGrid = {0.0f, 0.0f, 0.0f, 0.0f};
+    glm::vec4 clusterDepthParams = {0.0f, 0.0f, 0.0f, 0.0f};
+    glm::vec4 viewportSize = {0.0f, 0.0f, 0.0f, 0.0f};
+    
+    // world to shadow map transforms of the cascades, and their far splits. zero splits disable the shadows
+    std::array<glm::mat4, 4> shadowMatrices = {};
+    glm::vec4 shadowSplits = {0.0f, 0.0f, 0.0f, 0.0f};
+};
+
+
+void recordFrameUniforms(CommandList &commands, const FrameParams &frame, const Light &light) {
+    commands.setUniform(UniformSlot::Proj, frame.proj);
+    commands.setUniform(UniformSlot::View, frame.view);
+    commands.setUniform(UniformSlot::CameraPosition, frame.cameraPosition);
+    
+    commands.setUniform(UniformSlot::LightDirection, light.direction);
+    commands.setUniform(UniformSlot::LightAmbient, light.ambient);
+    commands.setUniform(UniformSlot::LightDiffuse, light.diffuse);
+    
+    commands.setUniform(UniformSlot::ClusterGrid, frame.clusterGrid);
+    commands.setUniform(UniformSlot::ClusterDepthParams, frame.clusterDepthParams);
+    commands.setUniform(UniformSlot::ViewportSize, frame.viewportSize);
+    
+    commands.setUniform(UniformSlot::ShadowMatrices, frame.shadowMatrices.data(), frame.shadowMatrices.size());
+    commands.setUniform(UniformSlot::ShadowSplits, frame.shadowSplits);
+}
+
+
+// an opaque draw of the frame
+struct DrawItem {
+    // view space depth of the bounds center
+    float depth = 0.0f;
+    
+    const Mesh *mesh = nullptr;
+    const glm::mat4 *model = nullptr;
+    
+    // index of the skin of the mesh, or -1
+    int skin = -1;
+};
+
+
+// the range of draws recorded by a job, when the draws are split evenly between the jobs
+std::pair<size_t, size_t> getJobRange(const size_t job, const size_t jobCount, const size_t drawCount) {
+    return {drawCount * job / jobCount, drawCount * (job + 1) / jobCount};
+}
+
+
+float getMaxScale(const glm::mat4 &transform) {
+    return std::sqrt(std::max({
+        glm::dot(glm::vec3{transform[0]}, glm::vec3{transform[0]}),
+        glm::dot(glm::vec3{transform[1]}, glm::vec3{transform[1]}),
+        glm::dot(glm::vec3{transform[2]}, glm::vec3{transform[2]})
+    }));
+}
+
+
+// frames averaged by the --frame-stats output
+const unsigned int FrameStatsInterval = 120;
+
+
+// measures the GPU time of the frames with timer queries, read back a few frames later so they don't stall
+class GpuFrameTimer {
+public:
+    GpuFrameTimer() {
+        glGenQueries(QueryCount, queries.data());
+    }
+    
+    ~GpuFrameTimer() {
+        glDeleteQueries(QueryCount, queries.data());
+    }
+    
+    void begin() {
+        glBeginQuery(GL_TIME_ELAPSED, queries[frame % QueryCount]);
+    }
+    
+    void end() {
+        glEndQuery(GL_TIME_ELAPSED);
+        frame++;
+        
+        // the oldest query, reused by the next frame
+        if (frame >= QueryCount) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[frame % QueryCount], GL_QUERY_RESULT, &elapsed);
+            
+            totalElapsed += elapsed;
+            sampleCount++;
+        }
+    }
+    
+    unsigned int getSampleCount() const {
+        return sampleCount;
+    }
+    
+    // average of the samples since the last call, in milliseconds
+    double takeAverage() {
+        const double average = sampleCount ? double(totalElapsed) / sampleCount / 1e6 : 0.0;
+        
+        totalElapsed = 0;
+        sampleCount = 0;
+        
+        return average;
+    }
+    
+private:
+    static const unsigned int QueryCount = 4;
+    
+    std::array<GLuint, QueryCount> queries = {};
+    unsigned int frame = 0;
+    
+    GLuint64 totalElapsed = 0;
+    unsigned int sampleCount = 0;
+};
+
+
+// frames between two calibrations of the GPU clock against the CPU one
+const unsigned int ClockCalibrationInterval = 120;
+
+
+// limits the frames queued ahead of the GPU, with a fence after the swap of each one. a timestamp query next to
+// the fence tells when the GPU got past the swap, which is the closest the CPU sees to the photons: the latency
+// of a frame is measured from the sampling of its input to that time
+class FrameFences {
+public:
+    explicit FrameFences(const unsigned int maxFramesInFlight) : maxFramesInFlight(maxFramesInFlight) {}
+    
+    ~FrameFences() {
+        for (const PendingFrame &frame : pending) {
+            glDeleteSync(frame.fence);
+            freeQueries.push_back(frame.query);
+        }
+        
+        glDeleteQueries(GLsizei(freeQueries.size()), freeQueries.data());
+    }
+    
+    FrameFences(const FrameFences&) = delete;
+    FrameFences& operator=(const FrameFences&) = delete;
+    
+    // right after the swap. collects the frames the GPU finished, then waits for the oldest ones until the next
+    // frame fits. their latencies go to the stats, when there are any
+    void endFrame(const std::chrono::steady_clock::time_point inputTime, LatencyStats *latency) {
+        if (frameCount++ % ClockCalibrationInterval == 0) {
+            calibrate();
+        }
+        
+        PendingFrame frame;
+        frame.inputTime = inputTime;
+        frame.query = acquireQuery();
+        
+        glQueryCounter(frame.query, GL_TIMESTAMP);
+        frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        
+        pending.push_back(frame);
+        
+        while (!pending.empty()) {
+            const bool full = pending.size() >= maxFramesInFlight;
+            const auto start = std::chrono::steady_clock::now();
+            const GLenum status = glClientWaitSync(pending.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, full ? GL_TIMEOUT_IGNORED : 0);
+            
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                break;
+            }
+            
+            if (full) {
+                stallMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+            
+            retire(latency);
+        }
+    }
+    
+    // time spent waiting for the frames in flight since the last call
+    double takeStallMilliseconds() {
+        const double stall = stallMilliseconds;
+        stallMilliseconds = 0.0;
+        
+        return stall;
+    }
+
+private:
+    struct PendingFrame {
+        GLsync fence = nullptr;
+        GLuint query = 0;
+        std::chrono::steady_clock::time_point inputTime;
+    };
+    
+    GLuint acquireQuery() {
+        GLuint query = 0;
+        
+        if (freeQueries.empty()) {
+            glGenQueries(1, &query);
+        }
+        else {
+            query = freeQueries.back();
+            freeQueries.pop_back();
+        }
+        
+        return query;
+    }
+    
+    // the GPU clock has its own origin, and drifts slowly away from the CPU one
+    void calibrate() {
+        GLint64 gpuTime = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+        
+        gpuEpoch = std::chrono::steady_clock::now() - std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(gpuTime));
+    }
+    
+    // the oldest frame, once its fence signaled. its timestamp is available by then
+    void retire(LatencyStats *latency) {
+        const PendingFrame &frame = pending.front();
+        
+        if (latency) {
+            GLuint64 timestamp = 0;
+            glGetQueryObjectui64v(frame.query, GL_QUERY_RESULT, &timestamp);
+            
+            const auto swapTime = gpuEpoch + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(timestamp));
+            latency->addSample(swapTime - frame.inputTime);
+        }
+        
+        glDeleteSync(frame.fence);
+        freeQueries.push_back(frame.query);
+        pending.pop_front();
+    }
+
+private:
+    const unsigned int maxFramesInFlight;
+    
+    std::deque<PendingFrame> pending;
+    std::vector<GLuint> freeQueries;
+    
+    std::chrono::steady_clock::time_point gpuEpoch;
+    unsigned int frameCount = 0;
+    
+    double stallMilliseconds = 0.0;
+};
+
+
+// frames read back ahead of the one being mapped, by --capture
+const unsigned int CaptureBufferCount = 3;
+
+
+// reads the frames back into a ring of pixel buffers. each one is mapped a few frames later, once its fence
+// signals, so the readback doesn't stall the pipeline unless the GPU is a whole ring behind. the mapped pixels
+// are copied to the encoder, which writes them on its own threads
+class FrameCapture {
+public:
+    FrameCapture(const GLsizei width, const GLsizei height, const FrameEncoderParams &params) : width(width), height(height), encoder(params) {
+        glGenBuffers(CaptureBufferCount, buffers.data());
+        
+        for (const GLuint buffer : buffers) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, getFrameSize(), nullptr, GL_STREAM_READ);
+        }
+        
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    
+    ~FrameCapture() {
+        finish();
+        glDeleteBuffers(CaptureBufferCount, buffers.data());
+    }
+    
+    bool isOpen() const {
+        return encoder.isOpen();
+    }
+    
+    size_t getFrameCount() const {
+        return frame;
+    }
+    
+    // queues the readback of the back buffer, once the frame is rendered and before the swap
+    void capture() {
+        if (frame - retired == CaptureBufferCount) {
+            retire();
+        }
+        
+        const unsigned int slot = frame % CaptureBufferCount;
+        
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glReadBuffer(GL_BACK);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[slot]);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frame++;
+        
+        // the readbacks the GPU already finished are handed over without waiting
+        while (retired < frame) {
+            const GLenum status = glClientWaitSync(fences[retired % CaptureBufferCount], 0, 0);
+            
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                break;
+            }
+            
+            retire();
+        }
+    }
+    
+    // hands over every pending readback, waiting for the GPU, and waits for the encoder to write them
+    void finish() {
+        while (retired < frame) {
+            retire();
+        }
+        
+        encoder.flush();
+    }
+    
+    void printStats() {
+        const FrameEncoderStats stats = encoder.getStats();
+        
+        std::cout << "Captured " << frame << " frames: " << stats.submitted << " submitted, " << stats.encoded << " encoded, "
+            << stats.dropped << " dropped, " << stats.failed << " failed, " << stallMilliseconds << " ms waiting for the readbacks" << std::endl;
+    }
+
+private:
+    GLsizeiptr getFrameSize() const {
+        return GLsizeiptr(width) * height * 4;
+    }
+    
+    // maps the oldest pending readback
+    void retire() {
+        const unsigned int slot = retired % CaptureBufferCount;
+        const auto start = std::chrono::steady_clock::now();
+        
+        glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fences[slot]);
+        fences[slot] = nullptr;
+        retired++;
+        
+        stallMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[slot]);
+        
+        const void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, getFrameSize(), GL_MAP_READ_BIT);
+        
+        // when the encoder is too far behind, the frame is either dropped or waited for
+        std::vector<std::uint8_t> pixels;
+        const bool accepted = mapped && encoder.acquireBuffer(size_t(getFrameSize()), pixels);
+        
+        if (accepted) {
+            std::memcpy(pixels.data(), mapped, pixels.size());
+        }
+        
+        if (mapped) {
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        
+        if (accepted) {
+            encoder.submit(unsigned(width), unsigned(height), std::move(pixels));
+        }
+    }
+
+private:
+    const GLsizei width;
+    const GLsizei height;
+    
+    FrameEncoder encoder;
+    
+    std::array<GLuint, CaptureBufferCount> buffers = {};
+    std::array<GLsync, CaptureBufferCount> fences = {};
+    
+    // frames read back, and the ones handed over to the encoder
+    size_t frame = 0;
+    size_t retired = 0;
+    
+    double stallMilliseconds = 0.0;
+};
+
+
+// state of a single recording job
+struct DrawContext {
+    glm::mat4 viewProj = glm::identity<glm::mat4>();
+    glm::vec3 cameraPosition = {0.0f, 0.0f, 0.0f};
+    bool coneCulling = false;
+    
+    // scratch storage for the meshlet culling and the skinning, reused between draws
+    std::vector<std::uint8_t> meshletVisibility;
+    std::vector<MeshletRange> meshletRanges;
+    std::vector<float> bonePalette;
+    std::vector<glm::vec3> skinnedPositions;
+    std::vector<glm::vec3> skinnedNormals;
+};
+
+
+// records the draw of the mesh with the given VAO, either mesh.vao or mesh.depthVao.
+// the model matrix must be already set, it's only used for culling here
+void recordMeshDraw(CommandList &commands, DrawContext &context, const Mesh &mesh, const GLuint vao, const glm::mat4 &model) {
+    // the culling must be deterministic, the prepass and the shading pass have to draw the same meshlets
+    if (! mesh.meshlets.empty()) {
+        MeshletCullParams cullParams;
+        cullParams.frustum = extractFrustum(context.viewProj * model);
+        cullParams.cameraPosition = glm::inverse(model) * glm::vec4{context.cameraPosition, 1.0f};
+        cullParams.coneCulling = context.coneCulling;
+        
+        if (cullMeshlets(mesh.meshlets.bounds, cullParams, context.meshletVisibility) == 0) {
+            return;
+        }
+        
+        buildMeshletRanges(mesh.meshlets.meshlets, context.meshletVisibility, context.meshletRanges);
+        
+        commands.multiDrawElements(vao, mesh.primitiveType, mesh.indexDataType, context.meshletRanges);
+    }
+    else if (mesh.indexed) {
+        commands.drawElements(vao, mesh.primitiveType, mesh.indexDataType, mesh.count);
+    }
+    else {
+        commands.drawArrays(vao, mesh.primitiveType, mesh.count);
+    }
+}
+
+
+// texture units of the metallic-roughness materials, besides the base color in unit 0
+const std::uint8_t MaterialMetallicUnit = 5;
+const std::uint8_t MaterialRoughnessUnit = 6;
+const std::uint8_t MaterialNormalUnit = 7;
+
+// the base color of the materials packed into texture arrays
+const std::uint8_t MaterialDiffuseArrayUnit = 11;
+
+// the opacity map of the transparent materials
+const std::uint8_t MaterialOpacityUnit = 12;
+
+
+// records the material setup and the draw of the mesh
+void recordMesh(CommandList &commands, DrawContext &context, const Mesh &mesh, const Material &material, const glm::mat4 &model) {
+    commands.setUniform(UniformSlot::MaterialAmbient, material.ambient);
+    commands.setUniform(UniformSlot::MaterialDiffuse, material.diffuse);
+    commands.setUniform(UniformSlot::MaterialSpecular, material.specular);
+    
+    // the draws sharing a texture array only change the layer
+    if (material.diffuseArray) {
+        commands.bindTextureArray(MaterialDiffuseArrayUnit, material.diffuseArray);
+        commands.setUniform(UniformSlot::MaterialDiffuseSamplerEnable, 2.0f);
+        commands.setUniform(UniformSlot::MaterialDiffuseLayer, material.diffuseLayer);
+    }
+    else {
+        commands.bindTexture(0, material.diffuseTexture);
+        commands.setUniform(UniformSlot::MaterialDiffuseSamplerEnable, material.diffuseTexture ? 1.0f : 0.0f);
+        
+        if (material.diffuseTexture) {
+            commands.setUniform(UniformSlot::MaterialDiffuseSampler, 0);
+        }
+    }
+    
+    commands.setUniform(UniformSlot::MaterialOpacity, material.opacity);
+    commands.setUniform(UniformSlot::MaterialOpacitySamplerEnable, material.opacityTexture ? 1.0f : 0.0f);
+    
+    if (material.opacityTexture) {
+        commands.bindTexture(MaterialOpacityUnit, material.opacityTexture);
+    }
+    
+    commands.setUniform(UniformSlot::MaterialPbr, glm::vec4{material.pbr ? 1.0f : 0.0f, material.metallic, material.roughness, 0.0f});
+    
+    if (material.pbr) {
+        commands.setUniform(UniformSlot::MaterialPbrTextures, glm::vec4{
+            material.metallicTexture ? 1.0f : 0.0f, material.roughnessTexture ? 1.0f : 0.0f, material.normalTexture ? 1.0f : 0.0f, 0.0f
+        });
+        
+        commands.bindTexture(MaterialMetallicUnit, material.metallicTexture);
+        commands.bindTexture(MaterialRoughnessUnit, material.roughnessTexture);
+        commands.bindTexture(MaterialNormalUnit, material.normalTexture);
+    }
+    
+    recordMeshDraw(commands, context, mesh, mesh.vao, model);
+}
+
+
+std::vector<Material> createMaterialArray(TextureRepository &textureRepository, const std::vector<TiledMaterial> &tiledMaterials) {
+    std::vector<Material> materials;
+    
+    for (const TiledMaterial &tiledMaterial : tiledMaterials) {
+        Material material;
+        
+        material.ambient = tiledMaterial.ambient;
+        material.diffuse = tiledMaterial.diffuse;
+        material.specular = tiledMaterial.specular;
+        material.diffuseTexture = textureRepository.getOrCreate(tiledMaterial.diffuseTexture, true);
+        
+        materials.push_back(material);
+    }
+    
+    return materials;
+}
+
+
+// texture units of the clustered lighting data, the shadow maps and the image based lighting. the materials
+// use the units below, MaterialMetallicUnit to MaterialNormalUnit, MaterialDiffuseArrayUnit and MaterialOpacityUnit
+const GLint ClusterRangesUnit = 1;
+const GLint ClusterLightIndicesUnit = 2;
+const GLint LightDataUnit = 3;
+const GLint ShadowMapUnit = 4;
+const GLint IrradianceUnit = 8;
+const GLint PrefilteredUnit = 9;
+const GLint BrdfLutUnit = 10;
+
+
+struct BufferTexture {
+    GLuint buffer = 0;
+    GLuint texture = 0;
+    GLenum format = GL_R32UI;
+};
+
+
+BufferTexture createBufferTexture(const GLenum format) {
+    BufferTexture bufferTexture;
+    bufferTexture.format = format;
+    
+    glGenBuffers(1, &bufferTexture.buffer);
+    glGenTextures(1, &bufferTexture.texture);
+    
+    return bufferTexture;
+}
+
+
+// replaces the contents of the buffer. the previous storage is orphaned, so the frames in flight keep theirs
+void updateBufferTexture(const BufferTexture &bufferTexture, const void *data, const size_t size) {
+    // empty buffers can't be attached to a texture
+    const std::uint32_t zeros[4] = {};
+    
+    glBindBuffer(GL_TEXTURE_BUFFER, bufferTexture.buffer);
+    glBufferData(GL_TEXTURE_BUFFER, size ? size : sizeof(zeros), size ? data : zeros, GL_STREAM_DRAW);
+    
+    glBindTexture(GL_TEXTURE_BUFFER, bufferTexture.texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, bufferTexture.format, bufferTexture.buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+
+void setLightingSamplers(const GLuint program, const ShaderLocationMap &location) {
+    glUseProgram(program);
+    glUniform1i(location.uClusterRanges, ClusterRangesUnit);
+    glUniform1i(location.uClusterLightIndices, ClusterLightIndicesUnit);
+    glUniform1i(location.uLightData, LightDataUnit);
+    glUniform1i(location.uShadowMap, ShadowMapUnit);
+    glUniform1i(location.uMaterialMetallicSampler, MaterialMetallicUnit);
+    glUniform1i(location.uMaterialRoughnessSampler, MaterialRoughnessUnit);
+    glUniform1i(location.uMaterialNormalSampler, MaterialNormalUnit);
+    glUniform1i(location.uMaterialDiffuseArray, MaterialDiffuseArrayUnit);
+    glUniform1i(location.uMaterialOpacitySampler, MaterialOpacityUnit);
+    glUniform1i(location.uIrradianceMap, IrradianceUnit);
+    glUniform1i(location.uPrefilteredMap, PrefilteredUnit);
+    glUniform1f(location.uPrefilteredMaxLod, float(IblParams{}.prefilteredLevels - 1));
+    glUniform1i(location.uBrdfLut, BrdfLutUnit);
+    glUseProgram(0);
+}
+
+
+// slope scaled bias of the shadow casters, against shadow acne
+const float ShadowDepthBiasFactor = 2.0f;
+const float ShadowDepthBiasUnits = 4.0f;
+
+
+// depth texture arrays with a layer per cascade. when some casters move, the static ones are cached in a
+// separate array and copied under the moving ones every frame. otherwise they are cached in the shadow maps themselves
+struct ShadowMaps {
+    GLuint texture = 0;
+    GLuint staticTexture = 0;
+    
+    // one per layer
+    std::vector<GLuint> framebuffers;
+    std::vector<GLuint> staticFramebuffers;
+    
+    GLsizei resolution = 0;
+};
+
+
+GLuint createDepthTextureArray(const GLsizei resolution, const GLsizei layers, const bool compare) {
+    GLuint texture = 0;
+    
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, layers, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    
+    // outside of the map everything is lit
+    const float border[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+    
+    // the comparison is filtered by the hardware, for a first level of PCF
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, compare ? GL_LINEAR : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, compare ? GL_LINEAR : GL_NEAREST);
+    
+    if (compare) {
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    }
+    
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    
+    return texture;
+}
+
+
+std::vector<GLuint> createLayerFramebuffers(const GLuint texture, const GLsizei layers) {
+    std::vector<GLuint> framebuffers(layers);
+    
+    glGenFramebuffers(layers, framebuffers.data());
+    
+    for (GLsizei layer = 0; layer < layers; layer++) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[layer]);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Incomplete shadow map framebuffer" << std::endl;
+        }
+    }
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    
+    return framebuffers;
+}
+
+
+ShadowMaps createShadowMaps(const GLsizei resolution, const GLsizei cascadeCount, const bool dynamicCasters) {
+    ShadowMaps shadowMaps;
+    shadowMaps.resolution = resolution;
+    shadowMaps.texture = createDepthTextureArray(resolution, cascadeCount, true);
+    shadowMaps.framebuffers = createLayerFramebuffers(shadowMaps.texture, cascadeCount);
+    
+    if (dynamicCasters) {
+        shadowMaps.staticTexture = createDepthTextureArray(resolution, cascadeCount, false);
+        shadowMaps.staticFramebuffers = createLayerFramebuffers(shadowMaps.staticTexture, cascadeCount);
+    }
+    
+    return shadowMaps;
+}
+
+
+// decodes an equirectangular environment image to linear floats. the 8 bit images are taken as sRGB
+bool loadEnvironmentImage(const std::string &filePath, EquirectImage &image) {
+    // the texture repository of the viewer has initialized DevIL already, initializing it again keeps this usable on its own
+    ilInit();
+    iluInit();
+    
+    ILuint imageID;
+    
+    ilGenImages(1, &imageID);
+    ilBindImage(imageID);
+    
+    if (! ilLoadImage(filePath.c_str())) {
+        const ILenum error = ilGetError();
+        std::cout << "Environment load failed: \"" << filePath << "\" - IL reports error: " << error << " - " << iluErrorString(error) << std::endl;
+        
+        ilDeleteImages(1, &imageID);
+        
+        return false;
+    }
+    
+    const bool srgb = ilGetInteger(IL_IMAGE_TYPE) == IL_UNSIGNED_BYTE;
+    
+    // the first row of an equirectangular image looks up
+    if (ilGetInteger(IL_IMAGE_ORIGIN) == IL_ORIGIN_LOWER_LEFT) {
+        iluFlipImage();
+    }
+    
+    if (! ilConvertImage(IL_RGB, IL_FLOAT)) {
+        ilDeleteImages(1, &imageID);
+        
+        return false;
+    }
+    
+    image.width = ilGetInteger(IL_IMAGE_WIDTH);
+    image.height = ilGetInteger(IL_IMAGE_HEIGHT);
+    image.pixels.resize(size_t(image.width) * image.height);
+    
+    const float *data = reinterpret_cast<const float*>(ilGetData());
+    
+    for (size_t i = 0; i < image.pixels.size(); i++) {
+        const glm::vec3 color = {data[3 * i], data[3 * i + 1], data[3 * i + 2]};
+        
+        image.pixels[i] = srgb ? glm::vec3{std::pow(color.x, 2.2f), std::pow(color.y, 2.2f), std::pow(color.z, 2.2f)} : color;
+    }
+    
+    ilDeleteImages(1, &imageID);
+    
+    return true;
+}
+
+
+// reads the IBL maps of the environment from its cache, or computes them and writes the cache. an empty path
+// stands for the default sky
+IblMaps loadIblMaps(const std::string &environmentPath, ThreadPool &threadPool) {
+    const IblParams params;
+    const std::string cachePath = (environmentPath.empty() ? std::string{"default_sky"} : environmentPath) + ".ibl";
+    const std::uint64_t key = computeIblCacheKey(environmentPath, params);
+    
+    IblMaps maps;
+    
+    if (readIblCache(cachePath, key, maps)) {
+        return maps;
+    }
+    
+    EquirectImage environment;
+    
+    // an image that can't be loaded falls back to the sky, which isn't cached under its name
+    const bool fallback = ! environmentPath.empty() && ! loadEnvironmentImage(environmentPath, environment);
+    
+    if (environmentPath.empty() || fallback) {
+        environment = createDefaultSky(2 * params.prefilteredWidth);
+    }
+    
+    const auto start = std::chrono::steady_clock::now();
+    
+    computeIblMaps(environment, params, threadPool, maps);
+    
+    const auto end = std::chrono::steady_clock::now();
+    
+    std::cout << "Computed the IBL maps in " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+    
+    if (! fallback && ! writeIblCache(cachePath, key, maps)) {
+        std::cout << "Can't write the IBL cache " << cachePath << std::endl;
+    }
+    
+    return maps;
+}
+
+
+struct IblTextures {
+    GLuint irradiance = 0;
+    GLuint prefiltered = 0;
+    GLuint brdfLut = 0;
+};
+
+
+// equirectangular maps, which wrap around horizontally. the prefiltered levels are the mip levels of their texture
+IblTextures createIblTextures(const IblMaps &maps) {
+    GL_SCOPED_ERROR_CHECK
+    
+    IblTextures textures;
+    
+    const auto createEquirectTexture = [](const std::vector<EquirectImage> &levels) {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        
+        for (size_t level = 0; level < levels.size(); level++) {
+            glTexImage2D(GL_TEXTURE_2D, GLint(level), GL_RGB16F, levels[level].width, levels[level].height, 0, GL_RGB, GL_FLOAT, levels[level].pixels.data());
+        }
+        
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(levels.size() - 1));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        
+        return texture;
+    };
+    
+    textures.irradiance = createEquirectTexture({maps.irradiance});
+    textures.prefiltered = createEquirectTexture(maps.prefiltered);
+    
+    glGenTextures(1, &textures.brdfLut);
+    glBindTexture(GL_TEXTURE_2D, textures.brdfLut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, maps.brdfLutSize, maps.brdfLutSize, 0, GL_RG, GL_FLOAT, maps.brdfLut.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    return textures;
+}
+
+
+// a mesh rendered into the shadow maps, with its world space bounds
+struct ShadowCaster {
+    const Mesh *mesh = nullptr;
+    const glm::mat4 *model = nullptr;
+    
+    glm::vec3 center = {0.0f, 0.0f, 0.0f};
+    float radius = 0.0f;
+    
+    // moves every frame, so it can't be cached
+    bool dynamic = false;
+};
+
+
+// distance where the attenuation brings the light below 1/256 of its intensity
+float computeLightRange(const aiLight *light) {
+    const float intensity = std::max({light->mColorDiffuse.r, light->mColorDiffuse.g, light->mColorDiffuse.b, 1.0f});
+    const float threshold = 256.0f * intensity;
+    
+    const float c = light->mAttenuationConstant - threshold;
+    const float l = light->mAttenuationLinear;
+    const float q = light->mAttenuationQuadratic;
+    
+    if (q > 0.0f) {
+        return (-l + std::sqrt(l * l - 4.0f * q * c)) / (2.0f * q);
+    }
+    
+    if (l > 0.0f) {
+        return -c / l;
+    }
+    
+    // no attenuation at all
+    return DefaultLightRange;
+}
+
+
+// the point and spot lights of the scene, in world space
+std::vector<LocalLight> createLocalLights(const aiScene *scene, const SceneArena &sceneArena) {
+    std::vector<LocalLight> lights;
+    
+    if (!scene) {
+        return lights;
+    }
+    
+    for (unsigned int i = 0; i < scene->mNumLights; i++) {
+        const aiLight *light = scene->mLights[i];
+        
+        if (light->mType != aiLightSource_POINT && light->mType != aiLightSource_SPOT) {
+            continue;
+        }
+        
+        const std::uint32_t node = sceneArena.find(light->mName.C_Str());
+        const glm::mat4 transform = node != InvalidIndex ? sceneArena.getWorldTransform(node) : glm::identity<glm::mat4>();
+        
+        LocalLight localLight;
+        localLight.position = transform * glm::vec4{light->mPosition.x, light->mPosition.y, light->mPosition.z, 1.0f};
+        localLight.range = computeLightRange(light);
+        localLight.color = {light->mColorDiffuse.r, light->mColorDiffuse.g, light->mColorDiffuse.b};
+        
+        if (light->mType == aiLightSource_SPOT) {
+            localLight.direction = glm::normalize(glm::vec3{transform * glm::vec4{light->mDirection.x, light->mDirection.y, light->mDirection.z, 0.0f}});
+            localLight.cosInnerCone = std::cos(light->mAngleInnerCone);
+            localLight.cosOuterCone = std::cos(light->mAngleOuterCone);
+        }
+        
+        lights.push_back(localLight);
+    }
+    
+    return lights;
+}
+
+
+// how the window is shared between the cameras
+enum class ViewLayout {
+    // the player camera alone
+    Single,
+    
+    // the player camera on the left half, and a camera chasing it from above on the right one
+    SplitScreen,
+    
+    // the player camera, with a rear view inset in the top right corner
+    PictureInPicture
+};
+
+
+// A camera rendered into its own region of the window. The views share the world transforms and bounds of
+// the instances, the meshes, the materials and the shadow maps, each one culls, sorts and records its own draws.
+struct SceneView {
+    // the region of the default framebuffer, in pixels from the bottom left corner
+    std::uint32_t x = 0;
+    std::uint32_t y = 0;
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    
+    FrameParams frame;
+    
+    // visibility of the mesh instances, and the draws of the view: opaque front to back, transparent back to front
+    std::vector<std::uint8_t> visibility;
+    std::vector<DrawItem> drawItems;
+    std::vector<DrawItem> transparentItems, unsortedTransparentItems;
+    std::vector<std::uint32_t> transparentKeys, transparentOrder;
+    RadixSorter transparentSorter;
+    
+    // the local lights assigned to the clusters of the view
+    LightClusters lightClusters;
+    BufferTexture clusterRangesTexture;
+    BufferTexture clusterLightIndicesTexture;
+};
+
+
+const float ChaseCameraDistance = 6.0f;
+const float ChaseCameraHeight = 4.0f;
+
+
+std::vector<SceneView> createViews(const ViewLayout layout, const std::uint32_t width, const std::uint32_t height) {
+    std::vector<SceneView> views(layout == ViewLayout::Single ? 1 : 2);
+    views[0].width = width;
+    views[0].height = height;
+    
+    if (layout == ViewLayout::SplitScreen) {
+        views[0].width = width / 2;
+        
+        views[1].x = width / 2;
+        views[1].width = width - width / 2;
+        views[1].height = height;
+    }
+    else if (layout == ViewLayout::PictureInPicture) {
+        // a quarter of the window on each side, a bit away from its borders
+        const std::uint32_t margin = height / 32;
+        
+        views[1].width = width / 4;
+        views[1].height = height / 4;
+        views[1].x = width - views[1].width - margin;
+        views[1].y = height - views[1].height - margin;
+    }
+    
+    for (SceneView &view : views) {
+        view.clusterRangesTexture = createBufferTexture(GL_RG32UI);
+        view.clusterLightIndicesTexture = createBufferTexture(GL_R32UI);
+    }
+    
+    return views;
+}
+
+
+// the first view is the player camera. the second one chases the player in the split screen, and looks back in
+// the inset
+void pointViewCamera(const ViewLayout layout, const size_t index, const glm::vec3 &position, const glm::vec3 &direction, FrameParams &frame) {
+    const glm::vec3 up = {0.0f, 1.0f, 0.0f};
+    
+    glm::vec3 eye = position;
+    glm::vec3 target = position + direction;
+    
+    if (index > 0 && layout == ViewLayout::SplitScreen) {
+        eye = position - ChaseCameraDistance * direction + ChaseCameraHeight * up;
+        target = position;
+    }
+    else if (index > 0) {
+        target = position - direction;
+    }
+    
+    frame.view = glm::lookAt(eye, target, up);
+    frame.cameraPosition = eye;
+}
+
+
+// And have it read the given file with some example postprocessing
+// Usually - if speed is not the most important aspect for you - you'll
+// propably to request more postprocessing than we do in this example.
+// the identical vertices are joined by weldVertices() afterwards, in parallel
+const unsigned int SceneImportFlags =   aiProcess_Triangulate |
+                                        aiProcess_GenNormals |
+                                        aiProcess_LimitBoneWeights |
+                                        // aiProcess_CalcTangentSpace |
+                                        // aiProcess_SortByPType |
+                                        aiProcess_ValidateDataStructure;
+
+
+struct Options {
+    std::string sceneFilePath;
+    
+    // cull meshlets facing away from the camera. requires (and enables) GL_CULL_FACE
+    bool coneCulling = false;
+    
+    // memory budget for the chunks of a streamed (.tscene) scene
+    size_t streamingBudgetMB = 512;
+    
+    // skin the animated meshes with SSE on the CPU, instead of in the vertex shader
+    bool cpuSkinning = false;
+    
+    // simulation ticks per second
+    double tickRate = 60.0;
+    
+    // lay down the depth first, then shade with an equal depth test
+    bool depthPrepass = false;
+    
+    // print the average GPU frame time every FrameStatsInterval frames
+    bool frameStats = false;
+    
+    // point lights scattered over the scene, in addition to its own lights
+    size_t randomLightCount = 0;
+    
+    // cascaded shadow maps for the directional light
+    bool shadows = true;
+    
+    // watch the shaders, textures and scene file, and reload them when they change
+    bool hotReload = false;
+    
+    // join the identical vertices with aiProcess_JoinIdenticalVertices instead of weldVertices()
+    bool assimpWeld = false;
+    
+    WeldParams weldParams;
+    
+    // equirectangular image lighting the metallic-roughness materials. empty for the default sky
+    std::string environmentPath;
+    
+    // compute the IBL maps of the environment into their cache and exit, without a window
+    bool bakeIbl = false;
+    
+    // write the frames to a .y4m video, or to numbered PNG files starting with this path. empty for none
+    std::string capturePath;
+    
+    // close the window after capturing this many frames, zero to capture until it's closed
+    size_t captureFrameCount = 0;
+    
+    // drop the frames the encoder can't keep up with, instead of slowing down the rendering
+    bool captureDropFrames = false;
+    
+    // pack the diffuse textures of the same size and format into texture arrays
+    bool textureArrays = true;
+    
+    // draw the transparent materials blended in a pass of their own, instead of as opaque
+    bool transparency = true;
+    
+    // cameras sharing the window, and the culled and transformed scene
+    ViewLayout viewLayout = ViewLayout::Single;
+    
+    // wait for the vertical blank, start the frames as soon as possible, or at a fixed rate
+    FramePacingParams pacing;
+    
+    // frames submitted and not finished by the GPU, at most. one waits for each frame before starting the next
+    unsigned int framesInFlight = 2;
+};
+
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        
+        if (arg == "--cone-culling") {
+            options.coneCulling = true;
+        }
+        else if (arg == "--cpu-skinning") {
+            options.cpuSkinning = true;
+        }
+        else if (arg == "--depth-prepass") {
+            options.depthPrepass = true;
+        }
+        else if (arg == "--frame-stats") {
+            options.frameStats = true;
+        }
+        else if (arg == "--no-shadows") {
+            options.shadows = false;
+        }
+        else if (arg == "--hot-reload") {
+            options.hotReload = true;
+        }
+        else if (arg == "--environment" && i + 1 < argc) {
+            options.environmentPath = argv[++i];
+        }
+        else if (arg == "--bake-ibl") {
+            options.bakeIbl = true;
+        }
+        else if (arg == "--capture" && i + 1 < argc) {
+            options.capturePath = argv[++i];
+        }
+        else if (arg == "--capture-frames" && i + 1 < argc) {
+            const std::string count = argv[++i];
+            
+            if (!parseCount(count, options.captureFrameCount)) {
+                std::cout << "Invalid capture frame count " << count << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--capture-drop-frames") {
+            options.captureDropFrames = true;
+        }
+        else if (arg == "--no-texture-arrays") {
+            options.textureArrays = false;
+        }
+        else if (arg == "--no-transparency") {
+            options.transparency = false;
+        }
+        else if (arg == "--assimp-weld") {
+            options.assimpWeld = true;
+        }
+        else if (arg == "--weld-epsilon" && i + 3 < argc) {
+            WeldParams &params = options.weldParams;
+            
+            if (!parseEpsilon(argv[++i], params.positionEpsilon) || !parseEpsilon(argv[++i], params.normalEpsilon) || !parseEpsilon(argv[++i], params.texCoordEpsilon)) {
+                std::cout << "Invalid weld epsilon" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--random-lights" && i + 1 < argc) {
+            const std::string count = argv[++i];
+            
+            if (!parseCount(count, options.randomLightCount) || options.randomLightCount > MaxRandomLights) {
+                std::cout << "Invalid random light count " << count << ", at most " << MaxRandomLights << " are supported" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--tick-rate" && i + 1 < argc) {
+            const std::string rate = argv[++i];
+            
+            if (!parseNumber(rate, options.tickRate) || options.tickRate <= 0.0) {
+                std::cout << "Invalid tick rate " << rate << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--streaming-budget" && i + 1 < argc) {
+            const std::string budget = argv[++i];
+            
+            if (!parseCount(budget, options.streamingBudgetMB) || options.streamingBudgetMB == 0) {
+                std::cout << "Invalid streaming budget " << budget << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--views" && i + 1 < argc) {
+            const std::string layout = argv[++i];
+            
+            if (layout == "single") {
+                options.viewLayout = ViewLayout::Single;
+            }
+            else if (layout == "split") {
+                options.viewLayout = ViewLayout::SplitScreen;
+            }
+            else if (layout == "pip") {
+                options.viewLayout = ViewLayout::PictureInPicture;
+            }
+            else {
+                std::cout << "Unknown view layout " << layout << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--pacing" && i + 1 < argc) {
+            const std::string mode = argv[++i];
+            
+            if (mode == "vsync") {
+                options.pacing.mode = PacingMode::Vsync;
+            }
+            else if (mode == "uncapped") {
+                options.pacing.mode = PacingMode::Uncapped;
+            }
+            else {
+                double rate = 0.0;
+                
+                if (!parseNumber(mode, rate) || rate <= 0.0) {
+                    std::cout << "Unknown pacing mode " << mode << std::endl;
+                    return false;
+                }
+                
+                options.pacing.mode = PacingMode::Capped;
+                options.pacing.frameRate = rate;
+            }
+        }
+        else if (arg == "--frames-in-flight" && i + 1 < argc) {
+            const std::string count = argv[++i];
+            size_t framesInFlight = 0;
+            
+            if (!parseCount(count, framesInFlight) || framesInFlight == 0 || framesInFlight > std::numeric_limits<unsigned int>::max()) {
+                std::cout << "Invalid frames in flight " << count << std::endl;
+                return false;
+            }
+            
+            options.framesInFlight = unsigned(framesInFlight);
+        }
+        else if (arg.size() > 2 && arg.substr(0, 2) == "--") {
+            std::cout << "Unknown option " << arg << std::endl;
+            return false;
+        }
+        else {
+            options.sceneFilePath = arg;
+        }
+    }
+    
+    return !options.sceneFilePath.empty() || options.bakeIbl;
+}
+
+
+// reads the scene and welds its vertices, on the pool when there is one
+const aiScene* importScene(Assimp::Importer &importer, const std::string &filePath, const Options &options, ThreadPool *threadPool) {
+    if (options.assimpWeld) {
+        return importer.ReadFile(filePath, SceneImportFlags | aiProcess_JoinIdenticalVertices);
+    }
+    
+    const aiScene *scene = importer.ReadFile(filePath, SceneImportFlags);
+    
+    if (scene) {
+        const auto start = std::chrono::steady_clock::now();
+        
+        // the importer owns the scene, but it is ours to post-process until it's freed
+        const WeldStats stats = weldVertices(const_cast<aiScene*>(scene), options.weldParams, threadPool);
+        
+        const auto end = std::chrono::steady_clock::now();
+        
+        std::cout << "Welded " << stats.verticesBefore << " vertices into " << stats.verticesAfter << " in "
+            << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+    }
+    
+    return scene;
+}
+
+
+int main(int argc, char **argv) {
+    Options options;
+    
+    if (! parseOptions(argc, argv, options)) {
+        std::cout << "usage: 3dgraphics <scene-file> [--cone-culling] [--cpu-skinning] [--depth-prepass] [--frame-stats] [--hot-reload] [--no-shadows] [--no-texture-arrays] [--no-transparency] [--assimp-weld] [--weld-epsilon <position> <normal> <texcoord>] [--environment <image>] [--bake-ibl] [--capture <video.y4m | png prefix>] [--capture-frames <count>] [--capture-drop-frames] [--random-lights <count>] [--tick-rate <Hz>] [--streaming-budget <MB>] [--views <single | split | pip>] [--pacing <vsync | uncapped | fps>] [--frames-in-flight <count>]" << std::endl;
+        
+        return EXIT_FAILURE;
+    }
+    
+    TextureRepository textureRepository;
+    
+    // the passes read the frame parameters, which the main thread updates before recording them. the pool
+    // welds the vertices of the scene first
+    ThreadPool threadPool;
+    
+    // the image based lighting is computed once per environment, and read from its cache on the next launches
+    const IblMaps iblMaps = loadIblMaps(options.environmentPath, threadPool);
+    
+    if (options.bakeIbl) {
+        return EXIT_SUCCESS;
+    }
+    
+    // tiled scenes are paged in and out around the camera, instead of being loaded at once
+    const bool streaming = isTiledSceneFile(options.sceneFilePath);
+    TiledSceneReader tiledScene;
+    
+    // Create an instance of the Importer class
+    Assimp::Importer importer;
+    const aiScene *scene = nullptr;
+    
+    const std::string sceneFilePath = options.sceneFilePath;
+    const std::string sceneFileParentPath = std::string{parent_path(sceneFilePath)};
+    
+    // static glTF scenes are read without Assimp, the vertex data is uploaded from the mapped file
+    GltfDocument gltf;
+    const bool gltfFastPath = !streaming && isGltfFile(sceneFilePath) && loadGltf(sceneFilePath, gltf);
+    
+    if (streaming) {
+        if (! tiledScene.open(sceneFilePath)) {
+            std::cout << "Can't open the tiled scene " << sceneFilePath << std::endl;
+            
+            return EXIT_FAILURE;
+        }
+        
+        std::cout << "Tiled scene with " << tiledScene.getChunks().size() << " chunks" << std::endl;
+    }
+    else if (gltfFastPath) {
+        std::cout << "glTF scene with " << gltf.primitives.size() << " primitives" << std::endl;
+    }
+    else {
+        scene = importScene(importer, sceneFilePath, options, &threadPool);
+
+        // If the import failed, report it
+        if (!scene) {
+            std::cout << importer.GetErrorString() << std::endl;
+
+            return EXIT_FAILURE;
+        }
+
+        if (! scene->HasMeshes()) {
+            std::cout << "scene doesn't have meshes" << std::endl;
+
+            return EXIT_FAILURE;
+        }
+        
+        for (int i = 0; i<scene->mNumMeshes; i++) {
+            std::cout << "Mesh: " << scene->mMeshes[i]->mName.C_Str() << std::endl;
+        }
+    }
+
+    // the runtime copy of the node graph, the imported scene is freed once everything is converted
+    SceneArena sceneArena = gltfFastPath ? SceneArena{gltf} : SceneArena{scene};
+
+    glfwInit();
+
+    const auto monitor = glfwGetPrimaryMonitor();
+    const GLFWvidmode* mode = glfwGetVideoMode(monitor);
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_NATIVE_CONTEXT_API);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_TRUE);
+    glfwWindowHint(GLFW_DEPTH_BITS, 24);
+    glfwWindowHint(GLFW_RED_BITS, mode->redBits);
+    glfwWindowHint(GLFW_GREEN_BITS, mode->greenBits);
+    glfwWindowHint(GLFW_BLUE_BITS, mode->blueBits);
+    glfwWindowHint(GLFW_REFRESH_RATE, mode->refreshRate);
+    
+    GLFWwindow* window = glfwCreateWindow(mode->width, mode->height, "3dgraphics", nullptr, nullptr);
+    
+    if (!window) {
+        std::cout << "Cant open a Window" << std::endl;
+        
+        const char description[1024] = {};
         const char *desc = &description[0];
         
-        glfwGetError(&desc);
+        glfwGetError(&desc);
+        
+        std::cout << description << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    int windowWidth = 0;
+    int windowHeight = 0;
+
+    glfwGetWindowSize(window, &windowWidth, &windowHeight);
+    
+    // gl_FragCoord is in framebuffer pixels, which may differ from the window size
+    int framebufferWidth = 0;
+    int framebufferHeight = 0;
+    
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cout << "Failed to initialize extensions (via GLAD)" << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    // the capped mode paces the frames itself, without vertical sync
+    glfwSwapInterval(options.pacing.mode == PacingMode::Vsync ? 1 : 0);
+
+    // the only blending, of the transparent pass over the opaque colors
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    GLuint program = createProgram("gouraud.vert", "gouraud.frag");
+    assert(program);
+    
+    ShaderLocationMap location = createShaderLocationMap(program);
+    setLightingSamplers(program, location);
+    std::vector<Mesh> meshes = gltfFastPath ? createMeshArray(location, gltf) : createMeshArray(location, scene);
+    const std::vector<GLuint> textures = createTextureArray(scene, "");
+
+    std::vector<Material> materials = streaming
+        ? createMaterialArray(textureRepository, tiledScene.getMaterials())
+        : gltfFastPath
+        ? createMaterialArray(sceneFilePath, textureRepository, gltf)
+        : createMaterialArray(sceneFileParentPath, textureRepository, scene);
+    
+    if (options.textureArrays) {
+        textureRepository.packTextureArrays(materials);
+    }
+
+    const Light light;
+    
+    // skeletal animation. the first clip of the scene is played in loop
+    NodeHierarchy hierarchy {sceneArena};
+    std::vector<AnimationClip> clips;
+    std::vector<SkinnedMesh> skins;
+    Pose pose;
+    
+    if (scene) {
+        for (unsigned int i = 0; i < scene->mNumAnimations; i++) {
+            clips.push_back(createAnimationClip(hierarchy, scene->mAnimations[i]));
+        }
+        
+        // the first node holding each mesh, which places its unweighted vertices
+        std::vector<int> meshNodes(scene->mNumMeshes, -1);
+        
+        for (std::uint32_t n = 0; n < sceneArena.getMeshNodeCount(); n++) {
+            const std::uint32_t node = sceneArena.getMeshNodes()[n];
+            
+            for (std::uint32_t i = 0; i < sceneArena.getNode(node).instanceCount; i++) {
+                int &meshNode = meshNodes[sceneArena.getMeshInstances(node)[i]];
+                meshNode = meshNode < 0 ? static_cast<int>(node) : meshNode;
+            }
+        }
+        
+        for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+            skins.push_back(createSkinnedMesh(hierarchy, scene->mMeshes[i], meshNodes[i]));
+        }
+    }
+    
+    const bool skinning = std::any_of(skins.begin(), skins.end(), [](const SkinnedMesh &skin) {
+        return !skin.empty();
+    });
+    
+    GLuint skinnedProgram = 0;
+    ShaderLocationMap skinnedLocation;
+    GLuint bonePaletteBuffer = 0;
+    
+    if (skinning && !options.cpuSkinning) {
+        skinnedProgram = createProgram("gouraud_skinned.vert", "gouraud.frag");
+        assert(skinnedProgram);
+        
+        skinnedLocation = createShaderLocationMap(skinnedProgram);
+        setLightingSamplers(skinnedProgram, skinnedLocation);
+        
+        glUniformBlockBinding(skinnedProgram, glGetUniformBlockIndex(skinnedProgram, "BonePalette"), BonePaletteBinding);
+        
+        bonePaletteBuffer = createBuffer(GL_UNIFORM_BUFFER, MaxPaletteBones * 12 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+        
+        for (size_t i = 0; i < skins.size(); i++) {
+            if (!skins[i].empty()) {
+                attachSkinAttributes(skinnedLocation, meshes[i], skins[i]);
+            }
+        }
+    }
+    
+    // local lights, assigned to the clusters of the view frustum every frame
+    std::vector<LocalLight> localLights = createLocalLights(scene, sceneArena);
+    
+    // a reimport of the scene only replaces the meshes that changed
+    std::vector<std::uint64_t> meshHashes;
+    
+    if (scene) {
+        for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+            meshHashes.push_back(hashMesh(scene->mMeshes[i]));
+        }
+    }
+    
+    // everything needed from the imported scene is converted by now
+    if (scene) {
+        importer.FreeScene();
+        scene = nullptr;
+        
+        std::cout << "Scene arena: " << sceneArena.getNodeCount() << " nodes, " << sceneArena.getMemorySize() / 1024 << " KB" << std::endl;
+    }
+    
+    // unmaps the glTF buffers
+    gltf = GltfDocument{};
+    
+    if (options.randomLightCount > 0) {
+        glm::vec3 boxMin{std::numeric_limits<float>::max()};
+        glm::vec3 boxMax{std::numeric_limits<float>::lowest()};
+        
+        for (std::uint32_t n = 0; n < sceneArena.getMeshNodeCount(); n++) {
+            const std::uint32_t node = sceneArena.getMeshNodes()[n];
+            const glm::mat4 &model = sceneArena.getWorldTransform(node);
+            
+            for (std::uint32_t i = 0; i < sceneArena.getNode(node).instanceCount; i++) {
+                const Mesh &mesh = meshes[sceneArena.getMeshInstances(node)[i]];
+                
+                if (mesh.empty()) {
+                    continue;
+                }
+                
+                const glm::vec3 center = model * glm::vec4{mesh.boundsCenter, 1.0f};
+                const float radius = mesh.boundsRadius * getMaxScale(model);
+                
+                boxMin = glm::min(boxMin, center - radius);
+                boxMax = glm::max(boxMax, center + radius);
+            }
+        }
+        
+        for (const TiledChunk &chunk : tiledScene.getChunks()) {
+            boxMin = glm::min(boxMin, chunk.boxMin);
+            boxMax = glm::max(boxMax, chunk.boxMax);
+        }
+        
+        if (boxMin.x <= boxMax.x) {
+            const std::vector<LocalLight> randomLights = createRandomLights(options.randomLightCount, boxMin, boxMax, DefaultLightRange, 1);
+            localLights.insert(localLights.end(), randomLights.begin(), randomLights.end());
+        }
+    }
+    
+    std::cout << localLights.size() << " local lights" << std::endl;
+    
+    ClusterGridParams clusterGridParams;
+    clusterGridParams.nearPlane = CameraNearPlane;
+    clusterGridParams.farPlane = CameraFarPlane;
+    
+    LightClusterBuilder lightClusterBuilder {clusterGridParams};
+    
+    // the cameras of the frame, each one with its own light clusters
+    std::vector<SceneView> views = createViews(options.viewLayout, framebufferWidth, framebufferHeight);
+    
+    const BufferTexture lightDataTexture = createBufferTexture(GL_RGBA32F);
+    
+    // the lights don't move, their data is uploaded once
+    std::vector<glm::vec4> lightTexels;
+    packLightData(localLights, lightTexels);
+    updateBufferTexture(lightDataTexture, lightTexels.data(), lightTexels.size() * sizeof(glm::vec4));
+    
+    // chunks of the tiled scene, only the resident ones have a VAO
+    std::vector<Mesh> chunkMeshes;
+    std::unique_ptr<SceneStreamer> streamer;
+    StreamingEvents streamingEvents;
+    
+    if (streaming) {
+        StreamingParams streamingParams;
+        streamingParams.memoryBudget = options.streamingBudgetMB * 1024 * 1024;
+        
+        chunkMeshes.resize(tiledScene.getChunks().size());
+        streamer = std::make_unique<SceneStreamer>(tiledScene, streamingParams);
+    }
+    
+    bool running = true;
+    
+    // the player moves on the simulation thread, at a fixed rate
+    SimulationParams simulationParams;
+    simulationParams.tickRate = options.tickRate;
+    
+    Simulation simulation {simulationParams, PlayerState{}};
+    
+    const bool animated = !clips.empty();
+    
+    // the nodes the clip moves. the other ones are still, and cast their shadows from the cached cascades
+    const std::vector<std::uint8_t> animatedNodes = animated ? findAnimatedNodes(hierarchy, clips[0]) : std::vector<std::uint8_t>{};
+    
+    const auto isAnimatedNode = [&](const std::uint32_t node) {
+        return node < animatedNodes.size() && animatedNodes[node] != 0;
+    };
+    
+    const bool dynamicCasters = std::any_of(sceneArena.getMeshNodes(), sceneArena.getMeshNodes() + sceneArena.getMeshNodeCount(), isAnimatedNode);
+    
+    GLCommandExecutor executor;
+    
+    executor.addProgram(program, location);
+    
+    if (skinnedProgram) {
+        executor.addProgram(skinnedProgram, skinnedLocation);
+    }
+    
+    // position only program, for the depth prepass and the shadow maps
+    GLuint depthProgram = 0;
+    
+    if (options.depthPrepass || options.shadows) {
+        depthProgram = createProgram("depth.vert", "depth.frag");
+        assert(depthProgram);
+        
+        executor.addProgram(depthProgram, createShaderLocationMap(depthProgram));
+    }
+    
+    // cascaded shadow maps of the directional light. the skinned meshes don't cast shadows
+    ShadowCascadeParams shadowParams;
+    shadowParams.shadowDistance = CameraFarPlane;
+    
+    ShadowCascades shadowCascades {shadowParams};
+    ShadowMaps shadowMaps;
+    std::vector<ShadowCaster> shadowCasters;
+    std::vector<DrawContext> shadowDrawContexts(shadowParams.cascadeCount);
+    
+    // changes whenever the static casters do, so the cached cascades are rendered again
+    std::uint64_t staticSceneVersion = 0;
+    
+    // the animated nodes move every frame, they are rendered over the cached static casters
+    if (options.shadows) {
+        shadowMaps = createShadowMaps(shadowParams.resolution, shadowParams.cascadeCount, dynamicCasters);
+    }
+    
+    const IblTextures iblTextures = createIblTextures(iblMaps);
+    
+    const glm::mat4 identity = glm::identity<glm::mat4>();
+    
+    // world transforms of the nodes
+    std::vector<glm::mat4> nodeModels(sceneArena.getMeshNodeCount());
+    
+    // the mesh instances of the nodes in draw order, with the bounds of their meshes. they are transformed in
+    // batches once per frame, and culled by every view
+    std::vector<std::uint32_t> instanceNodes, instanceMeshes;
+    SphereArray instanceBounds, worldBounds;
+    
+    // the instances of the animated nodes, rendered over the cached static casters
+    std::vector<std::uint8_t> instanceDynamic;
+    
+    const auto updateInstanceBounds = [&]() {
+        instanceNodes.clear();
+        instanceMeshes.clear();
+        instanceDynamic.clear();
+        
+        for (std::uint32_t n = 0; n < sceneArena.getMeshNodeCount(); n++) {
+            const std::uint32_t node = sceneArena.getMeshNodes()[n];
+            
+            for (std::uint32_t i = 0; i < sceneArena.getNode(node).instanceCount; i++) {
+                const std::uint32_t mesh = sceneArena.getMeshInstances(node)[i];
+                
+                if (meshes[mesh].empty()) {
+                    continue;
+                }
+                
+                instanceNodes.push_back(n);
+                instanceMeshes.push_back(mesh);
+                instanceDynamic.push_back(dynamicCasters && isAnimatedNode(node) ? 1 : 0);
+            }
+        }
+        
+        instanceBounds.resize(instanceMeshes.size());
+        
+        for (SceneView &view : views) {
+            view.visibility.resize(instanceMeshes.size());
+        }
+        
+        for (size_t i = 0; i < instanceMeshes.size(); i++) {
+            const Mesh &mesh = meshes[instanceMeshes[i]];
+            instanceBounds.set(i, mesh.boundsCenter, mesh.boundsRadius);
+        }
+    };
+    
+    updateInstanceBounds();
+    
+    // the passes of every view are recorded at the same time, so each one has its own draw contexts
+    const size_t recordJobCount = 2 * (threadPool.getThreadCount() + 1);
+    std::vector<DrawContext> drawContexts(3 * recordJobCount * views.size());
+    
+    const auto setupDrawContext = [&](DrawContext &context, const FrameParams &frame) {
+        context.viewProj = frame.proj * frame.view;
+        context.cameraPosition = frame.cameraPosition;
+        context.coneCulling = options.coneCulling;
+    };
+    
+    const auto isTransparent = [&](const Mesh &mesh) {
+        return options.transparency && mesh.material >= 0 && materials[mesh.material].transparent;
+    };
+    
+    const auto recordDrawItem = [&](CommandList &commands, DrawContext &context, const FrameParams &frame, const DrawItem &item) {
+        const Mesh &mesh = *item.mesh;
+        const Material material = mesh.material >= 0 ? materials[mesh.material] : Material{};
+        
+        if (item.skin < 0) {
+            commands.setUniform(UniformSlot::Model, *item.model);
+            recordMesh(commands, context, mesh, material, *item.model);
+            return;
+        }
+        
+        // the skinned meshes are left out of the prepass, so they are depth tested as usual. the transparent pass
+        // doesn't write depth at all
+        const bool depthTested = options.depthPrepass && !isTransparent(mesh);
+        
+        if (depthTested) {
+            commands.setDepthFunc(DepthFunc::Less);
+            commands.setDepthWrite(true);
+        }
+        
+        // the bone palette already places the skinned vertices in world space
+        const SkinnedMesh &skin = skins[item.skin];
+        
+        computeBonePalette(skin, pose.globalTransforms, context.bonePalette);
+        
+        if (options.cpuSkinning) {
+            context.skinnedPositions.resize(skin.vertexCount);
+            context.skinnedNormals.resize(skin.vertexCount);
+            
+            skinVertices(skin, context.bonePalette, context.skinnedPositions.data(), context.skinnedNormals.data());
+            
+            commands.updateBuffer(mesh.coordBuffer, context.skinnedPositions.data(), skin.vertexCount * sizeof(glm::vec3));
+            
+            if (mesh.normalBuffer) {
+                commands.updateBuffer(mesh.normalBuffer, context.skinnedNormals.data(), skin.vertexCount * sizeof(glm::vec3));
+            }
+            
+            commands.setUniform(UniformSlot::Model, identity);
+            recordMesh(commands, context, mesh, material, identity);
+        }
+        else {
+            commands.updateBuffer(bonePaletteBuffer, context.bonePalette.data(), context.bonePalette.size() * sizeof(float));
+            commands.bindUniformBuffer(BonePaletteBinding, bonePaletteBuffer);
+            
+            commands.useProgram(skinnedProgram);
+            recordFrameUniforms(commands, frame, light);
+            commands.setUniform(UniformSlot::Model, identity);
+            
+            recordMesh(commands, context, mesh, material, identity);
+            
+            commands.useProgram(program);
+        }
+        
+        if (depthTested) {
+            commands.setDepthFunc(DepthFunc::Equal);
+            commands.setDepthWrite(false);
+        }
+    };
+    
+    RenderGraph renderGraph;
+    
+    // each job renders a cascade. the cached ones with no dynamic casters don't record anything
+    if (options.shadows) {
+        RenderPass shadowPass;
+        shadowPass.name = "shadows";
+        shadowPass.writes = {"shadow-maps"};
+        shadowPass.jobCount = shadowParams.cascadeCount;
+        shadowPass.record = [&](const size_t cascadeIndex, CommandList &commands) {
+            const ShadowCascade &cascade = shadowCascades.getCascades()[cascadeIndex];
+            const bool dynamicCasters = shadowMaps.staticTexture != 0;
+            
+            if (!cascade.staticDirty && !dynamicCasters) {
+                return;
+            }
+            
+            // the meshlets are culled against the cascade. the cone culling needs a perspective camera
+            DrawContext &context = shadowDrawContexts[cascadeIndex];
+            context.viewProj = cascade.viewProj;
+            context.coneCulling = false;
+            
+            commands.enable(RenderState::DepthTest);
+            commands.disable(RenderState::CullFace);
+            commands.setDepthFunc(DepthFunc::Less);
+            commands.setDepthWrite(true);
+            commands.setDepthBias(ShadowDepthBiasFactor, ShadowDepthBiasUnits);
+            
+            commands.useProgram(depthProgram);
+            commands.setUniform(UniformSlot::Proj, cascade.proj);
+            commands.setUniform(UniformSlot::View, cascade.view);
+            
+            const auto recordCasters = [&](const bool dynamic) {
+                for (const ShadowCaster &caster : shadowCasters) {
+                    if (caster.dynamic != dynamic || !intersects(cascade.frustum, caster.center, caster.radius)) {
+                        continue;
+                    }
+                    
+                    commands.setUniform(UniformSlot::Model, *caster.model);
+                    recordMeshDraw(commands, context, *caster.mesh, caster.mesh->depthVao, *caster.model);
+                }
+            };
+            
+            const GLsizei resolution = shadowMaps.resolution;
+            const GLuint framebuffer = shadowMaps.framebuffers[cascadeIndex];
+            
+            if (cascade.staticDirty) {
+                commands.bindFramebuffer(dynamicCasters ? shadowMaps.staticFramebuffers[cascadeIndex] : framebuffer, resolution, resolution);
+                commands.clearTargets({0.0f, 0.0f, 0.0f, 0.0f}, false, true);
+                
+                recordCasters(false);
+            }
+            
+            if (dynamicCasters) {
+                commands.blitDepth(shadowMaps.staticFramebuffers[cascadeIndex], framebuffer, resolution, resolution);
+                commands.bindFramebuffer(framebuffer, resolution, resolution);
+                
+                recordCasters(true);
+            }
+            
+            commands.setDepthBias(0.0f, 0.0f);
+            commands.bindFramebuffer(0, framebufferWidth, framebufferHeight);
+        };
+        
+        renderGraph.addPass(std::move(shadowPass));
+    }
+    
+    // the views are rendered one after the other, each one over its own region of the color and depth targets.
+    // their passes are recorded together, on the same jobs
+    for (size_t v = 0; v < views.size(); v++) {
+        const std::string suffix = v > 0 ? "-" + std::to_string(v) : "";
         
-        std::cout << description << std::endl;
-
-        return EXIT_FAILURE;
+        RenderPass clearPass;
+        clearPass.name = "clear" + suffix;
+        clearPass.writes = {"color", "depth"};
+        clearPass.record = [&views, v](const size_t, CommandList &commands) {
+            const SceneView &view = views[v];
+            commands.setViewport(view.x, view.y, view.width, view.height);
+            
+            // the masks also apply to the clear, and the scissor box keeps it in the region of the view
+            commands.setColorWrite(true);
+            commands.setDepthWrite(true);
+            commands.enable(RenderState::ScissorTest);
+            commands.clearTargets({0.1f, 0.1f, 0.6f, 1.0f}, true, true);
+            commands.disable(RenderState::ScissorTest);
+        };
+        
+        renderGraph.addPass(std::move(clearPass));
+        
+        // lays down the depth of the opaque geometry, so the shading pass only shades the visible fragments
+        if (options.depthPrepass) {
+            RenderPass depthPass;
+            depthPass.name = "depth-prepass" + suffix;
+            depthPass.reads = {"depth"};
+            depthPass.writes = {"depth"};
+            depthPass.jobCount = recordJobCount;
+            depthPass.record = [&, v](const size_t job, CommandList &commands) {
+                const SceneView &view = views[v];
+                const FrameParams &frame = view.frame;
+                
+                DrawContext &context = drawContexts[3 * recordJobCount * v + job];
+                setupDrawContext(context, frame);
+                
+                commands.setViewport(view.x, view.y, view.width, view.height);
+                commands.enable(RenderState::DepthTest);
+                
+                if (options.coneCulling) {
+                    commands.enable(RenderState::CullFace);
+                }
+                
+                commands.setDepthFunc(DepthFunc::Less);
+                commands.setDepthWrite(true);
+                commands.setColorWrite(false);
+                
+                commands.useProgram(depthProgram);
+                commands.setUniform(UniformSlot::Proj, frame.proj);
+                commands.setUniform(UniformSlot::View, frame.view);
+                
+                const auto [begin, end] = getJobRange(job, recordJobCount, view.drawItems.size());
+                
+                for (size_t i = begin; i < end; i++) {
+                    const DrawItem &item = view.drawItems[i];
+                    
+                    if (item.skin >= 0) {
+                        continue;
+                    }
+                    
+                    commands.setUniform(UniformSlot::Model, *item.model);
+                    recordMeshDraw(commands, context, *item.mesh, item.mesh->depthVao, *item.model);
+                }
+            };
+            
+            renderGraph.addPass(std::move(depthPass));
+        }
+        
+        RenderPass opaquePass;
+        opaquePass.name = "opaque" + suffix;
+        opaquePass.reads = {"color", "depth"};
+        opaquePass.writes = {"color", "depth"};
+        
+        if (options.shadows) {
+            opaquePass.reads.push_back("shadow-maps");
+        }
+        
+        opaquePass.jobCount = recordJobCount;
+        opaquePass.record = [&, v](const size_t job, CommandList &commands) {
+            const SceneView &view = views[v];
+            const FrameParams &frame = view.frame;
+            
+            DrawContext &context = drawContexts[3 * recordJobCount * v + recordJobCount + job];
+            setupDrawContext(context, frame);
+            
+            // every command list sets up its own state, the jobs can't rely on each other
+            commands.setViewport(view.x, view.y, view.width, view.height);
+            commands.enable(RenderState::DepthTest);
+            
+            if (options.coneCulling) {
+                commands.enable(RenderState::CullFace);
+            }
+            
+            commands.setColorWrite(true);
+            
+            if (options.depthPrepass) {
+                commands.setDepthFunc(DepthFunc::Equal);
+                commands.setDepthWrite(false);
+            }
+            else {
+                commands.setDepthFunc(DepthFunc::Less);
+                commands.setDepthWrite(true);
+            }
+            
+            commands.useProgram(program);
+            recordFrameUniforms(commands, frame, light);
+            
+            commands.bindBufferTexture(ClusterRangesUnit, view.clusterRangesTexture.texture);
+            commands.bindBufferTexture(ClusterLightIndicesUnit, view.clusterLightIndicesTexture.texture);
+            
+            const auto [begin, end] = getJobRange(job, recordJobCount, view.drawItems.size());
+            
+            for (size_t i = begin; i < end; i++) {
+                recordDrawItem(commands, context, frame, view.drawItems[i]);
+            }
+        };
+        
+        renderGraph.addPass(std::move(opaquePass));
+        
+        // blended over the opaque colors, depth tested against them without writing depth. the jobs cover
+        // consecutive ranges and are executed in order, so the draws keep their back to front order
+        RenderPass transparentPass;
+        transparentPass.name = "transparent" + suffix;
+        transparentPass.reads = {"color", "depth"};
+        transparentPass.writes = {"color"};
+        
+        if (options.shadows) {
+            transparentPass.reads.push_back("shadow-maps");
+        }
+        
+        transparentPass.jobCount = recordJobCount;
+        transparentPass.record = [&, v](const size_t job, CommandList &commands) {
+            const SceneView &view = views[v];
+            const FrameParams &frame = view.frame;
+            
+            const auto [begin, end] = getJobRange(job, recordJobCount, view.transparentItems.size());
+            
+            if (begin == end) {
+                return;
+            }
+            
+            DrawContext &context = drawContexts[3 * recordJobCount * v + 2 * recordJobCount + job];
+            setupDrawContext(context, frame);
+            
+            // both sides of the transparent surfaces are seen
+            commands.setViewport(view.x, view.y, view.width, view.height);
+            commands.enable(RenderState::DepthTest);
+            commands.disable(RenderState::CullFace);
+            commands.enable(RenderState::Blend);
+            
+            commands.setColorWrite(true);
+            commands.setDepthFunc(DepthFunc::Less);
+            commands.setDepthWrite(false);
+            
+            commands.useProgram(program);
+            recordFrameUniforms(commands, frame, light);
+            
+            commands.bindBufferTexture(ClusterRangesUnit, view.clusterRangesTexture.texture);
+            commands.bindBufferTexture(ClusterLightIndicesUnit, view.clusterLightIndicesTexture.texture);
+            
+            for (size_t i = begin; i < end; i++) {
+                recordDrawItem(commands, context, frame, view.transparentItems[i]);
+            }
+            
+            commands.disable(RenderState::Blend);
+        };
+        
+        renderGraph.addPass(std::move(transparentPass));
     }
-
-    int windowWidth = 0;
-    int windowHeight = 0;
-
-    glfwGetWindowSize(window, &windowWidth, &windowHeight);
-
-    glfwMakeContextCurrent(window);
-
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cout << "Failed to initialize extensions (via GLAD)" << std::endl;
+    
+    renderGraph.setOutput("color");
+    
+    if (! renderGraph.compile()) {
         return EXIT_FAILURE;
     }
-
-    const GLuint program = createProgram("gouraud.vert", "gouraud.frag");
-    assert(program);
     
-    const ShaderLocationMap location = createShaderLocationMap(program);
-    const std::vector<Mesh> meshes = createMeshArray(location, scene);
-    const std::vector<GLuint> textures = createTextureArray(scene, "");
-
-    const std::vector<Material> materials = createMaterialArray(sceneFileParentPath, textureRepository, scene);
-    const Light light;
+    std::unique_ptr<GpuFrameTimer> frameTimer;
     
-    bool running = true;
+    if (options.frameStats) {
+        frameTimer = std::make_unique<GpuFrameTimer>();
+    }
+    
+    FramePacer framePacer {options.pacing};
+    auto frameFences = std::make_unique<FrameFences>(options.framesInFlight);
+    
+    // measured along with the GPU frame time
+    LatencyStats latencyStats;
+    
+    std::unique_ptr<FrameCapture> frameCapture;
+    
+    if (! options.capturePath.empty()) {
+        const std::string &capturePath = options.capturePath;
+        
+        FrameEncoderParams encoderParams;
+        encoderParams.outputPath = capturePath;
+        encoderParams.dropFrames = options.captureDropFrames;
+        encoderParams.frameRate = mode->refreshRate > 0 ? unsigned(mode->refreshRate) : 60;
+        
+        if (capturePath.size() > 4 && capturePath.substr(capturePath.size() - 4) == ".y4m") {
+            encoderParams.format = CaptureFormat::Y4m;
+        }
+        
+        frameCapture = std::make_unique<FrameCapture>(framebufferWidth, framebufferHeight, encoderParams);
+        
+        if (! frameCapture->isOpen()) {
+            return EXIT_FAILURE;
+        }
+    }
 
-    glm::vec3 playerPosition = {0.0f, 0.0f, 10.0f};
-    float angle = 0.0f;
+    // cascades whose static casters were rendered again, since the last stats
+    size_t shadowCascadeUpdates = 0;
+    
+    // the files are watched for changes, and the resources replaced between frames
+    std::unique_ptr<FileWatcher> fileWatcher;
+    std::vector<std::string> changedFiles;
+    
+    struct ReloadableProgram {
+        GLuint *program;
+        ShaderLocationMap *location;
+        std::string vertFile;
+        std::string fragFile;
+    };
+    
+    std::vector<ReloadableProgram> reloadablePrograms = {{&program, &location, "gouraud.vert", "gouraud.frag"}};
+    
+    if (skinnedProgram) {
+        reloadablePrograms.push_back({&skinnedProgram, &skinnedLocation, "gouraud_skinned.vert", "gouraud.frag"});
+    }
+    
+    ShaderLocationMap depthLocation;
+    
+    if (depthProgram) {
+        reloadablePrograms.push_back({&depthProgram, &depthLocation, "depth.vert", "depth.frag"});
+    }
+    
+    // the scene is imported again, and its meshes hashed, on a background thread
+    struct SceneImport {
+        std::unique_ptr<Assimp::Importer> importer;
+        std::vector<std::uint64_t> meshHashes;
+    };
+    
+    std::future<SceneImport> sceneImport;
+    bool sceneChanged = false;
+    
+    if (options.hotReload) {
+        fileWatcher = std::make_unique<FileWatcher>();
+        
+        for (const ReloadableProgram &reloadable : reloadablePrograms) {
+            fileWatcher->addFile(reloadable.vertFile);
+            fileWatcher->addFile(reloadable.fragFile);
+        }
+        
+        for (const std::string &filePath : textureRepository.getFilePaths()) {
+            fileWatcher->addFile(filePath);
+        }
+        
+        // the chunks of the tiled scenes are read by the streamer, they are not reloaded. neither are the glTF
+        // scenes of the fast path, the reimport goes through Assimp and its meshes don't match ours
+        if (!streaming && !gltfFastPath) {
+            fileWatcher->addFile(sceneFilePath);
+        }
+    }
+    
+    // builds the program again. when the new sources don't compile, the previous program stays in use
+    const auto reloadProgram = [&](const ReloadableProgram &reloadable) {
+        const GLuint reloaded = createProgram(reloadable.vertFile, reloadable.fragFile);
+        
+        if (! reloaded) {
+            std::cout << "Can't reload " << reloadable.vertFile << " and " << reloadable.fragFile << ", keeping the previous program" << std::endl;
+            return;
+        }
+        
+        const ShaderLocationMap reloadedLocation = createShaderLocationMap(reloaded);
+        setLightingSamplers(reloaded, reloadedLocation);
+        
+        const GLuint bonePaletteIndex = glGetUniformBlockIndex(reloaded, "BonePalette");
+        
+        if (bonePaletteIndex != GL_INVALID_INDEX) {
+            glUniformBlockBinding(reloaded, bonePaletteIndex, BonePaletteBinding);
+        }
+        
+        executor.removeProgram(*reloadable.program);
+        executor.addProgram(reloaded, reloadedLocation);
+        glDeleteProgram(*reloadable.program);
+        
+        *reloadable.program = reloaded;
+        *reloadable.location = reloadedLocation;
+        
+        std::cout << "Reloaded " << reloadable.vertFile << " and " << reloadable.fragFile << std::endl;
+    };
+    
+    // replaces the meshes whose data changed, the materials and the node transforms. a scene with different
+    // nodes or meshes would invalidate too much state, it needs a restart
+    const auto applySceneImport = [&](const aiScene *reimported, const std::vector<std::uint64_t> &reimportedHashes) {
+        SceneArena reimportedArena {reimported};
+        
+        if (reimported->mNumMeshes != meshes.size() || reimported->mNumMaterials != materials.size() || !reimportedArena.hasSameLayout(sceneArena)) {
+            std::cout << "The nodes or meshes of " << sceneFilePath << " changed, restart to see them" << std::endl;
+            return;
+        }
+        
+        size_t reloadedMeshes = 0;
+        
+        for (unsigned int i = 0; i < reimported->mNumMeshes; i++) {
+            const std::uint64_t hash = reimportedHashes[i];
+            
+            if (hash == meshHashes[i]) {
+                continue;
+            }
+            
+            // the skins were extracted from the previous meshes
+            if (!skins[i].empty()) {
+                std::cout << "Skinned mesh " << reimported->mMeshes[i]->mName.C_Str() << " changed, restart to see it" << std::endl;
+                continue;
+            }
+            
+            destroyMeshVAO(meshes[i]);
+            meshes[i] = createMeshVAO(location, reimported->mMeshes[i]);
+            meshHashes[i] = hash;
+            reloadedMeshes++;
+        }
+        
+        materials = createMaterialArray(sceneFileParentPath, textureRepository, reimported);
+        
+        if (options.textureArrays) {
+            textureRepository.packTextureArrays(materials);
+        }
+        
+        sceneArena = std::move(reimportedArena);
+        hierarchy = NodeHierarchy{sceneArena};
+        updateInstanceBounds();
+        
+        // the static casters may have changed
+        staticSceneVersion++;
+        
+        std::cout << "Reloaded " << sceneFilePath << ", " << reloadedMeshes << " meshes changed" << std::endl;
+    };
     
     while (running) {
+        // the input is sampled right after the wait, so it's as recent as it can be when the frame is rendered
+        framePacer.waitForNextFrame();
+        
         glfwPollEvents();
+        
+        // swap the changed resources before anything of the frame is recorded
+        if (fileWatcher) {
+            changedFiles.clear();
+            fileWatcher->poll(changedFiles);
+            
+            for (const std::string &file : changedFiles) {
+                for (const ReloadableProgram &reloadable : reloadablePrograms) {
+                    if (file == reloadable.vertFile || file == reloadable.fragFile) {
+                        reloadProgram(reloadable);
+                    }
+                }
+                
+                if (textureRepository.contains(file)) {
+                    textureRepository.reloadAsync(file);
+                }
+                
+                if (file == sceneFilePath) {
+                    sceneChanged = true;
+                }
+            }
+            
+            textureRepository.applyReloads();
+            
+            if (sceneImport.valid() && sceneImport.wait_for(std::chrono::seconds{0}) == std::future_status::ready) {
+                const SceneImport reimport = sceneImport.get();
+                
+                if (reimport.importer->GetScene()) {
+                    applySceneImport(reimport.importer->GetScene(), reimport.meshHashes);
+                    
+                    // the textures the reload loaded for the first time. the files already watched are kept
+                    for (const std::string &filePath : textureRepository.getFilePaths()) {
+                        fileWatcher->addFile(filePath);
+                    }
+                }
+                else {
+                    std::cout << "Can't reload " << sceneFilePath << ": " << reimport.importer->GetErrorString() << std::endl;
+                }
+            }
+            
+            // one import at a time. the changes made during an import start another one once it's done
+            if (sceneChanged && !sceneImport.valid()) {
+                sceneChanged = false;
+                
+                // the pool is busy with the frames, the import thread welds the meshes by itself
+                sceneImport = std::async(std::launch::async, [sceneFilePath, &options] {
+                    SceneImport reimport;
+                    reimport.importer = std::make_unique<Assimp::Importer>();
+                    
+                    if (const aiScene *reimported = importScene(*reimport.importer, sceneFilePath, options, nullptr)) {
+                        for (unsigned int i = 0; i < reimported->mNumMeshes; i++) {
+                            reimport.meshHashes.push_back(hashMesh(reimported->mMeshes[i]));
+                        }
+                    }
+                    
+                    return reimport;
+                });
+            }
+        }
 
         if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
             running = false;
         }
 
-        if (glfwGetKey(window, GLFW_KEY_LEFT)) {
-            angle += 0.02f;
+        SimulationInput input;
+        input.turnLeft = glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS;
+        input.turnRight = glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS;
+        input.forward = glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS;
+        input.backward = glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS;
+        
+        const auto inputTime = std::chrono::steady_clock::now();
+        simulation.setInput(input);
+        
+        // the player state interpolated between the last two ticks
+        const PlayerState player = simulation.getState(std::chrono::steady_clock::now());
+        const glm::vec3 playerPosition = player.position;
+        const glm::vec3 playerDirection = player.getDirection();
+        
+        // page the chunks around the new position
+        if (streamer) {
+            streamingEvents.loaded.clear();
+            streamingEvents.evicted.clear();
+            
+            streamer->update(playerPosition, streamingEvents);
+            
+            for (auto &[chunk, data] : streamingEvents.loaded) {
+                chunkMeshes[chunk] = createMeshVAO(location, data, tiledScene.getChunks()[chunk].material);
+            }
+            
+            for (const std::uint32_t chunk : streamingEvents.evicted) {
+                destroyMeshVAO(chunkMeshes[chunk]);
+            }
+            
+            if (!streamingEvents.loaded.empty() || !streamingEvents.evicted.empty()) {
+                staticSceneVersion++;
+            }
         }
-        else if (glfwGetKey(window, GLFW_KEY_RIGHT)) {
-            angle -= 0.02f;
+        
+        // setup transformation matrices, and assign the lights to the clusters of each view. the passes bind the
+        // cluster textures of their view
+        const glm::vec2 depthSliceParams = lightClusterBuilder.getDepthSliceParams();
+        
+        for (size_t v = 0; v < views.size(); v++) {
+            SceneView &view = views[v];
+            FrameParams &frame = view.frame;
+            
+            frame.proj = glm::perspective(
+                45.0f,
+                static_cast<float>(view.width) / static_cast<float>(view.height),
+                CameraNearPlane,
+                CameraFarPlane);
+            
+            pointViewCamera(options.viewLayout, v, playerPosition, playerDirection, frame);
+            
+            lightClusterBuilder.build(localLights, frame.view, frame.proj, threadPool, view.lightClusters);
+            
+            frame.clusterGrid = {float(clusterGridParams.tilesX), float(clusterGridParams.tilesY), float(clusterGridParams.slices), 0.0f};
+            frame.clusterDepthParams = {depthSliceParams.x, depthSliceParams.y, 0.0f, 0.0f};
+            frame.viewportSize = {float(view.width), float(view.height), float(view.x), float(view.y)};
+            
+            const LightClusters &clusters = view.lightClusters;
+            
+            updateBufferTexture(view.clusterRangesTexture, clusters.ranges.data(), clusters.ranges.size() * sizeof(std::uint32_t));
+            updateBufferTexture(view.clusterLightIndicesTexture, clusters.lightIndices.data(), clusters.lightIndices.size() * sizeof(std::uint32_t));
         }
         
-        // compute player direction
-        glm::mat4 rotationY = glm::identity<glm::mat4>();
-        rotationY = glm::rotate(rotationY, angle, glm::vec3{0.0f, 1.0f, 0.0f});
+        glActiveTexture(GL_TEXTURE0 + LightDataUnit);
+        glBindTexture(GL_TEXTURE_BUFFER, lightDataTexture.texture);
         
-        const glm::vec3 playerDirection = rotationY * glm::vec4{0.0f, 0.0f, -1.0f, 0.0f};
-
-        // compute player movement
-        if (! (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS && glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)) {
-            if (glfwGetKey(window, GLFW_KEY_UP)) {
-                playerPosition += 0.075f * playerDirection;
+        // the texture loads of the hot reload bind to the active unit, so these are bound every frame too
+        glActiveTexture(GL_TEXTURE0 + IrradianceUnit);
+        glBindTexture(GL_TEXTURE_2D, iblTextures.irradiance);
+        glActiveTexture(GL_TEXTURE0 + PrefilteredUnit);
+        glBindTexture(GL_TEXTURE_2D, iblTextures.prefiltered);
+        glActiveTexture(GL_TEXTURE0 + BrdfLutUnit);
+        glBindTexture(GL_TEXTURE_2D, iblTextures.brdfLut);
+        
+        // fit the cascades to the player camera. they don't cover the other views, which are drawn without
+        // shadows, their splits are left at zero
+        if (options.shadows) {
+            FrameParams &frame = views[0].frame;
+            
+            shadowCascades.update(frame.view, frame.proj, light.direction, staticSceneVersion);
+            
+            const std::vector<ShadowCascade> &cascades = shadowCascades.getCascades();
+            
+            for (size_t i = 0; i < cascades.size(); i++) {
+                frame.shadowMatrices[i] = cascades[i].textureMatrix;
+                
+                if (cascades[i].staticDirty) {
+                    shadowCascadeUpdates++;
+                }
             }
-            else if (glfwGetKey(window, GLFW_KEY_DOWN)) {
-                playerPosition -= 0.075f * playerDirection;
+            
+            frame.shadowSplits = shadowCascades.getSplits();
+            
+            glActiveTexture(GL_TEXTURE0 + ShadowMapUnit);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMaps.texture);
+        }
+        
+        // animate the node hierarchy. skinned meshes need the bone transforms even without a clip
+        if (animated || skinning) {
+            resetPose(hierarchy, pose);
+            
+            if (animated) {
+                sampleAnimation(clips[0], static_cast<float>(glfwGetTime()), pose);
             }
+            
+            computeGlobalTransforms(hierarchy, pose);
         }
         
-        glClearColor(0.1f, 0.1f, 0.6f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glEnable(GL_DEPTH_TEST);
+        // the nodes with meshes
+        const std::uint32_t *nodes = sceneArena.getMeshNodes();
+        const size_t nodeCount = sceneArena.getMeshNodeCount();
         
-        glUseProgram(program);
-
-        // setup transformation matrices
-        const glm::mat4 proj = glm::perspective(
-            45.0f,
-            static_cast<float>(windowWidth) / static_cast<float>(windowHeight),
-            0.1f,
-            100.0f);
-
-        const glm::mat4 view = glm::lookAt(
-            playerPosition,
-            playerPosition + playerDirection,
-            glm::vec3{0.0f, 1.0f, 0.0f});
-
-        glUniformMatrix4fv(location.uProj, 1, GL_FALSE, glm::value_ptr(proj));
-        glUniformMatrix4fv(location.uView, 1, GL_FALSE, glm::value_ptr(view));
+        threadPool.parallelFor(nodeCount, [&](const size_t n) {
+            nodeModels[n] = animated ? pose.globalTransforms[nodes[n]] : sceneArena.getWorldTransform(nodes[n]);
+        });
         
-        // setup lighting
-        glUniform3fv(location.uLightDirection, 1, glm::value_ptr(light.direction));
-        glUniform4fv(location.uLightAmbient, 1, glm::value_ptr(light.ambient));
-        glUniform4fv(location.uLightDiffuse, 1, glm::value_ptr(light.diffuse));
+        // the bounds are transformed once, and culled by every view
+        transformSpheres(nodeModels.data(), instanceNodes.data(), instanceBounds, worldBounds);
         
-        for (const aiNode *node : sceneNodes.getNodes()) {
-            assert(node);
+        // the casters are culled by each cascade later, not by the views
+        shadowCasters.clear();
+        
+        if (options.shadows) {
+            for (size_t i = 0; i < instanceMeshes.size(); i++) {
+                const std::uint32_t meshIndex = instanceMeshes[i];
+                
+                if (skinning && !skins[meshIndex].empty()) {
+                    continue;
+                }
+                
+                shadowCasters.push_back({&meshes[meshIndex], &nodeModels[instanceNodes[i]], worldBounds.getCenter(i), worldBounds.radius[i], instanceDynamic[i] != 0});
+            }
+            
+            for (const Mesh &mesh : chunkMeshes) {
+                if (!mesh.empty()) {
+                    shadowCasters.push_back({&mesh, &identity, mesh.boundsCenter, mesh.boundsRadius, false});
+                }
+            }
+        }
+        
+        // collect the visible draws of the views in parallel, each one on a thread of the pool
+        threadPool.parallelFor(views.size(), [&](const size_t v) {
+            SceneView &view = views[v];
+            const glm::mat4 &viewMatrix = view.frame.view;
+            const Frustum frustum = extractFrustum(view.frame.proj * viewMatrix);
             
-            const glm::mat4 model = computeNodeTransformation(node);
+            cullSpheres(frustum, worldBounds, view.visibility.data());
             
-            glUniformMatrix4fv(location.uModel, 1, GL_FALSE, glm::value_ptr(model));
+            view.drawItems.clear();
+            view.unsortedTransparentItems.clear();
             
-            for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-                const unsigned int meshIndex = node->mMeshes[i];
-                const Mesh &mesh = meshes[meshIndex];
-                const Material material = mesh.material >= 0 ? materials[mesh.material] : Material{};
+            for (size_t i = 0; i < instanceMeshes.size(); i++) {
+                const std::uint32_t meshIndex = instanceMeshes[i];
                 
-                glUniform4fv(location.uMaterialAmbient, 1, glm::value_ptr(material.ambient));
-                glUniform4fv(location.uMaterialDiffuse, 1, glm::value_ptr(material.diffuse));
-                glUniform4fv(location.uMaterialSpecular, 1, glm::value_ptr(material.specular));
+                DrawItem item;
+                item.mesh = &meshes[meshIndex];
+                item.skin = skinning && !skins[meshIndex].empty() ? int(meshIndex) : -1;
+                item.model = item.skin < 0 ? &nodeModels[instanceNodes[i]] : &identity;
                 
-                if (material.diffuseTexture) {
-                    glActiveTexture(GL_TEXTURE0 + 0);
-                    glBindTexture(GL_TEXTURE_2D, material.diffuseTexture);
-                    glUniform1f(location.uMaterialDiffuseSamplerEnable, 1.0f);
-                    glUniform1i(location.uMaterialDiffuseSampler, 0);
-                }
-                else {
-                    glActiveTexture(GL_TEXTURE0 + 0);
-                    glBindTexture(GL_TEXTURE_2D, 0);
-                    glUniform1f(location.uMaterialDiffuseSamplerEnable, 0.0f);
+                // the bounds of the skinned meshes don't follow the animation
+                if (item.skin < 0 && !view.visibility[i]) {
+                    continue;
                 }
                 
-                // render the mesh
-                glBindVertexArray(mesh.vao);
-                if (mesh.indexed) {
-                    glDrawElements(mesh.primitiveType, mesh.count, mesh.indexDataType, nullptr);
+                // the skinned vertices are already in world space
+                const glm::vec3 center = item.skin < 0 ? worldBounds.getCenter(i) : item.mesh->boundsCenter;
+                
+                item.depth = -(viewMatrix * glm::vec4{center, 1.0f}).z;
+                (isTransparent(*item.mesh) ? view.unsortedTransparentItems : view.drawItems).push_back(item);
+            }
+            
+            for (const Mesh &mesh : chunkMeshes) {
+                if (mesh.empty() || !intersects(frustum, mesh.boundsCenter, mesh.boundsRadius)) {
+                    continue;
                 }
-                else {
-                    glDrawArrays(mesh.primitiveType, 0, mesh.count);
+                
+                DrawItem item;
+                item.mesh = &mesh;
+                item.model = &identity;
+                item.depth = -(viewMatrix * glm::vec4{mesh.boundsCenter, 1.0f}).z;
+                
+                (isTransparent(mesh) ? view.unsortedTransparentItems : view.drawItems).push_back(item);
+            }
+            
+            // front to back, so the depth test rejects the occluded fragments early
+            std::sort(view.drawItems.begin(), view.drawItems.end(), [](const DrawItem &a, const DrawItem &b) {
+                return a.depth < b.depth;
+            });
+        });
+        
+        // back to front, the farthest first. the radix sort keys invert the order of the depths. the sorts run
+        // on the pool themselves, so they come after the parallel culling
+        size_t drawCount = 0, transparentCount = 0;
+        
+        for (SceneView &view : views) {
+            view.transparentKeys.resize(view.unsortedTransparentItems.size());
+            view.transparentOrder.resize(view.unsortedTransparentItems.size());
+            
+            for (std::uint32_t i = 0; i < view.unsortedTransparentItems.size(); i++) {
+                view.transparentKeys[i] = ~toSortableKey(view.unsortedTransparentItems[i].depth);
+                view.transparentOrder[i] = i;
+            }
+            
+            view.transparentSorter.sort(view.transparentKeys, view.transparentOrder, &threadPool);
+            view.transparentItems.resize(view.unsortedTransparentItems.size());
+            
+            for (size_t i = 0; i < view.transparentOrder.size(); i++) {
+                view.transparentItems[i] = view.unsortedTransparentItems[view.transparentOrder[i]];
+            }
+            
+            drawCount += view.drawItems.size();
+            transparentCount += view.transparentItems.size();
+        }
+        
+        renderGraph.record(threadPool);
+        
+        if (frameTimer) {
+            frameTimer->begin();
+        }
+        
+        renderGraph.visit([&executor](const RenderPass &, const CommandList &commands) {
+            executor.execute(commands);
+        });
+        
+        if (frameTimer) {
+            frameTimer->end();
+            
+            if (frameTimer->getSampleCount() == FrameStatsInterval) {
+                std::cout << "GPU frame time: " << frameTimer->takeAverage() << " ms, " << drawCount << " draws, " << transparentCount << " transparent in " << views.size() << " views, "
+                    << shadowCascadeUpdates << " static shadow cascade updates"
+                    << (options.depthPrepass ? " (depth prepass)" : "") << std::endl;
+                
+                const LatencyStats::Summary latency = latencyStats.takeSummary();
+                
+                std::cout << "Input to swap completion: " << latency.average << " ms average, " << latency.median << " ms median, " << latency.p99 << " ms 99th percentile, "
+                    << latency.max << " ms max, " << frameFences->takeStallMilliseconds() << " ms waiting for the " << options.framesInFlight << " frames in flight";
+                
+                if (options.pacing.mode == PacingMode::Capped) {
+                    std::cout << ", " << framePacer.takeMissedFrames() << " frames started late, " << framePacer.getSpinMargin() << " ms spin margin";
                 }
+                
+                std::cout << std::endl;
+                
+                shadowCascadeUpdates = 0;
             }
         }
         
-        glFlush();
+        if (frameCapture) {
+            frameCapture->capture();
+            
+            if (frameCapture->getFrameCount() == options.captureFrameCount) {
+                running = false;
+            }
+        }
+
         glfwSwapBuffers(window);
+        frameFences->endFrame(inputTime, frameTimer ? &latencyStats : nullptr);
     }
+    
+    if (frameCapture) {
+        frameCapture->finish();
+        frameCapture->printStats();
+        
+        // the pixel buffers go before the context
+        frameCapture.reset();
+    }
+    
+    // and so do the fences and queries of the frames in flight
+    frameFences.reset();
 
     glfwDestroyWindow(window);
     glfwTerminate();
@@ -0,0 +1,307 @@
+
+#include "animation.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <assimp/scene.h>
+
+#include "assimp_glm.hpp"
+#include "batch_math.hpp"
+
+
+NodeHierarchy::NodeHierarchy(const SceneArena &scene) {
+    parents.resize(scene.getNodeCount());
+    bindTransforms.resize(scene.getNodeCount());
+
+    for (std::uint32_t node = 0; node < scene.getNodeCount(); node++) {
+        const std::uint32_t parent = scene.getNode(node).parent;
+
+        parents[node] = parent == InvalidIndex ? -1 : static_cast<int>(parent);
+        bindTransforms[node] = scene.getLocalTransform(node);
+
+        nameIndices.emplace(scene.getName(node), static_cast<int>(node));
+    }
+}
+
+
+int NodeHierarchy::find(const std::string &name) const {
+    if (auto it = nameIndices.find(name); it != nameIndices.end()) {
+        return it->second;
+    }
+
+    return -1;
+}
+
+
+AnimationClip createAnimationClip(const NodeHierarchy &hierarchy, const aiAnimation *animation) {
+    assert(animation);
+
+    AnimationClip clip;
+
+    // a lot of exporters leave the tick rate unset
+    const double ticksPerSecond = animation->mTicksPerSecond > 0.0 ? animation->mTicksPerSecond : 25.0;
+
+    clip.name = animation->mName.C_Str();
+    clip.duration = static_cast<float>(animation->mDuration / ticksPerSecond);
+
+    for (unsigned int i = 0; i < animation->mNumChannels; i++) {
+        const aiNodeAnim *channel = animation->mChannels[i];
+
+        NodeChannel nodeChannel;
+        nodeChannel.node = hierarchy.find(std::string{channel->mNodeName.C_Str()});
+
+        if (nodeChannel.node < 0) {
+            std::cout << "Animation " << clip.name << " targets the unknown node " << channel->mNodeName.C_Str() << std::endl;
+            continue;
+        }
+
+        for (unsigned int k = 0; k < channel->mNumPositionKeys; k++) {
+            const aiVectorKey &key = channel->mPositionKeys[k];
+            nodeChannel.positions.push_back({float(key.mTime / ticksPerSecond), {key.mValue.x, key.mValue.y, key.mValue.z}});
+        }
+
+        for (unsigned int k = 0; k < channel->mNumRotationKeys; k++) {
+            const aiQuatKey &key = channel->mRotationKeys[k];
+            nodeChannel.rotations.push_back({float(key.mTime / ticksPerSecond), glm::quat{key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z}});
+        }
+
+        for (unsigned int k = 0; k < channel->mNumScalingKeys; k++) {
+            const aiVectorKey &key = channel->mScalingKeys[k];
+            nodeChannel.scalings.push_back({float(key.mTime / ticksPerSecond), {key.mValue.x, key.mValue.y, key.mValue.z}});
+        }
+
+        clip.channels.push_back(std::move(nodeChannel));
+    }
+
+    return clip;
+}
+
+
+// finds the pair of keys around time, and the interpolation factor between them
+template<typename Key>
+static size_t findKey(const std::vector<Key> &keys, const float time, float &factor) {
+    assert(!keys.empty());
+
+    const auto it = std::upper_bound(keys.begin(), keys.end(), time, [](const float t, const Key &key) {
+        return t < key.time;
+    });
+
+    if (it == keys.begin()) {
+        factor = 0.0f;
+        return 0;
+    }
+
+    const size_t next = static_cast<size_t>(it - keys.begin());
+
+    if (next == keys.size()) {
+        factor = 0.0f;
+        return keys.size() - 1;
+    }
+
+    const float span = keys[next].time - keys[next - 1].time;
+    factor = span > 0.0f ? (time - keys[next - 1].time) / span : 0.0f;
+
+    return next - 1;
+}
+
+
+static glm::vec3 sampleVector(const std::vector<VectorKey> &keys, const float time, const glm::vec3 &defaultValue) {
+    if (keys.empty()) {
+        return defaultValue;
+    }
+
+    float factor = 0.0f;
+    const size_t i = findKey(keys, time, factor);
+
+    return factor > 0.0f ? glm::mix(keys[i].value, keys[i + 1].value, factor) : keys[i].value;
+}
+
+
+static glm::quat sampleRotation(const std::vector<RotationKey> &keys, const float time) {
+    if (keys.empty()) {
+        return glm::quat{1.0f, 0.0f, 0.0f, 0.0f};
+    }
+
+    float factor = 0.0f;
+    const size_t i = findKey(keys, time, factor);
+
+    return factor > 0.0f ? glm::normalize(glm::slerp(keys[i].value, keys[i + 1].value, factor)) : keys[i].value;
+}
+
+
+void resetPose(const NodeHierarchy &hierarchy, Pose &pose) {
+    pose.localTransforms.resize(hierarchy.size());
+    pose.globalTransforms.resize(hierarchy.size());
+
+    for (size_t i = 0; i < hierarchy.size(); i++) {
+        pose.localTransforms[i] = hierarchy.getBindTransform(static_cast<int>(i));
+    }
+}
+
+
+void sampleAnimation(const AnimationClip &clip, float time, Pose &pose) {
+    if (clip.duration > 0.0f) {
+        time = std::fmod(time, clip.duration);
+    }
+
+    for (const NodeChannel &channel : clip.channels) {
+        const glm::vec3 position = sampleVector(channel.positions, time, glm::vec3{0.0f});
+        const glm::quat rotation = sampleRotation(channel.rotations, time);
+        const glm::vec3 scaling = sampleVector(channel.scalings, time, glm::vec3{1.0f});
+
+        const glm::mat4 identity = glm::identity<glm::mat4>();
+
+        pose.localTransforms[channel.node] = glm::translate(identity, position) * glm::mat4_cast(rotation) * glm::scale(identity, scaling);
+    }
+}
+
+
+void computeGlobalTransforms(const NodeHierarchy &hierarchy, Pose &pose) {
+    assert(pose.localTransforms.size() == hierarchy.size());
+
+    pose.globalTransforms.resize(hierarchy.size());
+
+    // parents come first, so a single pass is enough
+    concatenateTransforms(hierarchy.getParents(), pose.localTransforms.data(), pose.globalTransforms.data(), hierarchy.size());
+}
+
+
+// true when some key differs from the first one
+template<typename Key>
+static bool changes(const std::vector<Key> &keys) {
+    return std::any_of(keys.begin(), keys.end(), [&](const Key &key) {
+        return key.value != keys.front().value;
+    });
+}
+
+
+std::vector<std::uint8_t> findAnimatedNodes(const NodeHierarchy &hierarchy, const AnimationClip &clip) {
+    std::vector<std::uint8_t> animated(hierarchy.size(), 0);
+
+    // a channel with constant keys poses its node once, and leaves it there
+    for (const NodeChannel &channel : clip.channels) {
+        if (channel.node >= 0 && (changes(channel.positions) || changes(channel.rotations) || changes(channel.scalings))) {
+            animated[channel.node] = 1;
+        }
+    }
+
+    // parents come first, so a single pass reaches every descendant
+    for (size_t node = 0; node < hierarchy.size(); node++) {
+        const int parent = hierarchy.getParent(int(node));
+
+        if (parent >= 0 && animated[parent]) {
+            animated[node] = 1;
+        }
+    }
+
+    return animated;
+}
+
+
+SkinnedMesh createSkinnedMesh(const NodeHierarchy &hierarchy, const aiMesh *mesh, const int meshNode) {
+    SkinnedMesh skin;
+
+    if (!mesh || !mesh->HasBones()) {
+        return skin;
+    }
+
+    const size_t paddedCount = (mesh->mNumVertices + 3) / 4 * 4;
+
+    skin.vertexCount = mesh->mNumVertices;
+    skin.boneIndices.resize(paddedCount * MaxBoneInfluences, 0);
+    skin.boneWeights.resize(paddedCount * MaxBoneInfluences, 0.0f);
+
+    // the last palette entry is kept for the node of the mesh
+    const unsigned int maxBones = MaxPaletteBones - 1;
+
+    if (mesh->mNumBones > maxBones) {
+        std::cout << "Mesh " << mesh->mName.C_Str() << " has " << mesh->mNumBones << " bones, only the first " << maxBones << " are used" << std::endl;
+    }
+
+    for (unsigned int b = 0; b < std::min(mesh->mNumBones, maxBones); b++) {
+        const aiBone *bone = mesh->mBones[b];
+
+        SkinBone skinBone;
+        skinBone.node = hierarchy.find(std::string{bone->mName.C_Str()});
+        skinBone.offset = Assimp2Glm(bone->mOffsetMatrix);
+
+        if (skinBone.node < 0) {
+            std::cout << "Bone " << bone->mName.C_Str() << " has no node" << std::endl;
+            skinBone.node = 0;
+        }
+
+        skin.bones.push_back(skinBone);
+
+        // keep the strongest influences of each vertex
+        for (unsigned int w = 0; w < bone->mNumWeights; w++) {
+            const aiVertexWeight &weight = bone->mWeights[w];
+
+            std::uint8_t *indices = &skin.boneIndices[weight.mVertexId * MaxBoneInfluences];
+            float *weights = &skin.boneWeights[weight.mVertexId * MaxBoneInfluences];
+
+            const auto weakest = std::min_element(weights, weights + MaxBoneInfluences) - weights;
+
+            if (weight.mWeight > weights[weakest]) {
+                indices[weakest] = static_cast<std::uint8_t>(b);
+                weights[weakest] = weight.mWeight;
+            }
+        }
+    }
+
+    // the bone placing the unweighted vertices with the node of the mesh, added with the first one
+    int meshBone = -1;
+
+    for (size_t v = 0; v < skin.vertexCount; v++) {
+        std::uint8_t *indices = &skin.boneIndices[v * MaxBoneInfluences];
+        float *weights = &skin.boneWeights[v * MaxBoneInfluences];
+        float sum = 0.0f;
+
+        for (unsigned int k = 0; k < MaxBoneInfluences; k++) {
+            sum += weights[k];
+        }
+
+        if (sum > 0.0f) {
+            for (unsigned int k = 0; k < MaxBoneInfluences; k++) {
+                weights[k] /= sum;
+            }
+
+            continue;
+        }
+
+        if (meshBone < 0) {
+            SkinBone skinBone;
+            skinBone.node = meshNode >= 0 ? meshNode : 0;
+
+            meshBone = static_cast<int>(skin.bones.size());
+            skin.bones.push_back(skinBone);
+        }
+
+        indices[0] = static_cast<std::uint8_t>(meshBone);
+        weights[0] = 1.0f;
+    }
+
+    skin.positionX.resize(paddedCount, 0.0f);
+    skin.positionY.resize(paddedCount, 0.0f);
+    skin.positionZ.resize(paddedCount, 0.0f);
+    skin.normalX.resize(paddedCount, 0.0f);
+    skin.normalY.resize(paddedCount, 0.0f);
+    skin.normalZ.resize(paddedCount, 0.0f);
+
+    for (size_t v = 0; v < skin.vertexCount; v++) {
+        skin.positionX[v] = mesh->mVertices[v].x;
+        skin.positionY[v] = mesh->mVertices[v].y;
+        skin.positionZ[v] = mesh->mVertices[v].z;
+
+        if (mesh->HasNormals()) {
+            skin.normalX[v] = mesh->mNormals[v].x;
+            skin.normalY[v] = mesh->mNormals[v].y;
+            skin.normalZ[v] = mesh->mNormals[v].z;
+        }
+    }
+
+    return skin;
+}
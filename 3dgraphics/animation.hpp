@@ -0,0 +1,103 @@
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "scene_arena.hpp"
+#include "skinning.hpp"
+
+struct aiAnimation;
+struct aiMesh;
+
+
+// the node tree as parent links, parents before their children. the node indices are the ones of the scene arena
+class NodeHierarchy {
+public:
+    explicit NodeHierarchy(const SceneArena &scene);
+
+    size_t size() const {
+        return parents.size();
+    }
+
+    int getParent(const int node) const {
+        return parents[node];
+    }
+
+    // the parent of every node, -1 for the roots
+    const int* getParents() const {
+        return parents.data();
+    }
+
+    const glm::mat4& getBindTransform(const int node) const {
+        return bindTransforms[node];
+    }
+
+    // -1 when the node isn't part of the hierarchy
+    int find(const std::string &name) const;
+
+private:
+    std::vector<int> parents;
+    std::vector<glm::mat4> bindTransforms;
+
+    std::unordered_map<std::string, int> nameIndices;
+};
+
+
+struct Pose {
+    std::vector<glm::mat4> localTransforms;
+    std::vector<glm::mat4> globalTransforms;
+};
+
+
+struct VectorKey {
+    float time = 0.0f;
+    glm::vec3 value = {0.0f, 0.0f, 0.0f};
+};
+
+
+struct RotationKey {
+    float time = 0.0f;
+    glm::quat value;
+};
+
+
+struct NodeChannel {
+    int node = -1;
+
+    std::vector<VectorKey> positions;
+    std::vector<RotationKey> rotations;
+    std::vector<VectorKey> scalings;
+};
+
+
+struct AnimationClip {
+    std::string name;
+
+    // in seconds
+    float duration = 0.0f;
+
+    std::vector<NodeChannel> channels;
+};
+
+
+AnimationClip createAnimationClip(const NodeHierarchy &hierarchy, const aiAnimation *animation);
+
+// resets the pose to the bind transforms
+void resetPose(const NodeHierarchy &hierarchy, Pose &pose);
+
+// overwrites the local transforms of the animated nodes with the clip sampled at time (wrapped to the clip duration)
+void sampleAnimation(const AnimationClip &clip, float time, Pose &pose);
+
+void computeGlobalTransforms(const NodeHierarchy &hierarchy, Pose &pose);
+
+// flags the nodes the clip moves over time: the ones with keys that change, and their descendants
+std::vector<std::uint8_t> findAnimatedNodes(const NodeHierarchy &hierarchy, const AnimationClip &clip);
+
+// extracts the bones and the (up to MaxBoneInfluences) influences of each vertex. the vertices no bone influences
+// are bound to an extra bone, the node holding the mesh, so they follow it instead of collapsing to the origin
+SkinnedMesh createSkinnedMesh(const NodeHierarchy &hierarchy, const aiMesh *mesh, int meshNode);
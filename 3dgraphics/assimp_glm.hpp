@@ -0,0 +1,23 @@
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <assimp/matrix4x4.h>
+
+
+// assimp stores the rows, glm the columns. the conversion to mat4 also narrows the doubles of the
+// ASSIMP_DOUBLE_PRECISION builds
+inline glm::mat4 Assimp2Glm(const aiMatrix4x4& from) {
+    return glm::mat4(glm::transpose(glm::make_mat4(&from.a1)));
+}
+
+
+inline aiMatrix4x4 Glm2Assimp(const glm::mat4& from) {
+    return aiMatrix4x4(
+        from[0][0], from[1][0], from[2][0], from[3][0],
+        from[0][1], from[1][1], from[2][1], from[3][1],
+        from[0][2], from[1][2], from[2][2], from[3][2],
+        from[0][3], from[1][3], from[2][3], from[3][3]
+    );
+}
@@ -0,0 +1,402 @@
+
+#include "batch_math.hpp"
+
+#include <cmath>
+
+#include "batch_math_kernels.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#   define BATCH_MATH_USE_SSE
+#   include <emmintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#   define BATCH_MATH_USE_NEON
+#   include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#   include <intrin.h>
+#endif
+
+
+namespace {
+
+struct ScalarLanes {
+    using Vector = float;
+    static const size_t Width = 1;
+
+    static float set(const float value) { return value; }
+    static float load(const float *values) { return *values; }
+    static void store(float *values, const float value) { *values = value; }
+    static float add(const float a, const float b) { return a + b; }
+    static float mul(const float a, const float b) { return a * b; }
+    static float madd(const float a, const float b, const float c) { return a * b + c; }
+    static float max(const float a, const float b) { return a > b ? a : b; }
+    static float abs(const float value) { return std::abs(value); }
+    static float sqrt(const float value) { return std::sqrt(value); }
+
+    static unsigned int nonNegativeMask(const float value) {
+        return value >= 0.0f ? 1 : 0;
+    }
+
+    static void loadColumns(const float *const *matrices, const int column, float *rows) {
+        for (int row = 0; row < 3; row++) {
+            rows[row] = matrices[0][4 * column + row];
+        }
+    }
+
+    // the sums in the order of glm, so the results are the same
+    static void multiplyMatrix(const float *left, const float *right, float *result) {
+        for (int column = 0; column < 4; column++) {
+            const float *r = right + 4 * column;
+            float sums[4];
+
+            for (int row = 0; row < 4; row++) {
+                sums[row] = left[row] * r[0] + left[4 + row] * r[1] + left[8 + row] * r[2] + left[12 + row] * r[3];
+            }
+
+            for (int row = 0; row < 4; row++) {
+                result[4 * column + row] = sums[row];
+            }
+        }
+    }
+};
+
+
+#if defined(BATCH_MATH_USE_SSE)
+struct SseLanes {
+    using Vector = __m128;
+    static const size_t Width = 4;
+
+    static __m128 set(const float value) { return _mm_set1_ps(value); }
+    static __m128 load(const float *values) { return _mm_loadu_ps(values); }
+    static void store(float *values, const __m128 value) { _mm_storeu_ps(values, value); }
+    static __m128 add(const __m128 a, const __m128 b) { return _mm_add_ps(a, b); }
+    static __m128 mul(const __m128 a, const __m128 b) { return _mm_mul_ps(a, b); }
+    static __m128 madd(const __m128 a, const __m128 b, const __m128 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static __m128 max(const __m128 a, const __m128 b) { return _mm_max_ps(a, b); }
+    static __m128 abs(const __m128 value) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), value); }
+    static __m128 sqrt(const __m128 value) { return _mm_sqrt_ps(value); }
+
+    static unsigned int nonNegativeMask(const __m128 value) {
+        return unsigned(_mm_movemask_ps(_mm_cmpge_ps(value, _mm_setzero_ps())));
+    }
+
+    static void loadColumns(const float *const *matrices, const int column, __m128 *rows) {
+        __m128 a = _mm_loadu_ps(matrices[0] + 4 * column);
+        __m128 b = _mm_loadu_ps(matrices[1] + 4 * column);
+        __m128 c = _mm_loadu_ps(matrices[2] + 4 * column);
+        __m128 d = _mm_loadu_ps(matrices[3] + 4 * column);
+
+        _MM_TRANSPOSE4_PS(a, b, c, d);
+
+        rows[0] = a;
+        rows[1] = b;
+        rows[2] = c;
+    }
+
+    // every column of the result weights the columns of the left matrix with the elements of the right one
+    static void multiplyMatrix(const float *left, const float *right, float *result) {
+        const __m128 l0 = _mm_loadu_ps(left);
+        const __m128 l1 = _mm_loadu_ps(left + 4);
+        const __m128 l2 = _mm_loadu_ps(left + 8);
+        const __m128 l3 = _mm_loadu_ps(left + 12);
+
+        for (int column = 0; column < 4; column++) {
+            const __m128 r = _mm_loadu_ps(right + 4 * column);
+
+            __m128 sum = _mm_mul_ps(l0, _mm_shuffle_ps(r, r, 0x00));
+            sum = _mm_add_ps(sum, _mm_mul_ps(l1, _mm_shuffle_ps(r, r, 0x55)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(l2, _mm_shuffle_ps(r, r, 0xAA)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(l3, _mm_shuffle_ps(r, r, 0xFF)));
+
+            _mm_storeu_ps(result + 4 * column, sum);
+        }
+    }
+};
+#endif
+
+
+#if defined(BATCH_MATH_USE_NEON)
+const std::uint32_t NeonLaneBits[4] = {1, 2, 4, 8};
+
+struct NeonLanes {
+    using Vector = float32x4_t;
+    static const size_t Width = 4;
+
+    static float32x4_t set(const float value) { return vdupq_n_f32(value); }
+    static float32x4_t load(const float *values) { return vld1q_f32(values); }
+    static void store(float *values, const float32x4_t value) { vst1q_f32(values, value); }
+    static float32x4_t add(const float32x4_t a, const float32x4_t b) { return vaddq_f32(a, b); }
+    static float32x4_t mul(const float32x4_t a, const float32x4_t b) { return vmulq_f32(a, b); }
+    static float32x4_t madd(const float32x4_t a, const float32x4_t b, const float32x4_t c) { return vfmaq_f32(c, a, b); }
+    static float32x4_t max(const float32x4_t a, const float32x4_t b) { return vmaxq_f32(a, b); }
+    static float32x4_t abs(const float32x4_t value) { return vabsq_f32(value); }
+    static float32x4_t sqrt(const float32x4_t value) { return vsqrtq_f32(value); }
+
+    static unsigned int nonNegativeMask(const float32x4_t value) {
+        return vaddvq_u32(vandq_u32(vcgeq_f32(value, vdupq_n_f32(0.0f)), vld1q_u32(NeonLaneBits)));
+    }
+
+    static void loadColumns(const float *const *matrices, const int column, float32x4_t *rows) {
+        const float32x4x2_t ab = vtrnq_f32(vld1q_f32(matrices[0] + 4 * column), vld1q_f32(matrices[1] + 4 * column));
+        const float32x4x2_t cd = vtrnq_f32(vld1q_f32(matrices[2] + 4 * column), vld1q_f32(matrices[3] + 4 * column));
+
+        rows[0] = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+        rows[1] = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+        rows[2] = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+    }
+
+    static void multiplyMatrix(const float *left, const float *right, float *result) {
+        const float32x4_t l0 = vld1q_f32(left);
+        const float32x4_t l1 = vld1q_f32(left + 4);
+        const float32x4_t l2 = vld1q_f32(left + 8);
+        const float32x4_t l3 = vld1q_f32(left + 12);
+
+        for (int column = 0; column < 4; column++) {
+            const float32x4_t r = vld1q_f32(right + 4 * column);
+
+            float32x4_t sum = vmulq_laneq_f32(l0, r, 0);
+            sum = vfmaq_laneq_f32(sum, l1, r, 1);
+            sum = vfmaq_laneq_f32(sum, l2, r, 2);
+            sum = vfmaq_laneq_f32(sum, l3, r, 3);
+
+            vst1q_f32(result + 4 * column, sum);
+        }
+    }
+};
+#endif
+
+
+template<typename Lanes>
+constexpr BatchMathKernels createKernels() {
+    return {
+        multiplyTransformsKernel<Lanes>, concatenateTransformsKernel<Lanes>,
+        transformSpheresKernel<Lanes>, transformBoxesKernel<Lanes>, cullSpheresKernel<Lanes>
+    };
+}
+
+}
+
+
+constexpr BatchMathKernels ScalarKernels = createKernels<ScalarLanes>();
+
+#if defined(BATCH_MATH_USE_SSE)
+constexpr BatchMathKernels SseKernels = createKernels<SseLanes>();
+#endif
+
+#if defined(BATCH_MATH_USE_NEON)
+constexpr BatchMathKernels NeonKernels = createKernels<NeonLanes>();
+#endif
+
+
+// the processor and the operating system, which saves the 256 bit registers, support AVX2 and FMA
+static bool isAvx2Supported() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+
+    if (info[0] < 7) {
+        return false;
+    }
+
+    __cpuid(info, 1);
+
+    const bool fma = info[2] & (1 << 12);
+    const bool osxsave = info[2] & (1 << 27);
+    const bool avx = info[2] & (1 << 28);
+
+    if (!fma || !osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+
+    return info[1] & (1 << 5);
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+
+// null for the levels the build or the processor lack
+static const BatchMathKernels* getKernels(const SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Scalar:
+        return &ScalarKernels;
+
+    case SimdLevel::Avx2:
+        return getSupportedSimdLevel() == SimdLevel::Avx2 ? getAvx2BatchMathKernels() : nullptr;
+
+#if defined(BATCH_MATH_USE_SSE)
+    case SimdLevel::Sse2:
+        return &SseKernels;
+#endif
+
+#if defined(BATCH_MATH_USE_NEON)
+    case SimdLevel::Neon:
+        return &NeonKernels;
+#endif
+
+    default:
+        return nullptr;
+    }
+}
+
+
+static SimdLevel detectSimdLevel() {
+    if (getAvx2BatchMathKernels() && isAvx2Supported()) {
+        return SimdLevel::Avx2;
+    }
+
+#if defined(BATCH_MATH_USE_SSE)
+    return SimdLevel::Sse2;
+#elif defined(BATCH_MATH_USE_NEON)
+    return SimdLevel::Neon;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+
+struct ActiveKernels {
+    SimdLevel level;
+    const BatchMathKernels *kernels;
+};
+
+
+static ActiveKernels& getActiveKernels() {
+    static ActiveKernels active {getSupportedSimdLevel(), getKernels(getSupportedSimdLevel())};
+
+    return active;
+}
+
+
+const char* getSimdLevelName(const SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Sse2: return "SSE2";
+    case SimdLevel::Neon: return "NEON";
+    case SimdLevel::Avx2: return "AVX2";
+    default: return "scalar";
+    }
+}
+
+
+SimdLevel getSupportedSimdLevel() {
+    static const SimdLevel level = detectSimdLevel();
+
+    return level;
+}
+
+
+SimdLevel getSimdLevel() {
+    return getActiveKernels().level;
+}
+
+
+SimdLevel setSimdLevel(SimdLevel level) {
+    if (!getKernels(level)) {
+        level = getSupportedSimdLevel();
+    }
+
+    getActiveKernels() = {level, getKernels(level)};
+
+    return level;
+}
+
+
+void SphereArray::resize(const size_t count) {
+    centerX.resize(count);
+    centerY.resize(count);
+    centerZ.resize(count);
+    radius.resize(count);
+}
+
+
+void SphereArray::set(const size_t index, const glm::vec3 &center, const float radius) {
+    centerX[index] = center.x;
+    centerY[index] = center.y;
+    centerZ[index] = center.z;
+    this->radius[index] = radius;
+}
+
+
+void BoxArray::resize(const size_t count) {
+    centerX.resize(count);
+    centerY.resize(count);
+    centerZ.resize(count);
+    extentX.resize(count);
+    extentY.resize(count);
+    extentZ.resize(count);
+}
+
+
+void BoxArray::set(const size_t index, const glm::vec3 &center, const glm::vec3 &extent) {
+    centerX[index] = center.x;
+    centerY[index] = center.y;
+    centerZ[index] = center.z;
+    extentX[index] = extent.x;
+    extentY[index] = extent.y;
+    extentZ[index] = extent.z;
+}
+
+
+void multiplyTransforms(const glm::mat4 *lefts, const glm::mat4 *rights, glm::mat4 *results, const size_t count) {
+    getActiveKernels().kernels->multiplyTransforms(
+        reinterpret_cast<const float*>(lefts), reinterpret_cast<const float*>(rights), reinterpret_cast<float*>(results), count
+    );
+}
+
+
+void concatenateTransforms(const int *parents, const glm::mat4 *locals, glm::mat4 *worlds, const size_t count) {
+    getActiveKernels().kernels->concatenateTransforms(parents, reinterpret_cast<const float*>(locals), reinterpret_cast<float*>(worlds), count);
+}
+
+
+void transformSpheres(const glm::mat4 *models, const std::uint32_t *modelIndices, const SphereArray &local, SphereArray &world) {
+    const size_t count = local.size();
+    world.resize(count);
+
+    const float *const in[] = {local.centerX.data(), local.centerY.data(), local.centerZ.data(), local.radius.data()};
+    float *const out[] = {world.centerX.data(), world.centerY.data(), world.centerZ.data(), world.radius.data()};
+    const float *matrices = reinterpret_cast<const float*>(models);
+
+    const size_t done = getActiveKernels().kernels->transformSpheres(matrices, modelIndices, in, out, 0, count);
+    ScalarKernels.transformSpheres(matrices, modelIndices, in, out, done, count);
+}
+
+
+void transformBoxes(const glm::mat4 *models, const std::uint32_t *modelIndices, const BoxArray &local, BoxArray &world) {
+    const size_t count = local.size();
+    world.resize(count);
+
+    const float *const in[] = {
+        local.centerX.data(), local.centerY.data(), local.centerZ.data(), local.extentX.data(), local.extentY.data(), local.extentZ.data()
+    };
+
+    float *const out[] = {
+        world.centerX.data(), world.centerY.data(), world.centerZ.data(), world.extentX.data(), world.extentY.data(), world.extentZ.data()
+    };
+
+    const float *matrices = reinterpret_cast<const float*>(models);
+
+    const size_t done = getActiveKernels().kernels->transformBoxes(matrices, modelIndices, in, out, 0, count);
+    ScalarKernels.transformBoxes(matrices, modelIndices, in, out, done, count);
+}
+
+
+size_t cullSpheres(const Frustum &frustum, const SphereArray &spheres, std::uint8_t *visible) {
+    const float *const in[] = {spheres.centerX.data(), spheres.centerY.data(), spheres.centerZ.data(), spheres.radius.data()};
+    const float *planes = &frustum.planes[0].x;
+    size_t visibleCount = 0;
+
+    const size_t done = getActiveKernels().kernels->cullSpheres(planes, in, visible, 0, spheres.size(), visibleCount);
+    ScalarKernels.cullSpheres(planes, in, visible, done, spheres.size(), visibleCount);
+
+    return visibleCount;
+}
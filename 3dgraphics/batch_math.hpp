@@ -0,0 +1,91 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "frustum.hpp"
+
+
+// the instruction sets of the kernels, from the slowest
+enum class SimdLevel {
+    Scalar,
+    Sse2,
+    Neon,
+    Avx2
+};
+
+
+const char* getSimdLevelName(SimdLevel level);
+
+// the best level the build and the processor support, detected once
+SimdLevel getSupportedSimdLevel();
+
+// the level the kernels run with, the supported one unless changed
+SimdLevel getSimdLevel();
+
+// for comparisons, not while the kernels run. the levels the build or the processor lack fall back to the
+// supported one, and the level set is returned
+SimdLevel setSimdLevel(SimdLevel level);
+
+
+// bounding spheres as a structure of arrays, so the kernels load several of them at once
+struct SphereArray {
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> radius;
+
+    size_t size() const {
+        return radius.size();
+    }
+
+    void resize(size_t count);
+
+    void set(size_t index, const glm::vec3 &center, float radius);
+
+    glm::vec3 getCenter(size_t index) const {
+        return {centerX[index], centerY[index], centerZ[index]};
+    }
+};
+
+
+// axis aligned boxes as centers and half extents
+struct BoxArray {
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+
+    size_t size() const {
+        return centerX.size();
+    }
+
+    void resize(size_t count);
+
+    void set(size_t index, const glm::vec3 &center, const glm::vec3 &extent);
+
+    glm::vec3 getCenter(size_t index) const {
+        return {centerX[index], centerY[index], centerZ[index]};
+    }
+
+    glm::vec3 getExtent(size_t index) const {
+        return {extentX[index], extentY[index], extentZ[index]};
+    }
+};
+
+
+// results[i] = lefts[i] * rights[i]
+void multiplyTransforms(const glm::mat4 *lefts, const glm::mat4 *rights, glm::mat4 *results, size_t count);
+
+// worlds[i] = worlds[parents[i]] * locals[i], or locals[i] for the negative parents. the parents come before
+// their children, so a single pass is enough
+void concatenateTransforms(const int *parents, const glm::mat4 *locals, glm::mat4 *worlds, size_t count);
+
+// places the local spheres with the models[modelIndices[i]] transforms, or models[i] when the indices are null.
+// the radius grows with the largest scale of the transform
+void transformSpheres(const glm::mat4 *models, const std::uint32_t *modelIndices, const SphereArray &local, SphereArray &world);
+
+// the world boxes enclose the transformed local boxes
+void transformBoxes(const glm::mat4 *models, const std::uint32_t *modelIndices, const BoxArray &local, BoxArray &world);
+
+// visible[i] is 1 for the spheres that intersect the frustum and 0 for the rest. returns the visible count
+size_t cullSpheres(const Frustum &frustum, const SphereArray &spheres, std::uint8_t *visible);
@@ -0,0 +1,88 @@
+
+// The AVX2 kernels, in a file of their own built with AVX2 and FMA enabled. They only run once batch_math.cpp
+// has checked the processor supports them. Nothing with external linkage is used here, the standard library and
+// glm included, so the linker can't pick AVX2 copies of the inline functions for the rest of the program.
+
+#include "batch_math_kernels.hpp"
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+
+
+namespace {
+
+struct Avx2Lanes {
+    using Vector = __m256;
+    static const size_t Width = 8;
+
+    static __m256 set(const float value) { return _mm256_set1_ps(value); }
+    static __m256 load(const float *values) { return _mm256_loadu_ps(values); }
+    static void store(float *values, const __m256 value) { _mm256_storeu_ps(values, value); }
+    static __m256 add(const __m256 a, const __m256 b) { return _mm256_add_ps(a, b); }
+    static __m256 mul(const __m256 a, const __m256 b) { return _mm256_mul_ps(a, b); }
+    static __m256 madd(const __m256 a, const __m256 b, const __m256 c) { return _mm256_fmadd_ps(a, b, c); }
+    static __m256 max(const __m256 a, const __m256 b) { return _mm256_max_ps(a, b); }
+    static __m256 abs(const __m256 value) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), value); }
+    static __m256 sqrt(const __m256 value) { return _mm256_sqrt_ps(value); }
+
+    static unsigned int nonNegativeMask(const __m256 value) {
+        return unsigned(_mm256_movemask_ps(_mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_GE_OQ)));
+    }
+
+    // the first four matrices in the low halves and the others in the high ones. the unpacks and shuffles work
+    // on each half, so they transpose both at once
+    static __m256 loadColumn(const float *const *matrices, const int lane, const int column) {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(matrices[lane] + 4 * column)), _mm_loadu_ps(matrices[lane + 4] + 4 * column), 1);
+    }
+
+    static void loadColumns(const float *const *matrices, const int column, __m256 *rows) {
+        const __m256 ab0 = _mm256_unpacklo_ps(loadColumn(matrices, 0, column), loadColumn(matrices, 1, column));
+        const __m256 ab1 = _mm256_unpackhi_ps(loadColumn(matrices, 0, column), loadColumn(matrices, 1, column));
+        const __m256 cd0 = _mm256_unpacklo_ps(loadColumn(matrices, 2, column), loadColumn(matrices, 3, column));
+        const __m256 cd1 = _mm256_unpackhi_ps(loadColumn(matrices, 2, column), loadColumn(matrices, 3, column));
+
+        rows[0] = _mm256_shuffle_ps(ab0, cd0, 0x44);
+        rows[1] = _mm256_shuffle_ps(ab0, cd0, 0xEE);
+        rows[2] = _mm256_shuffle_ps(ab1, cd1, 0x44);
+    }
+
+    // two columns of the result at a time, each half of the registers with the left matrix and one column
+    static void multiplyMatrix(const float *left, const float *right, float *result) {
+        const __m256 l0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(left));
+        const __m256 l1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(left + 4));
+        const __m256 l2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(left + 8));
+        const __m256 l3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(left + 12));
+
+        for (int column = 0; column < 4; column += 2) {
+            const __m256 r = _mm256_loadu_ps(right + 4 * column);
+
+            __m256 sum = _mm256_mul_ps(l0, _mm256_permute_ps(r, 0x00));
+            sum = _mm256_fmadd_ps(l1, _mm256_permute_ps(r, 0x55), sum);
+            sum = _mm256_fmadd_ps(l2, _mm256_permute_ps(r, 0xAA), sum);
+            sum = _mm256_fmadd_ps(l3, _mm256_permute_ps(r, 0xFF), sum);
+
+            _mm256_storeu_ps(result + 4 * column, sum);
+        }
+    }
+};
+
+
+const BatchMathKernels Avx2Kernels = {
+    multiplyTransformsKernel<Avx2Lanes>, concatenateTransformsKernel<Avx2Lanes>,
+    transformSpheresKernel<Avx2Lanes>, transformBoxesKernel<Avx2Lanes>, cullSpheresKernel<Avx2Lanes>
+};
+
+}
+
+
+const BatchMathKernels* getAvx2BatchMathKernels() {
+    return &Avx2Kernels;
+}
+
+#else
+
+const BatchMathKernels* getAvx2BatchMathKernels() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,181 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+// The kernels of an instruction set, on raw arrays: the matrices are 16 floats in glm order, the spheres the
+// centerX, centerY, centerZ and radius arrays and the boxes the center and extent ones. The batched kernels start
+// at the first element and stop before the count once less than their width is left. They return where they
+// stopped, and the scalar kernels do the rest.
+struct BatchMathKernels {
+    void (*multiplyTransforms)(const float *lefts, const float *rights, float *results, size_t count);
+    void (*concatenateTransforms)(const int *parents, const float *locals, float *worlds, size_t count);
+
+    size_t (*transformSpheres)(const float *models, const std::uint32_t *modelIndices, const float *const *local, float *const *world, size_t first, size_t count);
+    size_t (*transformBoxes)(const float *models, const std::uint32_t *modelIndices, const float *const *local, float *const *world, size_t first, size_t count);
+
+    // the planes are 24 floats, as in Frustum. adds the visible spheres to the visible count
+    size_t (*cullSpheres)(const float *planes, const float *const *spheres, std::uint8_t *visible, size_t first, size_t count, size_t &visibleCount);
+};
+
+
+// null when the build has no AVX2 kernels
+const BatchMathKernels* getAvx2BatchMathKernels();
+
+
+// The kernels written once for every instruction set. Lanes wraps the vector type, with Width floats, its
+// operations, the transposed load of the matrices, and the product of two matrices. The product reads a column of the right matrix before writing that
+// column of the result, so the hierarchy can be concatenated in place. The kernels are in an anonymous namespace,
+// so each translation unit keeps its own instances, compiled with its own flags.
+namespace {
+
+// the elements of the matrices of Width consecutive elements, one vector per element. Lanes::loadColumns
+// transposes the rows of a column of the matrices into vectors, leaving out the last one
+template<typename Lanes>
+struct MatrixLanes {
+    typename Lanes::Vector m[12];
+
+    MatrixLanes(const float *models, const std::uint32_t *modelIndices, const size_t first) {
+        const float *matrices[Lanes::Width];
+
+        for (size_t lane = 0; lane < Lanes::Width; lane++) {
+            matrices[lane] = models + 16 * (modelIndices ? modelIndices[first + lane] : first + lane);
+        }
+
+        for (int column = 0; column < 4; column++) {
+            Lanes::loadColumns(matrices, column, m + 3 * column);
+        }
+    }
+
+    // element of the column and row, as in glm
+    const typename Lanes::Vector& get(const int column, const int row) const {
+        return m[3 * column + row];
+    }
+};
+
+
+template<typename Lanes>
+void multiplyTransformsKernel(const float *lefts, const float *rights, float *results, const size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        Lanes::multiplyMatrix(lefts + 16 * i, rights + 16 * i, results + 16 * i);
+    }
+}
+
+
+template<typename Lanes>
+void concatenateTransformsKernel(const int *parents, const float *locals, float *worlds, const size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (parents[i] < 0) {
+            for (int k = 0; k < 16; k++) {
+                worlds[16 * i + k] = locals[16 * i + k];
+            }
+        }
+        else {
+            Lanes::multiplyMatrix(worlds + 16 * size_t(parents[i]), locals + 16 * i, worlds + 16 * i);
+        }
+    }
+}
+
+
+template<typename Lanes>
+size_t transformSpheresKernel(const float *models, const std::uint32_t *modelIndices, const float *const *local, float *const *world, const size_t first, const size_t count) {
+    using Vector = typename Lanes::Vector;
+
+    size_t i = first;
+
+    for (; i + Lanes::Width <= count; i += Lanes::Width) {
+        const MatrixLanes<Lanes> matrix {models, modelIndices, i};
+
+        const Vector x = Lanes::load(local[0] + i);
+        const Vector y = Lanes::load(local[1] + i);
+        const Vector z = Lanes::load(local[2] + i);
+
+        for (int row = 0; row < 3; row++) {
+            const Vector sum = Lanes::madd(matrix.get(0, row), x, Lanes::madd(matrix.get(1, row), y, Lanes::madd(matrix.get(2, row), z, matrix.get(3, row))));
+            Lanes::store(world[row] + i, sum);
+        }
+
+        // the largest squared length of the axes
+        Vector scale = Lanes::set(0.0f);
+
+        for (int column = 0; column < 3; column++) {
+            const Vector &ax = matrix.get(column, 0), &ay = matrix.get(column, 1), &az = matrix.get(column, 2);
+            scale = Lanes::max(scale, Lanes::madd(ax, ax, Lanes::madd(ay, ay, Lanes::mul(az, az))));
+        }
+
+        Lanes::store(world[3] + i, Lanes::mul(Lanes::load(local[3] + i), Lanes::sqrt(scale)));
+    }
+
+    return i;
+}
+
+
+template<typename Lanes>
+size_t transformBoxesKernel(const float *models, const std::uint32_t *modelIndices, const float *const *local, float *const *world, const size_t first, const size_t count) {
+    using Vector = typename Lanes::Vector;
+
+    size_t i = first;
+
+    for (; i + Lanes::Width <= count; i += Lanes::Width) {
+        const MatrixLanes<Lanes> matrix {models, modelIndices, i};
+
+        const Vector x = Lanes::load(local[0] + i);
+        const Vector y = Lanes::load(local[1] + i);
+        const Vector z = Lanes::load(local[2] + i);
+        const Vector ex = Lanes::load(local[3] + i);
+        const Vector ey = Lanes::load(local[4] + i);
+        const Vector ez = Lanes::load(local[5] + i);
+
+        // the extents of the transformed box add up the absolute axes (Arvo)
+        for (int row = 0; row < 3; row++) {
+            const Vector &m0 = matrix.get(0, row), &m1 = matrix.get(1, row), &m2 = matrix.get(2, row);
+
+            Lanes::store(world[row] + i, Lanes::madd(m0, x, Lanes::madd(m1, y, Lanes::madd(m2, z, matrix.get(3, row)))));
+            Lanes::store(world[3 + row] + i, Lanes::madd(Lanes::abs(m0), ex, Lanes::madd(Lanes::abs(m1), ey, Lanes::mul(Lanes::abs(m2), ez))));
+        }
+    }
+
+    return i;
+}
+
+
+template<typename Lanes>
+size_t cullSpheresKernel(const float *planes, const float *const *spheres, std::uint8_t *visible, const size_t first, const size_t count, size_t &visibleCount) {
+    using Vector = typename Lanes::Vector;
+
+    size_t i = first;
+
+    Vector planeLanes[6][4];
+
+    for (int plane = 0; plane < 6; plane++) {
+        for (int k = 0; k < 4; k++) {
+            planeLanes[plane][k] = Lanes::set(planes[4 * plane + k]);
+        }
+    }
+
+    for (; i + Lanes::Width <= count; i += Lanes::Width) {
+        const Vector x = Lanes::load(spheres[0] + i);
+        const Vector y = Lanes::load(spheres[1] + i);
+        const Vector z = Lanes::load(spheres[2] + i);
+        const Vector radius = Lanes::load(spheres[3] + i);
+
+        // outside when the sphere is entirely behind a plane, the distance plus the radius below zero
+        unsigned int mask = ~0u;
+
+        for (int plane = 0; plane < 6 && mask; plane++) {
+            const Vector (&p)[4] = planeLanes[plane];
+            mask &= Lanes::nonNegativeMask(Lanes::madd(p[0], x, Lanes::madd(p[1], y, Lanes::madd(p[2], z, Lanes::add(p[3], radius)))));
+        }
+
+        for (size_t lane = 0; lane < Lanes::Width; lane++) {
+            visible[i + lane] = (mask >> lane) & 1;
+            visibleCount += (mask >> lane) & 1;
+        }
+    }
+
+    return i;
+}
+
+}
@@ -0,0 +1,229 @@
+
+// concatenates a node hierarchy, and transforms and culls the bounding spheres and boxes of its instances, with
+// per node glm code as 3dgraphics did, and with the batched kernels of every instruction set the machine supports.
+// reports the time of each and checks the batched results against glm.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../batch_math.hpp"
+
+
+const int Repetitions = 20;
+
+const SimdLevel Levels[] = {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Neon, SimdLevel::Avx2};
+
+
+struct Scene {
+    std::vector<int> parents;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+
+    // the instances of the nodes, with their local bounds
+    std::vector<std::uint32_t> instanceNodes;
+    SphereArray spheres;
+    BoxArray boxes;
+};
+
+
+// a rotation about the vertical axis, a scale and a translation
+static glm::mat4 createTransform(const float angle, const float scale, const glm::vec3 &position) {
+    glm::mat4 transform {1.0f};
+    transform[0] = glm::vec4{std::cos(angle) * scale, 0.0f, -std::sin(angle) * scale, 0.0f};
+    transform[1] = glm::vec4{0.0f, scale, 0.0f, 0.0f};
+    transform[2] = glm::vec4{std::sin(angle) * scale, 0.0f, std::cos(angle) * scale, 0.0f};
+    transform[3] = glm::vec4{position, 1.0f};
+
+    return transform;
+}
+
+
+static Scene createScene(const size_t nodeCount) {
+    std::mt19937 random {std::uint32_t(nodeCount)};
+    std::uniform_real_distribution<float> unit {0.0f, 1.0f};
+
+    Scene scene;
+    scene.parents.resize(nodeCount);
+    scene.locals.resize(nodeCount);
+    scene.worlds.resize(nodeCount);
+
+    // shallow trees, as the imported scenes tend to be
+    for (size_t i = 0; i < nodeCount; i++) {
+        scene.parents[i] = i < 16 ? -1 : int(random() % std::min<size_t>(i, 1 + i / 4));
+        scene.locals[i] = createTransform(6.28f * unit(random), 0.8f + 0.4f * unit(random), glm::vec3{
+            40.0f * unit(random) - 20.0f, 2.0f * unit(random), 40.0f * unit(random) - 20.0f
+        });
+    }
+
+    const size_t instanceCount = 2 * nodeCount;
+    scene.instanceNodes.resize(instanceCount);
+    scene.spheres.resize(instanceCount);
+    scene.boxes.resize(instanceCount);
+
+    for (size_t i = 0; i < instanceCount; i++) {
+        const glm::vec3 center {unit(random) - 0.5f, unit(random), unit(random) - 0.5f};
+        const glm::vec3 extent {0.1f + unit(random), 0.1f + unit(random), 0.1f + unit(random)};
+
+        scene.instanceNodes[i] = std::uint32_t(random() % nodeCount);
+        scene.spheres.set(i, center, glm::length(extent));
+        scene.boxes.set(i, center, extent);
+    }
+
+    return scene;
+}
+
+
+static double measure(const std::function<void()> &task) {
+    double best = 1e30;
+
+    for (int i = 0; i < Repetitions; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        task();
+        const auto end = std::chrono::steady_clock::now();
+
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    return best;
+}
+
+
+static float getMaxScale(const glm::mat4 &transform) {
+    return std::sqrt(std::max({
+        glm::dot(glm::vec3{transform[0]}, glm::vec3{transform[0]}),
+        glm::dot(glm::vec3{transform[1]}, glm::vec3{transform[1]}),
+        glm::dot(glm::vec3{transform[2]}, glm::vec3{transform[2]})
+    }));
+}
+
+
+static bool isClose(const float a, const float b) {
+    return std::abs(a - b) <= 1e-4f * std::max(1.0f, std::abs(a));
+}
+
+
+static void benchmark(const size_t nodeCount, const Frustum &frustum) {
+    Scene scene = createScene(nodeCount);
+    const size_t instanceCount = scene.instanceNodes.size();
+
+    // the per node code
+    std::vector<glm::mat4> glmWorlds(nodeCount);
+    std::vector<glm::vec3> glmCenters(instanceCount), glmBoxCenters(instanceCount), glmBoxExtents(instanceCount);
+    std::vector<float> glmRadii(instanceCount);
+    size_t glmVisible = 0;
+
+    const double glmHierarchy = measure([&]() {
+        for (size_t i = 0; i < nodeCount; i++) {
+            glmWorlds[i] = scene.parents[i] < 0 ? scene.locals[i] : glmWorlds[scene.parents[i]] * scene.locals[i];
+        }
+    });
+
+    const double glmSpheres = measure([&]() {
+        glmVisible = 0;
+
+        for (size_t i = 0; i < instanceCount; i++) {
+            const glm::mat4 &model = glmWorlds[scene.instanceNodes[i]];
+
+            glmCenters[i] = model * glm::vec4{scene.spheres.getCenter(i), 1.0f};
+            glmRadii[i] = scene.spheres.radius[i] * getMaxScale(model);
+            glmVisible += intersects(frustum, glmCenters[i], glmRadii[i]) ? 1 : 0;
+        }
+    });
+
+    const double glmBoxes = measure([&]() {
+        for (size_t i = 0; i < instanceCount; i++) {
+            const glm::mat4 &model = glmWorlds[scene.instanceNodes[i]];
+            const glm::vec3 extent = scene.boxes.getExtent(i);
+
+            glmBoxCenters[i] = model * glm::vec4{scene.boxes.getCenter(i), 1.0f};
+            glmBoxExtents[i] = glm::abs(glm::vec3{model[0]}) * extent.x + glm::abs(glm::vec3{model[1]}) * extent.y + glm::abs(glm::vec3{model[2]}) * extent.z;
+        }
+    });
+
+    std::cout << std::fixed << std::setprecision(3)
+        << std::setw(8) << nodeCount << std::setw(10) << "glm"
+        << std::setw(14) << glmHierarchy << std::setw(14) << glmSpheres << std::setw(14) << glmBoxes
+        << std::setw(10) << glmVisible << std::endl;
+
+    // the batched kernels
+    SphereArray worldSpheres;
+    BoxArray worldBoxes;
+    std::vector<std::uint8_t> visible(instanceCount);
+
+    for (const SimdLevel level : Levels) {
+        if (setSimdLevel(level) != level) {
+            continue;
+        }
+
+        size_t visibleCount = 0;
+
+        const double hierarchy = measure([&]() {
+            concatenateTransforms(scene.parents.data(), scene.locals.data(), scene.worlds.data(), nodeCount);
+        });
+
+        const double spheres = measure([&]() {
+            transformSpheres(scene.worlds.data(), scene.instanceNodes.data(), scene.spheres, worldSpheres);
+            visibleCount = cullSpheres(frustum, worldSpheres, visible.data());
+        });
+
+        const double boxes = measure([&]() {
+            transformBoxes(scene.worlds.data(), scene.instanceNodes.data(), scene.boxes, worldBoxes);
+        });
+
+        size_t mismatches = 0;
+
+        for (size_t i = 0; i < nodeCount; i++) {
+            for (int k = 0; k < 16; k++) {
+                mismatches += isClose(scene.worlds[i][k / 4][k % 4], glmWorlds[i][k / 4][k % 4]) ? 0 : 1;
+            }
+        }
+
+        for (size_t i = 0; i < instanceCount; i++) {
+            const glm::vec3 center = worldSpheres.getCenter(i), boxCenter = worldBoxes.getCenter(i), extent = worldBoxes.getExtent(i);
+
+            for (int k = 0; k < 3; k++) {
+                mismatches += isClose(center[k], glmCenters[i][k]) && isClose(boxCenter[k], glmBoxCenters[i][k]) && isClose(extent[k], glmBoxExtents[i][k]) ? 0 : 1;
+            }
+
+            mismatches += isClose(worldSpheres.radius[i], glmRadii[i]) ? 0 : 1;
+        }
+
+        std::cout << std::setw(8) << "" << std::setw(10) << getSimdLevelName(level)
+            << std::setw(14) << hierarchy << std::setw(14) << spheres << std::setw(14) << boxes
+            << std::setw(10) << visibleCount;
+
+        if (mismatches > 0) {
+            std::cout << "   " << mismatches << " results differ from glm";
+        }
+
+        std::cout << std::endl;
+    }
+
+    setSimdLevel(getSupportedSimdLevel());
+}
+
+
+int main() {
+    const glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    const glm::mat4 view = glm::lookAt(glm::vec3{0.0f, 10.0f, 30.0f}, glm::vec3{0.0f}, glm::vec3{0.0f, 1.0f, 0.0f});
+    const Frustum frustum = extractFrustum(proj * view);
+
+    std::cout << std::setw(8) << "nodes" << std::setw(10) << "kernels"
+        << std::setw(14) << "hierarchy ms" << std::setw(14) << "spheres ms" << std::setw(14) << "boxes ms"
+        << std::setw(10) << "visible"
+        << "   (" << getSimdLevelName(getSupportedSimdLevel()) << " supported, twice as many instances as nodes)" << std::endl;
+
+    for (const size_t nodeCount : {1000, 10000, 100000}) {
+        benchmark(nodeCount, frustum);
+    }
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+
+// starts frames at a fixed rate by sleeping until each deadline, and with the sleep and spin FramePacer, and
+// reports how far the frame intervals stray from the period with each one. run it on a loaded machine too, the
+// sleeps get worse and the pacer adapts its spin margin to them.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+#include "../frame_pacing.hpp"
+
+
+const int Frames = 600;
+
+const double FrameRate = 144.0;
+
+
+struct IntervalStats {
+    double average = 0.0;
+    double deviation = 0.0;
+    double worst = 0.0;
+};
+
+
+// the intervals between the starts of the frames, in milliseconds
+static IntervalStats measure(const std::function<void()> &waitForNextFrame) {
+    std::vector<double> intervals;
+
+    waitForNextFrame();
+    auto last = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < Frames; i++) {
+        waitForNextFrame();
+
+        const auto now = std::chrono::steady_clock::now();
+        intervals.push_back(std::chrono::duration<double, std::milli>(now - last).count());
+        last = now;
+    }
+
+    const double period = 1000.0 / FrameRate;
+
+    IntervalStats stats;
+
+    for (const double interval : intervals) {
+        stats.average += interval / intervals.size();
+        stats.deviation += (interval - period) * (interval - period) / intervals.size();
+        stats.worst = std::max(stats.worst, std::abs(interval - period));
+    }
+
+    stats.deviation = std::sqrt(stats.deviation);
+
+    return stats;
+}
+
+
+int main() {
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / FrameRate));
+    auto deadline = std::chrono::steady_clock::now();
+
+    const IntervalStats sleepStats = measure([&]() {
+        deadline += period;
+        std::this_thread::sleep_until(deadline);
+    });
+
+    FramePacingParams params;
+    params.mode = PacingMode::Capped;
+    params.frameRate = FrameRate;
+
+    FramePacer pacer {params};
+
+    const IntervalStats pacerStats = measure([&]() {
+        pacer.waitForNextFrame();
+    });
+
+    auto report = [](const char *name, const IntervalStats &stats) {
+        std::cout << std::setw(16) << name << std::setw(10) << stats.average << " ms average" << std::setw(10) << stats.deviation << " ms deviation"
+            << std::setw(10) << stats.worst << " ms worst" << std::endl;
+    };
+
+    std::cout << std::fixed << std::setprecision(3) << Frames << " frames at " << FrameRate << " FPS, " << 1000.0 / FrameRate << " ms apart" << std::endl;
+
+    report("sleep", sleepStats);
+    report("sleep and spin", pacerStats);
+
+    std::cout << "  " << pacer.takeMissedFrames() << " frames started late, " << pacer.getSpinMargin() << " ms spin margin" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,233 @@
+
+// encodes the chunks of a terrain, laid out as the tiler writes them, and decodes them with the scalar and the
+// SSE2 decoders, on one thread and across the chunks on the pool. reports the compressed size, the decoded bytes
+// per second of each decoder next to a plain copy of the raw chunks, and the largest quantization errors.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+#include "../mesh_codec.hpp"
+#include "../thread_pool.hpp"
+
+
+const int Repetitions = 10;
+
+const int ChunkCount = 32;
+
+// cells along each side of a chunk, about 32K vertices and 64K triangles
+const int ChunkCells = 180;
+
+const float ChunkSize = 32.0f;
+
+
+struct Chunk {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<std::uint32_t> indices;
+
+    size_t byteSize() const {
+        return positions.size() * sizeof(glm::vec3) + normals.size() * sizeof(glm::vec3) + texCoords.size() * sizeof(glm::vec2) + indices.size() * sizeof(std::uint32_t);
+    }
+};
+
+
+struct EncodedChunk {
+    std::vector<std::uint8_t> vertices;
+    std::vector<std::uint8_t> indices;
+};
+
+
+static float getHeight(const float x, const float z, const float phase) {
+    return 3.0f * std::sin(0.11f * x + phase) * std::cos(0.07f * z - phase) + 0.4f * std::sin(0.9f * x + 1.3f * z);
+}
+
+
+// a grid of cells, with the vertices numbered in the order the triangles first use them
+static Chunk createChunk(const int chunkX, const int chunkZ) {
+    const float cellSize = ChunkSize / ChunkCells;
+    const float phase = 0.37f * float(chunkX + 3 * chunkZ);
+
+    std::vector<std::uint32_t> remap((ChunkCells + 1) * (ChunkCells + 1), ~0u);
+
+    Chunk chunk;
+
+    auto addVertex = [&](const int i, const int j) {
+        std::uint32_t &index = remap[j * (ChunkCells + 1) + i];
+
+        if (index == ~0u) {
+            const float x = ChunkSize * chunkX + cellSize * i;
+            const float z = ChunkSize * chunkZ + cellSize * j;
+            const float h = 0.01f;
+
+            index = std::uint32_t(chunk.positions.size());
+
+            chunk.positions.push_back({x, getHeight(x, z, phase), z});
+            chunk.normals.push_back(glm::normalize(glm::vec3{
+                getHeight(x - h, z, phase) - getHeight(x + h, z, phase), 2.0f * h, getHeight(x, z - h, phase) - getHeight(x, z + h, phase)
+            }));
+            chunk.texCoords.push_back({x / 4.0f, z / 4.0f});
+        }
+
+        chunk.indices.push_back(index);
+    };
+
+    for (int j = 0; j < ChunkCells; j++) {
+        for (int i = 0; i < ChunkCells; i++) {
+            addVertex(i, j);
+            addVertex(i, j + 1);
+            addVertex(i + 1, j);
+
+            addVertex(i + 1, j);
+            addVertex(i, j + 1);
+            addVertex(i + 1, j + 1);
+        }
+    }
+
+    return chunk;
+}
+
+
+static double measure(const std::function<void()> &task) {
+    double best = 1e30;
+
+    for (int i = 0; i < Repetitions; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        task();
+        const auto end = std::chrono::steady_clock::now();
+
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    return best;
+}
+
+
+int main() {
+    std::vector<Chunk> chunks;
+    size_t rawBytes = 0, vertexCount = 0, indexCount = 0;
+
+    for (int i = 0; i < ChunkCount; i++) {
+        chunks.push_back(createChunk(i % 8, i / 8));
+
+        rawBytes += chunks.back().byteSize();
+        vertexCount += chunks.back().positions.size();
+        indexCount += chunks.back().indices.size();
+    }
+
+    std::vector<EncodedChunk> encoded(ChunkCount);
+
+    const double encodeTime = measure([&]() {
+        for (int i = 0; i < ChunkCount; i++) {
+            const Chunk &chunk = chunks[i];
+
+            encoded[i] = {};
+            encodeVertices(chunk.positions.data(), chunk.normals.data(), chunk.texCoords.data(), chunk.positions.size(), encoded[i].vertices);
+            encodeIndices(chunk.indices.data(), chunk.indices.size(), encoded[i].indices);
+        }
+    });
+
+    size_t vertexBytes = 0, indexBytes = 0;
+
+    for (const EncodedChunk &chunk : encoded) {
+        vertexBytes += chunk.vertices.size();
+        indexBytes += chunk.indices.size();
+    }
+
+    std::cout << std::fixed << std::setprecision(2)
+        << ChunkCount << " chunks, " << vertexCount << " vertices, " << indexCount / 3 << " triangles, " << rawBytes / (1024.0 * 1024.0) << " MB raw" << std::endl
+        << "  vertices " << double(vertexBytes) / vertexCount << " bytes each (" << 32.0 * vertexCount / vertexBytes << "x), "
+        << "triangles " << 3.0 * indexBytes / indexCount << " bytes each (" << 4.0 * indexCount / indexBytes << "x), "
+        << "encoded in " << encodeTime << " ms" << std::endl;
+
+    std::vector<Chunk> decoded(ChunkCount);
+
+    for (int i = 0; i < ChunkCount; i++) {
+        decoded[i].positions.resize(chunks[i].positions.size());
+        decoded[i].normals.resize(chunks[i].normals.size());
+        decoded[i].texCoords.resize(chunks[i].texCoords.size());
+        decoded[i].indices.resize(chunks[i].indices.size());
+    }
+
+    bool failed = false;
+
+    auto copyChunk = [&](const size_t i) {
+        std::memcpy(decoded[i].positions.data(), chunks[i].positions.data(), chunks[i].positions.size() * sizeof(glm::vec3));
+        std::memcpy(decoded[i].normals.data(), chunks[i].normals.data(), chunks[i].normals.size() * sizeof(glm::vec3));
+        std::memcpy(decoded[i].texCoords.data(), chunks[i].texCoords.data(), chunks[i].texCoords.size() * sizeof(glm::vec2));
+        std::memcpy(decoded[i].indices.data(), chunks[i].indices.data(), chunks[i].indices.size() * sizeof(std::uint32_t));
+    };
+
+    auto decodeChunkWith = [&](const size_t i, decltype(&decodeVertices) decode, decltype(&decodeIndices) decodeIndices) {
+        Chunk &chunk = decoded[i];
+
+        failed |= !decode(encoded[i].vertices.data(), encoded[i].vertices.size(), chunk.positions.size(), chunk.positions.data(), chunk.normals.data(), chunk.texCoords.data());
+        failed |= !decodeIndices(encoded[i].indices.data(), encoded[i].indices.size(), chunk.indices.data(), chunk.indices.size());
+    };
+
+    ThreadPool pool;
+
+    const double copyTime = measure([&]() {
+        for (int i = 0; i < ChunkCount; i++) {
+            copyChunk(i);
+        }
+    });
+
+    const double scalarTime = measure([&]() {
+        for (int i = 0; i < ChunkCount; i++) {
+            decodeChunkWith(i, decodeVerticesScalar, decodeIndicesScalar);
+        }
+    });
+
+    const double simdTime = measure([&]() {
+        for (int i = 0; i < ChunkCount; i++) {
+            decodeChunkWith(i, decodeVertices, decodeIndices);
+        }
+    });
+
+    const double poolTime = measure([&]() {
+        pool.parallelFor(ChunkCount, [&](const size_t i) {
+            decodeChunkWith(i, decodeVertices, decodeIndices);
+        });
+    });
+
+    auto report = [&](const char *name, const double time) {
+        std::cout << std::setw(24) << name << std::setw(10) << time << " ms" << std::setw(10) << rawBytes / (time * 1e6) << " GB/s" << std::endl;
+    };
+
+    report("copy of the raw chunks", copyTime);
+    report("scalar decoder", scalarTime);
+    report("SSE2 decoder", simdTime);
+    report("SSE2 decoder on the pool", poolTime);
+
+    std::cout << "  (" << pool.getThreadCount() + 1 << " threads on the pool)" << std::endl;
+
+    // the errors of the last decoded chunks
+    float positionError = 0.0f, normalError = 0.0f, texCoordError = 0.0f;
+    size_t indexMismatches = 0;
+
+    for (int i = 0; i < ChunkCount; i++) {
+        for (size_t v = 0; v < chunks[i].positions.size(); v++) {
+            positionError = std::max(positionError, glm::length(decoded[i].positions[v] - chunks[i].positions[v]));
+            normalError = std::max(normalError, std::acos(std::min(glm::dot(decoded[i].normals[v], chunks[i].normals[v]), 1.0f)));
+            texCoordError = std::max(texCoordError, glm::length(decoded[i].texCoords[v] - chunks[i].texCoords[v]));
+        }
+
+        for (size_t k = 0; k < chunks[i].indices.size(); k++) {
+            indexMismatches += decoded[i].indices[k] != chunks[i].indices[k] ? 1 : 0;
+        }
+    }
+
+    std::cout << std::setprecision(5) << "  largest errors: position " << positionError << ", normal " << glm::degrees(normalError) << " degrees, texture coordinate " << texCoordError
+        << ", " << indexMismatches << " indices differ" << (failed ? ", some streams failed to decode" : "") << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+
+// compares the string helpers 3dgraphics used to have against path_utils, on paths of increasing length.
+// the time per character of the path_utils versions should stay flat as the paths grow.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "../path_utils.hpp"
+
+
+namespace naive {
+    std::vector<std::string> split(const std::string &str, const std::string &delimiter) {
+        std::string s = str;
+        std::vector<std::string> tokens;
+
+        size_t pos = 0;
+        while ((pos = s.find(delimiter)) != std::string::npos) {
+            tokens.push_back(s.substr(0, pos));
+            s.erase(0, pos + delimiter.length());
+        }
+
+        tokens.push_back(s);
+
+        return tokens;
+    }
+
+
+    std::string replace_all(const std::string &str, const std::string &search, const std::string &replace) {
+        std::string result = str;
+
+        size_t pos = 0;
+        do {
+            pos = result.find(search);
+
+            if (pos != std::string::npos) {
+                result.replace(pos, search.size(), replace);
+            }
+        }
+        while (pos != std::string::npos);
+
+        return result;
+    }
+}
+
+
+// keeps the optimizer from discarding the benchmarked work
+static volatile size_t sink = 0;
+
+
+template<typename Function>
+double measureNanoseconds(const int iterations, Function &&function) {
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; i++) {
+        function();
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+
+int main() {
+    std::cout << std::setw(10) << "segments" << std::setw(10) << "chars"
+        << std::setw(16) << "naive split" << std::setw(16) << "split"
+        << std::setw(16) << "naive replace" << std::setw(16) << "replace_all"
+        << "   (ns per char)" << std::endl;
+
+    std::vector<std::string_view> tokens;
+    std::string joined;
+    std::string replaced;
+
+    for (int segments = 64; segments <= 65536; segments *= 4) {
+        std::string path;
+
+        for (int i = 0; i < segments; i++) {
+            path += "textures\\";
+        }
+
+        path += "diffuse.png";
+
+        const int iterations = std::max(1, (1 << 20) / segments);
+        const double chars = double(path.size());
+
+        // the naive versions are quadratic, so they are skipped once they take too long
+        const bool runNaive = segments <= 4096;
+
+        const double naiveSplit = runNaive ? measureNanoseconds(iterations, [&] {
+            sink = sink + naive::split(path, "\\").size();
+        }) : 0.0;
+
+        const double fastSplit = measureNanoseconds(iterations, [&] {
+            split(path, "\\", tokens);
+            joined.clear();
+            join(tokens, "/", joined);
+            sink = sink + joined.size();
+        });
+
+        const double naiveReplace = runNaive ? measureNanoseconds(iterations, [&] {
+            sink = sink + naive::replace_all(path, "\\", "/").size();
+        }) : 0.0;
+
+        const double fastReplace = measureNanoseconds(iterations, [&] {
+            replace_all(path, "\\", "/", replaced);
+            sink = sink + replaced.size();
+        });
+
+        std::cout << std::fixed << std::setprecision(2)
+            << std::setw(10) << segments << std::setw(10) << path.size()
+            << std::setw(16) << (runNaive ? naiveSplit / chars : 0.0) << std::setw(16) << fastSplit / chars
+            << std::setw(16) << (runNaive ? naiveReplace / chars : 0.0) << std::setw(16) << fastReplace / chars
+            << std::endl;
+    }
+
+    return 0;
+}
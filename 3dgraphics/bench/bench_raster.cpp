@@ -0,0 +1,165 @@
+
+// renders a synthetic scene of textured spheres with the software rasterizer on an increasing number of threads,
+// and reports the frames and millions of triangles per second of each. also checks that every thread count
+// produces the same image.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../software_rasterizer.hpp"
+#include "../thread_pool.hpp"
+
+
+const unsigned int Width = 1280;
+const unsigned int Height = 720;
+const int Frames = 20;
+
+
+static SoftMesh createSphere(const int rings, const int segments) {
+    SoftMesh mesh;
+    mesh.material = 0;
+
+    for (int ring = 0; ring <= rings; ring++) {
+        const float theta = glm::pi<float>() * float(ring) / float(rings);
+
+        for (int segment = 0; segment <= segments; segment++) {
+            const float phi = 2.0f * glm::pi<float>() * float(segment) / float(segments);
+            const glm::vec3 normal = {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+
+            mesh.positions.push_back(normal);
+            mesh.normals.push_back(normal);
+            mesh.texCoords.push_back({4.0f * float(segment) / float(segments), 2.0f * float(ring) / float(rings)});
+        }
+    }
+
+    for (int ring = 0; ring < rings; ring++) {
+        for (int segment = 0; segment < segments; segment++) {
+            const std::uint32_t a = ring * (segments + 1) + segment, b = a + segments + 1;
+
+            mesh.indices.insert(mesh.indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+        }
+    }
+
+    return mesh;
+}
+
+
+// a grid of size x size spheres over a checkerboard
+static SoftScene createScene(const int size, const int rings) {
+    SoftScene scene;
+
+    scene.meshes.push_back(createSphere(rings, 2 * rings));
+    scene.materials.push_back({});
+    scene.materials[0].diffuseTexture = 0;
+
+    std::vector<std::uint8_t> checker(256 * 256 * 3);
+
+    for (int y = 0; y < 256; y++) {
+        for (int x = 0; x < 256; x++) {
+            const std::uint8_t value = ((x / 32) + (y / 32)) % 2 ? 230 : 40;
+
+            checker[3 * (y * 256 + x) + 0] = value;
+            checker[3 * (y * 256 + x) + 1] = value;
+            checker[3 * (y * 256 + x) + 2] = 255 - value;
+        }
+    }
+
+    scene.textures.push_back(createSoftTexture(256, 256, 3, checker.data()));
+
+    for (int z = 0; z < size; z++) {
+        for (int x = 0; x < size; x++) {
+            SoftInstance instance;
+            instance.model[3] = glm::vec4{2.5f * (x - 0.5f * (size - 1)), 0.0f, 2.5f * (z - 0.5f * (size - 1)), 1.0f};
+
+            scene.instances.push_back(instance);
+        }
+    }
+
+    return scene;
+}
+
+
+struct Measure {
+    double milliseconds = 0.0;
+    size_t triangles = 0;
+    std::vector<std::uint32_t> image;
+};
+
+
+static Measure measure(const SoftScene &scene, const int threadCount) {
+    ThreadPool threadPool {threadCount - 1};
+    SoftwareRasterizer rasterizer {threadPool};
+
+    SoftFramebuffer framebuffer;
+    framebuffer.resize(Width, Height);
+
+    const glm::mat4 proj = glm::perspective(glm::radians(60.0f), float(Width) / float(Height), 0.1f, 200.0f);
+    const glm::mat4 view = glm::lookAt(glm::vec3{0.0f, 12.0f, 30.0f}, glm::vec3{0.0f}, glm::vec3{0.0f, 1.0f, 0.0f});
+    const SoftLight light;
+
+    // the first frame allocates the bins
+    Measure result;
+    result.triangles = rasterizer.render(scene, view, proj, light, framebuffer).trianglesSubmitted;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int frame = 0; frame < Frames; frame++) {
+        rasterizer.render(scene, view, proj, light, framebuffer);
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+
+    result.milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / Frames;
+    result.image = framebuffer.color;
+
+    return result;
+}
+
+
+int main() {
+    const int hardwareThreads = int(std::max(std::thread::hardware_concurrency(), 1u));
+
+    std::vector<int> threadCounts;
+
+    for (int threads = 1; threads < hardwareThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+
+    threadCounts.push_back(hardwareThreads);
+
+    std::cout << std::setw(20) << "scene" << std::setw(10) << "threads"
+        << std::setw(12) << "ms/frame" << std::setw(12) << "frames/s" << std::setw(14) << "Mtriangles/s"
+        << std::setw(10) << "speedup" << std::setw(10) << "same" << std::endl;
+
+    for (const int rings : {8, 32, 64}) {
+        const SoftScene scene = createScene(10, rings);
+
+        Measure serial;
+
+        for (const int threads : threadCounts) {
+            Measure result = measure(scene, threads);
+
+            if (threads == 1) {
+                serial = result;
+            }
+
+            std::cout << std::fixed << std::setprecision(2)
+                << std::setw(20) << (std::to_string(result.triangles / 1000) + "k triangles")
+                << std::setw(10) << threads
+                << std::setw(12) << result.milliseconds
+                << std::setw(12) << 1000.0 / result.milliseconds
+                << std::setw(14) << result.triangles / (1000.0 * result.milliseconds)
+                << std::setw(10) << serial.milliseconds / result.milliseconds
+                << std::setw(10) << (result.image == serial.image ? "yes" : "NO")
+                << std::endl;
+        }
+    }
+
+    return 0;
+}
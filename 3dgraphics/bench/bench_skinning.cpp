@@ -0,0 +1,136 @@
+
+// skins a synthetic mesh with the scalar and the SIMD paths, and reports millions of skinned vertices per second.
+// also checks that both paths agree.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+#include "../skinning.hpp"
+
+
+static SkinnedMesh createSyntheticMesh(const size_t vertexCount, const int boneCount, std::mt19937 &random) {
+    std::uniform_real_distribution<float> coord{-1.0f, 1.0f};
+    std::uniform_int_distribution<int> bone{0, boneCount - 1};
+    std::uniform_int_distribution<int> influences{1, MaxBoneInfluences};
+
+    SkinnedMesh mesh;
+
+    const size_t paddedCount = (vertexCount + 3) / 4 * 4;
+
+    mesh.vertexCount = vertexCount;
+    mesh.bones.resize(boneCount);
+    mesh.boneIndices.resize(paddedCount * MaxBoneInfluences, 0);
+    mesh.boneWeights.resize(paddedCount * MaxBoneInfluences, 0.0f);
+
+    for (int b = 0; b < boneCount; b++) {
+        mesh.bones[b].node = b;
+    }
+
+    for (size_t v = 0; v < vertexCount; v++) {
+        const int count = influences(random);
+        float sum = 0.0f;
+
+        for (int k = 0; k < count; k++) {
+            mesh.boneIndices[v * MaxBoneInfluences + k] = static_cast<std::uint8_t>(bone(random));
+            mesh.boneWeights[v * MaxBoneInfluences + k] = 0.1f + std::abs(coord(random));
+            sum += mesh.boneWeights[v * MaxBoneInfluences + k];
+        }
+
+        for (int k = 0; k < count; k++) {
+            mesh.boneWeights[v * MaxBoneInfluences + k] /= sum;
+        }
+    }
+
+    for (std::vector<float> *component : {&mesh.positionX, &mesh.positionY, &mesh.positionZ, &mesh.normalX, &mesh.normalY, &mesh.normalZ}) {
+        component->resize(paddedCount, 0.0f);
+
+        for (size_t v = 0; v < vertexCount; v++) {
+            (*component)[v] = coord(random);
+        }
+    }
+
+    return mesh;
+}
+
+
+static std::vector<glm::mat4> createBoneTransforms(const int boneCount, std::mt19937 &random) {
+    std::uniform_real_distribution<float> value{-1.0f, 1.0f};
+
+    std::vector<glm::mat4> transforms(boneCount);
+
+    for (glm::mat4 &transform : transforms) {
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 3; row++) {
+                transform[col][row] = value(random);
+            }
+        }
+    }
+
+    return transforms;
+}
+
+
+template<typename Function>
+double measureSeconds(const int iterations, Function &&function) {
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; i++) {
+        function();
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(end - start).count() / iterations;
+}
+
+
+int main() {
+    std::mt19937 random{42};
+
+    const int boneCount = 64;
+    const int iterations = 20;
+
+    std::cout << std::setw(10) << "vertices" << std::setw(16) << "scalar" << std::setw(16) << "simd"
+        << std::setw(12) << "speedup" << std::setw(14) << "max error"
+        << "   (millions of vertices per second)" << std::endl;
+
+    for (size_t vertexCount = 10000; vertexCount <= 1000000; vertexCount *= 10) {
+        const SkinnedMesh mesh = createSyntheticMesh(vertexCount, boneCount, random);
+
+        std::vector<float> palette;
+        computeBonePalette(mesh, createBoneTransforms(boneCount, random), palette);
+
+        std::vector<glm::vec3> scalarPositions(vertexCount), scalarNormals(vertexCount);
+        std::vector<glm::vec3> simdPositions(vertexCount), simdNormals(vertexCount);
+
+        const double scalarSeconds = measureSeconds(iterations, [&] {
+            skinVerticesScalar(mesh, palette, scalarPositions.data(), scalarNormals.data());
+        });
+
+        const double simdSeconds = measureSeconds(iterations, [&] {
+            skinVertices(mesh, palette, simdPositions.data(), simdNormals.data());
+        });
+
+        float maxError = 0.0f;
+
+        for (size_t v = 0; v < vertexCount; v++) {
+            maxError = std::max(maxError, glm::length(scalarPositions[v] - simdPositions[v]));
+            maxError = std::max(maxError, glm::length(scalarNormals[v] - simdNormals[v]));
+        }
+
+        std::cout << std::fixed << std::setprecision(2)
+            << std::setw(10) << vertexCount
+            << std::setw(16) << vertexCount / scalarSeconds / 1e6
+            << std::setw(16) << vertexCount / simdSeconds / 1e6
+            << std::setw(12) << scalarSeconds / simdSeconds
+            << std::setw(14) << std::scientific << maxError
+            << std::endl;
+    }
+
+    return 0;
+}
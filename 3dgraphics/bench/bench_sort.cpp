@@ -0,0 +1,134 @@
+
+// sorts the view depths of random draw items back to front with std::sort and with the radix sort, on one thread
+// and on the pool, and reports the time of each. the items are reshuffled a little between the frames, as a moving
+// camera does to the previous order.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../radix_sort.hpp"
+#include "../thread_pool.hpp"
+
+
+const int Frames = 50;
+
+
+struct Item {
+    float depth;
+    std::uint32_t index;
+};
+
+
+static double measure(const std::vector<float> &depths, const std::function<void(const std::vector<float>&, std::vector<std::uint32_t>&)> &sort) {
+    std::mt19937 random {7};
+    std::uniform_real_distribution<float> jitter {-0.01f, 0.01f};
+
+    std::vector<float> frameDepths = depths;
+    std::vector<std::uint32_t> order;
+    std::vector<std::uint32_t> reference;
+
+    double best = 1e30;
+
+    for (int frame = 0; frame < Frames; frame++) {
+        for (float &depth : frameDepths) {
+            depth += jitter(random);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        sort(frameDepths, order);
+        const auto end = std::chrono::steady_clock::now();
+
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+
+        for (size_t i = 1; i < order.size(); i++) {
+            if (frameDepths[order[i - 1]] < frameDepths[order[i]]) {
+                std::cout << "not sorted back to front at " << i << std::endl;
+                return best;
+            }
+        }
+    }
+
+    return best;
+}
+
+
+static void benchmark(const size_t count, ThreadPool &threadPool) {
+    std::mt19937 random {count};
+    std::uniform_real_distribution<float> distance {0.1f, 500.0f};
+    std::vector<float> depths(count);
+
+    for (float &depth : depths) {
+        depth = distance(random);
+    }
+
+    std::vector<Item> items;
+
+    const double standard = measure(depths, [&items](const std::vector<float> &frameDepths, std::vector<std::uint32_t> &order) {
+        items.resize(frameDepths.size());
+
+        for (std::uint32_t i = 0; i < frameDepths.size(); i++) {
+            items[i] = {frameDepths[i], i};
+        }
+
+        std::sort(items.begin(), items.end(), [](const Item &a, const Item &b) {
+            return a.depth > b.depth;
+        });
+
+        order.resize(items.size());
+
+        for (size_t i = 0; i < items.size(); i++) {
+            order[i] = items[i].index;
+        }
+    });
+
+    RadixSorter sorter;
+    std::vector<std::uint32_t> keys;
+
+    const auto radix = [&sorter, &keys](ThreadPool *pool) {
+        return [&sorter, &keys, pool](const std::vector<float> &frameDepths, std::vector<std::uint32_t> &order) {
+            keys.resize(frameDepths.size());
+            order.resize(frameDepths.size());
+
+            for (std::uint32_t i = 0; i < frameDepths.size(); i++) {
+                keys[i] = ~toSortableKey(frameDepths[i]);
+                order[i] = i;
+            }
+
+            sorter.sort(keys, order, pool);
+        };
+    };
+
+    const double serial = measure(depths, radix(nullptr));
+    const double parallel = measure(depths, radix(&threadPool));
+
+    std::cout << std::fixed << std::setprecision(3)
+        << std::setw(10) << count
+        << std::setw(14) << standard
+        << std::setw(14) << serial
+        << std::setw(14) << parallel
+        << std::setw(10) << std::setprecision(2) << standard / std::min(serial, parallel)
+        << std::endl;
+}
+
+
+int main() {
+    ThreadPool threadPool;
+
+    std::cout << std::setw(10) << "items"
+        << std::setw(14) << "std::sort ms" << std::setw(14) << "radix ms" << std::setw(14) << "parallel ms"
+        << std::setw(10) << "speedup"
+        << "   (" << threadPool.getThreadCount() + 1 << " threads)" << std::endl;
+
+    for (const size_t count : {1000, 10000, 50000, 200000}) {
+        benchmark(count, threadPool);
+    }
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+
+// joins the identical vertices of the same scenes with aiProcess_JoinIdenticalVertices and with weldVertices, on
+// one thread and on the pool, and reports the time of each and the resulting vertex counts. takes the scene files
+// to weld, or generates OBJ grids of increasing size without arguments.
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include "../thread_pool.hpp"
+#include "../vertex_weld.hpp"
+
+
+// the import flags of 3dgraphics, without the welding
+const unsigned int ImportFlags = aiProcess_Triangulate | aiProcess_GenNormals;
+
+const int Repetitions = 3;
+
+
+// a square grid of quads, in several objects so the meshes can be welded in parallel
+static std::string createObjGrid(const int size, const int objectCount) {
+    std::ostringstream obj;
+
+    for (int y = 0; y <= size; y++) {
+        for (int x = 0; x <= size; x++) {
+            obj << "v " << x << " 0 " << y << "\n";
+            obj << "vt " << float(x) / size << " " << float(y) / size << "\n";
+        }
+    }
+
+    obj << "vn 0 1 0\n";
+
+    const auto vertex = [size](const int x, const int y) {
+        const int index = y * (size + 1) + x + 1;
+
+        return std::to_string(index) + "/" + std::to_string(index) + "/1";
+    };
+
+    for (int y = 0; y < size; y++) {
+        if (y % (size / objectCount) == 0) {
+            obj << "o part" << y << "\n";
+        }
+
+        for (int x = 0; x < size; x++) {
+            obj << "f " << vertex(x, y) << " " << vertex(x, y + 1) << " " << vertex(x + 1, y + 1) << " " << vertex(x + 1, y) << "\n";
+        }
+    }
+
+    return obj.str();
+}
+
+
+static size_t countVertices(const aiScene *scene) {
+    size_t count = 0;
+
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+        count += scene->mMeshes[i]->mNumVertices;
+    }
+
+    return count;
+}
+
+
+struct Measure {
+    double milliseconds = 1e30;
+    size_t vertices = 0;
+};
+
+
+// imports the scene again for every repetition, and only times the welding
+static Measure measure(const std::function<const aiScene*(Assimp::Importer&)> &import, const std::function<void(Assimp::Importer&)> &weld) {
+    Measure result;
+
+    for (int i = 0; i < Repetitions; i++) {
+        Assimp::Importer importer;
+
+        if (!import(importer)) {
+            std::cout << importer.GetErrorString() << std::endl;
+            return result;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        weld(importer);
+        const auto end = std::chrono::steady_clock::now();
+
+        result.milliseconds = std::min(result.milliseconds, std::chrono::duration<double, std::milli>(end - start).count());
+        result.vertices = countVertices(importer.GetScene());
+    }
+
+    return result;
+}
+
+
+static void benchmark(const std::string &name, const std::function<const aiScene*(Assimp::Importer&)> &import, ThreadPool &threadPool) {
+    const WeldParams params;
+
+    const Measure assimp = measure(import, [](Assimp::Importer &importer) {
+        importer.ApplyPostProcessing(aiProcess_JoinIdenticalVertices);
+    });
+
+    const Measure serial = measure(import, [&params](Assimp::Importer &importer) {
+        weldVertices(const_cast<aiScene*>(importer.GetScene()), params);
+    });
+
+    const Measure parallel = measure(import, [&params, &threadPool](Assimp::Importer &importer) {
+        weldVertices(const_cast<aiScene*>(importer.GetScene()), params, &threadPool);
+    });
+
+    std::cout << std::fixed << std::setprecision(2)
+        << std::setw(24) << name
+        << std::setw(12) << assimp.milliseconds << std::setw(10) << assimp.vertices
+        << std::setw(12) << serial.milliseconds << std::setw(10) << serial.vertices
+        << std::setw(12) << parallel.milliseconds << std::setw(10) << parallel.vertices
+        << std::setw(10) << assimp.milliseconds / parallel.milliseconds
+        << std::endl;
+}
+
+
+int main(int argc, char **argv) {
+    ThreadPool threadPool;
+
+    std::cout << std::setw(24) << "scene"
+        << std::setw(12) << "assimp ms" << std::setw(10) << "vertices"
+        << std::setw(12) << "serial ms" << std::setw(10) << "vertices"
+        << std::setw(12) << "parallel ms" << std::setw(10) << "vertices"
+        << std::setw(10) << "speedup"
+        << "   (" << threadPool.getThreadCount() + 1 << " threads)" << std::endl;
+
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            const std::string filePath = argv[i];
+
+            benchmark(filePath, [&filePath](Assimp::Importer &importer) {
+                return importer.ReadFile(filePath, ImportFlags);
+            }, threadPool);
+        }
+
+        return 0;
+    }
+
+    for (int size = 64; size <= 1024; size *= 4) {
+        const std::string obj = createObjGrid(size, 16);
+
+        benchmark("grid " + std::to_string(size) + "x" + std::to_string(size), [&obj](Assimp::Importer &importer) {
+            return importer.ReadFileFromMemory(obj.data(), obj.size(), ImportFlags, "obj");
+        }, threadPool);
+    }
+
+    return 0;
+}
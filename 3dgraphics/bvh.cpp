@@ -0,0 +1,623 @@
+
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+#include "thread_pool.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#   define BVH_USE_SSE
+#   include <xmmintrin.h>
+#endif
+
+
+const std::uint32_t LeafFlag = 0x80000000;
+const std::uint32_t EmptyChild = 0xFFFFFFFF;
+
+const int BinCount = 16;
+const std::uint32_t MaxLeafTriangles = 8;
+
+// cost of visiting a node, relative to intersecting a triangle
+const float TraversalCost = 1.0f;
+
+// subtrees with less triangles aren't worth a task of their own
+const std::uint32_t MinTaskTriangles = 4096;
+
+// entries of the traversal stack kept on the frame, the deeper trees use one on the heap
+const std::uint32_t MaxStackSize = 256;
+
+
+namespace {
+    struct Bounds {
+        glm::vec3 min = glm::vec3{std::numeric_limits<float>::max()};
+        glm::vec3 max = glm::vec3{std::numeric_limits<float>::lowest()};
+
+        void extend(const glm::vec3 &point) {
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+
+        void extend(const Bounds &other) {
+            min = glm::min(min, other.min);
+            max = glm::max(max, other.max);
+        }
+
+        float area() const {
+            const glm::vec3 extent = glm::max(max - min, glm::vec3{0.0f});
+
+            return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+        }
+    };
+
+
+    // a node of the binary tree. inner nodes have no triangles
+    struct BuildNode {
+        Bounds bounds;
+        std::uint32_t children[2] = {0, 0};
+        std::uint32_t first = 0;
+        std::uint32_t count = 0;
+    };
+
+
+    // a range of triangles left for a parallel task, and the placeholder node its subtree replaces
+    struct BuildTask {
+        std::uint32_t node;
+        std::uint32_t first;
+        std::uint32_t count;
+    };
+
+
+    class BvhBuilder {
+    public:
+        BvhBuilder(const std::vector<glm::vec3> &corners, ThreadPool *threadPool) : threadPool(threadPool) {
+            const auto triangleCount = std::uint32_t(corners.size() / 3);
+
+            triangleBounds.resize(triangleCount);
+            centroids.resize(triangleCount);
+            references.resize(triangleCount);
+
+            const auto computeBounds = [&](const std::uint32_t first, const std::uint32_t last) {
+                for (std::uint32_t i = first; i < last; i++) {
+                    Bounds &bounds = triangleBounds[i];
+                    bounds = {};
+                    bounds.extend(corners[3 * i + 0]);
+                    bounds.extend(corners[3 * i + 1]);
+                    bounds.extend(corners[3 * i + 2]);
+
+                    centroids[i] = 0.5f * (bounds.min + bounds.max);
+                    references[i] = i;
+                }
+            };
+
+            if (threadPool) {
+                const std::uint32_t chunkSize = MinTaskTriangles;
+
+                threadPool->parallelFor((triangleCount + chunkSize - 1) / chunkSize, [&](const size_t chunk) {
+                    computeBounds(std::uint32_t(chunk) * chunkSize, std::min(std::uint32_t(chunk + 1) * chunkSize, triangleCount));
+                });
+            }
+            else {
+                computeBounds(0, triangleCount);
+            }
+        }
+
+        std::vector<BuildNode> build() {
+            std::vector<BuildNode> nodes;
+
+            if (references.empty()) {
+                return nodes;
+            }
+
+            nodes.emplace_back();
+
+            // split the top levels here, until there is enough work for every thread
+            const size_t threadCount = threadPool ? threadPool->getThreadCount() + 1 : 1;
+            int taskDepth = 0;
+
+            while (threadCount > 1 && (size_t(1) << taskDepth) < 4 * threadCount && taskDepth < 10) {
+                taskDepth++;
+            }
+
+            std::vector<BuildTask> tasks;
+            buildNode(nodes, 0, 0, std::uint32_t(references.size()), taskDepth, taskDepth > 0 ? &tasks : nullptr);
+
+            if (tasks.empty()) {
+                return nodes;
+            }
+
+            std::vector<std::vector<BuildNode>> subtrees(tasks.size());
+
+            threadPool->parallelFor(tasks.size(), [&](const size_t task) {
+                subtrees[task].emplace_back();
+                buildNode(subtrees[task], 0, tasks[task].first, tasks[task].count, 0, nullptr);
+            });
+
+            // the subtree roots replace their placeholders, and the other nodes are appended
+            for (size_t task = 0; task < tasks.size(); task++) {
+                const std::vector<BuildNode> &subtree = subtrees[task];
+                const auto base = std::uint32_t(nodes.size());
+
+                const auto remap = [base](BuildNode node) {
+                    if (node.count == 0) {
+                        node.children[0] += base - 1;
+                        node.children[1] += base - 1;
+                    }
+
+                    return node;
+                };
+
+                nodes[tasks[task].node] = remap(subtree[0]);
+
+                for (size_t i = 1; i < subtree.size(); i++) {
+                    nodes.push_back(remap(subtree[i]));
+                }
+            }
+
+            return nodes;
+        }
+
+        const std::vector<std::uint32_t>& getReferences() const {
+            return references;
+        }
+
+    private:
+        // fills nodes[index] with the triangles in [first, first + count). below taskDepth levels, the ranges
+        // large enough are left as tasks
+        void buildNode(std::vector<BuildNode> &nodes, const std::uint32_t index, const std::uint32_t first, const std::uint32_t count, const int taskDepth, std::vector<BuildTask> *tasks) {
+            Bounds bounds, centroidBounds;
+
+            for (std::uint32_t i = first; i < first + count; i++) {
+                bounds.extend(triangleBounds[references[i]]);
+                centroidBounds.extend(centroids[references[i]]);
+            }
+
+            nodes[index].bounds = bounds;
+
+            if (tasks && taskDepth == 0) {
+                if (count >= MinTaskTriangles) {
+                    tasks->push_back({index, first, count});
+                    return;
+                }
+
+                tasks = nullptr;
+            }
+
+            std::uint32_t middle = first;
+
+            if (!split(bounds, centroidBounds, first, count, middle)) {
+                nodes[index].first = first;
+                nodes[index].count = count;
+                return;
+            }
+
+            // the vector grows, the references to its nodes don't survive the recursion
+            const auto left = std::uint32_t(nodes.size());
+
+            nodes.emplace_back();
+            nodes.emplace_back();
+
+            nodes[index].children[0] = left;
+            nodes[index].children[1] = left + 1;
+
+            buildNode(nodes, left, first, middle - first, taskDepth - 1, tasks);
+            buildNode(nodes, left + 1, middle, first + count - middle, taskDepth - 1, tasks);
+        }
+
+        // partitions the range along the cheapest of the binned splits. false when a leaf is cheaper
+        bool split(const Bounds &bounds, const Bounds &centroidBounds, const std::uint32_t first, const std::uint32_t count, std::uint32_t &middle) {
+            if (count <= 1) {
+                return false;
+            }
+
+            float bestCost = std::numeric_limits<float>::max();
+            int bestAxis = -1, bestBin = 0;
+
+            for (int axis = 0; axis < 3; axis++) {
+                const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+
+                if (extent <= 0.0f) {
+                    continue;
+                }
+
+                Bounds bins[BinCount];
+                std::uint32_t binCounts[BinCount] = {};
+                const float scale = BinCount / extent;
+
+                for (std::uint32_t i = first; i < first + count; i++) {
+                    const int bin = std::min(int((centroids[references[i]][axis] - centroidBounds.min[axis]) * scale), BinCount - 1);
+
+                    bins[bin].extend(triangleBounds[references[i]]);
+                    binCounts[bin]++;
+                }
+
+                // the cost of the triangles on the right of each split, swept from the right
+                float rightCosts[BinCount];
+                Bounds right;
+                std::uint32_t rightCount = 0;
+
+                for (int bin = BinCount - 1; bin > 0; bin--) {
+                    right.extend(bins[bin]);
+                    rightCount += binCounts[bin];
+                    rightCosts[bin] = rightCount > 0 ? right.area() * rightCount : 0.0f;
+                }
+
+                Bounds left;
+                std::uint32_t leftCount = 0;
+
+                for (int bin = 0; bin < BinCount - 1; bin++) {
+                    left.extend(bins[bin]);
+                    leftCount += binCounts[bin];
+
+                    const float cost = (leftCount > 0 ? left.area() * leftCount : 0.0f) + rightCosts[bin + 1];
+
+                    if (leftCount > 0 && leftCount < count && cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = bin;
+                    }
+                }
+            }
+
+            const float area = std::max(bounds.area(), std::numeric_limits<float>::min());
+
+            // all the centroids in the same spot: halve the range if it's too large for a leaf
+            if (bestAxis < 0) {
+                middle = first + count / 2;
+                return count > MaxLeafTriangles;
+            }
+
+            if (count <= MaxLeafTriangles && float(count) <= TraversalCost + bestCost / area) {
+                return false;
+            }
+
+            const float extent = centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis];
+            const float scale = BinCount / extent;
+
+            const auto partitioned = std::partition(references.begin() + first, references.begin() + first + count, [&](const std::uint32_t triangle) {
+                return std::min(int((centroids[triangle][bestAxis] - centroidBounds.min[bestAxis]) * scale), BinCount - 1) <= bestBin;
+            });
+
+            middle = std::uint32_t(partitioned - references.begin());
+
+            return true;
+        }
+
+    private:
+        ThreadPool *threadPool;
+
+        std::vector<Bounds> triangleBounds;
+        std::vector<glm::vec3> centroids;
+
+        // the triangles, reordered so the ones of each leaf are contiguous
+        std::vector<std::uint32_t> references;
+    };
+}
+
+
+void Bvh4::build(const std::vector<glm::vec3> &corners, ThreadPool *threadPool) {
+    nodes.clear();
+    groups.clear();
+    triangleCount = corners.size() / 3;
+    stackCapacity = 0;
+
+    BvhBuilder builder {corners, threadPool};
+
+    const std::vector<BuildNode> binaryNodes = builder.build();
+    const std::vector<std::uint32_t> &references = builder.getReferences();
+
+    if (binaryNodes.empty()) {
+        return;
+    }
+
+    const auto addLeaf = [&](const BuildNode &leaf, std::uint32_t &child, std::uint32_t &groupCount) {
+        child = LeafFlag | std::uint32_t(groups.size());
+        groupCount = (leaf.count + 3) / 4;
+
+        for (std::uint32_t i = 0; i < leaf.count; i += 4) {
+            TriangleGroup group = {};
+
+            for (std::uint32_t lane = 0; lane < 4; lane++) {
+                group.triangles[lane] = EmptyChild;
+
+                if (i + lane >= leaf.count) {
+                    continue;
+                }
+
+                const std::uint32_t triangle = references[leaf.first + i + lane];
+                const glm::vec3 &v0 = corners[3 * triangle + 0];
+                const glm::vec3 e1 = corners[3 * triangle + 1] - v0;
+                const glm::vec3 e2 = corners[3 * triangle + 2] - v0;
+
+                group.v0x[lane] = v0.x; group.v0y[lane] = v0.y; group.v0z[lane] = v0.z;
+                group.e1x[lane] = e1.x; group.e1y[lane] = e1.y; group.e1z[lane] = e1.z;
+                group.e2x[lane] = e2.x; group.e2y[lane] = e2.y; group.e2z[lane] = e2.z;
+                group.triangles[lane] = triangle;
+            }
+
+            groups.push_back(group);
+        }
+    };
+
+    // pulls up the grandchildren with the largest surfaces until each node has four children
+    const auto collapse = [&](const auto &self, const std::uint32_t binaryNode, const std::uint32_t depth) -> std::uint32_t {
+        std::uint32_t children[4] = {binaryNode, 0, 0, 0};
+        int childCount = 1;
+
+        while (childCount < 4) {
+            int largest = -1;
+
+            for (int i = 0; i < childCount; i++) {
+                const BuildNode &child = binaryNodes[children[i]];
+
+                if (child.count == 0 && (largest < 0 || child.bounds.area() > binaryNodes[children[largest]].bounds.area())) {
+                    largest = i;
+                }
+            }
+
+            if (largest < 0) {
+                break;
+            }
+
+            const BuildNode &opened = binaryNodes[children[largest]];
+            children[largest] = opened.children[0];
+            children[childCount++] = opened.children[1];
+        }
+
+        const auto index = std::uint32_t(nodes.size());
+        nodes.emplace_back();
+
+        // each level leaves at most three siblings on the stack, two entries for a leaf, and the last one pushes eight
+        stackCapacity = std::max(stackCapacity, 6 * depth + 8);
+
+        for (int i = 0; i < 4; i++) {
+            const float infinity = std::numeric_limits<float>::infinity();
+            std::uint32_t child = EmptyChild, groupCount = 0;
+            Bounds bounds;
+            bounds.min = bounds.max = glm::vec3{infinity};
+
+            if (i < childCount) {
+                const BuildNode &binaryChild = binaryNodes[children[i]];
+                bounds = binaryChild.bounds;
+
+                if (binaryChild.count > 0) {
+                    addLeaf(binaryChild, child, groupCount);
+                }
+                else {
+                    child = self(self, children[i], depth + 1);
+                }
+            }
+
+            // written through the index, the recursion grows the vector
+            Node &node = nodes[index];
+            node.minX[i] = bounds.min.x; node.minY[i] = bounds.min.y; node.minZ[i] = bounds.min.z;
+            node.maxX[i] = bounds.max.x; node.maxY[i] = bounds.max.y; node.maxZ[i] = bounds.max.z;
+            node.children[i] = child;
+            node.groupCounts[i] = groupCount;
+        }
+
+        return index;
+    };
+
+    collapse(collapse, 0, 0);
+}
+
+
+struct Bvh4::Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+    glm::vec3 invDirection;
+    float maxDistance;
+
+    Ray(const glm::vec3 &origin, const glm::vec3 &direction, const float maxDistance) : origin(origin), direction(direction), maxDistance(std::min(maxDistance, FLT_MAX)) {
+        // no infinities in the slab tests, they would give NaNs on the planes through the origin
+        for (int i = 0; i < 3; i++) {
+            const float component = std::abs(direction[i]) < 1e-20f ? std::copysign(1e-20f, direction[i]) : direction[i];
+
+            invDirection[i] = 1.0f / component;
+        }
+    }
+};
+
+
+template<bool AnyHit>
+bool Bvh4::traverse(const Ray &ray, BvhHit &hit) const {
+    if (nodes.empty()) {
+        return false;
+    }
+
+    std::uint32_t localStack[MaxStackSize];
+    std::vector<std::uint32_t> heapStack;
+    std::uint32_t *stack = localStack;
+
+    if (stackCapacity > MaxStackSize) {
+        heapStack.resize(stackCapacity);
+        stack = heapStack.data();
+    }
+
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    float closest = ray.maxDistance;
+    bool found = false;
+
+#if defined(BVH_USE_SSE)
+    const __m128 originX = _mm_set1_ps(ray.origin.x), originY = _mm_set1_ps(ray.origin.y), originZ = _mm_set1_ps(ray.origin.z);
+    const __m128 invX = _mm_set1_ps(ray.invDirection.x), invY = _mm_set1_ps(ray.invDirection.y), invZ = _mm_set1_ps(ray.invDirection.z);
+    const __m128 directionX = _mm_set1_ps(ray.direction.x), directionY = _mm_set1_ps(ray.direction.y), directionZ = _mm_set1_ps(ray.direction.z);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+#endif
+
+    while (stackSize > 0) {
+        const std::uint32_t nodeIndex = stack[--stackSize];
+
+        if (nodeIndex & LeafFlag) {
+            // leaves are pushed as their first group, with the group count in the next entry
+            const std::uint32_t firstGroup = nodeIndex & ~LeafFlag;
+            const std::uint32_t groupCount = stack[--stackSize];
+
+            for (std::uint32_t g = firstGroup; g < firstGroup + groupCount; g++) {
+                const TriangleGroup &group = groups[g];
+
+                float distances[4], us[4], vs[4];
+                int hitMask = 0;
+
+#if defined(BVH_USE_SSE)
+                const __m128 e1x = _mm_load_ps(group.e1x), e1y = _mm_load_ps(group.e1y), e1z = _mm_load_ps(group.e1z);
+                const __m128 e2x = _mm_load_ps(group.e2x), e2y = _mm_load_ps(group.e2y), e2z = _mm_load_ps(group.e2z);
+
+                // Moller-Trumbore, on four triangles
+                const __m128 px = _mm_sub_ps(_mm_mul_ps(directionY, e2z), _mm_mul_ps(directionZ, e2y));
+                const __m128 py = _mm_sub_ps(_mm_mul_ps(directionZ, e2x), _mm_mul_ps(directionX, e2z));
+                const __m128 pz = _mm_sub_ps(_mm_mul_ps(directionX, e2y), _mm_mul_ps(directionY, e2x));
+                const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+                const __m128 invDet = _mm_div_ps(one, det);
+
+                const __m128 tx = _mm_sub_ps(originX, _mm_load_ps(group.v0x));
+                const __m128 ty = _mm_sub_ps(originY, _mm_load_ps(group.v0y));
+                const __m128 tz = _mm_sub_ps(originZ, _mm_load_ps(group.v0z));
+                const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), invDet);
+
+                const __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+                const __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+                const __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+                const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qx), _mm_mul_ps(directionY, qy)), _mm_mul_ps(directionZ, qz)), invDet);
+                const __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+                // the NaNs of the padding lanes fail every comparison
+                __m128 mask = _mm_cmpneq_ps(det, zero);
+                mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+                mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+                mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+                mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, zero));
+                mask = _mm_and_ps(mask, _mm_cmplt_ps(t, _mm_set1_ps(closest)));
+
+                hitMask = _mm_movemask_ps(mask);
+
+                if (hitMask == 0) {
+                    continue;
+                }
+
+                _mm_storeu_ps(distances, t);
+                _mm_storeu_ps(us, u);
+                _mm_storeu_ps(vs, v);
+#else
+                for (int lane = 0; lane < 4; lane++) {
+                    const glm::vec3 e1 = {group.e1x[lane], group.e1y[lane], group.e1z[lane]};
+                    const glm::vec3 e2 = {group.e2x[lane], group.e2y[lane], group.e2z[lane]};
+                    const glm::vec3 p = glm::cross(ray.direction, e2);
+                    const float det = glm::dot(e1, p);
+
+                    if (det == 0.0f) {
+                        continue;
+                    }
+
+                    const float invDet = 1.0f / det;
+                    const glm::vec3 t = ray.origin - glm::vec3{group.v0x[lane], group.v0y[lane], group.v0z[lane]};
+                    const glm::vec3 q = glm::cross(t, e1);
+
+                    us[lane] = glm::dot(t, p) * invDet;
+                    vs[lane] = glm::dot(ray.direction, q) * invDet;
+                    distances[lane] = glm::dot(e2, q) * invDet;
+
+                    if (us[lane] >= 0.0f && vs[lane] >= 0.0f && us[lane] + vs[lane] <= 1.0f && distances[lane] > 0.0f && distances[lane] < closest) {
+                        hitMask |= 1 << lane;
+                    }
+                }
+#endif
+
+                if (AnyHit && hitMask != 0) {
+                    return true;
+                }
+
+                for (int lane = 0; lane < 4; lane++) {
+                    if ((hitMask & (1 << lane)) && distances[lane] < closest) {
+                        closest = distances[lane];
+                        hit.distance = distances[lane];
+                        hit.u = us[lane];
+                        hit.v = vs[lane];
+                        hit.triangle = group.triangles[lane];
+                        found = true;
+                    }
+                }
+            }
+
+            continue;
+        }
+
+        const Node &node = nodes[nodeIndex];
+
+        float entries[4];
+        int hitMask = 0;
+
+#if defined(BVH_USE_SSE)
+        const __m128 x0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), originX), invX);
+        const __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), originX), invX);
+        const __m128 y0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), originY), invY);
+        const __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), originY), invY);
+        const __m128 z0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), originZ), invZ);
+        const __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), originZ), invZ);
+
+        const __m128 entry = _mm_max_ps(_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_max_ps(_mm_min_ps(z0, z1), zero));
+        const __m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_min_ps(_mm_max_ps(z0, z1), _mm_set1_ps(closest)));
+
+        hitMask = _mm_movemask_ps(_mm_cmple_ps(entry, exit));
+        _mm_storeu_ps(entries, entry);
+#else
+        for (int i = 0; i < 4; i++) {
+            const float x0 = (node.minX[i] - ray.origin.x) * ray.invDirection.x, x1 = (node.maxX[i] - ray.origin.x) * ray.invDirection.x;
+            const float y0 = (node.minY[i] - ray.origin.y) * ray.invDirection.y, y1 = (node.maxY[i] - ray.origin.y) * ray.invDirection.y;
+            const float z0 = (node.minZ[i] - ray.origin.z) * ray.invDirection.z, z1 = (node.maxZ[i] - ray.origin.z) * ray.invDirection.z;
+
+            entries[i] = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), 0.0f));
+            const float exit = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::min(std::max(z0, z1), closest));
+
+            hitMask |= entries[i] <= exit ? 1 << i : 0;
+        }
+#endif
+
+        // the nearest children are pushed last, so they are visited first
+        int order[4];
+        int hitCount = 0;
+
+        for (int i = 0; i < 4; i++) {
+            if (hitMask & (1 << i)) {
+                int position = hitCount++;
+
+                while (position > 0 && entries[order[position - 1]] < entries[i]) {
+                    order[position] = order[position - 1];
+                    position--;
+                }
+
+                order[position] = i;
+            }
+        }
+
+        for (int i = 0; i < hitCount; i++) {
+            const int child = order[i];
+
+            if (node.children[child] & LeafFlag) {
+                stack[stackSize++] = node.groupCounts[child];
+            }
+
+            stack[stackSize++] = node.children[child];
+        }
+    }
+
+    return found;
+}
+
+
+bool Bvh4::intersect(const glm::vec3 &origin, const glm::vec3 &direction, const float maxDistance, BvhHit &hit) const {
+    return traverse<false>(Ray{origin, direction, maxDistance}, hit);
+}
+
+
+bool Bvh4::occluded(const glm::vec3 &origin, const glm::vec3 &direction, const float maxDistance) const {
+    BvhHit hit;
+
+    return traverse<true>(Ray{origin, direction, maxDistance}, hit);
+}
@@ -0,0 +1,77 @@
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class ThreadPool;
+
+
+struct BvhHit {
+    float distance = 0.0f;
+
+    // barycentric coordinates of the second and third corners
+    float u = 0.0f;
+    float v = 0.0f;
+
+    std::uint32_t triangle = 0xFFFFFFFF;
+};
+
+
+// A four wide bounding volume hierarchy over triangles, for ray casting on the CPU. It is built as a binary
+// tree with the binned surface area heuristic, whose top levels are split on the calling thread and whose
+// subtrees are built in parallel, and then collapsed so each node holds the bounds of four children. Both the
+// four boxes of a node and the triangles of a leaf, in groups of four, are tested at once with SSE.
+class Bvh4 {
+public:
+    // corners holds the three corners of each triangle, the triangle indices of the hits are the ones of this
+    // array. the pool may be null
+    void build(const std::vector<glm::vec3> &corners, ThreadPool *threadPool);
+
+    // the closest hit closer than maxDistance
+    bool intersect(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, BvhHit &hit) const;
+
+    // any hit closer than maxDistance, for the shadow rays
+    bool occluded(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance) const;
+
+    size_t getNodeCount() const {
+        return nodes.size();
+    }
+
+    size_t getTriangleCount() const {
+        return triangleCount;
+    }
+
+private:
+    // the bounds of the children, by component. the empty slots have bounds no ray can hit
+    struct alignas(16) Node {
+        float minX[4], minY[4], minZ[4];
+        float maxX[4], maxY[4], maxZ[4];
+
+        // inner nodes, or the first triangle group of a leaf with LeafFlag set
+        std::uint32_t children[4];
+        std::uint32_t groupCounts[4];
+    };
+
+    // four triangles, as a corner and two edges by component. the padding lanes have zero edges, and never hit
+    struct alignas(16) TriangleGroup {
+        float v0x[4], v0y[4], v0z[4];
+        float e1x[4], e1y[4], e1z[4];
+        float e2x[4], e2y[4], e2z[4];
+        std::uint32_t triangles[4];
+    };
+
+    struct Ray;
+
+    template<bool AnyHit>
+    bool traverse(const Ray &ray, BvhHit &hit) const;
+
+private:
+    std::vector<Node> nodes;
+    std::vector<TriangleGroup> groups;
+    size_t triangleCount = 0;
+
+    // stack entries the traversal of the deepest path needs
+    std::uint32_t stackCapacity = 0;
+};
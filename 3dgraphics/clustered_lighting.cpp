@@ -0,0 +1,267 @@
+
+#include "clustered_lighting.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <random>
+
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#   define CLUSTERS_USE_SSE
+#   include <xmmintrin.h>
+#endif
+
+
+// lights handled by each job of the tile mask computation
+static const size_t LightsPerJob = 256;
+
+
+static unsigned int countTrailingZeros(const std::uint32_t value) {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward(&index, value);
+    return index;
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+
+LightClusterBuilder::LightClusterBuilder(const ClusterGridParams &params) : params(params) {
+    assert(params.tilesX > 0 && params.tilesX <= 32);
+    assert(params.tilesY > 0 && params.tilesY <= 32);
+    assert(params.nearPlane > 0.0f && params.farPlane > params.nearPlane);
+
+    sliceLists.resize(params.slices);
+
+    for (SliceLists &lists : sliceLists) {
+        lists.tiles.resize(params.tilesX * params.tilesY);
+    }
+}
+
+
+glm::vec2 LightClusterBuilder::getDepthSliceParams() const {
+    const float logRange = std::log(params.farPlane / params.nearPlane);
+
+    return {
+        params.slices / logRange,
+        -(params.slices * std::log(params.nearPlane)) / logRange
+    };
+}
+
+
+// the planes of the boundaries between tiles. a view space point is on the positive side of boundary i
+// when its projection is past the i-th boundary, from -1 to 1 in NDC
+static void computeBoundaryPlanes(const float scale, const float offset, const unsigned int tileCount, std::vector<glm::vec2> &planes) {
+    planes.resize(tileCount + 1);
+
+    for (unsigned int i = 0; i <= tileCount; i++) {
+        const float boundary = -1.0f + 2.0f * i / tileCount;
+
+        planes[i] = glm::normalize(glm::vec2{scale, offset + boundary});
+    }
+}
+
+
+void LightClusterBuilder::build(const std::vector<LocalLight> &lights, const glm::mat4 &view, const glm::mat4 &proj, ThreadPool &threadPool, LightClusters &clusters) {
+    computeBoundaryPlanes(proj[0][0], proj[2][0], params.tilesX, columnPlanes);
+    computeBoundaryPlanes(proj[1][1], proj[2][1], params.tilesY, rowPlanes);
+
+    // the padding lanes sit far behind the camera, so they never touch a slice
+    const size_t paddedCount = (lights.size() + 3) / 4 * 4;
+
+    lightX.assign(paddedCount, 0.0f);
+    lightY.assign(paddedCount, 0.0f);
+    lightZ.assign(paddedCount, 1e30f);
+    lightRadius.assign(paddedCount, 0.0f);
+    columnMasks.assign(paddedCount, 0);
+    rowMasks.assign(paddedCount, 0);
+
+    for (size_t i = 0; i < lights.size(); i++) {
+        const glm::vec3 position = view * glm::vec4{lights[i].position, 1.0f};
+
+        lightX[i] = position.x;
+        lightY[i] = position.y;
+        lightZ[i] = position.z;
+        lightRadius[i] = lights[i].range;
+    }
+
+    const size_t jobCount = (paddedCount + LightsPerJob - 1) / LightsPerJob;
+
+    threadPool.parallelFor(jobCount, [this, paddedCount](const size_t job) {
+        const size_t first = job * LightsPerJob;
+
+        computeTileMasks(first, std::min(LightsPerJob, paddedCount - first));
+    });
+
+    threadPool.parallelFor(params.slices, [this](const size_t slice) {
+        gatherSlice(static_cast<unsigned int>(slice));
+    });
+
+    // flatten the lists of every cluster
+    const unsigned int tileCount = params.tilesX * params.tilesY;
+
+    clusters.ranges.resize(2 * tileCount * params.slices);
+    clusters.lightIndices.clear();
+
+    for (unsigned int slice = 0; slice < params.slices; slice++) {
+        for (unsigned int tile = 0; tile < tileCount; tile++) {
+            const std::vector<std::uint32_t> &list = sliceLists[slice].tiles[tile];
+            const unsigned int cluster = slice * tileCount + tile;
+
+            clusters.ranges[2 * cluster + 0] = static_cast<std::uint32_t>(clusters.lightIndices.size());
+            clusters.ranges[2 * cluster + 1] = static_cast<std::uint32_t>(list.size());
+
+            clusters.lightIndices.insert(clusters.lightIndices.end(), list.begin(), list.end());
+        }
+    }
+}
+
+
+#if defined(CLUSTERS_USE_SSE)
+// bit i of the result is set when the sphere i of the group overlaps the tiles between the boundaries
+static void computeMasks(const std::vector<glm::vec2> &planes, const __m128 coord, const __m128 z, const __m128 radius, std::uint32_t *masks) {
+    const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+    const auto distance = [&](const glm::vec2 &plane) {
+        return _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), coord), _mm_mul_ps(_mm_set1_ps(plane.y), z));
+    };
+
+    // spheres on the positive side of the first boundary of the tile, and on the negative side of the last one
+    int afterStart = _mm_movemask_ps(_mm_cmpge_ps(distance(planes[0]), negRadius));
+
+    for (size_t tile = 0; tile + 1 < planes.size(); tile++) {
+        const __m128 next = distance(planes[tile + 1]);
+        const int lanes = afterStart & _mm_movemask_ps(_mm_cmple_ps(next, radius));
+
+        for (int lane = 0; lane < 4; lane++) {
+            if (lanes & (1 << lane)) {
+                masks[lane] |= 1u << tile;
+            }
+        }
+
+        afterStart = _mm_movemask_ps(_mm_cmpge_ps(next, negRadius));
+    }
+}
+#endif
+
+
+void LightClusterBuilder::computeTileMasks(const size_t firstLight, const size_t lightCount) {
+    assert(firstLight % 4 == 0 && lightCount % 4 == 0);
+
+#if defined(CLUSTERS_USE_SSE)
+    for (size_t i = firstLight; i < firstLight + lightCount; i += 4) {
+        const __m128 x = _mm_loadu_ps(&lightX[i]);
+        const __m128 y = _mm_loadu_ps(&lightY[i]);
+        const __m128 z = _mm_loadu_ps(&lightZ[i]);
+        const __m128 radius = _mm_loadu_ps(&lightRadius[i]);
+
+        computeMasks(columnPlanes, x, z, radius, &columnMasks[i]);
+        computeMasks(rowPlanes, y, z, radius, &rowMasks[i]);
+    }
+#else
+    const auto computeMask = [](const std::vector<glm::vec2> &planes, const float coord, const float z, const float radius) {
+        std::uint32_t mask = 0;
+
+        for (size_t tile = 0; tile + 1 < planes.size(); tile++) {
+            const float start = planes[tile].x * coord + planes[tile].y * z;
+            const float end = planes[tile + 1].x * coord + planes[tile + 1].y * z;
+
+            if (start >= -radius && end <= radius) {
+                mask |= 1u << tile;
+            }
+        }
+
+        return mask;
+    };
+
+    for (size_t i = firstLight; i < firstLight + lightCount; i++) {
+        columnMasks[i] = computeMask(columnPlanes, lightX[i], lightZ[i], lightRadius[i]);
+        rowMasks[i] = computeMask(rowPlanes, lightY[i], lightZ[i], lightRadius[i]);
+    }
+#endif
+}
+
+
+void LightClusterBuilder::gatherSlice(const unsigned int slice) {
+    const float depthRatio = params.farPlane / params.nearPlane;
+    const float sliceNear = params.nearPlane * std::pow(depthRatio, float(slice) / params.slices);
+    const float sliceFar = params.nearPlane * std::pow(depthRatio, float(slice + 1) / params.slices);
+
+    std::vector<std::vector<std::uint32_t>> &tiles = sliceLists[slice].tiles;
+
+    for (std::vector<std::uint32_t> &tile : tiles) {
+        tile.clear();
+    }
+
+    const auto addLight = [&](const std::uint32_t light) {
+        for (std::uint32_t rows = rowMasks[light]; rows; rows &= rows - 1) {
+            const unsigned int row = countTrailingZeros(rows);
+
+            for (std::uint32_t columns = columnMasks[light]; columns; columns &= columns - 1) {
+                tiles[row * params.tilesX + countTrailingZeros(columns)].push_back(light);
+            }
+        }
+    };
+
+    // the view looks down -Z
+#if defined(CLUSTERS_USE_SSE)
+    const __m128 nearDepth = _mm_set1_ps(-sliceNear);
+    const __m128 farDepth = _mm_set1_ps(-sliceFar);
+
+    for (size_t i = 0; i < lightZ.size(); i += 4) {
+        const __m128 z = _mm_loadu_ps(&lightZ[i]);
+        const __m128 radius = _mm_loadu_ps(&lightRadius[i]);
+
+        const __m128 beforeFar = _mm_cmpge_ps(_mm_add_ps(z, radius), farDepth);
+        const __m128 afterNear = _mm_cmple_ps(_mm_sub_ps(z, radius), nearDepth);
+
+        const int lanes = _mm_movemask_ps(_mm_and_ps(beforeFar, afterNear));
+
+        for (int lane = 0; lane < 4; lane++) {
+            if (lanes & (1 << lane)) {
+                addLight(static_cast<std::uint32_t>(i + lane));
+            }
+        }
+    }
+#else
+    for (size_t i = 0; i < lightZ.size(); i++) {
+        if (lightZ[i] + lightRadius[i] >= -sliceFar && lightZ[i] - lightRadius[i] <= -sliceNear) {
+            addLight(static_cast<std::uint32_t>(i));
+        }
+    }
+#endif
+}
+
+
+void packLightData(const std::vector<LocalLight> &lights, std::vector<glm::vec4> &texels) {
+    texels.resize(3 * lights.size());
+
+    for (size_t i = 0; i < lights.size(); i++) {
+        const LocalLight &light = lights[i];
+
+        texels[3 * i + 0] = {light.position, light.range};
+        texels[3 * i + 1] = {light.color, light.cosOuterCone};
+        texels[3 * i + 2] = {light.direction, light.cosInnerCone};
+    }
+}
+
+
+std::vector<LocalLight> createRandomLights(const size_t count, const glm::vec3 &boxMin, const glm::vec3 &boxMax, const float range, const unsigned int seed) {
+    std::mt19937 random{seed};
+    std::uniform_real_distribution<float> unit{0.0f, 1.0f};
+
+    std::vector<LocalLight> lights(count);
+
+    for (LocalLight &light : lights) {
+        light.position = boxMin + (boxMax - boxMin) * glm::vec3{unit(random), unit(random), unit(random)};
+        light.range = range;
+        light.color = glm::vec3{unit(random), unit(random), unit(random)};
+    }
+
+    return lights;
+}
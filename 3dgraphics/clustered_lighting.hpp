@@ -0,0 +1,93 @@
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "thread_pool.hpp"
+
+
+// point or spot light, in world space
+struct LocalLight {
+    glm::vec3 position = {0.0f, 0.0f, 0.0f};
+
+    // the light has no effect farther than this
+    float range = 10.0f;
+
+    glm::vec3 color = {1.0f, 1.0f, 1.0f};
+
+    // spot lights only. point lights keep the cone cosines at -1
+    glm::vec3 direction = {0.0f, 0.0f, -1.0f};
+    float cosInnerCone = -1.0f;
+    float cosOuterCone = -1.0f;
+};
+
+
+// the view frustum is split in tilesX * tilesY screen tiles, and in slices exponentially spaced in depth
+struct ClusterGridParams {
+    unsigned int tilesX = 16;
+    unsigned int tilesY = 9;
+    unsigned int slices = 24;
+
+    float nearPlane = 0.1f;
+    float farPlane = 100.0f;
+};
+
+
+struct LightClusters {
+    // offset and count of the light indices of each cluster. the tile column varies fastest, then the row, then the slice
+    std::vector<std::uint32_t> ranges;
+
+    std::vector<std::uint32_t> lightIndices;
+};
+
+
+// Assigns lights to the clusters they overlap. The bounding sphere of each light is tested against the
+// tile planes four lights at a time, then every depth slice gathers its lights in parallel.
+class LightClusterBuilder {
+public:
+    explicit LightClusterBuilder(const ClusterGridParams &params);
+
+    const ClusterGridParams& getParams() const {
+        return params;
+    }
+
+    // the shader computes the slice of a fragment as log(viewDepth) * scale + bias
+    glm::vec2 getDepthSliceParams() const;
+
+    void build(const std::vector<LocalLight> &lights, const glm::mat4 &view, const glm::mat4 &proj, ThreadPool &threadPool, LightClusters &clusters);
+
+private:
+    // per slice scratch storage
+    struct SliceLists {
+        std::vector<std::vector<std::uint32_t>> tiles;
+    };
+
+    void computeTileMasks(size_t firstLight, size_t lightCount);
+
+    void gatherSlice(unsigned int slice);
+
+private:
+    const ClusterGridParams params;
+
+    // tile boundary planes through the eye, in view space. (normal.x or normal.y, normal.z) pairs
+    std::vector<glm::vec2> columnPlanes;
+    std::vector<glm::vec2> rowPlanes;
+
+    // view space bounding spheres of the lights, as SoA padded to a multiple of 4
+    std::vector<float> lightX, lightY, lightZ, lightRadius;
+
+    // tile columns and rows overlapped by each light, one bit each
+    std::vector<std::uint32_t> columnMasks;
+    std::vector<std::uint32_t> rowMasks;
+
+    std::vector<SliceLists> sliceLists;
+};
+
+
+// three RGBA texels per light: (position, range), (color, cosOuterCone), (direction, cosInnerCone)
+void packLightData(const std::vector<LocalLight> &lights, std::vector<glm::vec4> &texels);
+
+// lights scattered in a box, to stress the lighting
+std::vector<LocalLight> createRandomLights(size_t count, const glm::vec3 &boxMin, const glm::vec3 &boxMax, float range, unsigned int seed);
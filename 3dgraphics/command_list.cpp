@@ -0,0 +1,275 @@
+
+#include "command_list.hpp"
+
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+
+
+std::uint32_t CommandList::addData(const void *data, const size_t size) {
+    const size_t offset = payload.size();
+
+    payload.resize(offset + (size + sizeof(std::uint32_t) - 1) / sizeof(std::uint32_t));
+    std::memcpy(payload.data() + offset, data, size);
+
+    return static_cast<std::uint32_t>(offset);
+}
+
+
+void CommandList::useProgram(const std::uint32_t program) {
+    Command command;
+    command.type = CommandType::UseProgram;
+    command.handle = program;
+
+    commands.push_back(command);
+}
+
+
+void CommandList::setUniform(const UniformSlot slot, const float value) {
+    Command command;
+    command.type = CommandType::UniformFloat;
+    command.slot = static_cast<std::uint8_t>(slot);
+    command.data = addData(&value, sizeof(value));
+
+    commands.push_back(command);
+}
+
+
+void CommandList::setUniform(const UniformSlot slot, const int value) {
+    Command command;
+    command.type = CommandType::UniformInt;
+    command.slot = static_cast<std::uint8_t>(slot);
+    command.data = addData(&value, sizeof(value));
+
+    commands.push_back(command);
+}
+
+
+void CommandList::setUniform(const UniformSlot slot, const glm::vec3 &value) {
+    Command command;
+    command.type = CommandType::UniformVec3;
+    command.slot = static_cast<std::uint8_t>(slot);
+    command.data = addData(glm::value_ptr(value), sizeof(float) * 3);
+
+    commands.push_back(command);
+}
+
+
+void CommandList::setUniform(const UniformSlot slot, const glm::vec4 &value) {
+    Command command;
+    command.type = CommandType::UniformVec4;
+    command.slot = static_cast<std::uint8_t>(slot);
+    command.data = addData(glm::value_ptr(value), sizeof(float) * 4);
+
+    commands.push_back(command);
+}
+
+
+void CommandList::setUniform(const UniformSlot slot, const glm::mat4 &value) {
+    Command command;
+    command.type = CommandType::UniformMat4;
+    command.slot = static_cast<std::uint8_t>(slot);
+    command.data = addData(glm::value_ptr(value), sizeof(float) * 16);
+
+    commands.push_back(command);
+}
+
+
+void CommandList::setUniform(const UniformSlot slot, const glm::mat4 *values, const size_t count) {
+    Command command;
+    command.type = CommandType::UniformMat4Array;
+    command.slot = static_cast<std::uint8_t>(slot);
+    command.count = static_cast<std::uint32_t>(count);
+    command.data = addData(values, sizeof(float) * 16 * count);
+
+    commands.push_back(command);
+}
+
+
+void CommandList::bindTexture(const std::uint8_t unit, const std::uint32_t texture) {
+    Command command;
+    command.type = CommandType::BindTexture;
+    command.slot = unit;
+    command.handle = texture;
+
+    commands.push_back(command);
+}
+
+
+void CommandList::bindTextureArray(const std::uint8_t unit, const std::uint32_t texture) {
+    Command command;
+    command.type = CommandType::BindTextureArray;
+    command.slot = unit;
+    command.handle = texture;
+
+    commands.push_back(command);
+}
+
+
+void CommandList::bindBufferTexture(const std::uint8_t unit, const std::uint32_t texture) {
+    Command command;
+    command.type = CommandType::BindBufferTexture;
+    command.slot = unit;
+    command.handle = texture;
+
+    commands.push_back(command);
+}
+
+
+void CommandList::enable(const RenderState state) {
+    Command command;
+    command.type = CommandType::Enable;
+    command.slot = static_cast<std::uint8_t>(state);
+
+    commands.push_back(command);
+}
+
+
+void CommandList::disable(const RenderState state) {
+    Command command;
+    command.type = CommandType::Disable;
+    command.slot = static_cast<std::uint8_t>(state);
+
+    commands.push_back(command);
+}
+
+
+void CommandList::setDepthFunc(const DepthFunc func) {
+    Command command;
+    command.type = CommandType::DepthFunc;
+    command.slot = static_cast<std::uint8_t>(func);
+
+    commands.push_back(command);
+}
+
+
+void CommandList::setDepthWrite(const bool enabled) {
+    Command command;
+    command.type = CommandType::DepthWrite;
+    command.slot = enabled ? 1 : 0;
+
+    commands.push_back(command);
+}
+
+
+void CommandList::setColorWrite(const bool enabled) {
+    Command command;
+    command.type = CommandType::ColorWrite;
+    command.slot = enabled ? 1 : 0;
+
+    commands.push_back(command);
+}
+
+
+void CommandList::setDepthBias(const float factor, const float units) {
+    const float values[] = {factor, units};
+
+    Command command;
+    command.type = CommandType::DepthBias;
+    command.data = addData(values, sizeof(values));
+
+    commands.push_back(command);
+}
+
+
+void CommandList::bindFramebuffer(const std::uint32_t framebuffer, const std::uint32_t width, const std::uint32_t height) {
+    const std::uint32_t size[] = {width, height};
+
+    Command command;
+    command.type = CommandType::BindFramebuffer;
+    command.handle = framebuffer;
+    command.data = addData(size, sizeof(size));
+
+    commands.push_back(command);
+}
+
+
+void CommandList::setViewport(const std::uint32_t x, const std::uint32_t y, const std::uint32_t width, const std::uint32_t height) {
+    const std::uint32_t region[] = {x, y, width, height};
+
+    Command command;
+    command.type = CommandType::Viewport;
+    command.data = addData(region, sizeof(region));
+
+    commands.push_back(command);
+}
+
+
+void CommandList::blitDepth(const std::uint32_t source, const std::uint32_t destination, const std::uint32_t width, const std::uint32_t height) {
+    const std::uint32_t arguments[] = {destination, width, height};
+
+    Command command;
+    command.type = CommandType::BlitDepth;
+    command.handle = source;
+    command.data = addData(arguments, sizeof(arguments));
+
+    commands.push_back(command);
+}
+
+
+void CommandList::clearTargets(const glm::vec4 &color, const bool clearColor, const bool clearDepth) {
+    Command command;
+    command.type = CommandType::Clear;
+    command.slot = (clearColor ? 1 : 0) | (clearDepth ? 2 : 0);
+    command.data = addData(glm::value_ptr(color), sizeof(float) * 4);
+
+    commands.push_back(command);
+}
+
+
+void CommandList::updateBuffer(const std::uint32_t buffer, const void *data, const size_t size) {
+    Command command;
+    command.type = CommandType::UpdateBuffer;
+    command.handle = buffer;
+    command.count = static_cast<std::uint32_t>(size);
+    command.data = addData(data, size);
+
+    commands.push_back(command);
+}
+
+
+void CommandList::bindUniformBuffer(const std::uint8_t binding, const std::uint32_t buffer) {
+    Command command;
+    command.type = CommandType::BindUniformBuffer;
+    command.slot = binding;
+    command.handle = buffer;
+
+    commands.push_back(command);
+}
+
+
+void CommandList::drawArrays(const std::uint32_t vertexArray, const std::uint32_t primitive, const std::uint32_t count) {
+    Command command;
+    command.type = CommandType::DrawArrays;
+    command.handle = vertexArray;
+    command.primitive = primitive;
+    command.count = count;
+
+    commands.push_back(command);
+}
+
+
+void CommandList::drawElements(const std::uint32_t vertexArray, const std::uint32_t primitive, const std::uint32_t indexType, const std::uint32_t count) {
+    Command command;
+    command.type = CommandType::DrawElements;
+    command.handle = vertexArray;
+    command.primitive = primitive;
+    command.indexType = indexType;
+    command.count = count;
+
+    commands.push_back(command);
+}
+
+
+void CommandList::multiDrawElements(const std::uint32_t vertexArray, const std::uint32_t primitive, const std::uint32_t indexType, const std::vector<MeshletRange> &ranges) {
+    static_assert(sizeof(MeshletRange) == 2 * sizeof(std::uint32_t), "the ranges are stored as (offset, count) word pairs");
+
+    Command command;
+    command.type = CommandType::MultiDrawElements;
+    command.handle = vertexArray;
+    command.primitive = primitive;
+    command.indexType = indexType;
+    command.count = static_cast<std::uint32_t>(ranges.size());
+    command.data = addData(ranges.data(), ranges.size() * sizeof(MeshletRange));
+
+    commands.push_back(command);
+}
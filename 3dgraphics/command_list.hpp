@@ -0,0 +1,179 @@
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "meshlet.hpp"
+
+
+// uniforms are addressed by slot. the backend maps each slot to a location of the program in use
+enum class UniformSlot : std::uint8_t {
+    Model,
+    View,
+    Proj,
+    MaterialAmbient,
+    MaterialDiffuse,
+    MaterialSpecular,
+    MaterialDiffuseSamplerEnable,
+    MaterialDiffuseSampler,
+    MaterialDiffuseLayer,
+    MaterialOpacity,
+    MaterialOpacitySamplerEnable,
+    MaterialPbr,
+    MaterialPbrTextures,
+    CameraPosition,
+    LightDirection,
+    LightAmbient,
+    LightDiffuse,
+    ClusterGrid,
+    ClusterDepthParams,
+    ViewportSize,
+    ShadowMatrices,
+    ShadowSplits,
+    Count
+};
+
+
+enum class RenderState : std::uint8_t {
+    DepthTest,
+    CullFace,
+    Blend,
+    ScissorTest
+};
+
+
+enum class DepthFunc : std::uint8_t {
+    Less,
+    LessEqual,
+    Equal
+};
+
+
+enum class CommandType : std::uint8_t {
+    UseProgram,
+    UniformFloat,
+    UniformInt,
+    UniformVec3,
+    UniformVec4,
+    UniformMat4,
+    UniformMat4Array,
+    BindTexture,
+    BindTextureArray,
+    BindBufferTexture,
+    Enable,
+    Disable,
+    DepthFunc,
+    DepthWrite,
+    ColorWrite,
+    DepthBias,
+    BindFramebuffer,
+    Viewport,
+    BlitDepth,
+    Clear,
+    UpdateBuffer,
+    BindUniformBuffer,
+    DrawArrays,
+    DrawElements,
+    MultiDrawElements
+};
+
+
+struct Command {
+    CommandType type = CommandType::UseProgram;
+
+    // uniform slot, texture unit, render state or buffer binding point
+    std::uint8_t slot = 0;
+
+    // program, texture, buffer, framebuffer or vertex array
+    std::uint32_t handle = 0;
+
+    // primitive type and index type of the draws
+    std::uint32_t primitive = 0;
+    std::uint32_t indexType = 0;
+
+    // vertex/index count, byte size, range count or array length
+    std::uint32_t count = 0;
+
+    // offset of the arguments in the payload of the command list, in words
+    std::uint32_t data = 0;
+};
+
+
+// A recorded sequence of rendering commands. Recording doesn't touch the graphics API, so command lists
+// can be built on any thread and replayed later by a backend on the context thread. Resource handles,
+// primitive and index types are opaque values defined by the backend.
+class CommandList {
+public:
+    void clear() {
+        commands.clear();
+        payload.clear();
+    }
+
+    bool empty() const {
+        return commands.empty();
+    }
+
+    void useProgram(std::uint32_t program);
+
+    void setUniform(UniformSlot slot, float value);
+    void setUniform(UniformSlot slot, int value);
+    void setUniform(UniformSlot slot, const glm::vec3 &value);
+    void setUniform(UniformSlot slot, const glm::vec4 &value);
+    void setUniform(UniformSlot slot, const glm::mat4 &value);
+    void setUniform(UniformSlot slot, const glm::mat4 *values, size_t count);
+
+    void bindTexture(std::uint8_t unit, std::uint32_t texture);
+    void bindTextureArray(std::uint8_t unit, std::uint32_t texture);
+    void bindBufferTexture(std::uint8_t unit, std::uint32_t texture);
+
+    void enable(RenderState state);
+    void disable(RenderState state);
+
+    void setDepthFunc(DepthFunc func);
+    void setDepthWrite(bool enabled);
+    void setColorWrite(bool enabled);
+
+    // polygon offset of the filled primitives. zero disables it
+    void setDepthBias(float factor, float units);
+
+    // binds the framebuffer for drawing, and sets the viewport to its size
+    void bindFramebuffer(std::uint32_t framebuffer, std::uint32_t width, std::uint32_t height);
+
+    // sets the viewport, and the scissor box to the same region
+    void setViewport(std::uint32_t x, std::uint32_t y, std::uint32_t width, std::uint32_t height);
+
+    // copies the depth of a whole framebuffer into another of the same size
+    void blitDepth(std::uint32_t source, std::uint32_t destination, std::uint32_t width, std::uint32_t height);
+
+    void clearTargets(const glm::vec4 &color, bool clearColor, bool clearDepth);
+
+    // the data is copied into the command list
+    void updateBuffer(std::uint32_t buffer, const void *data, size_t size);
+
+    void bindUniformBuffer(std::uint8_t binding, std::uint32_t buffer);
+
+    void drawArrays(std::uint32_t vertexArray, std::uint32_t primitive, std::uint32_t count);
+    void drawElements(std::uint32_t vertexArray, std::uint32_t primitive, std::uint32_t indexType, std::uint32_t count);
+
+    // draws several ranges of the index buffer at once. the offsets of the ranges are in indices, not bytes
+    void multiDrawElements(std::uint32_t vertexArray, std::uint32_t primitive, std::uint32_t indexType, const std::vector<MeshletRange> &ranges);
+
+    const std::vector<Command>& getCommands() const {
+        return commands;
+    }
+
+    const std::uint32_t* getData(const Command &command) const {
+        return payload.data() + command.data;
+    }
+
+private:
+    std::uint32_t addData(const void *data, size_t size);
+
+private:
+    std::vector<Command> commands;
+
+    // arguments of the commands, padded to whole words
+    std::vector<std::uint32_t> payload;
+};
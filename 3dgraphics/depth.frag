@@ -0,0 +1,5 @@
+#version 330
+
+// depth only, the color writes are masked out
+void main() {
+}
@@ -0,0 +1,14 @@
+#version 330
+
+uniform mat4 uModel;
+uniform mat4 uView;
+uniform mat4 uProj;
+
+in vec3 vertCoord;
+
+// must produce the same depth as gouraud.vert, the shading pass tests for equality
+invariant gl_Position;
+
+void main() {
+    gl_Position = uProj * uView * uModel * vec4(vertCoord, 1.0);
+}
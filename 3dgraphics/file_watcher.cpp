@@ -0,0 +1,107 @@
+
+#include "file_watcher.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include "path_utils.hpp"
+
+#if defined(__linux__)
+#   include <sys/inotify.h>
+#   include <unistd.h>
+#endif
+
+
+#if defined(__linux__)
+FileWatcher::FileWatcher() : buffer(64 * 1024) {
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (fd < 0) {
+        std::cout << "Can't initialize inotify, the files won't be watched" << std::endl;
+    }
+}
+
+
+FileWatcher::~FileWatcher() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+
+void FileWatcher::addFile(const std::string &filePath) {
+    if (fd < 0) {
+        return;
+    }
+
+    const std::string path = normalize_path(filePath);
+    const std::string directory {parent_path(path)};
+
+    if (directoryWatches.find(directory) == directoryWatches.end()) {
+        const int wd = inotify_add_watch(fd, directory.empty() ? "." : directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+
+        if (wd < 0) {
+            std::cout << "Can't watch the directory of " << filePath << std::endl;
+            return;
+        }
+
+        directories[wd] = directory;
+        directoryWatches[directory] = wd;
+    }
+
+    files[path] = filePath;
+}
+
+
+void FileWatcher::poll(std::vector<std::string> &changedFiles) {
+    if (fd < 0) {
+        return;
+    }
+
+    const size_t firstChange = changedFiles.size();
+
+    while (true) {
+        const ssize_t size = read(fd, buffer.data(), buffer.size());
+
+        // EAGAIN once the queue is empty
+        if (size <= 0) {
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < size; ) {
+            const inotify_event *event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            const auto directory = directories.find(event->wd);
+
+            if (event->len == 0 || directory == directories.end()) {
+                continue;
+            }
+
+            const auto file = files.find(directory->second + event->name);
+
+            if (file == files.end()) {
+                continue;
+            }
+
+            // a save usually triggers several events
+            if (std::find(changedFiles.begin() + firstChange, changedFiles.end(), file->second) == changedFiles.end()) {
+                changedFiles.push_back(file->second);
+            }
+        }
+    }
+}
+#else
+FileWatcher::FileWatcher() {
+    std::cout << "File watching requires inotify, the files won't be watched" << std::endl;
+}
+
+
+FileWatcher::~FileWatcher() {}
+
+
+void FileWatcher::addFile(const std::string &) {}
+
+
+void FileWatcher::poll(std::vector<std::string> &) {}
+#endif
@@ -0,0 +1,41 @@
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+
+// Reports the watched files that were written or replaced since the last poll. Built on inotify, on other
+// platforms no change is ever reported.
+class FileWatcher {
+public:
+    FileWatcher();
+
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool isSupported() const {
+        return fd >= 0;
+    }
+
+    // the directory of the file is watched, to catch the editors that save by renaming a temporary file
+    void addFile(const std::string &filePath);
+
+    // doesn't block. appends each changed file once, with the path it was added with
+    void poll(std::vector<std::string> &changedFiles);
+
+private:
+    int fd = -1;
+
+    // watch descriptor to directory, with its trailing separator (empty for the working directory)
+    std::map<int, std::string> directories;
+    std::map<std::string, int> directoryWatches;
+
+    // normalized path to the path given to addFile
+    std::map<std::string, std::string> files;
+
+    std::vector<char> buffer;
+};
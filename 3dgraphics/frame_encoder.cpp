@@ -0,0 +1,600 @@
+
+#include "frame_encoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+
+namespace {
+    // the fixed Huffman codes of deflate, bit reversed so they can be written least significant bit first
+    struct DeflateTables {
+        std::array<std::uint16_t, 288> literalCodes;
+        std::array<std::uint8_t, 288> literalLengths;
+        std::array<std::uint8_t, 30> distanceCodes;
+
+        // match length (3 to 258) and distance (1 to 32768) to their code
+        std::array<std::uint8_t, 259> lengthSymbols;
+        std::array<std::uint8_t, 32769> distanceSymbols;
+
+        static constexpr std::uint16_t LengthBases[29] = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+        };
+
+        static constexpr std::uint8_t LengthExtraBits[29] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+        };
+
+        static constexpr std::uint16_t DistanceBases[30] = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+            4097, 6145, 8193, 12289, 16385, 24577
+        };
+
+        static constexpr std::uint8_t DistanceExtraBits[30] = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+        };
+
+        DeflateTables() {
+            for (unsigned int symbol = 0; symbol < 288; symbol++) {
+                unsigned int code, length;
+
+                if (symbol < 144) {
+                    code = 0x30 + symbol;
+                    length = 8;
+                }
+                else if (symbol < 256) {
+                    code = 0x190 + symbol - 144;
+                    length = 9;
+                }
+                else if (symbol < 280) {
+                    code = symbol - 256;
+                    length = 7;
+                }
+                else {
+                    code = 0xC0 + symbol - 280;
+                    length = 8;
+                }
+
+                literalCodes[symbol] = std::uint16_t(reverse(code, length));
+                literalLengths[symbol] = std::uint8_t(length);
+            }
+
+            for (unsigned int symbol = 0; symbol < 30; symbol++) {
+                distanceCodes[symbol] = std::uint8_t(reverse(symbol, 5));
+            }
+
+            for (unsigned int symbol = 0; symbol < 29; symbol++) {
+                const unsigned int last = symbol == 28 ? 258 : LengthBases[symbol + 1] - 1u;
+
+                for (unsigned int length = LengthBases[symbol]; length <= last; length++) {
+                    lengthSymbols[length] = std::uint8_t(symbol);
+                }
+            }
+
+            for (unsigned int symbol = 0; symbol < 30; symbol++) {
+                const unsigned int last = symbol == 29 ? 32768 : DistanceBases[symbol + 1] - 1u;
+
+                for (unsigned int distance = DistanceBases[symbol]; distance <= last; distance++) {
+                    distanceSymbols[distance] = std::uint8_t(symbol);
+                }
+            }
+        }
+
+        static unsigned int reverse(unsigned int code, const unsigned int length) {
+            unsigned int reversed = 0;
+
+            for (unsigned int i = 0; i < length; i++) {
+                reversed = (reversed << 1) | (code & 1);
+                code >>= 1;
+            }
+
+            return reversed;
+        }
+    };
+
+
+    class BitWriter {
+    public:
+        explicit BitWriter(std::vector<std::uint8_t> &out) : out(out) {}
+
+        void write(const std::uint32_t value, const unsigned int count) {
+            bits |= std::uint64_t(value) << bitCount;
+            bitCount += count;
+
+            while (bitCount >= 8) {
+                out.push_back(std::uint8_t(bits));
+                bits >>= 8;
+                bitCount -= 8;
+            }
+        }
+
+        void flush() {
+            if (bitCount > 0) {
+                out.push_back(std::uint8_t(bits));
+            }
+
+            bits = 0;
+            bitCount = 0;
+        }
+
+    private:
+        std::vector<std::uint8_t> &out;
+        std::uint64_t bits = 0;
+        unsigned int bitCount = 0;
+    };
+
+
+    const unsigned int WindowSize = 32768;
+    const unsigned int HashBits = 15;
+    const unsigned int MinMatch = 3;
+    const unsigned int MaxMatch = 258;
+
+    // candidates tried for each match, a trade between speed and compression
+    const unsigned int MaxChainLength = 16;
+
+
+    // a zlib stream of a single deflate block with the fixed codes, and greedy matching over hash chains
+    void compress(const std::vector<std::uint8_t> &data, std::vector<std::uint8_t> &out) {
+        static const DeflateTables tables;
+
+        out.push_back(0x78);
+        out.push_back(0x01);
+
+        BitWriter writer {out};
+
+        // final block, fixed codes
+        writer.write(1, 1);
+        writer.write(1, 2);
+
+        const auto writeSymbol = [&](const unsigned int symbol) {
+            writer.write(tables.literalCodes[symbol], tables.literalLengths[symbol]);
+        };
+
+        std::vector<std::int32_t> head(size_t(1) << HashBits, -1);
+        std::vector<std::int32_t> previous(WindowSize, -1);
+
+        const size_t size = data.size();
+
+        const auto hash = [&](const size_t i) {
+            const std::uint32_t key = std::uint32_t(data[i]) << 16 | std::uint32_t(data[i + 1]) << 8 | data[i + 2];
+
+            return (key * 2654435761u) >> (32 - HashBits);
+        };
+
+        const auto insert = [&](const size_t i) {
+            const std::uint32_t h = hash(i);
+
+            previous[i % WindowSize] = head[h];
+            head[h] = std::int32_t(i);
+        };
+
+        size_t i = 0;
+
+        while (i < size) {
+            unsigned int bestLength = 0;
+            size_t bestDistance = 0;
+
+            if (i + MinMatch <= size) {
+                const size_t maxLength = std::min<size_t>(MaxMatch, size - i);
+                std::int32_t candidate = head[hash(i)];
+
+                for (unsigned int chain = 0; chain < MaxChainLength && candidate >= 0 && i - size_t(candidate) <= WindowSize; chain++) {
+                    unsigned int length = 0;
+
+                    while (length < maxLength && data[size_t(candidate) + length] == data[i + length]) {
+                        length++;
+                    }
+
+                    if (length > bestLength) {
+                        bestLength = length;
+                        bestDistance = i - size_t(candidate);
+
+                        if (length == maxLength) {
+                            break;
+                        }
+                    }
+
+                    candidate = previous[size_t(candidate) % WindowSize];
+                }
+
+                insert(i);
+            }
+
+            if (bestLength < MinMatch) {
+                writeSymbol(data[i]);
+                i++;
+                continue;
+            }
+
+            const unsigned int lengthSymbol = tables.lengthSymbols[bestLength];
+            writeSymbol(257 + lengthSymbol);
+            writer.write(bestLength - DeflateTables::LengthBases[lengthSymbol], DeflateTables::LengthExtraBits[lengthSymbol]);
+
+            const unsigned int distanceSymbol = tables.distanceSymbols[bestDistance];
+            writer.write(tables.distanceCodes[distanceSymbol], 5);
+            writer.write(std::uint32_t(bestDistance) - DeflateTables::DistanceBases[distanceSymbol], DeflateTables::DistanceExtraBits[distanceSymbol]);
+
+            for (size_t j = i + 1; j < i + bestLength && j + MinMatch <= size; j++) {
+                insert(j);
+            }
+
+            i += bestLength;
+        }
+
+        writeSymbol(256);
+        writer.flush();
+
+        std::uint32_t a = 1, b = 0;
+
+        for (const std::uint8_t byte : data) {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+
+        const std::uint32_t adler = (b << 16) | a;
+
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            out.push_back(std::uint8_t(adler >> shift));
+        }
+    }
+
+
+    std::uint32_t crc32(const std::uint8_t *data, const size_t size, std::uint32_t crc = 0) {
+        static const std::array<std::uint32_t, 256> table = [] {
+            std::array<std::uint32_t, 256> table;
+
+            for (std::uint32_t i = 0; i < 256; i++) {
+                std::uint32_t c = i;
+
+                for (int k = 0; k < 8; k++) {
+                    c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+
+                table[i] = c;
+            }
+
+            return table;
+        }();
+
+        crc = ~crc;
+
+        for (size_t i = 0; i < size; i++) {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+
+        return ~crc;
+    }
+
+
+    void writeBigEndian(std::vector<std::uint8_t> &out, const std::uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            out.push_back(std::uint8_t(value >> shift));
+        }
+    }
+
+
+    void writeChunk(std::vector<std::uint8_t> &png, const char *type, const std::vector<std::uint8_t> &data) {
+        writeBigEndian(png, std::uint32_t(data.size()));
+
+        const size_t start = png.size();
+
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), data.begin(), data.end());
+
+        writeBigEndian(png, crc32(png.data() + start, png.size() - start));
+    }
+
+
+    std::uint8_t paeth(const int a, const int b, const int c) {
+        const int p = a + b - c;
+        const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+
+        return std::uint8_t(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+    }
+}
+
+
+void encodePng(unsigned int width, unsigned int height, const std::uint8_t *rows, std::ptrdiff_t stride, size_t pixelSize, std::vector<std::uint8_t> &png) {
+    const size_t rowSize = size_t(width) * 3;
+
+    // each row with the filter of the smallest sum of absolute differences, as libpng chooses them
+    std::vector<std::uint8_t> filtered(height * (rowSize + 1));
+    std::vector<std::uint8_t> current(rowSize), above(rowSize, 0);
+    std::array<std::vector<std::uint8_t>, 4> candidates;
+
+    for (std::vector<std::uint8_t> &candidate : candidates) {
+        candidate.resize(rowSize);
+    }
+
+    const std::uint8_t filterTypes[4] = {0, 1, 2, 4};
+
+    for (unsigned int y = 0; y < height; y++) {
+        const std::uint8_t *row = rows + std::ptrdiff_t(y) * stride;
+
+        for (unsigned int x = 0; x < width; x++) {
+            std::memcpy(&current[3 * size_t(x)], row + x * pixelSize, 3);
+        }
+
+        unsigned int bestFilter = 0;
+        size_t bestSum = std::numeric_limits<size_t>::max();
+
+        for (unsigned int filter = 0; filter < 4; filter++) {
+            std::vector<std::uint8_t> &candidate = candidates[filter];
+            size_t sum = 0;
+
+            for (size_t i = 0; i < rowSize; i++) {
+                const int left = i >= 3 ? current[i - 3] : 0;
+                const int up = above[i];
+                const int upLeft = i >= 3 ? above[i - 3] : 0;
+
+                std::uint8_t predicted = 0;
+
+                switch (filterTypes[filter]) {
+                    case 1: predicted = std::uint8_t(left); break;
+                    case 2: predicted = std::uint8_t(up); break;
+                    case 4: predicted = paeth(left, up, upLeft); break;
+                }
+
+                candidate[i] = std::uint8_t(current[i] - predicted);
+                sum += std::abs(int(std::int8_t(candidate[i])));
+            }
+
+            if (sum < bestSum) {
+                bestSum = sum;
+                bestFilter = filter;
+            }
+        }
+
+        std::uint8_t *out = &filtered[y * (rowSize + 1)];
+        out[0] = filterTypes[bestFilter];
+        std::memcpy(out + 1, candidates[bestFilter].data(), rowSize);
+
+        std::swap(current, above);
+    }
+
+    png.clear();
+
+    const std::uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    png.insert(png.end(), signature, signature + 8);
+
+    std::vector<std::uint8_t> header;
+    writeBigEndian(header, width);
+    writeBigEndian(header, height);
+
+    // 8 bits per channel, RGB, no interlacing
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+    writeChunk(png, "IHDR", header);
+
+    std::vector<std::uint8_t> compressed;
+    compress(filtered, compressed);
+    writeChunk(png, "IDAT", compressed);
+
+    writeChunk(png, "IEND", {});
+}
+
+
+FrameEncoder::FrameEncoder(const FrameEncoderParams &params) : params(params) {
+    unsigned int threadCount = std::max(params.threadCount, 1u);
+
+    if (params.format == CaptureFormat::Y4m) {
+        stream.open(params.outputPath, std::ios::binary);
+
+        if (!stream) {
+            std::cout << "Can't write the capture to " << params.outputPath << std::endl;
+            open = false;
+            return;
+        }
+
+        // the frames must reach the stream in order
+        threadCount = 1;
+    }
+
+    for (unsigned int i = 0; i < threadCount; i++) {
+        encoderThreads.emplace_back(&FrameEncoder::encoderThreadMain, this);
+    }
+}
+
+
+FrameEncoder::~FrameEncoder() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        quit = true;
+    }
+
+    framesChanged.notify_all();
+
+    for (std::thread &thread : encoderThreads) {
+        thread.join();
+    }
+}
+
+
+bool FrameEncoder::acquireBuffer(const size_t size, std::vector<std::uint8_t> &pixels) {
+    if (!open) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock{mutex};
+
+    // a frame larger than the whole budget still goes through, alone
+    const auto fits = [&]() {
+        return bytesInFlight == 0 || bytesInFlight + size <= params.memoryBudget;
+    };
+
+    if (params.dropFrames && !fits()) {
+        stats.dropped++;
+        return false;
+    }
+
+    framesChanged.wait(lock, fits);
+
+    bytesInFlight += size;
+
+    if (!freeBuffers.empty()) {
+        pixels = std::move(freeBuffers.back());
+        freeBuffers.pop_back();
+    }
+
+    pixels.resize(size);
+
+    return true;
+}
+
+
+void FrameEncoder::submit(const unsigned int width, const unsigned int height, std::vector<std::uint8_t> &&pixels) {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        frames.push_back({nextIndex++, width, height, std::move(pixels)});
+        stats.submitted++;
+    }
+
+    framesChanged.notify_all();
+}
+
+
+void FrameEncoder::flush() {
+    std::unique_lock<std::mutex> lock{mutex};
+
+    framesChanged.wait(lock, [this]() {
+        return bytesInFlight == 0;
+    });
+}
+
+
+FrameEncoderStats FrameEncoder::getStats() {
+    std::lock_guard<std::mutex> lock{mutex};
+
+    return stats;
+}
+
+
+void FrameEncoder::encoderThreadMain() {
+    std::vector<std::uint8_t> scratch;
+
+    while (true) {
+        Frame frame;
+
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+
+            // the frames left when quitting are still written
+            framesChanged.wait(lock, [this]() {
+                return quit || !frames.empty();
+            });
+
+            if (frames.empty()) {
+                return;
+            }
+
+            frame = std::move(frames.front());
+            frames.pop_front();
+        }
+
+        const bool encoded = encode(frame, scratch);
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            if (encoded) {
+                stats.encoded++;
+            }
+            else {
+                stats.failed++;
+            }
+
+            bytesInFlight -= frame.pixels.size();
+            freeBuffers.push_back(std::move(frame.pixels));
+        }
+
+        framesChanged.notify_all();
+    }
+}
+
+
+bool FrameEncoder::encode(const Frame &frame, std::vector<std::uint8_t> &scratch) {
+    const size_t rowSize = size_t(frame.width) * 4;
+    const std::uint8_t *topRow = frame.pixels.data() + (frame.height - 1) * rowSize;
+
+    if (params.format == CaptureFormat::PngSequence) {
+        std::string index = std::to_string(frame.index);
+        index.insert(0, index.size() < 5 ? 5 - index.size() : 0, '0');
+
+        const std::string filePath = params.outputPath + index + ".png";
+
+        encodePng(frame.width, frame.height, topRow, -std::ptrdiff_t(rowSize), 4, scratch);
+
+        std::ofstream file {filePath, std::ios::binary};
+        file.write(reinterpret_cast<const char*>(scratch.data()), std::streamsize(scratch.size()));
+
+        if (!file) {
+            std::cout << "Can't write the captured frame " << filePath << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    // the stream has the size of its first frame
+    if (frame.index == 0) {
+        stream << "YUV4MPEG2 W" << frame.width << " H" << frame.height << " F" << params.frameRate << ":1 Ip A1:1 C420jpeg\n";
+        streamWidth = frame.width;
+        streamHeight = frame.height;
+    }
+
+    if (frame.width != streamWidth || frame.height != streamHeight) {
+        return false;
+    }
+
+    // BT.601 with the video range, as the players expect it. the chroma is averaged over each 2x2 block
+    const unsigned int chromaWidth = (frame.width + 1) / 2, chromaHeight = (frame.height + 1) / 2;
+    const size_t lumaSize = size_t(frame.width) * frame.height, chromaSize = size_t(chromaWidth) * chromaHeight;
+
+    scratch.resize(lumaSize + 2 * chromaSize);
+
+    std::uint8_t *luma = scratch.data();
+    std::uint8_t *blue = luma + lumaSize;
+    std::uint8_t *red = blue + chromaSize;
+
+    for (unsigned int y = 0; y < frame.height; y++) {
+        const std::uint8_t *row = topRow - std::ptrdiff_t(y) * std::ptrdiff_t(rowSize);
+
+        for (unsigned int x = 0; x < frame.width; x++) {
+            const int r = row[4 * x + 0], g = row[4 * x + 1], b = row[4 * x + 2];
+
+            luma[size_t(y) * frame.width + x] = std::uint8_t(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        }
+    }
+
+    for (unsigned int y = 0; y < chromaHeight; y++) {
+        for (unsigned int x = 0; x < chromaWidth; x++) {
+            int r = 0, g = 0, b = 0, count = 0;
+
+            for (unsigned int sy = 2 * y; sy < std::min(2 * y + 2, frame.height); sy++) {
+                const std::uint8_t *row = topRow - std::ptrdiff_t(sy) * std::ptrdiff_t(rowSize);
+
+                for (unsigned int sx = 2 * x; sx < std::min(2 * x + 2, frame.width); sx++) {
+                    r += row[4 * sx + 0];
+                    g += row[4 * sx + 1];
+                    b += row[4 * sx + 2];
+                    count++;
+                }
+            }
+
+            r /= count;
+            g /= count;
+            b /= count;
+
+            blue[size_t(y) * chromaWidth + x] = std::uint8_t(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            red[size_t(y) * chromaWidth + x] = std::uint8_t(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+
+    stream << "FRAME\n";
+    stream.write(reinterpret_cast<const char*>(scratch.data()), std::streamsize(scratch.size()));
+
+    return bool(stream);
+}
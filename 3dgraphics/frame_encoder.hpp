@@ -0,0 +1,115 @@
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+enum class CaptureFormat {
+    // one RGB file per frame, <outputPath>00000.png onwards
+    PngSequence,
+
+    // a single YUV4MPEG2 stream with 4:2:0 chroma, which ffmpeg and most players read as raw video
+    Y4m
+};
+
+
+struct FrameEncoderParams {
+    std::string outputPath;
+    CaptureFormat format = CaptureFormat::PngSequence;
+
+    // upper bound for the bytes of the frames waiting for the encoder, or being encoded
+    size_t memoryBudget = size_t(256) * 1024 * 1024;
+
+    // over the budget, drop the new frames instead of waiting for the encoder
+    bool dropFrames = false;
+
+    // the PNG files are compressed in parallel. the Y4M stream has a single thread
+    unsigned int threadCount = 2;
+
+    // frames per second, for the Y4M header
+    unsigned int frameRate = 60;
+};
+
+
+struct FrameEncoderStats {
+    size_t submitted = 0;
+    size_t encoded = 0;
+    size_t dropped = 0;
+    size_t failed = 0;
+};
+
+
+// Writes the frames read back from the GPU on background threads, so the render thread only pays for a copy.
+// The frame buffers are recycled once encoded, and the frames in flight are bounded by the memory budget.
+class FrameEncoder {
+public:
+    explicit FrameEncoder(const FrameEncoderParams &params);
+
+    // waits for the frames in flight
+    ~FrameEncoder();
+
+    FrameEncoder(const FrameEncoder&) = delete;
+    FrameEncoder& operator=(const FrameEncoder&) = delete;
+
+    // false when the output can't be written
+    bool isOpen() const {
+        return open;
+    }
+
+    // a buffer of the given size, from the ones already encoded when possible. over the memory budget it waits
+    // for the encoder, or returns false when dropping frames
+    bool acquireBuffer(size_t size, std::vector<std::uint8_t> &pixels);
+
+    // RGBA8 pixels of an acquired buffer, with the bottom row first as glReadPixels leaves them
+    void submit(unsigned int width, unsigned int height, std::vector<std::uint8_t> &&pixels);
+
+    // waits until every submitted frame is written
+    void flush();
+
+    FrameEncoderStats getStats();
+
+private:
+    struct Frame {
+        size_t index;
+        unsigned int width;
+        unsigned int height;
+        std::vector<std::uint8_t> pixels;
+    };
+
+    void encoderThreadMain();
+
+    bool encode(const Frame &frame, std::vector<std::uint8_t> &scratch);
+
+private:
+    const FrameEncoderParams params;
+    bool open = true;
+
+    // only touched by the encoder thread of the Y4M stream
+    std::ofstream stream;
+    unsigned int streamWidth = 0;
+    unsigned int streamHeight = 0;
+
+    std::mutex mutex;
+    std::condition_variable framesChanged;
+    std::deque<Frame> frames;
+    std::vector<std::vector<std::uint8_t>> freeBuffers;
+    size_t bytesInFlight = 0;
+    size_t nextIndex = 0;
+    FrameEncoderStats stats;
+    bool quit = false;
+
+    std::vector<std::thread> encoderThreads;
+};
+
+
+// encodes the first three channels of 8 bit pixels of pixelSize bytes as an RGB PNG image. rows points to the top
+// row, and stride is the distance in bytes to the next one, negative for the images stored bottom up
+void encodePng(unsigned int width, unsigned int height, const std::uint8_t *rows, std::ptrdiff_t stride, size_t pixelSize, std::vector<std::uint8_t> &png);
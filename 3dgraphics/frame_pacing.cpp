@@ -0,0 +1,89 @@
+
+#include "frame_pacing.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+
+
+// spun before the first oversleep is measured
+static const std::chrono::microseconds InitialSpinMargin {1000};
+
+// the shortest spin, the sleeps are never that punctual
+static const std::chrono::microseconds MinSpinMargin {100};
+
+
+FramePacer::FramePacer(const FramePacingParams &params)
+    : params(params), period(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / params.frameRate))), spinMargin(InitialSpinMargin) {}
+
+
+void FramePacer::waitForNextFrame() {
+    if (params.mode != PacingMode::Capped) {
+        return;
+    }
+
+    const Clock::time_point now = Clock::now();
+
+    // the first frame starts the schedule, and so does a late one
+    if (!started || now > deadline) {
+        missedFrames += started ? 1 : 0;
+        started = true;
+        deadline = now + period;
+
+        return;
+    }
+
+    const Clock::time_point wakeTime = deadline - spinMargin;
+
+    if (wakeTime > now) {
+        std::this_thread::sleep_until(wakeTime);
+
+        const Clock::duration oversleep = Clock::now() - wakeTime;
+
+        if (oversleep > spinMargin) {
+            spinMargin = std::min<Clock::duration>(oversleep, period / 2);
+        }
+        else {
+            spinMargin = std::max<Clock::duration>(spinMargin - (spinMargin - oversleep) / 16, MinSpinMargin);
+        }
+    }
+
+    // the rest is spun
+    while (Clock::now() < deadline) {
+    }
+
+    deadline += period;
+}
+
+
+size_t FramePacer::takeMissedFrames() {
+    const size_t count = missedFrames;
+    missedFrames = 0;
+
+    return count;
+}
+
+
+void LatencyStats::addSample(const std::chrono::steady_clock::duration latency) {
+    samples.push_back(std::chrono::duration<double, std::milli>(latency).count());
+}
+
+
+LatencyStats::Summary LatencyStats::takeSummary() {
+    Summary summary;
+
+    if (samples.empty()) {
+        return summary;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    summary.average = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    summary.median = samples[samples.size() / 2];
+    summary.p99 = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    summary.max = samples.back();
+
+    samples.clear();
+
+    return summary;
+}
@@ -0,0 +1,84 @@
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+
+enum class PacingMode {
+    // the swap waits for the vertical blank
+    Vsync,
+
+    // frames are started as soon as the previous one is submitted
+    Uncapped,
+
+    // no vertical sync, the frames are started at a fixed rate by FramePacer
+    Capped
+};
+
+
+struct FramePacingParams {
+    PacingMode mode = PacingMode::Vsync;
+
+    // frames per second of the capped mode
+    double frameRate = 60.0;
+};
+
+
+// Starts the frames of the capped mode at a steady rate. Sleeping alone overshoots by whatever the
+// scheduler adds, and spinning alone burns a core, so it sleeps until shortly before the deadline and
+// spins the rest. The spin margin follows the oversleeps it measures: it grows at once to the worst
+// one, and shrinks slowly while the sleeps are punctual. A frame that ends past its deadline restarts
+// the schedule, instead of having the next frames catch up in a burst.
+class FramePacer {
+public:
+    explicit FramePacer(const FramePacingParams &params);
+
+    // waits until the next frame is due. returns at once in the vsync and uncapped modes
+    void waitForNextFrame();
+
+    // frames that started late, since the last call
+    size_t takeMissedFrames();
+
+    double getSpinMargin() const {
+        return std::chrono::duration<double, std::milli>(spinMargin).count();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    const FramePacingParams params;
+    const Clock::duration period;
+
+    Clock::time_point deadline;
+    bool started = false;
+
+    Clock::duration spinMargin;
+    size_t missedFrames = 0;
+};
+
+
+// Input to photon latency proxies: the time from the sampling of the input of a frame to the completion
+// of its swap, as seen by the CPU.
+class LatencyStats {
+public:
+    void addSample(std::chrono::steady_clock::duration latency);
+
+    size_t getSampleCount() const {
+        return samples.size();
+    }
+
+    struct Summary {
+        double average = 0.0;
+        double median = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    // of the samples since the last call, in milliseconds
+    Summary takeSummary();
+
+private:
+    std::vector<double> samples;
+};
@@ -0,0 +1,48 @@
+
+#pragma once
+
+#include <array>
+#include <glm/glm.hpp>
+
+
+struct Frustum {
+    // left, right, bottom, top, near, far. Normals point inwards and are normalized,
+    // so plane.w + dot(plane.xyz, p) is the signed distance of p to the plane
+    std::array<glm::vec4, 6> planes;
+};
+
+
+// extracts the clipping planes of a (proj * view * model) matrix (Gribb-Hartmann).
+// the planes are expressed in the space the matrix transforms from
+inline Frustum extractFrustum(const glm::mat4 &m) {
+    const glm::vec4 row0 = {m[0][0], m[1][0], m[2][0], m[3][0]};
+    const glm::vec4 row1 = {m[0][1], m[1][1], m[2][1], m[3][1]};
+    const glm::vec4 row2 = {m[0][2], m[1][2], m[2][2], m[3][2]};
+    const glm::vec4 row3 = {m[0][3], m[1][3], m[2][3], m[3][3]};
+
+    Frustum frustum;
+
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    frustum.planes[4] = row3 + row2;
+    frustum.planes[5] = row3 - row2;
+
+    for (glm::vec4 &plane : frustum.planes) {
+        plane = plane / glm::length(glm::vec3{plane});
+    }
+
+    return frustum;
+}
+
+
+inline bool intersects(const Frustum &frustum, const glm::vec3 &center, const float radius) {
+    for (const glm::vec4 &plane : frustum.planes) {
+        if (glm::dot(glm::vec3{plane}, center) + plane.w < -radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,602 @@
+
+#include "gltf_loader.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "json.hpp"
+#include "path_utils.hpp"
+
+
+static const std::uint32_t GlbMagic = 0x46546C67;     // "glTF"
+static const std::uint32_t GlbJsonChunk = 0x4E4F534A; // "JSON"
+static const std::uint32_t GlbBinChunk = 0x004E4942;  // "BIN"
+
+static const std::uint32_t GltfTriangles = 4;
+
+
+bool isGltfFile(const std::string &filePath) {
+    const auto endsWith = [&filePath](const std::string &extension) {
+        return filePath.size() > extension.size() && std::equal(extension.rbegin(), extension.rend(), filePath.rbegin(), [](const char a, const char b) {
+            return a == std::tolower(static_cast<unsigned char>(b));
+        });
+    };
+
+    return endsWith(".gltf") || endsWith(".glb");
+}
+
+
+static std::uint32_t readU32(const std::uint8_t *data) {
+    std::uint32_t value = 0;
+    std::memcpy(&value, data, sizeof(value));
+
+    return value;
+}
+
+
+// the value of a hexadecimal digit, or -1
+static int hexDigit(const char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+
+    return -1;
+}
+
+
+// decodes the %XX escapes of a relative URI. a % without two hex digits is kept as it is
+static std::string decodeUri(const std::string &uri) {
+    std::string decoded;
+
+    for (size_t i = 0; i < uri.size(); i++) {
+        const int high = uri[i] == '%' && i + 2 < uri.size() ? hexDigit(uri[i + 1]) : -1;
+        const int low = high >= 0 ? hexDigit(uri[i + 2]) : -1;
+
+        if (low >= 0) {
+            decoded += static_cast<char>(high * 16 + low);
+            i += 2;
+        }
+        else {
+            decoded += uri[i];
+        }
+    }
+
+    return decoded;
+}
+
+
+// a non negative integer of the document, or the fallback when it is missing, negative or too large
+static size_t readIndex(const JsonValue &value, const size_t fallback = SIZE_MAX) {
+    const double number = value.asNumber(-1.0);
+
+    return number >= 0.0 && number <= 4294967295.0 ? static_cast<size_t>(number) : fallback;
+}
+
+
+static std::uint32_t getComponentSize(const std::uint32_t componentType) {
+    switch (componentType) {
+    case 5120: case 5121: return 1;
+    case 5122: case 5123: return 2;
+    case 5125: case 5126: return 4;
+    default: return 0;
+    }
+}
+
+
+// unsigned byte, short and int, the index types of glTF
+static bool isIndexType(const std::uint32_t componentType) {
+    return componentType == 5121 || componentType == 5123 || componentType == 5125;
+}
+
+
+static std::uint32_t getComponentCount(const std::string &type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    if (type == "MAT4") return 16;
+
+    return 0;
+}
+
+
+// up to four numbers of a JSON array, the missing ones take the fallbacks
+static glm::vec4 readVector(const JsonValue &array, const float fallback, const float fallbackW) {
+    glm::vec4 vector = {fallback, fallback, fallback, fallbackW};
+
+    for (size_t i = 0; i < 4 && i < array.size(); i++) {
+        vector[int(i)] = static_cast<float>(array[i].asNumber(fallback));
+    }
+
+    return vector;
+}
+
+
+static glm::vec4 readVector(const JsonValue &array, const float fallback) {
+    return readVector(array, fallback, fallback);
+}
+
+
+// the parse state, to reach the buffers while reading the accessors
+class GltfParser {
+public:
+    GltfParser(const JsonValue &root, GltfDocument &document) : root(root), document(document) {}
+
+    bool parse(const std::string &parentPath, const std::uint8_t *glbBin, size_t glbBinSize);
+
+private:
+    struct BufferView {
+        const std::uint8_t *data = nullptr;
+        size_t size = 0;
+        std::uint32_t stride = 0;
+    };
+
+    bool fail(const std::string &reason) {
+        std::cout << "glTF fast path unavailable: " << reason << std::endl;
+        return false;
+    }
+
+    bool parseBuffers(const std::string &parentPath, const std::uint8_t *glbBin, size_t glbBinSize);
+
+    bool parseAccessor(const JsonValue &index, GltfAccessor &accessor);
+
+    bool parseMeshes(std::vector<std::vector<std::uint32_t>> &meshPrimitives);
+
+    bool parseNodes(const std::vector<std::vector<std::uint32_t>> &meshPrimitives);
+
+    void parseMaterials();
+
+private:
+    const JsonValue &root;
+    GltfDocument &document;
+
+    std::vector<std::pair<const std::uint8_t*, size_t>> buffers;
+    std::vector<BufferView> bufferViews;
+};
+
+
+bool GltfParser::parse(const std::string &parentPath, const std::uint8_t *glbBin, const size_t glbBinSize) {
+    if (root["extensionsRequired"].size() > 0) {
+        return fail("requires the " + root["extensionsRequired"][0].asString() + " extension");
+    }
+
+    if (root["skins"].size() > 0 || root["animations"].size() > 0) {
+        return fail("skins and animations are loaded through Assimp");
+    }
+
+    std::vector<std::vector<std::uint32_t>> meshPrimitives;
+
+    if (!parseBuffers(parentPath, glbBin, glbBinSize) || !parseMeshes(meshPrimitives) || !parseNodes(meshPrimitives)) {
+        return false;
+    }
+
+    parseMaterials();
+
+    return true;
+}
+
+
+bool GltfParser::parseBuffers(const std::string &parentPath, const std::uint8_t *glbBin, const size_t glbBinSize) {
+    const JsonValue &jsonBuffers = root["buffers"];
+
+    for (size_t i = 0; i < jsonBuffers.size(); i++) {
+        const JsonValue &buffer = jsonBuffers[i];
+        const size_t byteLength = readIndex(buffer["byteLength"], 0);
+
+        if (!buffer.has("uri")) {
+            // the binary chunk of a .glb is the first buffer
+            if (i != 0 || !glbBin || glbBinSize < byteLength) {
+                return fail("buffer without data");
+            }
+
+            buffers.emplace_back(glbBin, byteLength);
+            continue;
+        }
+
+        const std::string &uri = buffer["uri"].asString();
+
+        if (uri.compare(0, 5, "data:") == 0) {
+            return fail("embedded base64 buffers");
+        }
+
+        MappedFile file;
+
+        if (!file.open(parentPath + decodeUri(uri)) || file.size() < byteLength) {
+            return fail("can't read the buffer " + uri);
+        }
+
+        buffers.emplace_back(file.data(), byteLength);
+        document.files.push_back(std::move(file));
+    }
+
+    const JsonValue &jsonViews = root["bufferViews"];
+
+    for (size_t i = 0; i < jsonViews.size(); i++) {
+        const JsonValue &view = jsonViews[i];
+        const size_t buffer = readIndex(view["buffer"]);
+        const size_t offset = readIndex(view["byteOffset"], 0);
+        const size_t size = readIndex(view["byteLength"], 0);
+
+        if (buffer >= buffers.size() || offset + size > buffers[buffer].second) {
+            return fail("buffer view out of range");
+        }
+
+        bufferViews.push_back({buffers[buffer].first + offset, size, static_cast<std::uint32_t>(readIndex(view["byteStride"], 0))});
+    }
+
+    return true;
+}
+
+
+bool GltfParser::parseAccessor(const JsonValue &index, GltfAccessor &accessor) {
+    if (index.isNull()) {
+        return true;
+    }
+
+    const JsonValue &jsonAccessor = root["accessors"][readIndex(index)];
+
+    if (!jsonAccessor.isObject()) {
+        return fail("missing accessor");
+    }
+
+    if (jsonAccessor.has("sparse") || !jsonAccessor.has("bufferView")) {
+        return fail("sparse accessors");
+    }
+
+    const size_t viewIndex = readIndex(jsonAccessor["bufferView"]);
+
+    if (viewIndex >= bufferViews.size()) {
+        return fail("accessor out of range");
+    }
+
+    const BufferView &view = bufferViews[viewIndex];
+
+    accessor.count = static_cast<std::uint32_t>(readIndex(jsonAccessor["count"], 0));
+    accessor.componentType = static_cast<std::uint32_t>(readIndex(jsonAccessor["componentType"], 0));
+    accessor.componentCount = getComponentCount(jsonAccessor["type"].asString());
+    accessor.normalized = jsonAccessor["normalized"].asBool();
+
+    const size_t elementSize = size_t(getComponentSize(accessor.componentType)) * accessor.componentCount;
+    const size_t offset = readIndex(jsonAccessor["byteOffset"], 0);
+
+    accessor.stride = view.stride ? view.stride : static_cast<std::uint32_t>(elementSize);
+
+    if (elementSize == 0 || accessor.count == 0 || offset + size_t(accessor.stride) * (accessor.count - 1) + elementSize > view.size) {
+        return fail("accessor out of range");
+    }
+
+    accessor.data = view.data + offset;
+
+    return true;
+}
+
+
+bool GltfParser::parseMeshes(std::vector<std::vector<std::uint32_t>> &meshPrimitives) {
+    const JsonValue &meshes = root["meshes"];
+
+    // reused to check the indices of every primitive
+    std::vector<std::uint32_t> indices;
+
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const JsonValue &primitives = meshes[i]["primitives"];
+
+        meshPrimitives.emplace_back();
+
+        for (size_t j = 0; j < primitives.size(); j++) {
+            const JsonValue &jsonPrimitive = primitives[j];
+            const JsonValue &attributes = jsonPrimitive["attributes"];
+
+            if (jsonPrimitive["mode"].asNumber(GltfTriangles) != GltfTriangles) {
+                return fail("primitives other than triangle lists");
+            }
+
+            if (jsonPrimitive["targets"].size() > 0) {
+                return fail("morph targets");
+            }
+
+            GltfPrimitive primitive;
+
+            if (jsonPrimitive.has("material")) {
+                const size_t material = readIndex(jsonPrimitive["material"]);
+
+                if (material >= root["materials"].size()) {
+                    return fail("material out of range");
+                }
+
+                primitive.material = static_cast<int>(material);
+            }
+
+            if (!parseAccessor(attributes["POSITION"], primitive.positions) ||
+                !parseAccessor(attributes["NORMAL"], primitive.normals) ||
+                !parseAccessor(attributes["TEXCOORD_0"], primitive.texCoords) ||
+                !parseAccessor(jsonPrimitive["indices"], primitive.indices)) {
+                return false;
+            }
+
+            // the attributes must cover the same vertices
+            const std::uint32_t vertexCount = primitive.positions.count;
+
+            if (primitive.positions.empty() || primitive.positions.componentCount != 3 ||
+                (!primitive.normals.empty() && primitive.normals.count != vertexCount) ||
+                (!primitive.texCoords.empty() && primitive.texCoords.count != vertexCount)) {
+                return fail("inconsistent vertex attributes");
+            }
+
+            // whole triangles, whose indices stay within the vertices
+            if (!primitive.indices.empty()) {
+                if (primitive.indices.componentCount != 1 || !isIndexType(primitive.indices.componentType)) {
+                    return fail("invalid index type");
+                }
+
+                if (primitive.indices.count % 3 != 0) {
+                    return fail("incomplete triangles");
+                }
+
+                readIndices(primitive.indices, indices);
+
+                if (*std::max_element(indices.begin(), indices.end()) >= vertexCount) {
+                    return fail("index out of range");
+                }
+            }
+            else if (vertexCount % 3 != 0) {
+                return fail("incomplete triangles");
+            }
+
+            meshPrimitives.back().push_back(static_cast<std::uint32_t>(document.primitives.size()));
+            document.primitives.push_back(primitive);
+        }
+    }
+
+    return true;
+}
+
+
+bool GltfParser::parseNodes(const std::vector<std::vector<std::uint32_t>> &meshPrimitives) {
+    const JsonValue &nodes = root["nodes"];
+
+    document.nodes.resize(nodes.size());
+
+    // every node can only have a single parent, which also rules out cycles below the roots
+    std::vector<int> parentCounts(nodes.size(), 0);
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const JsonValue &jsonNode = nodes[i];
+        GltfNode &node = document.nodes[i];
+
+        node.name = jsonNode["name"].asString();
+
+        if (jsonNode.has("mesh")) {
+            const size_t mesh = readIndex(jsonNode["mesh"]);
+
+            if (mesh >= meshPrimitives.size()) {
+                return fail("mesh out of range");
+            }
+
+            node.primitives = meshPrimitives[mesh];
+        }
+
+        const JsonValue &matrix = jsonNode["matrix"];
+
+        if (matrix.size() == 16) {
+            for (int k = 0; k < 16; k++) {
+                glm::value_ptr(node.transform)[k] = static_cast<float>(matrix[k].asNumber());
+            }
+        }
+        else {
+            const JsonValue &t = jsonNode["translation"];
+            const JsonValue &r = jsonNode["rotation"];
+            const JsonValue &s = jsonNode["scale"];
+
+            const glm::vec4 translation = readVector(t, 0.0f);
+            const glm::vec4 rotation = readVector(r, 0.0f, 1.0f);
+            const glm::vec4 scale = readVector(s, 1.0f);
+
+            node.transform = glm::translate(glm::mat4(1.0f), glm::vec3(translation))
+                * glm::mat4_cast(glm::quat(rotation.w, rotation.x, rotation.y, rotation.z))
+                * glm::scale(glm::mat4(1.0f), glm::vec3(scale));
+        }
+
+        const JsonValue &children = jsonNode["children"];
+
+        for (size_t k = 0; k < children.size(); k++) {
+            const size_t child = readIndex(children[k]);
+
+            if (child >= nodes.size() || ++parentCounts[child] > 1) {
+                return fail("invalid node hierarchy");
+            }
+
+            node.children.push_back(static_cast<std::uint32_t>(child));
+        }
+    }
+
+    // the default scene, or every node without a parent
+    const JsonValue &scene = root["scenes"][readIndex(root["scene"], 0)];
+
+    if (scene.isObject()) {
+        const JsonValue &sceneNodes = scene["nodes"];
+
+        for (size_t i = 0; i < sceneNodes.size(); i++) {
+            const size_t node = readIndex(sceneNodes[i]);
+
+            if (node >= nodes.size() || parentCounts[node] > 0) {
+                return fail("invalid scene roots");
+            }
+
+            document.rootNodes.push_back(static_cast<std::uint32_t>(node));
+        }
+    }
+    else {
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (parentCounts[i] == 0) {
+                document.rootNodes.push_back(static_cast<std::uint32_t>(i));
+            }
+        }
+    }
+
+    return true;
+}
+
+
+void GltfParser::parseMaterials() {
+    const JsonValue &images = root["images"];
+
+    for (size_t i = 0; i < images.size(); i++) {
+        GltfImage image;
+
+        if (images[i].has("uri")) {
+            image.uri = decodeUri(images[i]["uri"].asString());
+        }
+        else {
+            const size_t view = readIndex(images[i]["bufferView"]);
+
+            if (view < bufferViews.size()) {
+                image.data = bufferViews[view].data;
+                image.size = bufferViews[view].size;
+            }
+        }
+
+        document.images.push_back(image);
+    }
+
+    const JsonValue &materials = root["materials"];
+    const JsonValue &textures = root["textures"];
+
+    // the image of a texture reference. data URIs aren't supported, the material is left untextured then
+    const auto findImage = [&](const JsonValue &textureInfo) {
+        if (!textureInfo.isObject()) {
+            return -1;
+        }
+
+        const JsonValue &texture = textures[readIndex(textureInfo["index"])];
+        const size_t image = readIndex(texture["source"]);
+
+        return image < document.images.size() && document.images[image].uri.compare(0, 5, "data:") != 0 ? static_cast<int>(image) : -1;
+    };
+
+    for (size_t i = 0; i < materials.size(); i++) {
+        const JsonValue &pbr = materials[i]["pbrMetallicRoughness"];
+        const JsonValue &factor = pbr["baseColorFactor"];
+
+        GltfMaterial material;
+        material.name = materials[i]["name"].asString();
+        material.baseColor = readVector(factor, 1.0f, 1.0f);
+        material.metallic = static_cast<float>(pbr["metallicFactor"].asNumber(1.0));
+        material.roughness = static_cast<float>(pbr["roughnessFactor"].asNumber(1.0));
+        material.blend = materials[i]["alphaMode"].asString() == "BLEND";
+
+        material.baseColorImage = findImage(pbr["baseColorTexture"]);
+        material.metallicRoughnessImage = findImage(pbr["metallicRoughnessTexture"]);
+        material.normalImage = findImage(materials[i]["normalTexture"]);
+
+        document.materials.push_back(material);
+    }
+}
+
+
+bool loadGltf(const std::string &filePath, GltfDocument &document) {
+    document = GltfDocument{};
+
+    MappedFile file;
+
+    if (!file.open(filePath)) {
+        std::cout << "Can't open " << filePath << std::endl;
+        return false;
+    }
+
+    const std::uint8_t *data = file.data();
+    std::string_view json {reinterpret_cast<const char*>(data), file.size()};
+
+    const std::uint8_t *bin = nullptr;
+    size_t binSize = 0;
+
+    // a .glb is a header and a sequence of (length, type, data) chunks, the JSON one first
+    if (file.size() >= 20 && readU32(data) == GlbMagic) {
+        const size_t jsonSize = readU32(data + 12);
+
+        if (readU32(data + 16) != GlbJsonChunk || 20 + jsonSize > file.size()) {
+            std::cout << "Invalid GLB file " << filePath << std::endl;
+            return false;
+        }
+
+        json = json.substr(20, jsonSize);
+
+        const size_t binOffset = 20 + (jsonSize + 3) / 4 * 4;
+
+        if (binOffset + 8 <= file.size() && readU32(data + binOffset + 4) == GlbBinChunk) {
+            bin = data + binOffset + 8;
+            binSize = std::min<size_t>(readU32(data + binOffset), file.size() - binOffset - 8);
+        }
+    }
+
+    JsonValue root;
+    std::string error;
+
+    if (!parseJson(json, root, error)) {
+        std::cout << "Invalid glTF JSON in " << filePath << ": " << error << std::endl;
+        return false;
+    }
+
+    if (root["asset"]["version"].asString().compare(0, 2, "2.") != 0) {
+        std::cout << "glTF fast path unavailable: only glTF 2.0 is supported" << std::endl;
+        return false;
+    }
+
+    // the buffers of a .glb point into its mapping, which must stay alive with the document
+    document.files.push_back(std::move(file));
+
+    GltfParser parser {root, document};
+
+    if (!parser.parse(std::string{parent_path(filePath)}, bin, binSize)) {
+        document = GltfDocument{};
+        return false;
+    }
+
+    return true;
+}
+
+
+void readAccessor(const GltfAccessor &accessor, const std::uint32_t components, std::vector<float> &out) {
+    out.assign(size_t(accessor.count) * components, 0.0f);
+
+    const std::uint32_t count = std::min(components, accessor.componentCount);
+
+    for (std::uint32_t i = 0; i < accessor.count; i++) {
+        const std::uint8_t *element = accessor.data + size_t(i) * accessor.stride;
+
+        for (std::uint32_t c = 0; c < count; c++) {
+            float value = 0.0f;
+
+            switch (accessor.componentType) {
+            case 5120: { std::int8_t v; std::memcpy(&v, element + c, 1); value = accessor.normalized ? std::max(v / 127.0f, -1.0f) : v; break; }
+            case 5121: { std::uint8_t v; std::memcpy(&v, element + c, 1); value = accessor.normalized ? v / 255.0f : v; break; }
+            case 5122: { std::int16_t v; std::memcpy(&v, element + 2 * c, 2); value = accessor.normalized ? std::max(v / 32767.0f, -1.0f) : v; break; }
+            case 5123: { std::uint16_t v; std::memcpy(&v, element + 2 * c, 2); value = accessor.normalized ? v / 65535.0f : v; break; }
+            case 5125: { std::uint32_t v; std::memcpy(&v, element + 4 * c, 4); value = static_cast<float>(v); break; }
+            case 5126: std::memcpy(&value, element + 4 * c, 4); break;
+            }
+
+            out[size_t(i) * components + c] = value;
+        }
+    }
+}
+
+
+void readIndices(const GltfAccessor &accessor, std::vector<std::uint32_t> &out) {
+    out.resize(accessor.count);
+
+    for (std::uint32_t i = 0; i < accessor.count; i++) {
+        const std::uint8_t *element = accessor.data + size_t(i) * accessor.stride;
+
+        switch (accessor.componentType) {
+        case 5121: out[i] = *element; break;
+        case 5123: { std::uint16_t v; std::memcpy(&v, element, 2); out[i] = v; break; }
+        case 5125: std::memcpy(&out[i], element, 4); break;
+        }
+    }
+}
@@ -0,0 +1,116 @@
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "mapped_file.hpp"
+
+
+// the elements of an accessor, in place inside the mapped buffers
+struct GltfAccessor {
+    // first element, null when the accessor is missing
+    const std::uint8_t *data = nullptr;
+
+    std::uint32_t count = 0;
+
+    // GL enum values, the same as glTF uses
+    std::uint32_t componentType = 0;
+    std::uint32_t componentCount = 0;
+
+    bool normalized = false;
+
+    // bytes from an element to the next one, never zero
+    std::uint32_t stride = 0;
+
+    bool empty() const {
+        return data == nullptr;
+    }
+
+    // floats, without padding between the elements, so they can be uploaded without conversion
+    bool isPackedFloat(const std::uint32_t components) const {
+        return componentType == 0x1406 && componentCount == components && stride == components * sizeof(float);
+    }
+};
+
+
+// a triangle list
+struct GltfPrimitive {
+    GltfAccessor positions;
+    GltfAccessor normals;
+    GltfAccessor texCoords;
+    GltfAccessor indices;
+
+    int material = -1;
+};
+
+
+struct GltfNode {
+    std::string name;
+
+    glm::mat4 transform = glm::mat4(1.0f);
+
+    // the primitives of the mesh of the node
+    std::vector<std::uint32_t> primitives;
+
+    std::vector<std::uint32_t> children;
+};
+
+
+struct GltfImage {
+    // relative to the directory of the glTF file. empty for the images stored in a buffer
+    std::string uri;
+
+    // the encoded image, for the ones stored in a buffer
+    const std::uint8_t *data = nullptr;
+    size_t size = 0;
+};
+
+
+struct GltfMaterial {
+    std::string name;
+
+    glm::vec4 baseColor = {1.0f, 1.0f, 1.0f, 1.0f};
+    float metallic = 1.0f;
+    float roughness = 1.0f;
+
+    // alphaMode BLEND, the base color alpha is the opacity
+    bool blend = false;
+
+    // indices of the images, -1 for none. the metalness is in the blue channel and the roughness in the green one
+    int baseColorImage = -1;
+    int metallicRoughnessImage = -1;
+    int normalImage = -1;
+};
+
+
+// A glTF 2.0 scene whose accessors point straight into the memory mapped buffers. The mapped files are
+// released with the document.
+struct GltfDocument {
+    std::vector<GltfNode> nodes;
+    std::vector<std::uint32_t> rootNodes;
+
+    std::vector<GltfPrimitive> primitives;
+    std::vector<GltfMaterial> materials;
+    std::vector<GltfImage> images;
+
+    std::vector<MappedFile> files;
+};
+
+
+// .gltf and .glb
+bool isGltfFile(const std::string &filePath);
+
+// false when the file can't be read, or when it uses something the fast path doesn't handle: skins,
+// animations, sparse accessors, data URIs, compression extensions or other primitives than triangle lists.
+// The caller falls back to Assimp then.
+bool loadGltf(const std::string &filePath, GltfDocument &document);
+
+// converts the elements to floats, normalizing the integer types when the accessor says so. the missing
+// components are zero
+void readAccessor(const GltfAccessor &accessor, std::uint32_t components, std::vector<float> &out);
+
+// unsigned byte, short or int indices, widened to 32 bits. loadGltf rejects the other types
+void readIndices(const GltfAccessor &accessor, std::vector<std::uint32_t> &out);
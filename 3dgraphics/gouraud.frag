@@ -2,23 +2,285 @@
 
 in vec3 fragNormal;
 in vec2 fragTexCoord;
+in vec3 fragPosition;
+in float fragViewDepth;
 
+// 1 samples the 2D texture, 2 the layer of the texture array the material was packed into
 uniform float uMaterialDiffuseSamplerEnabled = 1.0;
 uniform sampler2D uMaterialDiffuseSampler;
+uniform sampler2DArray uMaterialDiffuseArray;
+uniform float uMaterialDiffuseLayer;
 
 uniform vec4 uMaterialAmbient;
 uniform vec4 uMaterialDiffuse;
 uniform vec4 uMaterialSpecular;
 
+// the opacity of the transparent materials, times the red channel of their opacity texture when enabled
+uniform float uMaterialOpacity = 1.0;
+uniform float uMaterialOpacitySamplerEnabled = 0.0;
+uniform sampler2D uMaterialOpacitySampler;
+
+// metallic-roughness materials: (enabled, metallic, roughness, 0), and which of their textures are bound
+uniform vec4 uMaterialPbr;
+uniform vec4 uMaterialPbrTextures;
+uniform sampler2D uMaterialMetallicSampler;
+uniform sampler2D uMaterialRoughnessSampler;
+uniform sampler2D uMaterialNormalSampler;
+
+uniform vec3 uCameraPosition;
+
+// equirectangular image based lighting, see ibl.hpp. the prefiltered roughness levels are its mip levels
+uniform sampler2D uIrradianceMap;
+uniform sampler2D uPrefilteredMap;
+uniform float uPrefilteredMaxLod;
+uniform sampler2D uBrdfLut;
+
 uniform vec4 uGlobalLightAmbient = vec4(0.1, 0.1, 0.1, 1.0);
 
 uniform vec3 uLightDirection;
 uniform vec4 uLightAmbient;
 uniform vec4 uLightDiffuse;
 
+// clustered point and spot lights, see clustered_lighting.hpp
+uniform usamplerBuffer uClusterRanges;
+uniform usamplerBuffer uClusterLightIndices;
+uniform samplerBuffer uLightData;
+
+// (tilesX, tilesY, slices, 0), (slice scale, slice bias, 0, 0) and (width, height, x, y) of the viewport
+uniform vec4 uClusterGrid;
+uniform vec4 uClusterDepthParams;
+uniform vec4 uViewportSize;
+
+// cascaded shadow maps of the directional light, see shadow_cascades.hpp
+uniform sampler2DArrayShadow uShadowMap;
+uniform mat4 uShadowMatrices[4];
+
+// far view depth of each cascade. zero for the unused ones
+uniform vec4 uShadowSplits;
+
+// light reaching the fragments in the shadow of the directional light
+const float ShadowLight = 0.5;
+
+const float Pi = 3.14159265;
+
+// the surface seen by the lights. the legacy materials only have a diffuse term
+struct Surface {
+    vec3 normal;
+    vec3 view;
+    vec3 albedo;
+    float metallic;
+    float roughness;
+    bool pbr;
+};
+
 out vec4 finalColor;
 
+float computeShadow() {
+    int cascade = 0;
+
+    while (cascade < 4 && uShadowSplits[cascade] > 0.0 && fragViewDepth > uShadowSplits[cascade]) {
+        cascade++;
+    }
+
+    if (cascade == 4 || uShadowSplits[cascade] == 0.0) {
+        return 1.0;
+    }
+
+    vec3 coord = (uShadowMatrices[cascade] * vec4(fragPosition, 1.0)).xyz;
+    vec2 texelSize = 1.0 / vec2(textureSize(uShadowMap, 0).xy);
+
+    // 3x3 PCF, over the bilinear filtering of the comparison
+    float lit = 0.0;
+
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            lit += texture(uShadowMap, vec4(coord.xy + vec2(x, y) * texelSize, float(cascade), coord.z));
+        }
+    }
+
+    return lit / 9.0;
+}
+
+vec2 equirectCoord(vec3 direction) {
+    return vec2(atan(direction.z, direction.x) / (2.0 * Pi) + 0.5, acos(clamp(direction.y, -1.0, 1.0)) / Pi);
+}
+
+// tangent space normal mapping without tangents, from the screen space derivatives of the position and texture coordinates
+vec3 perturbNormal(vec3 normal) {
+    vec3 dp1 = dFdx(fragPosition);
+    vec3 dp2 = dFdy(fragPosition);
+    vec2 duv1 = dFdx(fragTexCoord);
+    vec2 duv2 = dFdy(fragTexCoord);
+
+    vec3 dp2perp = cross(dp2, normal);
+    vec3 dp1perp = cross(normal, dp1);
+    vec3 tangent = dp2perp * duv1.x + dp1perp * duv2.x;
+    vec3 bitangent = dp2perp * duv1.y + dp1perp * duv2.y;
+
+    float scale = inversesqrt(max(max(dot(tangent, tangent), dot(bitangent, bitangent)), 1e-12));
+    vec3 mapped = texture(uMaterialNormalSampler, fragTexCoord).xyz * 2.0 - 1.0;
+
+    return normalize(mat3(tangent * scale, bitangent * scale, normal) * mapped);
+}
+
+vec3 fresnelSchlick(float cosTheta, vec3 f0) {
+    return f0 + (1.0 - f0) * pow(1.0 - cosTheta, 5.0);
+}
+
+// light reflected towards the viewer from a light of the given radiance. Cook-Torrance with the GGX distribution
+// and the Smith-Schlick geometry term for the metallic-roughness materials
+vec3 shadeLight(Surface surface, vec3 direction, vec3 radiance) {
+    float NdotL = max(dot(surface.normal, direction), 0.0);
+
+    if (!surface.pbr) {
+        return radiance * NdotL;
+    }
+
+    vec3 halfway = normalize(surface.view + direction);
+    float NdotV = max(dot(surface.normal, surface.view), 1e-4);
+    float NdotH = max(dot(surface.normal, halfway), 0.0);
+
+    float alpha = surface.roughness * surface.roughness;
+    float alpha2 = alpha * alpha;
+    float denominator = NdotH * NdotH * (alpha2 - 1.0) + 1.0;
+    float distribution = alpha2 / (Pi * denominator * denominator);
+
+    float k = (surface.roughness + 1.0) * (surface.roughness + 1.0) / 8.0;
+    float geometry = NdotV / (NdotV * (1.0 - k) + k) * NdotL / (NdotL * (1.0 - k) + k);
+
+    vec3 f0 = mix(vec3(0.04), surface.albedo, surface.metallic);
+    vec3 fresnel = fresnelSchlick(max(dot(halfway, surface.view), 0.0), f0);
+
+    vec3 specular = distribution * geometry * fresnel / (4.0 * NdotV * max(NdotL, 1e-4));
+    vec3 diffuse = (1.0 - fresnel) * (1.0 - surface.metallic) * surface.albedo / Pi;
+
+    // the light colors are the irradiance of a lambertian white surface, so the radiance is scaled by pi
+    return (diffuse + specular) * radiance * Pi * NdotL;
+}
+
+vec3 computeLocalLighting(Surface surface) {
+    ivec3 grid = ivec3(uClusterGrid.xyz);
+
+    if (grid.z == 0) {
+        return vec3(0.0);
+    }
+
+    ivec2 tile = clamp(ivec2((gl_FragCoord.xy - uViewportSize.zw) / uViewportSize.xy * vec2(grid.xy)), ivec2(0), grid.xy - 1);
+    int slice = clamp(int(log(fragViewDepth) * uClusterDepthParams.x + uClusterDepthParams.y), 0, grid.z - 1);
+
+    uvec2 range = texelFetch(uClusterRanges, (slice * grid.y + tile.y) * grid.x + tile.x).xy;
+
+    vec3 lighting = vec3(0.0);
+
+    for (uint i = 0u; i < range.y; i++) {
+        int light = int(texelFetch(uClusterLightIndices, int(range.x + i)).x);
+
+        vec4 positionRange = texelFetch(uLightData, 3 * light + 0);
+        vec4 colorCosOuter = texelFetch(uLightData, 3 * light + 1);
+        vec4 directionCosInner = texelFetch(uLightData, 3 * light + 2);
+
+        vec3 toLight = positionRange.xyz - fragPosition;
+        float lightDistance = length(toLight);
+
+        if (lightDistance >= positionRange.w) {
+            continue;
+        }
+
+        vec3 direction = toLight / lightDistance;
+
+        // smooth falloff that reaches zero at the range of the light
+        float falloff = clamp(1.0 - pow(lightDistance / positionRange.w, 4.0), 0.0, 1.0);
+        float attenuation = falloff * falloff / (lightDistance * lightDistance + 1.0);
+
+        if (colorCosOuter.w > -1.0) {
+            attenuation *= smoothstep(colorCosOuter.w, directionCosInner.w, dot(-direction, directionCosInner.xyz));
+        }
+
+        lighting += shadeLight(surface, direction, colorCosOuter.rgb * attenuation);
+    }
+
+    return lighting;
+}
+
+vec3 srgbToLinear(vec3 color) {
+    return pow(color, vec3(2.2));
+}
+
+vec4 sampleDiffuse() {
+    if (uMaterialDiffuseSamplerEnabled == 2.0) {
+        return texture(uMaterialDiffuseArray, vec3(fragTexCoord, uMaterialDiffuseLayer));
+    }
+
+    return texture(uMaterialDiffuseSampler, fragTexCoord);
+}
+
+float computeOpacity() {
+    if (uMaterialOpacitySamplerEnabled == 1.0) {
+        return uMaterialOpacity * texture(uMaterialOpacitySampler, fragTexCoord).r;
+    }
+
+    return uMaterialOpacity;
+}
+
+void shadePbr() {
+    vec4 baseColor = uMaterialDiffuse;
+
+    if (uMaterialDiffuseSamplerEnabled != 0.0) {
+        vec4 texel = sampleDiffuse();
+        baseColor *= vec4(srgbToLinear(texel.rgb), texel.a);
+    }
+
+    Surface surface;
+    surface.normal = normalize(fragNormal);
+    surface.view = normalize(uCameraPosition - fragPosition);
+    surface.albedo = baseColor.rgb;
+    surface.metallic = uMaterialPbr.y;
+    surface.roughness = uMaterialPbr.z;
+    surface.pbr = true;
+
+    // the glTF layout: metalness in blue, roughness in green
+    if (uMaterialPbrTextures.x == 1.0) {
+        surface.metallic *= texture(uMaterialMetallicSampler, fragTexCoord).b;
+    }
+
+    if (uMaterialPbrTextures.y == 1.0) {
+        surface.roughness *= texture(uMaterialRoughnessSampler, fragTexCoord).g;
+    }
+
+    if (uMaterialPbrTextures.z == 1.0) {
+        surface.normal = perturbNormal(surface.normal);
+    }
+
+    surface.roughness = clamp(surface.roughness, 0.04, 1.0);
+
+    vec3 color = shadeLight(surface, uLightDirection, uLightDiffuse.rgb) * computeShadow();
+    color += computeLocalLighting(surface);
+
+    // the split sum approximation of the environment lighting
+    float NdotV = max(dot(surface.normal, surface.view), 1e-4);
+    vec3 f0 = mix(vec3(0.04), surface.albedo, surface.metallic);
+    vec3 fresnel = f0 + (max(vec3(1.0 - surface.roughness), f0) - f0) * pow(1.0 - NdotV, 5.0);
+
+    vec3 irradiance = textureLod(uIrradianceMap, equirectCoord(surface.normal), 0.0).rgb;
+    vec3 reflected = reflect(-surface.view, surface.normal);
+    vec3 prefiltered = textureLod(uPrefilteredMap, equirectCoord(reflected), surface.roughness * uPrefilteredMaxLod).rgb;
+    vec2 brdf = texture(uBrdfLut, vec2(NdotV, surface.roughness)).rg;
+
+    color += (1.0 - fresnel) * (1.0 - surface.metallic) * surface.albedo * irradiance;
+    color += prefiltered * (fresnel * brdf.x + brdf.y);
+
+    // Reinhard tone mapping, back to the sRGB framebuffer values
+    color = color / (color + 1.0);
+
+    finalColor = vec4(pow(color, vec3(1.0 / 2.2)), baseColor.a * computeOpacity());
+}
+
 void main() {
+    if (uMaterialPbr.x == 1.0) {
+        shadePbr();
+        return;
+    }
+
     vec3 normal = fragNormal;
 
     // compute the diffuse factor contribution, per vertex
@@ -27,10 +289,14 @@ void main() {
     vec4 ambient = uGlobalLightAmbient + uMaterialAmbient * uLightAmbient;
     // vec4 diffuse = (uMaterialDiffuseSamplerEnabled == 1.0 ? texture(uMaterialDiffuseSampler, fragTexCoord) : uMaterialDiffuse) * uLightDiffuse * d;
 
-    vec4 diffuse = texture(uMaterialDiffuseSampler, fragTexCoord);
+    vec4 diffuse = sampleDiffuse();
 
     // finalColor = vec4(fragTexCoord, 1.0, 1.0) * d;
     // finalColor = texture(uMaterialDiffuseSampler, fragTexCoord);
 
-    finalColor = ambient + diffuse;
+    // the shadows only darken the directional light, the local lights still reach the fragment
+    float shadow = mix(ShadowLight, 1.0, computeShadow());
+
+    finalColor = ambient + vec4(diffuse.rgb * shadow, diffuse.a) + vec4(diffuse.rgb * computeLocalLighting(Surface(normalize(normal), vec3(0.0), vec3(1.0), 0.0, 1.0, false)), 0.0);
+    finalColor.a = uMaterialDiffuse.a * computeOpacity();
 }
@@ -11,6 +11,11 @@ in vec2 vertTexCoord;
 
 out vec3 fragNormal;
 out vec2 fragTexCoord;
+out vec3 fragPosition;
+out float fragViewDepth;
+
+// matches the depth prepass of depth.vert
+invariant gl_Position;
 
 void main() {
     gl_Position = uProj * uView * uModel * vec4(vertCoord, 1.0);
@@ -21,4 +26,8 @@ void main() {
     // vec3 normal = (normalSpace * vec4(vertNormal, 0.0)).xyz;
     fragNormal = (transpose(inverse(uModel)) * vec4(vertNormal, 0.0)).xyz;
     fragTexCoord = vertTexCoord;
+
+    // for the clustered lighting
+    fragPosition = (uModel * vec4(vertCoord, 1.0)).xyz;
+    fragViewDepth = -(uView * vec4(fragPosition, 1.0)).z;
 }
@@ -0,0 +1,53 @@
+#version 330
+
+// must match MaxPaletteBones in skinning.hpp
+#define MAX_BONES 256
+
+uniform mat4 uModel;
+uniform mat4 uView;
+uniform mat4 uProj;
+
+// rows of the 3x4 skinning matrix of each bone, see computeBonePalette
+layout(std140) uniform BonePalette {
+    vec4 uBoneRows[3 * MAX_BONES];
+};
+
+in vec3 vertCoord;
+in vec3 vertNormal;
+in vec2 vertTexCoord;
+in uvec4 vertBoneIndices;
+in vec4 vertBoneWeights;
+
+out vec3 fragNormal;
+out vec2 fragTexCoord;
+out vec3 fragPosition;
+out float fragViewDepth;
+
+void main() {
+    // blend the bone matrices of the vertex
+    vec4 row0 = vec4(0.0);
+    vec4 row1 = vec4(0.0);
+    vec4 row2 = vec4(0.0);
+
+    for (int i = 0; i < 4; i++) {
+        int bone = int(vertBoneIndices[i]);
+        float weight = vertBoneWeights[i];
+
+        row0 += weight * uBoneRows[3 * bone + 0];
+        row1 += weight * uBoneRows[3 * bone + 1];
+        row2 += weight * uBoneRows[3 * bone + 2];
+    }
+
+    vec4 coord = vec4(vertCoord, 1.0);
+    vec3 skinnedCoord = vec3(dot(row0, coord), dot(row1, coord), dot(row2, coord));
+    vec3 skinnedNormal = vec3(dot(row0.xyz, vertNormal), dot(row1.xyz, vertNormal), dot(row2.xyz, vertNormal));
+
+    gl_Position = uProj * uView * uModel * vec4(skinnedCoord, 1.0);
+
+    fragNormal = (transpose(inverse(uModel)) * vec4(normalize(skinnedNormal), 0.0)).xyz;
+    fragTexCoord = vertTexCoord;
+
+    // for the clustered lighting
+    fragPosition = (uModel * vec4(skinnedCoord, 1.0)).xyz;
+    fragViewDepth = -(uView * vec4(fragPosition, 1.0)).z;
+}
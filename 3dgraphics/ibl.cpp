@@ -0,0 +1,422 @@
+
+#include "ibl.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#include "thread_pool.hpp"
+
+
+static const float Pi = 3.14159265358979f;
+
+
+static glm::vec3 directionOf(const float u, const float v) {
+    const float phi = (u - 0.5f) * 2.0f * Pi;
+    const float theta = v * Pi;
+
+    return {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+}
+
+
+// direction of the center of a texel
+static glm::vec3 directionOf(const EquirectImage &image, const unsigned int x, const unsigned int y) {
+    return directionOf((x + 0.5f) / image.width, (y + 0.5f) / image.height);
+}
+
+
+glm::vec3 EquirectImage::sample(const glm::vec3 &direction) const {
+    const float u = std::atan2(direction.z, direction.x) / (2.0f * Pi) + 0.5f;
+    const float v = std::acos(std::clamp(direction.y, -1.0f, 1.0f)) / Pi;
+
+    const float x = u * width - 0.5f;
+    const float y = std::clamp(v * height - 0.5f, 0.0f, float(height - 1));
+
+    const float x0 = std::floor(x), y0 = std::floor(y);
+    const float fx = x - x0, fy = y - y0;
+
+    const auto texel = [this](const int tx, const int ty) {
+        const int wrapped = ((tx % int(width)) + int(width)) % int(width);
+
+        return pixels[size_t(std::min(ty, int(height) - 1)) * width + wrapped];
+    };
+
+    const int ix = int(x0), iy = int(y0);
+
+    return (texel(ix, iy) * (1.0f - fx) + texel(ix + 1, iy) * fx) * (1.0f - fy)
+        + (texel(ix, iy + 1) * (1.0f - fx) + texel(ix + 1, iy + 1) * fx) * fy;
+}
+
+
+static EquirectImage resample(const EquirectImage &source, const unsigned int width, ThreadPool &threadPool) {
+    EquirectImage image;
+    image.width = width;
+    image.height = std::max(width / 2, 1u);
+    image.pixels.resize(size_t(image.width) * image.height);
+
+    threadPool.parallelFor(image.height, [&](const size_t y) {
+        for (unsigned int x = 0; x < image.width; x++) {
+            image.pixels[y * image.width + x] = source.sample(directionOf(image, x, unsigned(y)));
+        }
+    });
+
+    return image;
+}
+
+
+// 2x2 box filter
+static EquirectImage downsample(const EquirectImage &source) {
+    EquirectImage image;
+    image.width = std::max(source.width / 2, 1u);
+    image.height = std::max(source.height / 2, 1u);
+    image.pixels.resize(size_t(image.width) * image.height);
+
+    for (unsigned int y = 0; y < image.height; y++) {
+        for (unsigned int x = 0; x < image.width; x++) {
+            const unsigned int sx = std::min(2 * x + 1, source.width - 1);
+            const unsigned int sy = std::min(2 * y + 1, source.height - 1);
+
+            image.pixels[size_t(y) * image.width + x] = 0.25f * (
+                source.pixels[size_t(2 * y) * source.width + 2 * x] + source.pixels[size_t(2 * y) * source.width + sx] +
+                source.pixels[size_t(sy) * source.width + 2 * x] + source.pixels[size_t(sy) * source.width + sx]);
+        }
+    }
+
+    return image;
+}
+
+
+static glm::vec2 hammersley(const std::uint32_t i, const std::uint32_t count) {
+    std::uint32_t bits = i;
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+
+    return {float(i) / count, float(bits) * 2.3283064365386963e-10f};
+}
+
+
+// half vector around n, distributed like the GGX normal distribution of roughness alpha squared
+static glm::vec3 sampleGgx(const glm::vec2 &xi, const glm::vec3 &n, const float alpha) {
+    const float phi = 2.0f * Pi * xi.x;
+    const float cosTheta = std::sqrt((1.0f - xi.y) / (1.0f + (alpha * alpha - 1.0f) * xi.y));
+    const float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+    const glm::vec3 up = std::abs(n.y) < 0.999f ? glm::vec3{0.0f, 1.0f, 0.0f} : glm::vec3{1.0f, 0.0f, 0.0f};
+    const glm::vec3 tangentX = glm::normalize(glm::cross(up, n));
+    const glm::vec3 tangentY = glm::cross(n, tangentX);
+
+    return glm::normalize(tangentX * (sinTheta * std::cos(phi)) + tangentY * (sinTheta * std::sin(phi)) + n * cosTheta);
+}
+
+
+static float distributionGgx(const float nDotH, const float alpha) {
+    const float alpha2 = alpha * alpha;
+    const float d = nDotH * nDotH * (alpha2 - 1.0f) + 1.0f;
+
+    return alpha2 / (Pi * d * d);
+}
+
+
+static void computeIrradiance(const std::vector<EquirectImage> &chain, const IblParams &params, ThreadPool &threadPool, EquirectImage &irradiance) {
+    // the irradiance is smooth, a 64 wide source is plenty
+    const EquirectImage &source = *std::find_if(chain.begin(), chain.end(), [](const EquirectImage &image) {
+        return image.width <= 64;
+    });
+
+    std::vector<glm::vec3> directions(source.pixels.size());
+    std::vector<float> solidAngles(source.pixels.size());
+
+    for (unsigned int y = 0; y < source.height; y++) {
+        const float theta = (y + 0.5f) / source.height * Pi;
+
+        for (unsigned int x = 0; x < source.width; x++) {
+            directions[size_t(y) * source.width + x] = directionOf(source, x, y);
+            solidAngles[size_t(y) * source.width + x] = (2.0f * Pi / source.width) * (Pi / source.height) * std::sin(theta);
+        }
+    }
+
+    irradiance.width = params.irradianceWidth;
+    irradiance.height = std::max(params.irradianceWidth / 2, 1u);
+    irradiance.pixels.resize(size_t(irradiance.width) * irradiance.height);
+
+    threadPool.parallelFor(irradiance.height, [&](const size_t y) {
+        for (unsigned int x = 0; x < irradiance.width; x++) {
+            const glm::vec3 normal = directionOf(irradiance, x, unsigned(y));
+            glm::vec3 sum = {0.0f, 0.0f, 0.0f};
+
+            for (size_t i = 0; i < directions.size(); i++) {
+                const float cosine = glm::dot(normal, directions[i]);
+
+                if (cosine > 0.0f) {
+                    sum += source.pixels[i] * (cosine * solidAngles[i]);
+                }
+            }
+
+            irradiance.pixels[y * irradiance.width + x] = sum / Pi;
+        }
+    });
+}
+
+
+// split sum prefiltering, with the view along the normal. the samples read the source level whose texels
+// cover about the solid angle of the sample, which removes most of the noise of a low sample count
+static void computePrefiltered(const std::vector<EquirectImage> &chain, const IblParams &params, ThreadPool &threadPool, std::vector<EquirectImage> &prefiltered) {
+    const float texelSolidAngle = 4.0f * Pi / (float(chain[0].width) * chain[0].height);
+
+    prefiltered.resize(params.prefilteredLevels);
+
+    for (unsigned int level = 0; level < params.prefilteredLevels; level++) {
+        const unsigned int width = std::max(params.prefilteredWidth >> level, 2u);
+
+        if (level == 0) {
+            prefiltered[level] = resample(chain[0], width, threadPool);
+            continue;
+        }
+
+        const float roughness = float(level) / (params.prefilteredLevels - 1);
+        const float alpha = roughness * roughness;
+
+        EquirectImage &image = prefiltered[level];
+        image.width = width;
+        image.height = width / 2;
+        image.pixels.resize(size_t(image.width) * image.height);
+
+        threadPool.parallelFor(image.height, [&](const size_t y) {
+            for (unsigned int x = 0; x < image.width; x++) {
+                const glm::vec3 normal = directionOf(image, x, unsigned(y));
+
+                glm::vec3 sum = {0.0f, 0.0f, 0.0f};
+                float weight = 0.0f;
+
+                for (unsigned int i = 0; i < params.prefilteredSamples; i++) {
+                    const glm::vec3 half = sampleGgx(hammersley(i, params.prefilteredSamples), normal, alpha);
+                    const float nDotH = glm::dot(normal, half);
+                    const glm::vec3 light = half * (2.0f * nDotH) - normal;
+                    const float nDotL = glm::dot(normal, light);
+
+                    if (nDotL <= 0.0f) {
+                        continue;
+                    }
+
+                    // the pdf of the reflected direction is D / 4, with the view along the normal
+                    const float pdf = distributionGgx(nDotH, alpha) * 0.25f;
+                    const float sampleSolidAngle = 1.0f / (params.prefilteredSamples * pdf + 1e-4f);
+                    const float lod = std::max(0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f, 0.0f);
+                    const size_t source = std::min(size_t(lod + 0.5f), chain.size() - 1);
+
+                    sum += chain[source].sample(light) * nDotL;
+                    weight += nDotL;
+                }
+
+                image.pixels[y * image.width + x] = weight > 0.0f ? sum / weight : sum;
+            }
+        });
+    }
+}
+
+
+static void computeBrdfLut(const IblParams &params, ThreadPool &threadPool, IblMaps &maps) {
+    const unsigned int size = params.brdfLutSize;
+
+    maps.brdfLutSize = size;
+    maps.brdfLut.resize(size_t(size) * size);
+
+    // rows by roughness, columns by n dot v
+    threadPool.parallelFor(size, [&](const size_t row) {
+        const float roughness = (row + 0.5f) / size;
+        const float alpha = roughness * roughness;
+        const float k = alpha * 0.5f;
+
+        const glm::vec3 normal = {0.0f, 0.0f, 1.0f};
+
+        for (unsigned int column = 0; column < size; column++) {
+            const float nDotV = (column + 0.5f) / size;
+            const glm::vec3 view = {std::sqrt(1.0f - nDotV * nDotV), 0.0f, nDotV};
+
+            float scale = 0.0f, bias = 0.0f;
+
+            for (unsigned int i = 0; i < params.brdfLutSamples; i++) {
+                const glm::vec3 half = sampleGgx(hammersley(i, params.brdfLutSamples), normal, alpha);
+                const float vDotH = glm::dot(view, half);
+                const glm::vec3 light = half * (2.0f * vDotH) - view;
+
+                const float nDotL = light.z;
+                const float nDotH = half.z;
+
+                if (nDotL <= 0.0f) {
+                    continue;
+                }
+
+                const float g = (nDotL / (nDotL * (1.0f - k) + k)) * (nDotV / (nDotV * (1.0f - k) + k));
+                const float visibility = g * vDotH / (nDotH * nDotV);
+                const float fresnel = std::pow(1.0f - vDotH, 5.0f);
+
+                scale += (1.0f - fresnel) * visibility;
+                bias += fresnel * visibility;
+            }
+
+            maps.brdfLut[row * size + column] = glm::vec2{scale, bias} / float(params.brdfLutSamples);
+        }
+    });
+}
+
+
+EquirectImage createDefaultSky(const unsigned int width) {
+    EquirectImage sky;
+    sky.width = width;
+    sky.height = std::max(width / 2, 1u);
+    sky.pixels.resize(size_t(sky.width) * sky.height);
+
+    const glm::vec3 zenith = {0.25f, 0.45f, 0.9f};
+    const glm::vec3 horizon = {0.9f, 0.9f, 1.0f};
+    const glm::vec3 ground = {0.15f, 0.13f, 0.12f};
+
+    for (unsigned int y = 0; y < sky.height; y++) {
+        for (unsigned int x = 0; x < sky.width; x++) {
+            const float up = directionOf(sky, x, y).y;
+
+            sky.pixels[size_t(y) * sky.width + x] = up > 0.0f
+                ? glm::mix(horizon, zenith, std::sqrt(up))
+                : glm::mix(horizon * 0.5f, ground, std::min(-up * 4.0f, 1.0f));
+        }
+    }
+
+    return sky;
+}
+
+
+void computeIblMaps(const EquirectImage &environment, const IblParams &params, ThreadPool &threadPool, IblMaps &maps) {
+    // the source is resampled to a power of two, twice as wide as the sharpest level, then halved down
+    std::vector<EquirectImage> chain;
+    chain.push_back(resample(environment, 2 * params.prefilteredWidth, threadPool));
+
+    while (chain.back().width > 4) {
+        chain.push_back(downsample(chain.back()));
+    }
+
+    computeIrradiance(chain, params, threadPool, maps.irradiance);
+    computePrefiltered(chain, params, threadPool, maps.prefiltered);
+    computeBrdfLut(params, threadPool, maps);
+}
+
+
+std::uint64_t computeIblCacheKey(const std::string &environmentPath, const IblParams &params) {
+    std::uint64_t hash = 14695981039346656037ull;
+
+    const auto add = [&hash](const void *data, const size_t size) {
+        const unsigned char *bytes = static_cast<const unsigned char*>(data);
+
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+
+    add(environmentPath.data(), environmentPath.size());
+
+    if (!environmentPath.empty()) {
+        std::error_code error;
+
+        const std::uint64_t fileSize = std::filesystem::file_size(environmentPath, error);
+        const auto modified = std::filesystem::last_write_time(environmentPath, error).time_since_epoch().count();
+
+        add(&fileSize, sizeof(fileSize));
+        add(&modified, sizeof(modified));
+    }
+
+    const std::uint32_t values[] = {
+        params.irradianceWidth, params.prefilteredWidth, params.prefilteredLevels, params.prefilteredSamples,
+        params.brdfLutSize, params.brdfLutSamples
+    };
+
+    add(values, sizeof(values));
+
+    return hash;
+}
+
+
+template<typename T>
+static void write(std::ostream &os, const T &value) {
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+
+template<typename T>
+static bool read(std::istream &is, T &value) {
+    return bool(is.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+
+static void writeImage(std::ostream &os, const EquirectImage &image) {
+    write(os, image.width);
+    write(os, image.height);
+    os.write(reinterpret_cast<const char*>(image.pixels.data()), image.pixels.size() * sizeof(glm::vec3));
+}
+
+
+static bool readImage(std::istream &is, EquirectImage &image) {
+    if (!read(is, image.width) || !read(is, image.height) || image.width > 16384 || image.height > 8192) {
+        return false;
+    }
+
+    image.pixels.resize(size_t(image.width) * image.height);
+
+    return bool(is.read(reinterpret_cast<char*>(image.pixels.data()), image.pixels.size() * sizeof(glm::vec3)));
+}
+
+
+bool readIblCache(const std::string &filePath, const std::uint64_t key, IblMaps &maps) {
+    std::ifstream is {filePath, std::ios::binary};
+    IblCacheHeader header;
+
+    if (!read(is, header) || header.magic != IblCacheMagic || header.version != IblCacheVersion || header.key != key) {
+        return false;
+    }
+
+    std::uint32_t levelCount = 0;
+
+    if (!readImage(is, maps.irradiance) || !read(is, levelCount) || levelCount > 16) {
+        return false;
+    }
+
+    maps.prefiltered.resize(levelCount);
+
+    for (EquirectImage &level : maps.prefiltered) {
+        if (!readImage(is, level)) {
+            return false;
+        }
+    }
+
+    if (!read(is, maps.brdfLutSize) || maps.brdfLutSize > 1024) {
+        return false;
+    }
+
+    maps.brdfLut.resize(size_t(maps.brdfLutSize) * maps.brdfLutSize);
+
+    return bool(is.read(reinterpret_cast<char*>(maps.brdfLut.data()), maps.brdfLut.size() * sizeof(glm::vec2)));
+}
+
+
+bool writeIblCache(const std::string &filePath, const std::uint64_t key, const IblMaps &maps) {
+    std::ofstream os {filePath, std::ios::binary};
+
+    IblCacheHeader header;
+    header.key = key;
+
+    write(os, header);
+    writeImage(os, maps.irradiance);
+    write(os, static_cast<std::uint32_t>(maps.prefiltered.size()));
+
+    for (const EquirectImage &level : maps.prefiltered) {
+        writeImage(os, level);
+    }
+
+    write(os, maps.brdfLutSize);
+    os.write(reinterpret_cast<const char*>(maps.brdfLut.data()), maps.brdfLut.size() * sizeof(glm::vec2));
+
+    return bool(os);
+}
@@ -0,0 +1,84 @@
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+class ThreadPool;
+
+
+// On-disk layout of the IBL cache (native endianness, it is a local cache and not an asset):
+//
+//   IblCacheHeader
+//   irradiance map, prefiltered levels from the sharpest, BRDF LUT
+//
+// the key identifies the environment and the parameters the maps were computed from.
+const std::uint32_t IblCacheMagic = 0x4C424933; // "3IBL"
+const std::uint32_t IblCacheVersion = 1;
+
+
+struct IblCacheHeader {
+    std::uint32_t magic = IblCacheMagic;
+    std::uint32_t version = IblCacheVersion;
+    std::uint64_t key = 0;
+};
+
+
+// an equirectangular RGB image. the first row looks up (+Y), and u grows with atan2(z, x)
+struct EquirectImage {
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<glm::vec3> pixels;
+
+    bool empty() const {
+        return pixels.empty();
+    }
+
+    // bilinear, wrapping around horizontally
+    glm::vec3 sample(const glm::vec3 &direction) const;
+};
+
+
+struct IblParams {
+    // the heights are half of the widths
+    unsigned int irradianceWidth = 32;
+    unsigned int prefilteredWidth = 256;
+
+    // roughness 0 to 1, in even steps. the widths halve from level to level
+    unsigned int prefilteredLevels = 5;
+    unsigned int prefilteredSamples = 128;
+
+    unsigned int brdfLutSize = 64;
+    unsigned int brdfLutSamples = 256;
+};
+
+
+struct IblMaps {
+    // cosine weighted irradiance, divided by pi so it only has to be multiplied by the albedo
+    EquirectImage irradiance;
+
+    // the environment convolved with the GGX lobe of increasing roughness
+    std::vector<EquirectImage> prefiltered;
+
+    // scale and bias of F0 of the split sum approximation, by (n dot v, roughness)
+    unsigned int brdfLutSize = 0;
+    std::vector<glm::vec2> brdfLut;
+};
+
+
+// a sky gradient over a dark ground, for the scenes without an environment image
+EquirectImage createDefaultSky(unsigned int width);
+
+// computes every map on the CPU, so it also works without a GL context
+void computeIblMaps(const EquirectImage &environment, const IblParams &params, ThreadPool &threadPool, IblMaps &maps);
+
+// from the path, size and modification time of the environment image, and the parameters. an empty path
+// stands for the default sky
+std::uint64_t computeIblCacheKey(const std::string &environmentPath, const IblParams &params);
+
+// false when the file is missing, of another version or computed for another key
+bool readIblCache(const std::string &filePath, std::uint64_t key, IblMaps &maps);
+
+bool writeIblCache(const std::string &filePath, std::uint64_t key, const IblMaps &maps);
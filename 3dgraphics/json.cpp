@@ -0,0 +1,480 @@
+
+#include "json.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+
+static const JsonValue NullValue;
+
+
+const JsonValue& JsonValue::operator[](const size_t index) const {
+    return type == Type::Array && index < elements.size() ? elements[index] : NullValue;
+}
+
+
+const JsonValue& JsonValue::operator[](const std::string_view key) const {
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (keys[i] == key) {
+            return elements[i];
+        }
+    }
+
+    return NullValue;
+}
+
+
+bool JsonValue::has(const std::string_view key) const {
+    return !(*this)[key].isNull();
+}
+
+
+// recursive descent parser, over the whole text
+class JsonParser {
+public:
+    explicit JsonParser(const std::string_view text) : text(text) {}
+
+    bool parse(JsonValue &value, std::string &error) {
+        if (!parseValue(value, 0)) {
+            error = this->error + " at offset " + std::to_string(position);
+            return false;
+        }
+
+        skipWhitespace();
+
+        if (position != text.size()) {
+            error = "trailing characters at offset " + std::to_string(position);
+            return false;
+        }
+
+        return true;
+    }
+
+private:
+    // deeper documents are rejected, instead of overflowing the stack
+    static const int MaxDepth = 256;
+
+    bool fail(const char *message) {
+        error = message;
+        return false;
+    }
+
+    void skipWhitespace() {
+        while (position < text.size() && (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r')) {
+            position++;
+        }
+    }
+
+    bool consume(const std::string_view token) {
+        if (text.substr(position, token.size()) != token) {
+            return false;
+        }
+
+        position += token.size();
+        return true;
+    }
+
+    bool parseValue(JsonValue &value, const int depth) {
+        if (depth > MaxDepth) {
+            return fail("nesting too deep");
+        }
+
+        skipWhitespace();
+
+        if (position >= text.size()) {
+            return fail("unexpected end");
+        }
+
+        switch (text[position]) {
+        case '{':
+            return parseObject(value, depth);
+
+        case '[':
+            return parseArray(value, depth);
+
+        case '"':
+            value.type = JsonValue::Type::String;
+            return parseString(value.string);
+
+        case 't':
+        case 'f':
+            value.type = JsonValue::Type::Bool;
+            value.boolean = text[position] == 't';
+            return consume(value.boolean ? "true" : "false") || fail("invalid literal");
+
+        case 'n':
+            value.type = JsonValue::Type::Null;
+            return consume("null") || fail("invalid literal");
+
+        default:
+            value.type = JsonValue::Type::Number;
+            return parseNumber(value.number);
+        }
+    }
+
+    bool parseObject(JsonValue &value, const int depth) {
+        value.type = JsonValue::Type::Object;
+        position++;
+
+        skipWhitespace();
+
+        if (consume("}")) {
+            return true;
+        }
+
+        while (true) {
+            skipWhitespace();
+
+            value.keys.emplace_back();
+
+            if (position >= text.size() || text[position] != '"' || !parseString(value.keys.back())) {
+                return fail("expected a member name");
+            }
+
+            skipWhitespace();
+
+            if (!consume(":")) {
+                return fail("expected ':'");
+            }
+
+            value.elements.emplace_back();
+
+            if (!parseValue(value.elements.back(), depth + 1)) {
+                return false;
+            }
+
+            skipWhitespace();
+
+            if (consume("}")) {
+                return true;
+            }
+
+            if (!consume(",")) {
+                return fail("expected ',' or '}'");
+            }
+        }
+    }
+
+    bool parseArray(JsonValue &value, const int depth) {
+        value.type = JsonValue::Type::Array;
+        position++;
+
+        skipWhitespace();
+
+        if (consume("]")) {
+            return true;
+        }
+
+        while (true) {
+            value.elements.emplace_back();
+
+            if (!parseValue(value.elements.back(), depth + 1)) {
+                return false;
+            }
+
+            skipWhitespace();
+
+            if (consume("]")) {
+                return true;
+            }
+
+            if (!consume(",")) {
+                return fail("expected ',' or ']'");
+            }
+        }
+    }
+
+    bool parseHex4(unsigned int &code) {
+        if (position + 4 > text.size()) {
+            return fail("truncated escape");
+        }
+
+        code = 0;
+
+        for (int i = 0; i < 4; i++) {
+            const char c = text[position++];
+            code <<= 4;
+
+            if (c >= '0' && c <= '9') {
+                code |= c - '0';
+            }
+            else if (c >= 'a' && c <= 'f') {
+                code |= c - 'a' + 10;
+            }
+            else if (c >= 'A' && c <= 'F') {
+                code |= c - 'A' + 10;
+            }
+            else {
+                return fail("invalid escape");
+            }
+        }
+
+        return true;
+    }
+
+    static void appendUtf8(const unsigned int code, std::string &out) {
+        if (code < 0x80) {
+            out += char(code);
+        }
+        else if (code < 0x800) {
+            out += char(0xC0 | (code >> 6));
+            out += char(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000) {
+            out += char(0xE0 | (code >> 12));
+            out += char(0x80 | ((code >> 6) & 0x3F));
+            out += char(0x80 | (code & 0x3F));
+        }
+        else {
+            out += char(0xF0 | (code >> 18));
+            out += char(0x80 | ((code >> 12) & 0x3F));
+            out += char(0x80 | ((code >> 6) & 0x3F));
+            out += char(0x80 | (code & 0x3F));
+        }
+    }
+
+    bool parseString(std::string &out) {
+        // skip the opening quote
+        position++;
+
+        while (position < text.size()) {
+            const char c = text[position++];
+
+            if (c == '"') {
+                return true;
+            }
+
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+
+            if (position >= text.size()) {
+                break;
+            }
+
+            switch (text[position++]) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+
+            case 'u': {
+                unsigned int code = 0;
+
+                if (!parseHex4(code)) {
+                    return false;
+                }
+
+                // surrogate pair
+                if (code >= 0xD800 && code < 0xDC00 && consume("\\u")) {
+                    unsigned int low = 0;
+
+                    if (!parseHex4(low)) {
+                        return false;
+                    }
+
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+
+                appendUtf8(code, out);
+                break;
+            }
+
+            default:
+                return fail("invalid escape");
+            }
+        }
+
+        return fail("unterminated string");
+    }
+
+    bool parseNumber(double &number) {
+        const size_t begin = position;
+
+        while (position < text.size() && std::string_view{"+-0123456789.eE"}.find(text[position]) != std::string_view::npos) {
+            position++;
+        }
+
+        // strtod needs a terminated string
+        const std::string token {text.substr(begin, position - begin)};
+        char *end = nullptr;
+
+        number = std::strtod(token.c_str(), &end);
+
+        if (token.empty() || end != token.c_str() + token.size()) {
+            position = begin;
+            return fail("invalid number");
+        }
+
+        return true;
+    }
+
+private:
+    const std::string_view text;
+    size_t position = 0;
+    std::string error;
+};
+
+
+bool parseJson(const std::string_view text, JsonValue &value, std::string &error) {
+    value = JsonValue{};
+
+    return JsonParser{text}.parse(value, error);
+}
+
+
+void JsonWriter::beginObject() {
+    beginValue();
+    os << '{';
+    levels.push_back({true, true});
+}
+
+
+void JsonWriter::endObject() {
+    const bool empty = levels.back().empty;
+    levels.pop_back();
+
+    if (! empty) {
+        indent();
+    }
+
+    os << '}';
+
+    if (levels.empty()) {
+        os << '\n';
+    }
+}
+
+
+void JsonWriter::beginArray() {
+    beginValue();
+    os << '[';
+    levels.push_back({false, true});
+}
+
+
+void JsonWriter::endArray() {
+    const bool empty = levels.back().empty;
+    levels.pop_back();
+
+    if (! empty) {
+        indent();
+    }
+
+    os << ']';
+
+    if (levels.empty()) {
+        os << '\n';
+    }
+}
+
+
+JsonWriter& JsonWriter::key(const std::string_view name) {
+    beginValue();
+    writeString(name);
+    os << ": ";
+
+    afterKey = true;
+
+    return *this;
+}
+
+
+void JsonWriter::string(const std::string_view value) {
+    beginValue();
+    writeString(value);
+}
+
+
+void JsonWriter::number(const double value) {
+    beginValue();
+
+    if (! std::isfinite(value)) {
+        os << "null";
+        return;
+    }
+
+    char text[32];
+
+    if (value == std::floor(value) && std::abs(value) < 1e15) {
+        std::snprintf(text, sizeof(text), "%.0f", value);
+    }
+    else {
+        std::snprintf(text, sizeof(text), "%.10g", value);
+    }
+
+    os << text;
+}
+
+
+void JsonWriter::boolean(const bool value) {
+    beginValue();
+    os << (value ? "true" : "false");
+}
+
+
+void JsonWriter::null() {
+    beginValue();
+    os << "null";
+}
+
+
+void JsonWriter::beginValue() {
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+
+    if (levels.empty()) {
+        return;
+    }
+
+    if (! levels.back().empty) {
+        os << ',';
+    }
+
+    levels.back().empty = false;
+    indent();
+}
+
+
+void JsonWriter::indent() {
+    os << '\n';
+
+    for (size_t i = 0; i < levels.size(); i++) {
+        os << "  ";
+    }
+}
+
+
+void JsonWriter::writeString(const std::string_view value) {
+    os << '"';
+
+    for (const char c : value) {
+        switch (c) {
+        case '"': os << "\\\""; break;
+        case '\\': os << "\\\\"; break;
+        case '\n': os << "\\n"; break;
+        case '\r': os << "\\r"; break;
+        case '\t': os << "\\t"; break;
+
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(c));
+                os << escaped;
+            }
+            else {
+                os << c;
+            }
+        }
+    }
+
+    os << '"';
+}
@@ -0,0 +1,129 @@
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// A parsed JSON document. Missing members and out of range elements read as null, so lookups can be
+// chained without checking every level.
+class JsonValue {
+public:
+    enum class Type {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    Type getType() const {
+        return type;
+    }
+
+    bool isNull() const {
+        return type == Type::Null;
+    }
+
+    bool isObject() const {
+        return type == Type::Object;
+    }
+
+    bool isArray() const {
+        return type == Type::Array;
+    }
+
+    bool asBool(const bool fallback = false) const {
+        return type == Type::Bool ? boolean : fallback;
+    }
+
+    double asNumber(const double fallback = 0.0) const {
+        return type == Type::Number ? number : fallback;
+    }
+
+    // empty when the value isn't a string
+    const std::string& asString() const {
+        return string;
+    }
+
+    // elements of an array, or members of an object
+    size_t size() const {
+        return elements.size();
+    }
+
+    const JsonValue& operator[](size_t index) const;
+
+    const JsonValue& operator[](std::string_view key) const;
+
+    bool has(std::string_view key) const;
+
+    // the name of the member at index, for objects
+    const std::string& getKey(const size_t index) const {
+        return keys[index];
+    }
+
+private:
+    friend class JsonParser;
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+
+    std::vector<JsonValue> elements;
+
+    // member names of an object, parallel to the elements
+    std::vector<std::string> keys;
+};
+
+
+// false on malformed input, with the reason in error
+bool parseJson(std::string_view text, JsonValue &value, std::string &error);
+
+
+// Writes a JSON document to a stream, two spaces per level. The commas and the line breaks follow from the
+// calls, which only have to nest like the document: key() names the value written next, inside objects.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::ostream &os) : os(os) {}
+
+    void beginObject();
+
+    void endObject();
+
+    void beginArray();
+
+    void endArray();
+
+    JsonWriter& key(std::string_view name);
+
+    void string(std::string_view value);
+
+    // the integral values are written without a fraction, the non finite ones as null
+    void number(double value);
+
+    void boolean(bool value);
+
+    void null();
+
+private:
+    // the separator and the indentation before a value, unless it follows its key
+    void beginValue();
+
+    void indent();
+
+    void writeString(std::string_view value);
+
+private:
+    struct Level {
+        bool object = false;
+        bool empty = true;
+    };
+
+    std::ostream &os;
+    std::vector<Level> levels;
+    bool afterKey = false;
+};
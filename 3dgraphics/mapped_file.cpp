@@ -0,0 +1,93 @@
+
+#include "mapped_file.hpp"
+
+#include <fstream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#   define MAPPED_FILE_USE_MMAP
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+
+MappedFile& MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        close();
+
+        // the vector keeps its buffer when moved, so the pointer stays valid
+        contents = std::move(other.contents);
+        bytes = std::exchange(other.bytes, nullptr);
+        byteSize = std::exchange(other.byteSize, 0);
+    }
+
+    return *this;
+}
+
+
+bool MappedFile::open(const std::string &filePath) {
+    close();
+
+#if defined(MAPPED_FILE_USE_MMAP)
+    const int fd = ::open(filePath.c_str(), O_RDONLY);
+
+    if (fd >= 0) {
+        struct stat status;
+
+        if (fstat(fd, &status) == 0 && status.st_size > 0) {
+            void *mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (mapping != MAP_FAILED) {
+                bytes = static_cast<const std::uint8_t*>(mapping);
+                byteSize = status.st_size;
+            }
+        }
+
+        ::close(fd);
+
+        if (bytes) {
+            return true;
+        }
+    }
+#endif
+
+    std::ifstream is{filePath.c_str(), std::ios::in | std::ios::binary};
+
+    if (!is) {
+        return false;
+    }
+
+    contents.assign(std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{});
+
+    bytes = contents.data();
+    byteSize = contents.size();
+
+    return true;
+}
+
+
+void MappedFile::close() {
+#if defined(MAPPED_FILE_USE_MMAP)
+    if (bytes && contents.empty()) {
+        munmap(const_cast<std::uint8_t*>(bytes), byteSize);
+    }
+#endif
+
+    contents.clear();
+    contents.shrink_to_fit();
+
+    bytes = nullptr;
+    byteSize = 0;
+}
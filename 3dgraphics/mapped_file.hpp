@@ -0,0 +1,40 @@
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// A read only file mapped into memory. Where mmap isn't available, the file is read instead.
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    ~MappedFile();
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile& operator=(MappedFile &&other) noexcept;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string &filePath);
+
+    void close();
+
+    const std::uint8_t* data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return byteSize;
+    }
+
+private:
+    const std::uint8_t *bytes = nullptr;
+    size_t byteSize = 0;
+
+    // the contents, when the file couldn't be mapped
+    std::vector<std::uint8_t> contents;
+};
@@ -0,0 +1,650 @@
+
+#include "mesh_codec.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#   define MESH_CODEC_USE_SSE
+#   include <emmintrin.h>
+#   include <xmmintrin.h>
+#endif
+
+
+// the positions, the octahedral normals and the texture coordinates
+const int ComponentCount = 7;
+
+const size_t GroupSize = 16;
+
+// the bits per byte of the packed groups, and the bytes they take
+const unsigned int GroupBits[4] = {0, 2, 4, 8};
+const size_t GroupBytes[4] = {0, 4, 8, 16};
+
+const float QuantizedMax = 65535.0f;
+const float NormalMax = float((1 << NormalBits) - 1);
+
+// the minimum and the step of the positions and the texture coordinates
+const size_t HeaderFloats = 10;
+
+// the bytes of the index codes
+const int IndexPlanes = 4;
+
+
+static size_t getGroupCount(const size_t vertexCount) {
+    return (vertexCount + GroupSize - 1) / GroupSize;
+}
+
+
+static std::uint16_t quantize(const float value, const float min, const float step) {
+    if (step <= 0.0f) {
+        return 0;
+    }
+
+    return static_cast<std::uint16_t>(std::lround(std::clamp((value - min) / step, 0.0f, QuantizedMax)));
+}
+
+
+// folds the lower hemisphere over the upper one, on the octahedron |x| + |y| + |z| = 1
+static glm::vec2 encodeOctahedral(const glm::vec3 &normal) {
+    const float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+
+    if (sum <= 0.0f) {
+        return {0.0f, 0.0f};
+    }
+
+    const glm::vec3 n = normal / sum;
+
+    if (n.z >= 0.0f) {
+        return {n.x, n.y};
+    }
+
+    return {
+        (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+        (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)
+    };
+}
+
+
+static glm::vec3 decodeOctahedral(const std::uint16_t qx, const std::uint16_t qy) {
+    glm::vec3 n;
+    n.x = float(qx) * (2.0f / NormalMax) - 1.0f;
+    n.y = float(qy) * (2.0f / NormalMax) - 1.0f;
+    n.z = 1.0f - std::abs(n.x) - std::abs(n.y);
+
+    const float fold = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -fold : fold;
+    n.y += n.y >= 0.0f ? -fold : fold;
+
+    return n * (1.0f / std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z));
+}
+
+
+static std::uint8_t getGroupCode(const std::uint8_t *bytes) {
+    const std::uint8_t max = *std::max_element(bytes, bytes + GroupSize);
+
+    return max == 0 ? 0 : max < 4 ? 1 : max < 16 ? 2 : 3;
+}
+
+
+static void packGroup(const std::uint8_t *bytes, const std::uint8_t code, std::vector<std::uint8_t> &stream) {
+    const unsigned int bits = GroupBits[code];
+
+    if (bits == 0) {
+        return;
+    }
+
+    if (bits == 8) {
+        stream.insert(stream.end(), bytes, bytes + GroupSize);
+        return;
+    }
+
+    const unsigned int perByte = 8 / bits;
+    const size_t start = stream.size();
+    stream.resize(start + GroupBytes[code], 0);
+
+    for (unsigned int j = 0; j < GroupSize; j++) {
+        stream[start + j / perByte] |= bytes[j] << (bits * (j % perByte));
+    }
+}
+
+
+// a plane of bytes, in groups of 16: the codes of the groups, four to a byte, followed by the packed groups
+static void encodePlane(const std::uint8_t *bytes, const size_t groupCount, std::vector<std::uint8_t> &stream) {
+    const size_t selectors = stream.size();
+    stream.resize(selectors + (groupCount + 3) / 4, 0);
+
+    for (size_t group = 0; group < groupCount; group++) {
+        const std::uint8_t code = getGroupCode(bytes + group * GroupSize);
+
+        stream[selectors + group / 4] |= code << (2 * (group % 4));
+        packGroup(bytes + group * GroupSize, code, stream);
+    }
+}
+
+
+// the zigzag encoded deltas between consecutive values, as a plane of low bytes and one of high bytes
+static void encodeComponent(const std::uint16_t *values, const size_t vertexCount, std::vector<std::uint8_t> &stream) {
+    const size_t groupCount = getGroupCount(vertexCount);
+
+    std::vector<std::uint8_t> low(groupCount * GroupSize, 0), high(groupCount * GroupSize, 0);
+    std::uint16_t previous = 0;
+
+    for (size_t i = 0; i < vertexCount; i++) {
+        const std::uint16_t delta = std::uint16_t(values[i] - previous);
+        const std::uint16_t zigzag = std::uint16_t((delta << 1) ^ -(delta >> 15));
+
+        low[i] = std::uint8_t(zigzag);
+        high[i] = std::uint8_t(zigzag >> 8);
+        previous = values[i];
+    }
+
+    encodePlane(low.data(), groupCount, stream);
+    encodePlane(high.data(), groupCount, stream);
+}
+
+
+struct Plane {
+    const std::uint8_t *selectors = nullptr;
+    const std::uint8_t *data = nullptr;
+
+    unsigned int getCode(const size_t group) const {
+        return (selectors[group / 4] >> (2 * (group % 4))) & 3;
+    }
+};
+
+
+// points the plane at the stream and moves the stream past it. false when its groups don't fit
+static bool findPlane(const std::uint8_t *&stream, const std::uint8_t *end, const size_t groupCount, Plane &plane) {
+    const size_t selectorBytes = (groupCount + 3) / 4;
+
+    if (size_t(end - stream) < selectorBytes) {
+        return false;
+    }
+
+    plane.selectors = stream;
+    plane.data = stream + selectorBytes;
+
+    // the bytes taken by the four groups of each selector byte. the codes past the last group are zero
+    static const auto selectorSizes = []() {
+        std::array<std::uint8_t, 256> sizes;
+
+        for (unsigned int selector = 0; selector < 256; selector++) {
+            sizes[selector] = std::uint8_t(GroupBytes[selector & 3] + GroupBytes[(selector >> 2) & 3] + GroupBytes[(selector >> 4) & 3] + GroupBytes[selector >> 6]);
+        }
+
+        return sizes;
+    }();
+
+    size_t size = 0;
+
+    for (size_t i = 0; i < selectorBytes; i++) {
+        size += selectorSizes[plane.selectors[i]];
+    }
+
+    if (size > size_t(end - plane.data)) {
+        return false;
+    }
+
+    stream = plane.data + size;
+
+    return true;
+}
+
+
+static const std::uint8_t* unpackGroupScalar(const std::uint8_t *data, const unsigned int code, std::uint8_t *bytes) {
+    const unsigned int bits = GroupBits[code];
+
+    if (bits == 0) {
+        std::fill(bytes, bytes + GroupSize, std::uint8_t(0));
+    }
+    else if (bits == 8) {
+        std::copy(data, data + GroupSize, bytes);
+    }
+    else {
+        const unsigned int perByte = 8 / bits;
+        const unsigned int mask = (1u << bits) - 1;
+
+        for (unsigned int j = 0; j < GroupSize; j++) {
+            bytes[j] = std::uint8_t((data[j / perByte] >> (bits * (j % perByte))) & mask);
+        }
+    }
+
+    return data + GroupBytes[code];
+}
+
+
+static void decodeComponentScalar(const Plane &low, const Plane &high, const size_t groupCount, std::uint16_t *values) {
+    const std::uint8_t *lowData = low.data, *highData = high.data;
+    std::uint16_t previous = 0;
+
+    for (size_t group = 0; group < groupCount; group++) {
+        std::uint8_t lowBytes[GroupSize], highBytes[GroupSize];
+        lowData = unpackGroupScalar(lowData, low.getCode(group), lowBytes);
+        highData = unpackGroupScalar(highData, high.getCode(group), highBytes);
+
+        for (unsigned int j = 0; j < GroupSize; j++) {
+            const std::uint16_t zigzag = std::uint16_t(lowBytes[j] | (highBytes[j] << 8));
+
+            previous = std::uint16_t(previous + ((zigzag >> 1) ^ -(zigzag & 1)));
+            values[group * GroupSize + j] = previous;
+        }
+    }
+}
+
+
+// the zigzag encoded distances of the indices, from the lowest byte. the next unreferenced vertex moves past
+// the index, by max(0, 1 - distance) vertices, so it is a running sum that doesn't depend on the indices
+static void decodeIndexCodesScalar(const Plane *planes, const size_t indexCount, std::uint32_t *indices) {
+    const std::uint8_t *data[IndexPlanes];
+
+    for (int k = 0; k < IndexPlanes; k++) {
+        data[k] = planes[k].data;
+    }
+
+    std::uint32_t next = 0;
+
+    for (size_t group = 0; group < getGroupCount(indexCount); group++) {
+        std::uint8_t bytes[IndexPlanes][GroupSize];
+
+        for (int k = 0; k < IndexPlanes; k++) {
+            data[k] = unpackGroupScalar(data[k], planes[k].getCode(group), bytes[k]);
+        }
+
+        for (unsigned int j = 0; j < GroupSize && group * GroupSize + j < indexCount; j++) {
+            const std::uint32_t zigzag = bytes[0][j] | (bytes[1][j] << 8) | (bytes[2][j] << 16) | (std::uint32_t(bytes[3][j]) << 24);
+            const std::int32_t distance = std::int32_t((zigzag >> 1) ^ -(zigzag & 1));
+
+            indices[group * GroupSize + j] = next - std::uint32_t(distance);
+            next += distance < 1 ? 1u - std::uint32_t(distance) : 0u;
+        }
+    }
+}
+
+
+// the header holds the minimum of the positions, their step, then the ones of the texture coordinates
+static void dequantizeScalar(const float *header, const std::uint16_t *const *components, const size_t first, const size_t count, glm::vec3 *positions, glm::vec3 *normals, glm::vec2 *texCoords) {
+    for (size_t i = first; i < count; i++) {
+        positions[i] = {header[0] + float(components[0][i]) * header[3], header[1] + float(components[1][i]) * header[4], header[2] + float(components[2][i]) * header[5]};
+        normals[i] = decodeOctahedral(components[3][i], components[4][i]);
+        texCoords[i] = {header[6] + float(components[5][i]) * header[8], header[7] + float(components[6][i]) * header[9]};
+    }
+}
+
+
+#if defined(MESH_CODEC_USE_SSE)
+
+static __m128i unpackGroup(const std::uint8_t *&data, const unsigned int code) {
+    __m128i bytes;
+
+    switch (code) {
+    case 0:
+        bytes = _mm_setzero_si128();
+        break;
+
+    case 1: {
+        // four values per byte, two bits apart
+        std::int32_t packed;
+        std::memcpy(&packed, data, sizeof(packed));
+
+        const __m128i v = _mm_cvtsi32_si128(packed);
+        const __m128i mask = _mm_set1_epi8(3);
+
+        const __m128i ab = _mm_unpacklo_epi8(_mm_and_si128(v, mask), _mm_and_si128(_mm_srli_epi16(v, 2), mask));
+        const __m128i cd = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(v, 4), mask), _mm_and_si128(_mm_srli_epi16(v, 6), mask));
+
+        bytes = _mm_unpacklo_epi16(ab, cd);
+        break;
+    }
+
+    case 2: {
+        const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+        const __m128i mask = _mm_set1_epi8(15);
+
+        bytes = _mm_unpacklo_epi8(_mm_and_si128(v, mask), _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+        break;
+    }
+
+    default:
+        bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        break;
+    }
+
+    data += GroupBytes[code];
+
+    return bytes;
+}
+
+
+// undoes the zigzag and adds up the deltas of eight values, on top of the last value of the previous ones
+static __m128i sumDeltas(const __m128i zigzag, const __m128i previous) {
+    __m128i v = _mm_xor_si128(_mm_srli_epi16(zigzag, 1), _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(zigzag, _mm_set1_epi16(1))));
+
+    v = _mm_add_epi16(v, _mm_slli_si128(v, 2));
+    v = _mm_add_epi16(v, _mm_slli_si128(v, 4));
+    v = _mm_add_epi16(v, _mm_slli_si128(v, 8));
+
+    return _mm_add_epi16(v, previous);
+}
+
+
+static __m128i broadcastLast(const __m128i v) {
+    const __m128i high = _mm_shufflehi_epi16(v, 0xFF);
+
+    return _mm_unpackhi_epi64(high, high);
+}
+
+
+static void decodeComponent(const Plane &low, const Plane &high, const size_t groupCount, std::uint16_t *values) {
+    const std::uint8_t *lowData = low.data, *highData = high.data;
+    __m128i previous = _mm_setzero_si128();
+
+    for (size_t group = 0; group < groupCount; group++) {
+        const __m128i lowBytes = unpackGroup(lowData, low.getCode(group));
+        const __m128i highBytes = unpackGroup(highData, high.getCode(group));
+
+        const __m128i first = sumDeltas(_mm_unpacklo_epi8(lowBytes, highBytes), previous);
+        const __m128i second = sumDeltas(_mm_unpackhi_epi8(lowBytes, highBytes), broadcastLast(first));
+        previous = broadcastLast(second);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + group * GroupSize), first);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + group * GroupSize + 8), second);
+    }
+}
+
+
+// the indices of four codes, and the next unreferenced vertex after them
+static __m128i decodeIndexLanes(const __m128i zigzag, __m128i &next) {
+    const __m128i distance = _mm_xor_si128(_mm_srli_epi32(zigzag, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(zigzag, _mm_set1_epi32(1))));
+
+    __m128i step = _mm_sub_epi32(_mm_set1_epi32(1), distance);
+    step = _mm_and_si128(step, _mm_cmpgt_epi32(step, _mm_setzero_si128()));
+
+    __m128i sum = _mm_add_epi32(step, _mm_slli_si128(step, 4));
+    sum = _mm_add_epi32(sum, _mm_slli_si128(sum, 8));
+
+    const __m128i indices = _mm_sub_epi32(_mm_add_epi32(next, _mm_sub_epi32(sum, step)), distance);
+    next = _mm_add_epi32(next, _mm_shuffle_epi32(sum, 0xFF));
+
+    return indices;
+}
+
+
+static void decodeIndexCodes(const Plane *planes, const size_t indexCount, std::uint32_t *indices) {
+    const std::uint8_t *data[IndexPlanes];
+
+    for (int k = 0; k < IndexPlanes; k++) {
+        data[k] = planes[k].data;
+    }
+
+    __m128i next = _mm_setzero_si128();
+
+    for (size_t group = 0; group < getGroupCount(indexCount); group++) {
+        const __m128i b0 = unpackGroup(data[0], planes[0].getCode(group));
+        const __m128i b1 = unpackGroup(data[1], planes[1].getCode(group));
+        const __m128i b2 = unpackGroup(data[2], planes[2].getCode(group));
+        const __m128i b3 = unpackGroup(data[3], planes[3].getCode(group));
+
+        const __m128i low01 = _mm_unpacklo_epi8(b0, b1), high01 = _mm_unpackhi_epi8(b0, b1);
+        const __m128i low23 = _mm_unpacklo_epi8(b2, b3), high23 = _mm_unpackhi_epi8(b2, b3);
+
+        __m128i groupIndices[4];
+        groupIndices[0] = decodeIndexLanes(_mm_unpacklo_epi16(low01, low23), next);
+        groupIndices[1] = decodeIndexLanes(_mm_unpackhi_epi16(low01, low23), next);
+        groupIndices[2] = decodeIndexLanes(_mm_unpacklo_epi16(high01, high23), next);
+        groupIndices[3] = decodeIndexLanes(_mm_unpackhi_epi16(high01, high23), next);
+
+        // the last group is padded
+        const size_t first = group * GroupSize;
+
+        if (first + GroupSize <= indexCount) {
+            for (int k = 0; k < 4; k++) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(indices + first + 4 * k), groupIndices[k]);
+            }
+        }
+        else {
+            std::uint32_t padded[GroupSize];
+            std::memcpy(padded, groupIndices, sizeof(padded));
+            std::copy(padded, padded + (indexCount - first), indices + first);
+        }
+    }
+}
+
+
+static __m128 loadQuantized(const std::uint16_t *values) {
+    const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(values));
+
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+}
+
+
+// stores the x, y and z vectors of four vertices. each store spills a float into the next vertex, so the last
+// vertex of the array is left to the scalar path
+static void storeVec3(glm::vec3 *vectors, __m128 x, __m128 y, __m128 z) {
+    __m128 w = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+
+    float *values = reinterpret_cast<float*>(vectors);
+    _mm_storeu_ps(values, x);
+    _mm_storeu_ps(values + 3, y);
+    _mm_storeu_ps(values + 6, z);
+    _mm_storeu_ps(values + 9, w);
+}
+
+
+static size_t dequantize(const float *header, const std::uint16_t *const *components, const size_t count, glm::vec3 *positions, glm::vec3 *normals, glm::vec2 *texCoords) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 normalStep = _mm_set1_ps(2.0f / NormalMax);
+
+    size_t i = 0;
+
+    for (; i + 4 < count; i += 4) {
+        __m128 p[3];
+
+        for (int k = 0; k < 3; k++) {
+            p[k] = _mm_add_ps(_mm_set1_ps(header[k]), _mm_mul_ps(loadQuantized(components[k] + i), _mm_set1_ps(header[3 + k])));
+        }
+
+        storeVec3(positions + i, p[0], p[1], p[2]);
+
+        // as decodeOctahedral, moving the folded coordinates towards zero
+        __m128 x = _mm_sub_ps(_mm_mul_ps(loadQuantized(components[3] + i), normalStep), one);
+        __m128 y = _mm_sub_ps(_mm_mul_ps(loadQuantized(components[4] + i), normalStep), one);
+        const __m128 z = _mm_sub_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, x)), _mm_andnot_ps(signMask, y));
+
+        const __m128 fold = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), z), _mm_setzero_ps());
+        x = _mm_sub_ps(x, _mm_or_ps(fold, _mm_and_ps(x, signMask)));
+        y = _mm_sub_ps(y, _mm_or_ps(fold, _mm_and_ps(y, signMask)));
+
+        const __m128 scale = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_add_ps(_mm_mul_ps(y, y), _mm_mul_ps(z, z)))));
+        storeVec3(normals + i, _mm_mul_ps(x, scale), _mm_mul_ps(y, scale), _mm_mul_ps(z, scale));
+
+        const __m128 u = _mm_add_ps(_mm_set1_ps(header[6]), _mm_mul_ps(loadQuantized(components[5] + i), _mm_set1_ps(header[8])));
+        const __m128 v = _mm_add_ps(_mm_set1_ps(header[7]), _mm_mul_ps(loadQuantized(components[6] + i), _mm_set1_ps(header[9])));
+
+        float *uv = reinterpret_cast<float*>(texCoords + i);
+        _mm_storeu_ps(uv, _mm_unpacklo_ps(u, v));
+        _mm_storeu_ps(uv + 4, _mm_unpackhi_ps(u, v));
+    }
+
+    return i;
+}
+
+#endif
+
+
+void encodeVertices(const glm::vec3 *positions, const glm::vec3 *normals, const glm::vec2 *texCoords, const size_t vertexCount, std::vector<std::uint8_t> &stream) {
+    glm::vec3 positionMin {std::numeric_limits<float>::max()}, positionMax {-std::numeric_limits<float>::max()};
+    glm::vec2 texCoordMin {std::numeric_limits<float>::max()}, texCoordMax {-std::numeric_limits<float>::max()};
+
+    for (size_t i = 0; i < vertexCount; i++) {
+        positionMin = glm::min(positionMin, positions[i]);
+        positionMax = glm::max(positionMax, positions[i]);
+        texCoordMin = glm::min(texCoordMin, texCoords[i]);
+        texCoordMax = glm::max(texCoordMax, texCoords[i]);
+    }
+
+    if (vertexCount == 0) {
+        positionMin = positionMax = glm::vec3{0.0f};
+        texCoordMin = texCoordMax = glm::vec2{0.0f};
+    }
+
+    const glm::vec3 positionStep = (positionMax - positionMin) / QuantizedMax;
+    const glm::vec2 texCoordStep = (texCoordMax - texCoordMin) / QuantizedMax;
+
+    const float header[HeaderFloats] = {
+        positionMin.x, positionMin.y, positionMin.z, positionStep.x, positionStep.y, positionStep.z,
+        texCoordMin.x, texCoordMin.y, texCoordStep.x, texCoordStep.y
+    };
+
+    const auto headerBytes = reinterpret_cast<const std::uint8_t*>(header);
+    stream.insert(stream.end(), headerBytes, headerBytes + sizeof(header));
+
+    std::vector<std::uint16_t> values(vertexCount);
+
+    for (int component = 0; component < ComponentCount; component++) {
+        for (size_t i = 0; i < vertexCount; i++) {
+            if (component < 3) {
+                values[i] = quantize(positions[i][component], positionMin[component], positionStep[component]);
+            }
+            else if (component < 5) {
+                const float octahedral = encodeOctahedral(normals[i])[component - 3];
+                values[i] = static_cast<std::uint16_t>(std::lround((octahedral * 0.5f + 0.5f) * NormalMax));
+            }
+            else {
+                values[i] = quantize(texCoords[i][component - 5], texCoordMin[component - 5], texCoordStep[component - 5]);
+            }
+        }
+
+        encodeComponent(values.data(), vertexCount, stream);
+    }
+}
+
+
+// the components are decoded into 16 bit arrays first, padded to whole groups, then converted to floats.
+// dequantize returns where it stopped, and the scalar path does the rest
+template<typename DecodeComponent, typename Dequantize>
+static bool decodeVerticesWith(DecodeComponent decodeComponent, Dequantize dequantize, const std::uint8_t *stream, const size_t size, const size_t vertexCount, glm::vec3 *positions, glm::vec3 *normals, glm::vec2 *texCoords) {
+    if (size < HeaderFloats * sizeof(float)) {
+        return false;
+    }
+
+    float header[HeaderFloats];
+    std::memcpy(header, stream, sizeof(header));
+
+    const std::uint8_t *data = stream + sizeof(header);
+    const std::uint8_t *end = stream + size;
+
+    const size_t groupCount = getGroupCount(vertexCount);
+    const size_t stride = groupCount * GroupSize;
+
+    std::vector<std::uint16_t> values(ComponentCount * stride);
+
+    for (int component = 0; component < ComponentCount; component++) {
+        Plane low, high;
+
+        if (!findPlane(data, end, groupCount, low) || !findPlane(data, end, groupCount, high)) {
+            return false;
+        }
+
+        decodeComponent(low, high, groupCount, values.data() + component * stride);
+    }
+
+    if (data != end) {
+        return false;
+    }
+
+    const std::uint16_t *components[ComponentCount];
+
+    for (int component = 0; component < ComponentCount; component++) {
+        components[component] = values.data() + component * stride;
+    }
+
+    const size_t first = dequantize(header, components, vertexCount, positions, normals, texCoords);
+    dequantizeScalar(header, components, first, vertexCount, positions, normals, texCoords);
+
+    return true;
+}
+
+
+bool decodeVerticesScalar(const std::uint8_t *stream, const size_t size, const size_t vertexCount, glm::vec3 *positions, glm::vec3 *normals, glm::vec2 *texCoords) {
+    auto dequantize = [](const float*, const std::uint16_t *const*, size_t, glm::vec3*, glm::vec3*, glm::vec2*) {
+        return size_t(0);
+    };
+
+    return decodeVerticesWith(decodeComponentScalar, dequantize, stream, size, vertexCount, positions, normals, texCoords);
+}
+
+
+bool decodeVertices(const std::uint8_t *stream, const size_t size, const size_t vertexCount, glm::vec3 *positions, glm::vec3 *normals, glm::vec2 *texCoords) {
+#if defined(MESH_CODEC_USE_SSE)
+    return decodeVerticesWith(decodeComponent, dequantize, stream, size, vertexCount, positions, normals, texCoords);
+#else
+    return decodeVerticesScalar(stream, size, vertexCount, positions, normals, texCoords);
+#endif
+}
+
+
+// each index is the distance back from the next unreferenced vertex, zigzag encoded for the indices past it,
+// cut into planes of bytes like the vertex components
+void encodeIndices(const std::uint32_t *indices, const size_t indexCount, std::vector<std::uint8_t> &stream) {
+    const size_t groupCount = getGroupCount(indexCount);
+
+    std::vector<std::uint8_t> planes(IndexPlanes * groupCount * GroupSize, 0);
+    std::uint32_t next = 0;
+
+    for (size_t i = 0; i < indexCount; i++) {
+        const std::uint32_t distance = next - indices[i];
+        const std::uint32_t zigzag = (distance << 1) ^ -(distance >> 31);
+
+        for (int k = 0; k < IndexPlanes; k++) {
+            planes[k * groupCount * GroupSize + i] = std::uint8_t(zigzag >> (8 * k));
+        }
+
+        next = std::max(next, indices[i] + 1);
+    }
+
+    for (int k = 0; k < IndexPlanes; k++) {
+        encodePlane(planes.data() + k * groupCount * GroupSize, groupCount, stream);
+    }
+}
+
+
+template<typename DecodeIndexCodes>
+static bool decodeIndicesWith(DecodeIndexCodes decodeIndexCodes, const std::uint8_t *stream, const size_t size, std::uint32_t *indices, const size_t indexCount) {
+    const std::uint8_t *end = stream + size;
+    const size_t groupCount = getGroupCount(indexCount);
+
+    Plane planes[IndexPlanes];
+
+    for (Plane &plane : planes) {
+        if (! findPlane(stream, end, groupCount, plane)) {
+            return false;
+        }
+    }
+
+    if (stream != end) {
+        return false;
+    }
+
+    decodeIndexCodes(planes, indexCount, indices);
+
+    return true;
+}
+
+
+bool decodeIndicesScalar(const std::uint8_t *stream, const size_t size, std::uint32_t *indices, const size_t indexCount) {
+    return decodeIndicesWith(decodeIndexCodesScalar, stream, size, indices, indexCount);
+}
+
+
+bool decodeIndices(const std::uint8_t *stream, const size_t size, std::uint32_t *indices, const size_t indexCount) {
+#if defined(MESH_CODEC_USE_SSE)
+    return decodeIndicesWith(decodeIndexCodes, stream, size, indices, indexCount);
+#else
+    return decodeIndicesScalar(stream, size, indices, indexCount);
+#endif
+}
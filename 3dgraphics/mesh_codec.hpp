@@ -0,0 +1,43 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+
+// Compressed vertex and index streams, for the chunks of the tiled scenes.
+//
+// The vertices are quantized to 16 bit integers: the positions and texture coordinates over the range of the
+// mesh, and the normals to octahedral coordinates of NormalBits bits. Each of the seven components is stored
+// on its own, as the zigzag encoded deltas between consecutive vertices, split into a plane with the low bytes
+// and one with the high bytes. The planes are cut into groups of 16 bytes, each packed with 0, 2, 4 or 8 bits
+// per byte, whatever its largest byte needs. The decoder expands a group with a few shifts and masks, so the
+// deltas can be summed up 8 at a time.
+//
+// The indices are coded as their distance back from the next vertex that has not been referenced yet, in four
+// planes of the same kind. The chunks number their vertices in the order the triangles first use them, so most
+// indices are either that vertex or one used shortly before, and need a few bits of the lowest plane.
+const int NormalBits = 12;
+
+
+// quantizes and encodes the vertices, appending them to the stream. the positions and the texture coordinates
+// are off by half a step of their range at most, and the normals by half a step of the octahedral coordinates
+void encodeVertices(const glm::vec3 *positions, const glm::vec3 *normals, const glm::vec2 *texCoords, size_t vertexCount, std::vector<std::uint8_t> &stream);
+
+// reference implementation. false when the stream doesn't hold exactly vertexCount vertices
+bool decodeVerticesScalar(const std::uint8_t *stream, size_t size, size_t vertexCount, glm::vec3 *positions, glm::vec3 *normals, glm::vec2 *texCoords);
+
+// expands and sums up the deltas of 16 vertices at a time with SSE2, and falls back to the scalar path elsewhere
+bool decodeVertices(const std::uint8_t *stream, size_t size, size_t vertexCount, glm::vec3 *positions, glm::vec3 *normals, glm::vec2 *texCoords);
+
+
+// lossless for the indices below 2^31, appends them to the stream
+void encodeIndices(const std::uint32_t *indices, size_t indexCount, std::vector<std::uint8_t> &stream);
+
+// reference implementation. false when the stream doesn't hold exactly indexCount indices
+bool decodeIndicesScalar(const std::uint8_t *stream, size_t size, std::uint32_t *indices, size_t indexCount);
+
+// expands the codes of 16 indices at a time with SSE2, and falls back to the scalar path elsewhere
+bool decodeIndices(const std::uint8_t *stream, size_t size, std::uint32_t *indices, size_t indexCount);
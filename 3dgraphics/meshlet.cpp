@@ -0,0 +1,357 @@
+
+#include "meshlet.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#   define MESHLET_USE_SSE
+#   include <emmintrin.h>
+#endif
+
+
+static const float MeshletExtentFactor = 1.5f;
+
+
+static float maxComponent(const glm::vec3 &v) {
+    return std::max(v.x, std::max(v.y, v.z));
+}
+
+
+static std::uint32_t expandBits(std::uint32_t v) {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+
+    return v;
+}
+
+
+// 30 bit morton code of a point inside the unit cube
+static std::uint32_t mortonCode(const glm::vec3 &p) {
+    const glm::vec3 q = glm::clamp(p * 1024.0f, 0.0f, 1023.0f);
+
+    return (expandBits(std::uint32_t(q.x)) << 2) | (expandBits(std::uint32_t(q.y)) << 1) | expandBits(std::uint32_t(q.z));
+}
+
+
+// sort the triangles along a morton curve, so the greedy pass below produces compact clusters
+// even when the input triangle order has no spatial coherence
+static std::vector<unsigned int> sortTrianglesSpatially(const glm::vec3 *positions, const unsigned int *indices, const size_t triangleCount) {
+    std::vector<glm::vec3> centroids(triangleCount);
+
+    glm::vec3 boxMin = glm::vec3{ std::numeric_limits<float>::max()};
+    glm::vec3 boxMax = glm::vec3{-std::numeric_limits<float>::max()};
+
+    for (size_t i = 0; i < triangleCount; i++) {
+        const glm::vec3 &a = positions[indices[i*3 + 0]];
+        const glm::vec3 &b = positions[indices[i*3 + 1]];
+        const glm::vec3 &c = positions[indices[i*3 + 2]];
+
+        centroids[i] = (a + b + c) / 3.0f;
+        boxMin = glm::min(boxMin, centroids[i]);
+        boxMax = glm::max(boxMax, centroids[i]);
+    }
+
+    const glm::vec3 extent = glm::max(boxMax - boxMin, glm::vec3{1e-6f});
+
+    std::vector<std::uint32_t> codes(triangleCount);
+    for (size_t i = 0; i < triangleCount; i++) {
+        codes[i] = mortonCode((centroids[i] - boxMin) / extent);
+    }
+
+    std::vector<unsigned int> order(triangleCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&codes](const unsigned int a, const unsigned int b) {
+        return codes[a] < codes[b];
+    });
+
+    return order;
+}
+
+
+static void computeMeshletBounds(const glm::vec3 *positions, const unsigned int *indices, const Meshlet &meshlet, MeshletBounds &bounds) {
+    glm::vec3 boxMin = glm::vec3{ std::numeric_limits<float>::max()};
+    glm::vec3 boxMax = glm::vec3{-std::numeric_limits<float>::max()};
+
+    for (unsigned int i = 0; i < meshlet.indexCount; i++) {
+        const glm::vec3 &p = positions[indices[meshlet.indexOffset + i]];
+
+        boxMin = glm::min(boxMin, p);
+        boxMax = glm::max(boxMax, p);
+    }
+
+    const glm::vec3 center = (boxMin + boxMax) * 0.5f;
+    float radius = 0.0f;
+
+    for (unsigned int i = 0; i < meshlet.indexCount; i++) {
+        radius = std::max(radius, glm::distance(center, positions[indices[meshlet.indexOffset + i]]));
+    }
+
+    // the cone axis is the average of the triangle normals, and its aperture the widest deviation from it
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.indexCount / 3);
+
+    glm::vec3 normalSum = {0.0f, 0.0f, 0.0f};
+
+    for (unsigned int i = 0; i < meshlet.indexCount; i += 3) {
+        const glm::vec3 &a = positions[indices[meshlet.indexOffset + i + 0]];
+        const glm::vec3 &b = positions[indices[meshlet.indexOffset + i + 1]];
+        const glm::vec3 &c = positions[indices[meshlet.indexOffset + i + 2]];
+
+        const glm::vec3 n = glm::cross(b - a, c - a);
+        const float area = glm::length(n);
+
+        if (area <= 0.0f) {
+            continue;
+        }
+
+        normals.push_back(n / area);
+        normalSum += normals.back();
+    }
+
+    glm::vec3 axis = {0.0f, 0.0f, 0.0f};
+    float cutoff = 1.0f;
+
+    if (const float length = glm::length(normalSum); length > 0.0f) {
+        axis = normalSum / length;
+
+        float minDot = 1.0f;
+        for (const glm::vec3 &n : normals) {
+            minDot = std::min(minDot, glm::dot(n, axis));
+        }
+
+        // cones wider than ~85 degrees are practically never backfacing as a whole
+        if (minDot > 0.1f) {
+            cutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+    }
+
+    bounds.centerX.push_back(center.x);
+    bounds.centerY.push_back(center.y);
+    bounds.centerZ.push_back(center.z);
+    bounds.radius.push_back(radius);
+    bounds.coneAxisX.push_back(axis.x);
+    bounds.coneAxisY.push_back(axis.y);
+    bounds.coneAxisZ.push_back(axis.z);
+    bounds.coneCutoff.push_back(cutoff);
+}
+
+
+MeshletMesh buildMeshlets(const glm::vec3 *positions, const size_t vertexCount, const unsigned int *indices, const size_t indexCount, const MeshletBuildParams &params) {
+    assert(positions);
+    assert(indices);
+    assert(indexCount % 3 == 0);
+    assert(params.maxVertices >= 3);
+    assert(params.maxTriangles >= 1);
+
+    MeshletMesh result;
+
+    const size_t triangleCount = indexCount / 3;
+
+    if (triangleCount == 0) {
+        return result;
+    }
+
+    const std::vector<unsigned int> order = sortTrianglesSpatially(positions, indices, triangleCount);
+
+    result.indices.reserve(indexCount);
+
+    // vertexOwner[v] holds the (1-based) meshlet that last referenced v, so we don't have to clear a set per meshlet
+    std::vector<unsigned int> vertexOwner(vertexCount, 0);
+    unsigned int meshletVertexCount = 0;
+
+    // the morton curve jumps between distant regions now and then. cap the extent a meshlet may grow to,
+    // relative to the size a meshlet of average triangles would have
+    float edgeSum = 0.0f;
+    for (size_t i = 0; i < indexCount; i += 3) {
+        edgeSum += glm::distance(positions[indices[i]], positions[indices[i + 1]]);
+    }
+
+    const float maxExtent = MeshletExtentFactor * (edgeSum / triangleCount) * std::sqrt(float(params.maxTriangles));
+
+    Meshlet current;
+    glm::vec3 boxMin, boxMax;
+
+    for (const unsigned int triangle : order) {
+        const unsigned int *tri = &indices[triangle * 3];
+        unsigned int owner = static_cast<unsigned int>(result.meshlets.size()) + 1;
+
+        unsigned int newVertices = 0;
+        for (int k = 0; k < 3; k++) {
+            assert(tri[k] < vertexCount);
+
+            newVertices += vertexOwner[tri[k]] != owner ? 1 : 0;
+        }
+
+        const glm::vec3 triangleMin = glm::min(positions[tri[0]], glm::min(positions[tri[1]], positions[tri[2]]));
+        const glm::vec3 triangleMax = glm::max(positions[tri[0]], glm::max(positions[tri[1]], positions[tri[2]]));
+
+        const bool full = meshletVertexCount + newVertices > params.maxVertices || current.indexCount / 3 + 1 > params.maxTriangles;
+        const bool tooWide = current.indexCount > 0 && maxComponent(glm::max(boxMax, triangleMax) - glm::min(boxMin, triangleMin)) > maxExtent;
+
+        if (current.indexCount == 0) {
+            boxMin = triangleMin;
+            boxMax = triangleMax;
+        }
+        else if (full || tooWide) {
+            result.meshlets.push_back(current);
+
+            current.indexOffset += current.indexCount;
+            current.indexCount = 0;
+            meshletVertexCount = 0;
+            owner++;
+
+            boxMin = triangleMin;
+            boxMax = triangleMax;
+        }
+        else {
+            boxMin = glm::min(boxMin, triangleMin);
+            boxMax = glm::max(boxMax, triangleMax);
+        }
+
+        for (int k = 0; k < 3; k++) {
+            if (vertexOwner[tri[k]] != owner) {
+                vertexOwner[tri[k]] = owner;
+                meshletVertexCount++;
+            }
+
+            result.indices.push_back(tri[k]);
+        }
+
+        current.indexCount += 3;
+    }
+
+    if (current.indexCount > 0) {
+        result.meshlets.push_back(current);
+    }
+
+    for (const Meshlet &meshlet : result.meshlets) {
+        computeMeshletBounds(positions, result.indices.data(), meshlet, result.bounds);
+    }
+
+    return result;
+}
+
+
+static bool isMeshletVisible(const MeshletBounds &bounds, const size_t i, const MeshletCullParams &params) {
+    const glm::vec3 center = {bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]};
+    const float radius = bounds.radius[i];
+
+    if (! intersects(params.frustum, center, radius)) {
+        return false;
+    }
+
+    if (params.coneCulling) {
+        const glm::vec3 axis = {bounds.coneAxisX[i], bounds.coneAxisY[i], bounds.coneAxisZ[i]};
+        const glm::vec3 view = center - params.cameraPosition;
+
+        if (glm::dot(view, axis) >= bounds.coneCutoff[i] * glm::length(view) + radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+size_t cullMeshlets(const MeshletBounds &bounds, const MeshletCullParams &params, std::vector<std::uint8_t> &visibility) {
+    const size_t count = bounds.size();
+
+    visibility.resize(count);
+
+    size_t visibleCount = 0;
+    size_t i = 0;
+
+#if defined(MESHLET_USE_SSE)
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+
+    for (int p = 0; p < 6; p++) {
+        planeX[p] = _mm_set1_ps(params.frustum.planes[p].x);
+        planeY[p] = _mm_set1_ps(params.frustum.planes[p].y);
+        planeZ[p] = _mm_set1_ps(params.frustum.planes[p].z);
+        planeW[p] = _mm_set1_ps(params.frustum.planes[p].w);
+    }
+
+    const __m128 cameraX = _mm_set1_ps(params.cameraPosition.x);
+    const __m128 cameraY = _mm_set1_ps(params.cameraPosition.y);
+    const __m128 cameraZ = _mm_set1_ps(params.cameraPosition.z);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= count; i += 4) {
+        const __m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+        const __m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+        const __m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+        const __m128 r = _mm_loadu_ps(&bounds.radius[i]);
+        const __m128 negR = _mm_sub_ps(zero, r);
+
+        // visible while the signed distance to every plane is >= -radius
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (int p = 0; p < 6; p++) {
+            __m128 d = _mm_add_ps(_mm_mul_ps(planeX[p], cx), planeW[p]);
+            d = _mm_add_ps(d, _mm_mul_ps(planeY[p], cy));
+            d = _mm_add_ps(d, _mm_mul_ps(planeZ[p], cz));
+
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(d, negR));
+        }
+
+        if (params.coneCulling) {
+            const __m128 vx = _mm_sub_ps(cx, cameraX);
+            const __m128 vy = _mm_sub_ps(cy, cameraY);
+            const __m128 vz = _mm_sub_ps(cz, cameraZ);
+
+            const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+
+            __m128 dp = _mm_mul_ps(vx, _mm_loadu_ps(&bounds.coneAxisX[i]));
+            dp = _mm_add_ps(dp, _mm_mul_ps(vy, _mm_loadu_ps(&bounds.coneAxisY[i])));
+            dp = _mm_add_ps(dp, _mm_mul_ps(vz, _mm_loadu_ps(&bounds.coneAxisZ[i])));
+
+            const __m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&bounds.coneCutoff[i]), length), r);
+
+            visible = _mm_andnot_ps(_mm_cmpge_ps(dp, limit), visible);
+        }
+
+        const int mask = _mm_movemask_ps(visible);
+
+        for (int k = 0; k < 4; k++) {
+            visibility[i + k] = (mask >> k) & 1;
+        }
+
+        visibleCount += ((mask >> 0) & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+    }
+#endif
+
+    for (; i < count; i++) {
+        visibility[i] = isMeshletVisible(bounds, i, params) ? 1 : 0;
+        visibleCount += visibility[i];
+    }
+
+    return visibleCount;
+}
+
+
+void buildMeshletRanges(const std::vector<Meshlet> &meshlets, const std::vector<std::uint8_t> &visibility, std::vector<MeshletRange> &ranges) {
+    assert(meshlets.size() == visibility.size());
+
+    ranges.clear();
+
+    for (size_t i = 0; i < meshlets.size(); i++) {
+        if (! visibility[i]) {
+            continue;
+        }
+
+        const Meshlet &meshlet = meshlets[i];
+
+        if (!ranges.empty() && ranges.back().indexOffset + ranges.back().indexCount == meshlet.indexOffset) {
+            ranges.back().indexCount += meshlet.indexCount;
+        }
+        else {
+            ranges.push_back({meshlet.indexOffset, meshlet.indexCount});
+        }
+    }
+}
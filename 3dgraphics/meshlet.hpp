@@ -0,0 +1,76 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "frustum.hpp"
+
+
+struct MeshletBuildParams {
+    unsigned int maxVertices = 64;
+    unsigned int maxTriangles = 124;
+};
+
+
+// a contiguous range of triangles inside the (reordered) index buffer of a mesh
+struct Meshlet {
+    unsigned int indexOffset = 0;
+    unsigned int indexCount = 0;
+};
+
+
+// culling data for all the meshlets of a mesh, stored as SoA so it can be tested four at a time
+struct MeshletBounds {
+    // bounding sphere
+    std::vector<float> centerX, centerY, centerZ, radius;
+
+    // normal cone. coneCutoff is the sine of the cone half angle, or 1 when the cone is too wide to be culled
+    std::vector<float> coneAxisX, coneAxisY, coneAxisZ, coneCutoff;
+
+    size_t size() const {
+        return radius.size();
+    }
+};
+
+
+struct MeshletMesh {
+    std::vector<Meshlet> meshlets;
+    MeshletBounds bounds;
+
+    // the triangle list of the mesh, reordered so each meshlet is contiguous
+    std::vector<unsigned int> indices;
+
+    bool empty() const {
+        return meshlets.empty();
+    }
+};
+
+
+struct MeshletCullParams {
+    // frustum and camera position, both expressed in the local space of the mesh
+    Frustum frustum;
+    glm::vec3 cameraPosition = {0.0f, 0.0f, 0.0f};
+
+    // backface cone culling is only valid for meshes drawn with GL_CULL_FACE enabled
+    bool coneCulling = false;
+};
+
+
+// a range of indices, in the index buffer built by buildMeshlets, that can be drawn with a single call
+struct MeshletRange {
+    unsigned int indexOffset = 0;
+    unsigned int indexCount = 0;
+};
+
+
+// splits a triangle list into clusters of spatially close triangles
+MeshletMesh buildMeshlets(const glm::vec3 *positions, size_t vertexCount, const unsigned int *indices, size_t indexCount, const MeshletBuildParams &params = {});
+
+// writes 1 to visibility[i] for each meshlet that passes the frustum and cone tests, 0 otherwise. returns the number of visible meshlets
+size_t cullMeshlets(const MeshletBounds &bounds, const MeshletCullParams &params, std::vector<std::uint8_t> &visibility);
+
+// collects the visible meshlets into index ranges, merging meshlets that are adjacent in the index buffer
+void buildMeshletRanges(const std::vector<Meshlet> &meshlets, const std::vector<std::uint8_t> &visibility, std::vector<MeshletRange> &ranges);
@@ -0,0 +1,35 @@
+
+#include "parse_utils.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+
+
+bool parseCount(const std::string &text, size_t &count) {
+    const char *end = text.data() + text.size();
+    const auto result = std::from_chars(text.data(), end, count);
+
+    return !text.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+
+bool parseNumber(const std::string &text, float &number) {
+    char *end = nullptr;
+    number = std::strtof(text.c_str(), &end);
+
+    return end != text.c_str() && *end == '\0' && std::isfinite(number);
+}
+
+
+bool parseNumber(const std::string &text, double &number) {
+    char *end = nullptr;
+    number = std::strtod(text.c_str(), &end);
+
+    return end != text.c_str() && *end == '\0' && std::isfinite(number);
+}
+
+
+bool parseEpsilon(const std::string &text, float &epsilon) {
+    return parseNumber(text, epsilon) && epsilon >= 0.0f;
+}
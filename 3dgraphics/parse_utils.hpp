@@ -0,0 +1,17 @@
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+
+// the whole argument as a decimal count. signs, spaces and trailing characters are rejected
+bool parseCount(const std::string &text, size_t &count);
+
+// the whole argument as a finite number. trailing characters, nan and the infinities are rejected
+bool parseNumber(const std::string &text, float &number);
+
+bool parseNumber(const std::string &text, double &number);
+
+// a finite number not below zero, for the tolerances of the weld
+bool parseEpsilon(const std::string &text, float &epsilon);
@@ -0,0 +1,84 @@
+
+#include "path_utils.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+
+
+void split(const std::string_view str, const std::string_view delimiter, std::vector<std::string_view> &tokens) {
+    tokens.clear();
+
+    split(str, delimiter, [&tokens](const std::string_view token) {
+        tokens.push_back(token);
+    });
+}
+
+
+void join(const std::vector<std::string_view> &elements, const std::string_view delimiter, std::string &out) {
+    bool first = true;
+
+    for (const std::string_view element : elements) {
+        if (element.empty()) {
+            continue;
+        }
+
+        if (! first) {
+            out.append(delimiter);
+        }
+
+        out.append(element);
+        first = false;
+    }
+}
+
+
+void replace_all(const std::string_view str, const std::string_view search, const std::string_view replace, std::string &out) {
+    assert(!search.empty());
+
+    out.clear();
+
+    size_t begin = 0;
+    size_t pos = 0;
+
+    // each search starts where the previous match ended, so the whole string is scanned once
+    while ((pos = str.find(search, begin)) != std::string_view::npos) {
+        out.append(str.substr(begin, pos - begin));
+        out.append(replace);
+
+        begin = pos + search.size();
+    }
+
+    out.append(str.substr(begin));
+}
+
+
+std::string_view parent_path(const std::string_view path) {
+    const size_t pos = path.find_last_of("/\\");
+
+    if (pos == std::string_view::npos) {
+        return {};
+    }
+
+    return path.substr(0, pos + 1);
+}
+
+
+std::string_view file_name(const std::string_view path) {
+    const size_t pos = path.find_last_of("/\\");
+
+    if (pos == std::string_view::npos) {
+        return path;
+    }
+
+    return path.substr(pos + 1);
+}
+
+
+std::string normalize_path(const std::string_view path) {
+    std::string str{path};
+
+    std::replace(str.begin(), str.end(), '\\', '/');
+
+    return std::filesystem::path{str}.lexically_normal().generic_string();
+}
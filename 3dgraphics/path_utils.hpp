@@ -0,0 +1,44 @@
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// calls visitor(token) for each delimiter separated token of str, left to right. the tokens are views into str
+template<typename Visitor>
+void split(std::string_view str, const std::string_view delimiter, Visitor &&visitor) {
+    size_t begin = 0;
+
+    while (true) {
+        const size_t end = str.find(delimiter, begin);
+
+        if (end == std::string_view::npos) {
+            visitor(str.substr(begin));
+            return;
+        }
+
+        visitor(str.substr(begin, end - begin));
+        begin = end + delimiter.size();
+    }
+}
+
+
+// same as above, but collects the tokens into a (reusable) vector
+void split(std::string_view str, std::string_view delimiter, std::vector<std::string_view> &tokens);
+
+// appends the non empty elements to out, separated by delimiter
+void join(const std::vector<std::string_view> &elements, std::string_view delimiter, std::string &out);
+
+// writes str to out, with every occurrence of search replaced. out is cleared first, but its capacity is reused
+void replace_all(std::string_view str, std::string_view search, std::string_view replace, std::string &out);
+
+// the directory part of a path, including its trailing separator. empty for bare file names
+std::string_view parent_path(std::string_view path);
+
+// the part of a path after its last separator
+std::string_view file_name(std::string_view path);
+
+// converts the separators to '/' and removes the redundant '.', '..' and repeated separators
+std::string normalize_path(std::string_view path);
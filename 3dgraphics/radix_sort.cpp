@@ -0,0 +1,100 @@
+
+#include "radix_sort.hpp"
+
+#include <algorithm>
+
+#include "thread_pool.hpp"
+
+
+const unsigned int DigitBits = 8;
+const unsigned int DigitCount = 1 << DigitBits;
+
+// smaller chunks cost more to count and schedule than they save
+const size_t MinChunkSize = 4096;
+
+
+void RadixSorter::sort(std::vector<std::uint32_t> &keys, std::vector<std::uint32_t> &values, ThreadPool *threadPool) {
+    const size_t count = keys.size();
+
+    if (count < 2) {
+        return;
+    }
+
+    const size_t threadCount = threadPool ? threadPool->getThreadCount() + 1 : 1;
+    const size_t chunkCount = std::max<size_t>(1, std::min(count / MinChunkSize, 4 * threadCount));
+    const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+    scratchKeys.resize(count);
+    scratchValues.resize(count);
+    offsets.resize(chunkCount * DigitCount);
+
+    const auto forEachChunk = [&](const auto &task) {
+        if (threadPool && chunkCount > 1) {
+            threadPool->parallelFor(chunkCount, task);
+        }
+        else {
+            for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+                task(chunk);
+            }
+        }
+    };
+
+    std::uint32_t *sourceKeys = keys.data();
+    std::uint32_t *sourceValues = values.data();
+    std::uint32_t *targetKeys = scratchKeys.data();
+    std::uint32_t *targetValues = scratchValues.data();
+
+    for (unsigned int shift = 0; shift < 32; shift += DigitBits) {
+        forEachChunk([&](const size_t chunk) {
+            std::uint32_t *counts = &offsets[chunk * DigitCount];
+            std::fill(counts, counts + DigitCount, 0);
+
+            for (size_t i = chunk * chunkSize; i < std::min(count, (chunk + 1) * chunkSize); i++) {
+                counts[(sourceKeys[i] >> shift) & (DigitCount - 1)]++;
+            }
+        });
+
+        // the digits in order, and the chunks in order within each digit
+        std::uint32_t offset = 0;
+        bool sharedDigit = false;
+
+        for (unsigned int digit = 0; digit < DigitCount; digit++) {
+            std::uint32_t digitCount = 0;
+
+            for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+                std::uint32_t &chunkOffset = offsets[chunk * DigitCount + digit];
+                const std::uint32_t chunkDigitCount = chunkOffset;
+
+                chunkOffset = offset + digitCount;
+                digitCount += chunkDigitCount;
+            }
+
+            sharedDigit = sharedDigit || digitCount == count;
+            offset += digitCount;
+        }
+
+        if (sharedDigit) {
+            continue;
+        }
+
+        forEachChunk([&](const size_t chunk) {
+            std::uint32_t *chunkOffsets = &offsets[chunk * DigitCount];
+
+            for (size_t i = chunk * chunkSize; i < std::min(count, (chunk + 1) * chunkSize); i++) {
+                const std::uint32_t target = chunkOffsets[(sourceKeys[i] >> shift) & (DigitCount - 1)]++;
+
+                targetKeys[target] = sourceKeys[i];
+                targetValues[target] = sourceValues[i];
+            }
+        });
+
+        std::swap(sourceKeys, targetKeys);
+        std::swap(sourceValues, targetValues);
+    }
+
+    // an odd number of scatters leaves the result in the scratch storage
+    if (sourceKeys != keys.data()) {
+        keys.swap(scratchKeys);
+        values.swap(scratchValues);
+    }
+}
@@ -0,0 +1,36 @@
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+class ThreadPool;
+
+
+// an unsigned key in the same order as the float, for every value but NaN
+inline std::uint32_t toSortableKey(const float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    // the negative values in reverse, below the positive ones
+    return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+
+
+// Least significant digit radix sort of 32 bit keys with a value each, in passes of 8 bits. Every pass counts
+// the digits of contiguous chunks in parallel, and scatters the chunks in parallel to the offsets their counts
+// give, so the sort is stable and its result doesn't depend on the thread count. The passes over a digit that
+// all the keys share are skipped. The scratch storage is kept between sorts.
+class RadixSorter {
+public:
+    // sorts the keys in increasing order, and the values along with them. the pool may be null
+    void sort(std::vector<std::uint32_t> &keys, std::vector<std::uint32_t> &values, ThreadPool *threadPool);
+
+private:
+    std::vector<std::uint32_t> scratchKeys;
+    std::vector<std::uint32_t> scratchValues;
+
+    // digit counts of every chunk, turned into their scatter offsets
+    std::vector<std::uint32_t> offsets;
+};
@@ -0,0 +1,389 @@
+
+// renders a scene readable by Assimp with the software rasterizer, or the ray tracer, for machines without a GPU.
+// the camera orbits around the scene for the requested frames, the throughput is reported in triangles or rays and
+// frames per second, and the last frame can be written as a binary PPM image.
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <il.h>
+#include <ilu.h>
+
+#include "parse_utils.hpp"
+#include "path_utils.hpp"
+#include "ray_tracer.hpp"
+#include "scene_arena.hpp"
+#include "software_rasterizer.hpp"
+#include "texture_resolver.hpp"
+#include "thread_pool.hpp"
+#include "vertex_weld.hpp"
+
+
+// the import flags of 3dgraphics, without the bones
+const unsigned int ImportFlags = aiProcess_Triangulate | aiProcess_GenNormals;
+
+
+struct Options {
+    std::string sceneFilePath;
+    std::string outputPath;
+
+    unsigned int width = 1280;
+    unsigned int height = 720;
+    unsigned int frames = 60;
+
+    // zero for one per hardware thread
+    unsigned int threads = 0;
+
+    bool cullBackFaces = false;
+    bool rayTrace = false;
+};
+
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    // a count that fits an int, the thread pool takes one
+    const auto parse = [](const char *text, unsigned int &value) {
+        size_t count = 0;
+
+        if (!parseCount(text, count) || count > size_t(std::numeric_limits<int>::max())) {
+            return false;
+        }
+
+        value = static_cast<unsigned int>(count);
+
+        return true;
+    };
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        if (arg == "--size" && i + 2 < argc) {
+            if (!parse(argv[++i], options.width) || !parse(argv[++i], options.height)) {
+                return false;
+            }
+        }
+        else if (arg == "--frames" && i + 1 < argc) {
+            if (!parse(argv[++i], options.frames)) {
+                return false;
+            }
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            if (!parse(argv[++i], options.threads)) {
+                return false;
+            }
+        }
+        else if (arg == "--output" && i + 1 < argc) {
+            options.outputPath = argv[++i];
+        }
+        else if (arg == "--cull") {
+            options.cullBackFaces = true;
+        }
+        else if (arg == "--ray-trace") {
+            options.rayTrace = true;
+        }
+        else if (options.sceneFilePath.empty()) {
+            options.sceneFilePath = arg;
+        }
+        else {
+            return false;
+        }
+    }
+
+    // the ray tracer hits both sides of the triangles
+    if (options.cullBackFaces && options.rayTrace) {
+        std::cout << "--cull only applies to the rasterizer, not to --ray-trace" << std::endl;
+        return false;
+    }
+
+    return !options.sceneFilePath.empty() && options.width > 0 && options.height > 0 && options.frames > 0;
+}
+
+
+// decodes an image with the same orientation as the GL textures of 3dgraphics. -1 when it can't be decoded
+int loadTexture(const std::string &filePath, SoftScene &scene) {
+    ILuint imageID;
+
+    ilGenImages(1, &imageID);
+    ilBindImage(imageID);
+
+    if (! ilLoadImage(filePath.c_str()) || ! ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE)) {
+        const ILenum error = ilGetError();
+        std::cout << "Image load failed: \"" << filePath << "\" - IL reports error: " << error << " - " << iluErrorString(error) << std::endl;
+
+        ilDeleteImages(1, &imageID);
+
+        return -1;
+    }
+
+    iluFlipImage();
+
+    scene.textures.push_back(createSoftTexture(ilGetInteger(IL_IMAGE_WIDTH), ilGetInteger(IL_IMAGE_HEIGHT), 4, ilGetData()));
+
+    ilDeleteImages(1, &imageID);
+
+    return int(scene.textures.size() - 1);
+}
+
+
+SoftMaterial convertMaterial(TextureResolver &textureResolver, std::map<std::string, int> &textures, SoftScene &scene, const aiMaterial *aimaterial) {
+    SoftMaterial material;
+
+    aiColor3D colorAmbient, colorDiffuse;
+    aiColor4D baseColor;
+
+    aimaterial->Get(AI_MATKEY_COLOR_AMBIENT, colorAmbient);
+    aimaterial->Get(AI_MATKEY_COLOR_DIFFUSE, colorDiffuse);
+
+    material.ambient = glm::vec4{colorAmbient.r, colorAmbient.g, colorAmbient.b, 1.0f};
+    material.diffuse = glm::vec4{colorDiffuse.r, colorDiffuse.g, colorDiffuse.b, 1.0f};
+
+    if (aimaterial->Get(AI_MATKEY_BASE_COLOR, baseColor) == AI_SUCCESS) {
+        material.diffuse = glm::vec4{baseColor.r, baseColor.g, baseColor.b, baseColor.a};
+    }
+
+    for (const aiTextureType type : {aiTextureType_DIFFUSE, aiTextureType_BASE_COLOR}) {
+        aiString fileName;
+        aimaterial->GetTexture(type, 0, &fileName);
+
+        const std::string &filePath = fileName.length > 0 ? textureResolver.resolve(fileName.C_Str()) : std::string{};
+
+        if (filePath.empty()) {
+            continue;
+        }
+
+        const auto cached = textures.find(filePath);
+
+        material.diffuseTexture = cached != textures.end() ? cached->second : (textures[filePath] = loadTexture(filePath, scene));
+
+        break;
+    }
+
+    return material;
+}
+
+
+SoftMesh convertMesh(const aiMesh *aimesh) {
+    SoftMesh mesh;
+
+    mesh.material = int(aimesh->mMaterialIndex);
+    mesh.positions.resize(aimesh->mNumVertices);
+
+    for (unsigned int i = 0; i < aimesh->mNumVertices; i++) {
+        mesh.positions[i] = {aimesh->mVertices[i].x, aimesh->mVertices[i].y, aimesh->mVertices[i].z};
+    }
+
+    if (aimesh->mNormals) {
+        mesh.normals.resize(aimesh->mNumVertices);
+
+        for (unsigned int i = 0; i < aimesh->mNumVertices; i++) {
+            mesh.normals[i] = {aimesh->mNormals[i].x, aimesh->mNormals[i].y, aimesh->mNormals[i].z};
+        }
+    }
+
+    if (aimesh->mTextureCoords[0]) {
+        mesh.texCoords.resize(aimesh->mNumVertices);
+
+        for (unsigned int i = 0; i < aimesh->mNumVertices; i++) {
+            mesh.texCoords[i] = {aimesh->mTextureCoords[0][i].x, aimesh->mTextureCoords[0][i].y};
+        }
+    }
+
+    // the points and lines left by the triangulation aren't drawn
+    for (unsigned int i = 0; i < aimesh->mNumFaces; i++) {
+        const aiFace &face = aimesh->mFaces[i];
+
+        if (face.mNumIndices == 3) {
+            mesh.indices.insert(mesh.indices.end(), face.mIndices, face.mIndices + 3);
+        }
+    }
+
+    return mesh;
+}
+
+
+SoftScene convertScene(const std::string &filePath, const aiScene *aiscene) {
+    SoftScene scene;
+
+    TextureResolver textureResolver {parent_path(filePath)};
+    std::map<std::string, int> textures;
+
+    for (unsigned int i = 0; i < aiscene->mNumMaterials; i++) {
+        scene.materials.push_back(convertMaterial(textureResolver, textures, scene, aiscene->mMaterials[i]));
+    }
+
+    for (unsigned int i = 0; i < aiscene->mNumMeshes; i++) {
+        scene.meshes.push_back(convertMesh(aiscene->mMeshes[i]));
+    }
+
+    // the same node transforms as the GL renderer, without animation
+    const SceneArena sceneArena {aiscene};
+
+    for (std::uint32_t i = 0; i < sceneArena.getMeshNodeCount(); i++) {
+        const std::uint32_t node = sceneArena.getMeshNodes()[i];
+        const std::uint32_t *meshes = sceneArena.getMeshInstances(node);
+
+        for (std::uint32_t j = 0; j < sceneArena.getNode(node).instanceCount; j++) {
+            scene.instances.push_back({meshes[j], sceneArena.getWorldTransform(node)});
+        }
+    }
+
+    return scene;
+}
+
+
+// world space bounding sphere of the instances
+void computeBounds(const SoftScene &scene, glm::vec3 &center, float &radius) {
+    glm::vec3 minimum {std::numeric_limits<float>::max()};
+    glm::vec3 maximum {std::numeric_limits<float>::lowest()};
+
+    for (const SoftInstance &instance : scene.instances) {
+        for (const glm::vec3 &position : scene.meshes[instance.mesh].positions) {
+            const glm::vec3 world = instance.model * glm::vec4{position, 1.0f};
+
+            minimum = glm::min(minimum, world);
+            maximum = glm::max(maximum, world);
+        }
+    }
+
+    center = 0.5f * (minimum + maximum);
+    radius = std::max(0.5f * glm::length(maximum - minimum), 1e-3f);
+}
+
+
+bool writePpm(const std::string &filePath, const SoftFramebuffer &framebuffer) {
+    std::ofstream file {filePath, std::ios::binary};
+
+    if (!file) {
+        return false;
+    }
+
+    file << "P6\n" << framebuffer.width << " " << framebuffer.height << "\n255\n";
+
+    for (const std::uint32_t color : framebuffer.color) {
+        const char rgb[3] = {char(color & 0xFF), char((color >> 8) & 0xFF), char((color >> 16) & 0xFF)};
+
+        file.write(rgb, 3);
+    }
+
+    return bool(file);
+}
+
+
+int main(int argc, char **argv) {
+    Options options;
+
+    if (!parseOptions(argc, argv, options)) {
+        std::cout << "usage: 3dgraphics-raster <scene file> [--size <width> <height>] [--frames <count>] [--threads <count>] [--cull] [--ray-trace] [--output <image.ppm>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    ilInit();
+    iluInit();
+
+    // the calling thread takes part in the work, the pool has the rest
+    ThreadPool threadPool {int(options.threads) - 1};
+
+    Assimp::Importer importer;
+    const aiScene *aiscene = importer.ReadFile(options.sceneFilePath, ImportFlags);
+
+    if (!aiscene) {
+        std::cout << importer.GetErrorString() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    weldVertices(const_cast<aiScene*>(aiscene), WeldParams{}, &threadPool);
+
+    const SoftScene scene = convertScene(options.sceneFilePath, aiscene);
+
+    importer.FreeScene();
+
+    glm::vec3 center;
+    float radius;
+    computeBounds(scene, center, radius);
+
+    SoftFramebuffer framebuffer;
+    framebuffer.resize(options.width, options.height);
+
+    const glm::mat4 proj = glm::perspective(glm::radians(45.0f), float(options.width) / float(options.height), 0.01f * radius, 10.0f * radius);
+    const SoftLight light;
+
+    const auto getView = [&](const unsigned int frame) {
+        const float angle = 2.0f * glm::pi<float>() * float(frame) / float(options.frames);
+        const glm::vec3 eye = center + 2.5f * radius * glm::vec3{std::sin(angle), 0.4f, std::cos(angle)};
+
+        return glm::lookAt(eye, center, glm::vec3{0.0f, 1.0f, 0.0f});
+    };
+
+    if (options.rayTrace) {
+        RayTracer rayTracer {threadPool};
+
+        const auto buildStart = std::chrono::steady_clock::now();
+        rayTracer.build(scene);
+        const auto buildEnd = std::chrono::steady_clock::now();
+
+        std::cout << "BVH of " << rayTracer.getBvh().getTriangleCount() << " triangles and " << rayTracer.getBvh().getNodeCount() << " nodes built in "
+            << std::chrono::duration<double, std::milli>(buildEnd - buildStart).count() << " ms" << std::endl;
+
+        size_t rays = 0;
+        double milliseconds = 0.0;
+
+        for (unsigned int frame = 1; frame <= options.frames; frame++) {
+            const auto start = std::chrono::steady_clock::now();
+            const RayTracerStats stats = rayTracer.render(getView(frame), proj, light, framebuffer);
+            const auto end = std::chrono::steady_clock::now();
+
+            rays += stats.primaryRays + stats.shadowRays;
+            milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+
+        std::cout << options.frames << " frames at " << options.width << "x" << options.height
+            << " on " << threadPool.getThreadCount() + 1 << " threads: "
+            << milliseconds / options.frames << " ms/frame, "
+            << 1000.0 * options.frames / milliseconds << " frames/s, "
+            << rays / (1000.0 * milliseconds) << " Mrays/s" << std::endl;
+    }
+    else {
+        SoftRasterParams params;
+        params.cullBackFaces = options.cullBackFaces;
+
+        SoftwareRasterizer rasterizer {threadPool, params};
+
+        size_t triangles = 0;
+        double milliseconds = 0.0;
+
+        for (unsigned int frame = 0; frame <= options.frames; frame++) {
+            const auto start = std::chrono::steady_clock::now();
+            const SoftRasterStats stats = rasterizer.render(scene, getView(frame), proj, light, framebuffer);
+            const auto end = std::chrono::steady_clock::now();
+
+            // the first frame allocates the bins, it isn't measured
+            if (frame > 0) {
+                triangles += stats.trianglesSubmitted;
+                milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+            }
+        }
+
+        std::cout << options.frames << " frames of " << triangles / options.frames << " triangles at " << options.width << "x" << options.height
+            << " on " << threadPool.getThreadCount() + 1 << " threads: "
+            << milliseconds / options.frames << " ms/frame, "
+            << 1000.0 * options.frames / milliseconds << " frames/s, "
+            << triangles / (1000.0 * milliseconds) << " Mtriangles/s" << std::endl;
+    }
+
+    if (!options.outputPath.empty() && !writePpm(options.outputPath, framebuffer)) {
+        std::cout << "Can't write " << options.outputPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,234 @@
+
+#include "ray_tracer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+#include "thread_pool.hpp"
+
+
+// work of a single task when flattening the instances
+const std::uint32_t FlattenBatchSize = 4096;
+
+
+RayTracer::RayTracer(ThreadPool &threadPool, const RayTracerParams &params) : threadPool(threadPool), params(params) {}
+
+
+void RayTracer::build(const SoftScene &scene) {
+    this->scene = &scene;
+
+    struct Batch {
+        std::uint32_t instance;
+        std::uint32_t first;
+        std::uint32_t count;
+    };
+
+    std::vector<size_t> vertexOffsets(scene.instances.size()), triangleOffsets(scene.instances.size());
+    std::vector<Batch> vertexBatches, triangleBatches;
+    size_t vertexCount = 0, triangleCount = 0;
+
+    for (std::uint32_t i = 0; i < scene.instances.size(); i++) {
+        const SoftMesh &mesh = scene.meshes[scene.instances[i].mesh];
+        const auto meshVertexCount = std::uint32_t(mesh.positions.size());
+        const auto meshTriangleCount = std::uint32_t(mesh.indices.size() / 3);
+
+        vertexOffsets[i] = vertexCount;
+        triangleOffsets[i] = triangleCount;
+        vertexCount += meshVertexCount;
+        triangleCount += meshTriangleCount;
+
+        for (std::uint32_t first = 0; first < meshVertexCount; first += FlattenBatchSize) {
+            vertexBatches.push_back({i, first, std::min(FlattenBatchSize, meshVertexCount - first)});
+        }
+
+        for (std::uint32_t first = 0; first < meshTriangleCount; first += FlattenBatchSize) {
+            triangleBatches.push_back({i, first, std::min(FlattenBatchSize, meshTriangleCount - first)});
+        }
+    }
+
+    positions.resize(vertexCount);
+    normals.resize(vertexCount);
+    texCoords.resize(vertexCount);
+    triangles.resize(triangleCount);
+
+    std::vector<glm::vec3> corners(3 * triangleCount);
+
+    // to world space. the missing normals and texture coordinates are zero
+    threadPool.parallelFor(vertexBatches.size(), [&](const size_t b) {
+        const Batch &batch = vertexBatches[b];
+        const SoftInstance &instance = scene.instances[batch.instance];
+        const SoftMesh &mesh = scene.meshes[instance.mesh];
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3{instance.model}));
+        const size_t offset = vertexOffsets[batch.instance];
+
+        for (std::uint32_t i = batch.first; i < batch.first + batch.count; i++) {
+            positions[offset + i] = instance.model * glm::vec4{mesh.positions[i], 1.0f};
+
+            if (mesh.normals.empty()) {
+                normals[offset + i] = glm::vec3{0.0f};
+            }
+            else {
+                const glm::vec3 normal = normalMatrix * mesh.normals[i];
+                const float length = glm::length(normal);
+
+                normals[offset + i] = length > 0.0f ? normal / length : glm::vec3{0.0f};
+            }
+
+            texCoords[offset + i] = mesh.texCoords.empty() ? glm::vec2{0.0f} : mesh.texCoords[i];
+        }
+    });
+
+    threadPool.parallelFor(triangleBatches.size(), [&](const size_t b) {
+        const Batch &batch = triangleBatches[b];
+        const SoftMesh &mesh = scene.meshes[scene.instances[batch.instance].mesh];
+        const size_t vertexOffset = vertexOffsets[batch.instance];
+        const size_t triangleOffset = triangleOffsets[batch.instance];
+
+        for (std::uint32_t i = batch.first; i < batch.first + batch.count; i++) {
+            Triangle &triangle = triangles[triangleOffset + i];
+            triangle.material = mesh.material;
+
+            for (int k = 0; k < 3; k++) {
+                triangle.vertices[k] = std::uint32_t(vertexOffset + mesh.indices[3 * size_t(i) + k]);
+                corners[3 * (triangleOffset + i) + k] = positions[triangle.vertices[k]];
+            }
+
+            const glm::vec3 &p0 = positions[triangle.vertices[0]];
+            const glm::vec2 &t0 = texCoords[triangle.vertices[0]];
+            const float worldArea = glm::length(glm::cross(positions[triangle.vertices[1]] - p0, positions[triangle.vertices[2]] - p0));
+
+            const glm::vec2 t1 = texCoords[triangle.vertices[1]] - t0, t2 = texCoords[triangle.vertices[2]] - t0;
+            const float texCoordArea = std::abs(t1.x * t2.y - t1.y * t2.x);
+
+            triangle.texCoordScale = worldArea > 0.0f ? std::sqrt(texCoordArea / worldArea) : 0.0f;
+        }
+    });
+
+    bvh.build(corners, &threadPool);
+
+    // the shadow rays start off the surface by a fraction of the scene size
+    glm::vec3 minimum {std::numeric_limits<float>::max()}, maximum {std::numeric_limits<float>::lowest()};
+
+    for (const glm::vec3 &position : positions) {
+        minimum = glm::min(minimum, position);
+        maximum = glm::max(maximum, position);
+    }
+
+    shadowBias = positions.empty() ? 1e-4f : std::max(1e-4f * glm::length(maximum - minimum), 1e-6f);
+}
+
+
+RayTracerStats RayTracer::render(const glm::mat4 &view, const glm::mat4 &proj, const SoftLight &light, SoftFramebuffer &framebuffer) const {
+    // the camera frame is the transpose of the rotation of the view matrix
+    Camera camera;
+    camera.right = {view[0][0], view[1][0], view[2][0]};
+    camera.up = {view[0][1], view[1][1], view[2][1]};
+    camera.forward = -glm::vec3{view[0][2], view[1][2], view[2][2]};
+    camera.position = -(camera.right * view[3][0] + camera.up * view[3][1] - camera.forward * view[3][2]);
+    camera.viewProj = proj * view;
+    camera.tanHalfWidth = 1.0f / proj[0][0];
+    camera.tanHalfHeight = 1.0f / proj[1][1];
+    camera.pixelAngle = 2.0f * camera.tanHalfHeight / float(framebuffer.height);
+
+    const unsigned int tilesX = (framebuffer.width + params.tileSize - 1) / params.tileSize;
+    const unsigned int tilesY = (framebuffer.height + params.tileSize - 1) / params.tileSize;
+
+    std::atomic<size_t> shadowRays {0};
+
+    threadPool.parallelFor(size_t(tilesX) * tilesY, [&](const size_t tile) {
+        const unsigned int minX = unsigned(tile % tilesX) * params.tileSize;
+        const unsigned int minY = unsigned(tile / tilesX) * params.tileSize;
+        const unsigned int maxX = std::min(minX + params.tileSize, framebuffer.width);
+        const unsigned int maxY = std::min(minY + params.tileSize, framebuffer.height);
+
+        size_t tileShadowRays = 0;
+
+        for (unsigned int y = minY; y < maxY; y++) {
+            const float ndcY = 1.0f - 2.0f * (float(y) + 0.5f) / float(framebuffer.height);
+
+            for (unsigned int x = minX; x < maxX; x++) {
+                const float ndcX = 2.0f * (float(x) + 0.5f) / float(framebuffer.width) - 1.0f;
+                const glm::vec3 direction = glm::normalize(camera.forward + camera.right * (ndcX * camera.tanHalfWidth) + camera.up * (ndcY * camera.tanHalfHeight));
+                const size_t pixel = size_t(y) * framebuffer.width + x;
+
+                framebuffer.color[pixel] = tracePixel(camera, light, direction, framebuffer.depth[pixel], tileShadowRays);
+            }
+        }
+
+        shadowRays += tileShadowRays;
+    });
+
+    RayTracerStats stats;
+    stats.primaryRays = size_t(framebuffer.width) * framebuffer.height;
+    stats.shadowRays = shadowRays;
+
+    return stats;
+}
+
+
+std::uint32_t RayTracer::tracePixel(const Camera &camera, const SoftLight &light, const glm::vec3 &direction, float &depth, size_t &shadowRays) const {
+    BvhHit hit;
+
+    if (!bvh.intersect(camera.position, direction, FLT_MAX, hit)) {
+        depth = 1.0f;
+        return params.clearColor;
+    }
+
+    const Triangle &triangle = triangles[hit.triangle];
+    const std::uint32_t i0 = triangle.vertices[0], i1 = triangle.vertices[1], i2 = triangle.vertices[2];
+    const float w = 1.0f - hit.u - hit.v;
+
+    const glm::vec3 point = camera.position + direction * hit.distance;
+    const glm::vec4 clip = camera.viewProj * glm::vec4{point, 1.0f};
+    depth = clip.z / clip.w * 0.5f + 0.5f;
+
+    // both sides are lit, as the rasterizers draw them
+    glm::vec3 geometricNormal = glm::normalize(glm::cross(positions[i1] - positions[i0], positions[i2] - positions[i0]));
+    glm::vec3 normal = normals[i0] * w + normals[i1] * hit.u + normals[i2] * hit.v;
+    const float normalLength = glm::length(normal);
+
+    normal = normalLength > 1e-6f ? normal / normalLength : geometricNormal;
+
+    if (glm::dot(geometricNormal, direction) > 0.0f) {
+        geometricNormal = -geometricNormal;
+    }
+
+    if (glm::dot(normal, direction) > 0.0f) {
+        normal = -normal;
+    }
+
+    const bool hasMaterial = triangle.material >= 0 && size_t(triangle.material) < scene->materials.size();
+    const SoftMaterial material = hasMaterial ? scene->materials[size_t(triangle.material)] : SoftMaterial{};
+    const bool textured = material.diffuseTexture >= 0 && size_t(material.diffuseTexture) < scene->textures.size();
+
+    float lambert = std::max(glm::dot(light.direction, normal), 0.0f);
+
+    if (lambert > 0.0f && params.shadows) {
+        shadowRays++;
+
+        if (bvh.occluded(point + geometricNormal * shadowBias, light.direction, FLT_MAX)) {
+            lambert = 0.0f;
+        }
+    }
+
+    const glm::vec3 ambient = glm::vec3{light.globalAmbient} + glm::vec3{material.ambient} * glm::vec3{light.ambient};
+    const glm::vec3 diffuse = glm::vec3{light.diffuse} * (textured ? glm::vec3{1.0f} : glm::vec3{material.diffuse});
+
+    glm::vec3 color = ambient + diffuse * lambert;
+
+    if (textured) {
+        const SoftTexture &texture = scene->textures[size_t(material.diffuseTexture)];
+        const glm::vec2 texCoord = texCoords[i0] * w + texCoords[i1] * hit.u + texCoords[i2] * hit.v;
+
+        // the width of the pixel cone where it hits the surface, in texels
+        const float textureSize = std::sqrt(float(texture.levels[0].width) * float(texture.levels[0].height));
+        const float footprint = hit.distance * camera.pixelAngle / std::max(std::abs(glm::dot(geometricNormal, direction)), 0.1f);
+
+        color = color * glm::vec3{texture.sample(texCoord, std::log2(footprint * triangle.texCoordScale * textureSize))};
+    }
+
+    return packColor(color);
+}
@@ -0,0 +1,87 @@
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "bvh.hpp"
+#include "software_rasterizer.hpp"
+
+class ThreadPool;
+
+
+struct RayTracerParams {
+    // square screen tiles, traced in parallel
+    unsigned int tileSize = 16;
+
+    // a shadow ray towards the light for every lit primary hit
+    bool shadows = true;
+
+    std::uint32_t clearColor = 0xFF000000;
+};
+
+
+struct RayTracerStats {
+    size_t primaryRays = 0;
+    size_t shadowRays = 0;
+};
+
+
+// Renders the scenes of the software rasterizer by casting rays against a BVH of their world space triangles,
+// with the same shading as the rasterizer but per pixel, and shadows of the directional light. Perspective
+// projections only.
+class RayTracer {
+public:
+    RayTracer(ThreadPool &threadPool, const RayTracerParams &params = {});
+
+    // flattens the instances and builds the BVH. the materials and textures are read from the scene when
+    // rendering, so it must outlive the tracer, or the next build
+    void build(const SoftScene &scene);
+
+    RayTracerStats render(const glm::mat4 &view, const glm::mat4 &proj, const SoftLight &light, SoftFramebuffer &framebuffer) const;
+
+    const Bvh4& getBvh() const {
+        return bvh;
+    }
+
+private:
+    struct Triangle {
+        std::uint32_t vertices[3];
+        int material;
+
+        // the ratio between the texture coordinates and the world space lengths, for the level of detail
+        float texCoordScale;
+    };
+
+    struct Camera {
+        glm::vec3 position;
+        glm::vec3 right;
+        glm::vec3 up;
+        glm::vec3 forward;
+        glm::mat4 viewProj;
+
+        // half extents of the image plane at distance one, and the angle covered by a pixel
+        float tanHalfWidth;
+        float tanHalfHeight;
+        float pixelAngle;
+    };
+
+    std::uint32_t tracePixel(const Camera &camera, const SoftLight &light, const glm::vec3 &direction, float &depth, size_t &shadowRays) const;
+
+private:
+    ThreadPool &threadPool;
+    const RayTracerParams params;
+
+    const SoftScene *scene = nullptr;
+    Bvh4 bvh;
+
+    // world space vertices, and the triangles by their vertex indices
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<Triangle> triangles;
+
+    // offset of the shadow rays from the surfaces, relative to the size of the scene
+    float shadowBias = 1e-4f;
+};
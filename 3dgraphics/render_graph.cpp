@@ -0,0 +1,110 @@
+
+#include "render_graph.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <map>
+
+
+void RenderGraph::addPass(RenderPass pass) {
+    assert(pass.record);
+
+    passes.push_back(std::move(pass));
+}
+
+
+bool RenderGraph::compile() {
+    // dependencies always point to previously declared passes, so the declaration order is a valid execution order
+    std::vector<std::vector<size_t>> dependencies(passes.size());
+    std::map<std::string, size_t> lastWriters;
+    std::map<std::string, std::vector<size_t>> readers;
+
+    for (size_t i = 0; i < passes.size(); i++) {
+        for (const std::string &resource : passes[i].reads) {
+            auto writer = lastWriters.find(resource);
+
+            if (writer == lastWriters.end()) {
+                std::cout << "Render pass " << passes[i].name << " reads " << resource << " before it's written" << std::endl;
+                return false;
+            }
+
+            dependencies[i].push_back(writer->second);
+        }
+
+        for (const std::string &resource : passes[i].writes) {
+            if (auto writer = lastWriters.find(resource); writer != lastWriters.end()) {
+                dependencies[i].push_back(writer->second);
+            }
+
+            // the previous readers must see the old contents
+            for (const size_t reader : readers[resource]) {
+                dependencies[i].push_back(reader);
+            }
+        }
+
+        for (const std::string &resource : passes[i].reads) {
+            readers[resource].push_back(i);
+        }
+
+        for (const std::string &resource : passes[i].writes) {
+            lastWriters[resource] = i;
+            readers[resource].clear();
+        }
+    }
+
+    // keep the passes the output depends on
+    std::vector<bool> used(passes.size(), output.empty());
+
+    if (!output.empty()) {
+        auto writer = lastWriters.find(output);
+
+        if (writer == lastWriters.end()) {
+            std::cout << "No render pass writes the output " << output << std::endl;
+            return false;
+        }
+
+        std::vector<size_t> stack = {writer->second};
+
+        while (!stack.empty()) {
+            const size_t pass = stack.back();
+            stack.pop_back();
+
+            if (used[pass]) {
+                continue;
+            }
+
+            used[pass] = true;
+            stack.insert(stack.end(), dependencies[pass].begin(), dependencies[pass].end());
+        }
+    }
+
+    executionOrder.clear();
+    jobs.clear();
+    commandLists.assign(passes.size(), {});
+
+    for (size_t i = 0; i < passes.size(); i++) {
+        if (!used[i]) {
+            continue;
+        }
+
+        executionOrder.push_back(i);
+        commandLists[i].resize(passes[i].jobCount);
+
+        for (size_t job = 0; job < passes[i].jobCount; job++) {
+            jobs.emplace_back(i, job);
+        }
+    }
+
+    return true;
+}
+
+
+void RenderGraph::record(ThreadPool &threadPool) {
+    threadPool.parallelFor(jobs.size(), [this](const size_t i) {
+        const auto [pass, job] = jobs[i];
+        CommandList &commands = commandLists[pass][job];
+
+        commands.clear();
+        passes[pass].record(job, commands);
+    });
+}
@@ -0,0 +1,70 @@
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "command_list.hpp"
+#include "thread_pool.hpp"
+
+
+struct RenderPass {
+    std::string name;
+
+    // resources (render targets, mostly) the pass reads and writes. they only order the passes
+    std::vector<std::string> reads;
+    std::vector<std::string> writes;
+
+    // the pass is recorded into this many command lists, in parallel
+    size_t jobCount = 1;
+
+    // records one job of the pass. called from the worker threads, so it must not touch the graphics API
+    std::function<void(size_t job, CommandList &commands)> record;
+};
+
+
+// Frontend of the renderer. Passes are declared once, then every frame their command lists are
+// recorded on a thread pool and replayed, in dependency order, by the backend on the context thread.
+class RenderGraph {
+public:
+    void addPass(RenderPass pass);
+
+    // the passes that don't contribute to this resource are culled
+    void setOutput(const std::string &resource) {
+        output = resource;
+    }
+
+    // orders the passes after the passes writing the resources they use. a resource read before being
+    // written is an error
+    bool compile();
+
+    // records the command lists of every job of the compiled passes
+    void record(ThreadPool &threadPool);
+
+    // calls visitor(const RenderPass&, const CommandList&) for every recorded command list, in execution order
+    template<typename Visitor>
+    void visit(Visitor &&visitor) const {
+        for (const size_t pass : executionOrder) {
+            for (const CommandList &commands : commandLists[pass]) {
+                visitor(passes[pass], commands);
+            }
+        }
+    }
+
+    size_t getPassCount() const {
+        return executionOrder.size();
+    }
+
+private:
+    std::vector<RenderPass> passes;
+    std::string output;
+
+    std::vector<size_t> executionOrder;
+
+    // one command list per job of each pass, kept between frames to reuse their storage
+    std::vector<std::vector<CommandList>> commandLists;
+
+    // (pass, job) pairs to record
+    std::vector<std::pair<size_t, size_t>> jobs;
+};
@@ -0,0 +1,183 @@
+
+#include "scene_arena.hpp"
+
+#include <cstring>
+#include <new>
+#include <assimp/scene.h>
+
+#include "assimp_glm.hpp"
+#include "gltf_loader.hpp"
+
+
+// reserves the space of count elements of T in the arena layout, and returns their offset
+template<typename T>
+static size_t reserve(size_t &size, const size_t count) {
+    const size_t offset = (size + alignof(T) - 1) / alignof(T) * alignof(T);
+
+    size = offset + count * sizeof(T);
+
+    return offset;
+}
+
+
+SceneArena::SceneArena(const aiScene *scene) {
+    if (!scene || !scene->mRootNode) {
+        return;
+    }
+
+    // size the arrays first, so they can share a single allocation
+    countNode(scene->mRootNode);
+
+    allocate();
+
+    addNode(scene->mRootNode, InvalidIndex);
+}
+
+
+SceneArena::SceneArena(const GltfDocument &document) {
+    for (const std::uint32_t root : document.rootNodes) {
+        countNode(document, root);
+    }
+
+    allocate();
+
+    // a glTF scene can have several roots
+    for (const std::uint32_t root : document.rootNodes) {
+        addNode(document, root, InvalidIndex);
+    }
+}
+
+
+void SceneArena::allocate() {
+    size_t size = 0;
+    const size_t nodesOffset = reserve<SceneNode>(size, nodeCount);
+    const size_t localTransformsOffset = reserve<glm::mat4>(size, nodeCount);
+    const size_t worldTransformsOffset = reserve<glm::mat4>(size, nodeCount);
+    const size_t meshInstancesOffset = reserve<std::uint32_t>(size, instanceCount);
+    const size_t meshNodesOffset = reserve<std::uint32_t>(size, meshNodeCount);
+    const size_t namesOffset = reserve<char>(size, namesSize);
+
+    block = std::make_unique<std::byte[]>(size);
+    memorySize = size;
+
+    nodes = new (block.get() + nodesOffset) SceneNode[nodeCount];
+    localTransforms = new (block.get() + localTransformsOffset) glm::mat4[nodeCount];
+    worldTransforms = new (block.get() + worldTransformsOffset) glm::mat4[nodeCount];
+    meshInstances = reinterpret_cast<std::uint32_t*>(block.get() + meshInstancesOffset);
+    meshNodes = reinterpret_cast<std::uint32_t*>(block.get() + meshNodesOffset);
+    names = reinterpret_cast<char*>(block.get() + namesOffset);
+
+    // the counters are the write cursors of the second pass
+    nodeCount = instanceCount = meshNodeCount = namesSize = 0;
+
+}
+
+
+void SceneArena::countNode(const aiNode *node) {
+    nodeCount++;
+    instanceCount += node->mNumMeshes;
+    meshNodeCount += node->mNumMeshes > 0 ? 1 : 0;
+    namesSize += node->mName.length + 1;
+
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        countNode(node->mChildren[i]);
+    }
+}
+
+
+void SceneArena::addNode(const aiNode *node, const std::uint32_t parent) {
+    const std::uint32_t index = nodeCount++;
+
+    SceneNode &sceneNode = nodes[index];
+    sceneNode.parent = parent;
+    sceneNode.firstInstance = instanceCount;
+    sceneNode.instanceCount = node->mNumMeshes;
+    sceneNode.name = namesSize;
+
+    if (node->mNumMeshes > 0) {
+        std::memcpy(meshInstances + instanceCount, node->mMeshes, node->mNumMeshes * sizeof(std::uint32_t));
+        instanceCount += node->mNumMeshes;
+
+        meshNodes[meshNodeCount++] = index;
+    }
+
+    std::memcpy(names + namesSize, node->mName.C_Str(), node->mName.length + 1);
+    namesSize += node->mName.length + 1;
+
+    // the parent is already done
+    localTransforms[index] = Assimp2Glm(node->mTransformation);
+    worldTransforms[index] = parent == InvalidIndex ? localTransforms[index] : worldTransforms[parent] * localTransforms[index];
+
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        addNode(node->mChildren[i], index);
+    }
+}
+
+
+void SceneArena::countNode(const GltfDocument &document, const std::uint32_t node) {
+    const GltfNode &gltfNode = document.nodes[node];
+
+    nodeCount++;
+    instanceCount += static_cast<std::uint32_t>(gltfNode.primitives.size());
+    meshNodeCount += gltfNode.primitives.empty() ? 0 : 1;
+    namesSize += static_cast<std::uint32_t>(gltfNode.name.size() + 1);
+
+    for (const std::uint32_t child : gltfNode.children) {
+        countNode(document, child);
+    }
+}
+
+
+void SceneArena::addNode(const GltfDocument &document, const std::uint32_t node, const std::uint32_t parent) {
+    const GltfNode &gltfNode = document.nodes[node];
+    const std::uint32_t index = nodeCount++;
+
+    SceneNode &sceneNode = nodes[index];
+    sceneNode.parent = parent;
+    sceneNode.firstInstance = instanceCount;
+    sceneNode.instanceCount = static_cast<std::uint32_t>(gltfNode.primitives.size());
+    sceneNode.name = namesSize;
+
+    if (!gltfNode.primitives.empty()) {
+        std::memcpy(meshInstances + instanceCount, gltfNode.primitives.data(), gltfNode.primitives.size() * sizeof(std::uint32_t));
+        instanceCount += sceneNode.instanceCount;
+
+        meshNodes[meshNodeCount++] = index;
+    }
+
+    std::memcpy(names + namesSize, gltfNode.name.c_str(), gltfNode.name.size() + 1);
+    namesSize += static_cast<std::uint32_t>(gltfNode.name.size() + 1);
+
+    localTransforms[index] = gltfNode.transform;
+    worldTransforms[index] = parent == InvalidIndex ? localTransforms[index] : worldTransforms[parent] * localTransforms[index];
+
+    for (const std::uint32_t child : gltfNode.children) {
+        addNode(document, child, index);
+    }
+}
+
+
+std::uint32_t SceneArena::find(const char *name) const {
+    for (std::uint32_t node = 0; node < nodeCount; node++) {
+        if (std::strcmp(getName(node), name) == 0) {
+            return node;
+        }
+    }
+
+    return InvalidIndex;
+}
+
+
+bool SceneArena::hasSameLayout(const SceneArena &other) const {
+    if (nodeCount != other.nodeCount || instanceCount != other.instanceCount) {
+        return false;
+    }
+
+    for (std::uint32_t node = 0; node < nodeCount; node++) {
+        if (nodes[node].parent != other.nodes[node].parent || nodes[node].firstInstance != other.nodes[node].firstInstance) {
+            return false;
+        }
+    }
+
+    return instanceCount == 0 || std::memcmp(meshInstances, other.meshInstances, instanceCount * sizeof(std::uint32_t)) == 0;
+}
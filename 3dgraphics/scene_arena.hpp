@@ -0,0 +1,114 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <glm/glm.hpp>
+
+struct aiScene;
+struct aiNode;
+struct GltfDocument;
+
+
+// marks a missing parent or node
+const std::uint32_t InvalidIndex = 0xFFFFFFFF;
+
+
+struct SceneNode {
+    std::uint32_t parent = InvalidIndex;
+
+    // range of the mesh indices of the node in the instance array
+    std::uint32_t firstInstance = 0;
+    std::uint32_t instanceCount = 0;
+
+    // offset of the null terminated name in the name pool
+    std::uint32_t name = 0;
+};
+
+
+// The node graph of an imported scene, converted so the importer can be freed right after loading. The
+// nodes are in depth first order, parents before their children, and every array lives in a single
+// allocation, indexed with 32 bit integers.
+class SceneArena {
+public:
+    SceneArena() = default;
+
+    explicit SceneArena(const aiScene *scene);
+
+    // the mesh instances are the indices of the document primitives
+    explicit SceneArena(const GltfDocument &document);
+
+    std::uint32_t getNodeCount() const {
+        return nodeCount;
+    }
+
+    const SceneNode& getNode(const std::uint32_t node) const {
+        return nodes[node];
+    }
+
+    const glm::mat4& getLocalTransform(const std::uint32_t node) const {
+        return localTransforms[node];
+    }
+
+    // the node transform concatenated with the ones of its parents, without animation
+    const glm::mat4& getWorldTransform(const std::uint32_t node) const {
+        return worldTransforms[node];
+    }
+
+    const std::uint32_t* getMeshInstances(const std::uint32_t node) const {
+        return meshInstances + nodes[node].firstInstance;
+    }
+
+    const char* getName(const std::uint32_t node) const {
+        return names + nodes[node].name;
+    }
+
+    // the nodes with meshes, the ones drawn every frame
+    std::uint32_t getMeshNodeCount() const {
+        return meshNodeCount;
+    }
+
+    const std::uint32_t* getMeshNodes() const {
+        return meshNodes;
+    }
+
+    // InvalidIndex when no node has the name
+    std::uint32_t find(const char *name) const;
+
+    // same nodes, parents and mesh instances. the transforms and names may differ
+    bool hasSameLayout(const SceneArena &other) const;
+
+    // bytes allocated by the arena
+    size_t getMemorySize() const {
+        return memorySize;
+    }
+
+private:
+    void countNode(const aiNode *node);
+
+    void addNode(const aiNode *node, std::uint32_t parent);
+
+    void countNode(const GltfDocument &document, std::uint32_t node);
+
+    void addNode(const GltfDocument &document, std::uint32_t node, std::uint32_t parent);
+
+    // allocates the arrays once the counters are known, and resets them to be the write cursors
+    void allocate();
+
+private:
+    std::unique_ptr<std::byte[]> block;
+    size_t memorySize = 0;
+
+    SceneNode *nodes = nullptr;
+    glm::mat4 *localTransforms = nullptr;
+    glm::mat4 *worldTransforms = nullptr;
+    std::uint32_t *meshInstances = nullptr;
+    std::uint32_t *meshNodes = nullptr;
+    char *names = nullptr;
+
+    std::uint32_t nodeCount = 0;
+    std::uint32_t instanceCount = 0;
+    std::uint32_t meshNodeCount = 0;
+    std::uint32_t namesSize = 0;
+};
@@ -0,0 +1,98 @@
+
+#include "shadow_cascades.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+
+
+ShadowCascades::ShadowCascades(const ShadowCascadeParams &params) : params(params) {
+    assert(params.cascadeCount > 0 && params.cascadeCount <= 4);
+
+    cascades.resize(params.cascadeCount);
+    snappedCenters.resize(params.cascadeCount);
+}
+
+
+glm::vec4 ShadowCascades::getSplits() const {
+    glm::vec4 splits = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    for (size_t i = 0; i < cascades.size(); i++) {
+        splits[int(i)] = cascades[i].splitFar;
+    }
+
+    return splits;
+}
+
+
+void ShadowCascades::update(const glm::mat4 &cameraView, const glm::mat4 &cameraProj, const glm::vec3 &lightDirection, const std::uint64_t staticSceneVersion) {
+    const bool lightChanged = !cached || lightDirection != cachedLightDirection;
+    const bool sceneChanged = !cached || staticSceneVersion != cachedStaticSceneVersion;
+
+    cachedLightDirection = lightDirection;
+    cachedStaticSceneVersion = staticSceneVersion;
+    cached = true;
+
+    // the near plane and the slopes of the frustum, recovered from the projection
+    const float nearPlane = cameraProj[3][2] / (cameraProj[2][2] - 1.0f);
+    const float tanX = 1.0f / cameraProj[0][0];
+    const float tanY = 1.0f / cameraProj[1][1];
+    const float slope2 = tanX * tanX + tanY * tanY;
+
+    const glm::mat4 cameraWorld = glm::inverse(cameraView);
+
+    // rotation into light space, looking along the light rays
+    const glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3{1.0f, 0.0f, 0.0f} : glm::vec3{0.0f, 1.0f, 0.0f};
+    const glm::mat4 lightRotation = glm::lookAt(glm::vec3{0.0f}, -lightDirection, up);
+
+    const float farPlane = params.shadowDistance;
+
+    for (unsigned int i = 0; i < params.cascadeCount; i++) {
+        ShadowCascade &cascade = cascades[i];
+
+        const auto split = [&](const unsigned int index) {
+            const float t = float(index) / params.cascadeCount;
+            const float logarithmic = nearPlane * std::pow(farPlane / nearPlane, t);
+            const float uniform = nearPlane + (farPlane - nearPlane) * t;
+
+            return params.splitLambda * logarithmic + (1.0f - params.splitLambda) * uniform;
+        };
+
+        cascade.splitNear = split(i);
+        cascade.splitFar = split(i + 1);
+
+        // smallest sphere centered on the view axis around the slice of the frustum
+        const float n = cascade.splitNear, f = cascade.splitFar;
+        const float centerDepth = std::min(0.5f * (f + n) * (1.0f + slope2), f);
+        const float radius = std::sqrt(f * f * slope2 + (f - centerDepth) * (f - centerDepth));
+
+        const float extent = radius * (1.0f + params.cacheMargin);
+        const float texelSize = 2.0f * extent / params.resolution;
+
+        // the cascade only moves by whole steps, which are whole texels too
+        const float step = std::max(std::floor(radius * params.cacheMargin / texelSize), 1.0f) * texelSize;
+
+        const glm::vec3 worldCenter = cameraWorld * glm::vec4{0.0f, 0.0f, -centerDepth, 1.0f};
+        const glm::vec3 lightCenter = lightRotation * glm::vec4{worldCenter, 1.0f};
+        const glm::vec3 snappedCenter = glm::floor(lightCenter / step + 0.5f) * step;
+
+        cascade.staticDirty = lightChanged || sceneChanged || snappedCenter != snappedCenters[i];
+        snappedCenters[i] = snappedCenter;
+
+        // the depth range extends towards the light, to catch the casters outside of the cascade
+        cascade.view = glm::translate(glm::mat4(1.0f), -snappedCenter) * lightRotation;
+        cascade.proj = glm::ortho(-extent, extent, -extent, extent, -extent - params.casterDistance, extent);
+        cascade.viewProj = cascade.proj * cascade.view;
+        cascade.frustum = extractFrustum(cascade.viewProj);
+
+        const glm::mat4 bias = {
+            0.5f, 0.0f, 0.0f, 0.0f,
+            0.0f, 0.5f, 0.0f, 0.0f,
+            0.0f, 0.0f, 0.5f, 0.0f,
+            0.5f, 0.5f, 0.5f, 1.0f
+        };
+
+        cascade.textureMatrix = bias * cascade.viewProj;
+    }
+}
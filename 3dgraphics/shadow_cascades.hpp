@@ -0,0 +1,82 @@
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "frustum.hpp"
+
+
+struct ShadowCascadeParams {
+    unsigned int cascadeCount = 4;
+    unsigned int resolution = 2048;
+
+    // blend between logarithmic (1) and uniform (0) split distances
+    float splitLambda = 0.8f;
+
+    // shadows end at this view depth
+    float shadowDistance = 100.0f;
+
+    // casters this far towards the light from a cascade are still rendered into it
+    float casterDistance = 100.0f;
+
+    // the cascades are enlarged by this fraction of their radius, so they only have to move (and the static
+    // casters be rendered again) once the camera travels that far
+    float cacheMargin = 0.25f;
+};
+
+
+struct ShadowCascade {
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 proj = glm::mat4(1.0f);
+    glm::mat4 viewProj = glm::mat4(1.0f);
+
+    // from world space to the [0, 1] texture coordinates and depth of the shadow map
+    glm::mat4 textureMatrix = glm::mat4(1.0f);
+
+    // for the caster culling
+    Frustum frustum;
+
+    // view depth range of the camera covered by the cascade
+    float splitNear = 0.0f;
+    float splitFar = 0.0f;
+
+    // the cached static casters are out of date
+    bool staticDirty = true;
+};
+
+
+// Fits the shadow cascades of a directional light around the view frustum. Each cascade bounds a
+// sphere around its slice of the frustum, so its size doesn't change as the camera rotates, and its
+// position is snapped to a grid in light space, so the shadow edges don't shimmer and the static
+// casters can be cached until the cascade moves.
+class ShadowCascades {
+public:
+    explicit ShadowCascades(const ShadowCascadeParams &params);
+
+    const ShadowCascadeParams& getParams() const {
+        return params;
+    }
+
+    // lightDirection points towards the light. staticSceneVersion must change whenever the static casters do
+    void update(const glm::mat4 &cameraView, const glm::mat4 &cameraProj, const glm::vec3 &lightDirection, std::uint64_t staticSceneVersion);
+
+    const std::vector<ShadowCascade>& getCascades() const {
+        return cascades;
+    }
+
+    // far split of each cascade, up to four
+    glm::vec4 getSplits() const;
+
+private:
+    const ShadowCascadeParams params;
+
+    std::vector<ShadowCascade> cascades;
+
+    // cached state, to detect when the static casters must be rendered again
+    std::vector<glm::vec3> snappedCenters;
+    glm::vec3 cachedLightDirection = {0.0f, 0.0f, 0.0f};
+    std::uint64_t cachedStaticSceneVersion = 0;
+    bool cached = false;
+};
@@ -0,0 +1,114 @@
+
+#include "simulation.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+// bits of the input mask
+static const std::uint32_t TurnLeftBit = 1 << 0;
+static const std::uint32_t TurnRightBit = 1 << 1;
+static const std::uint32_t ForwardBit = 1 << 2;
+static const std::uint32_t BackwardBit = 1 << 3;
+
+
+glm::vec3 PlayerState::getDirection() const {
+    return {-std::sin(angle), 0.0f, -std::cos(angle)};
+}
+
+
+Simulation::Simulation(const SimulationParams &params, const PlayerState &initialState)
+    : params(params), tickDuration(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / params.tickRate))) {
+
+    Snapshot &snapshot = snapshots.getBack();
+    snapshot.previous = initialState;
+    snapshot.current = initialState;
+    snapshot.currentTime = std::chrono::steady_clock::now();
+
+    snapshots.publish();
+
+    thread = std::thread(&Simulation::threadMain, this, initialState);
+}
+
+
+Simulation::~Simulation() {
+    quit = true;
+    thread.join();
+}
+
+
+void Simulation::setInput(const SimulationInput &input) {
+    const std::uint32_t bits = (input.turnLeft ? TurnLeftBit : 0u)
+        | (input.turnRight ? TurnRightBit : 0u)
+        | (input.forward ? ForwardBit : 0u)
+        | (input.backward ? BackwardBit : 0u);
+
+    this->input.store(bits, std::memory_order_relaxed);
+}
+
+
+PlayerState Simulation::getState(const std::chrono::steady_clock::time_point time) {
+    snapshots.fetch();
+
+    const Snapshot &snapshot = snapshots.getFront();
+
+    const float alpha = std::clamp(
+        std::chrono::duration<float>(time - snapshot.currentTime).count() / std::chrono::duration<float>(tickDuration).count(),
+        0.0f, 1.0f);
+
+    PlayerState state;
+    state.position = glm::mix(snapshot.previous.position, snapshot.current.position, alpha);
+    state.angle = snapshot.previous.angle + (snapshot.current.angle - snapshot.previous.angle) * alpha;
+
+    return state;
+}
+
+
+void Simulation::step(PlayerState &state, const SimulationInput &input) const {
+    const float dt = static_cast<float>(1.0 / params.tickRate);
+
+    if (input.turnLeft) {
+        state.angle += params.turnSpeed * dt;
+    }
+    else if (input.turnRight) {
+        state.angle -= params.turnSpeed * dt;
+    }
+
+    // pressing both keys cancels the movement
+    if (input.forward != input.backward) {
+        const float distance = (input.forward ? 1.0f : -1.0f) * params.moveSpeed * dt;
+
+        state.position += distance * state.getDirection();
+    }
+}
+
+
+void Simulation::threadMain(PlayerState state) {
+    auto nextTick = std::chrono::steady_clock::now();
+
+    while (!quit) {
+        const std::uint32_t bits = input.load(std::memory_order_relaxed);
+
+        SimulationInput tickInput;
+        tickInput.turnLeft = bits & TurnLeftBit;
+        tickInput.turnRight = bits & TurnRightBit;
+        tickInput.forward = bits & ForwardBit;
+        tickInput.backward = bits & BackwardBit;
+
+        Snapshot &snapshot = snapshots.getBack();
+        snapshot.previous = state;
+
+        step(state, tickInput);
+
+        snapshot.current = state;
+        snapshot.currentTime = std::chrono::steady_clock::now();
+
+        snapshots.publish();
+        tickCount++;
+
+        // fall behind instead of spiralling when a tick takes longer than its duration
+        nextTick = std::max(nextTick + tickDuration, std::chrono::steady_clock::now() - tickDuration);
+
+        std::this_thread::sleep_until(nextTick);
+    }
+}
@@ -0,0 +1,129 @@
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <glm/glm.hpp>
+
+
+// Hands values from one writer thread to one reader thread without locks. The writer fills the back
+// buffer and publishes it; the reader picks up the latest published buffer, if any. Three buffers
+// instead of two so neither side ever waits for the other.
+template<typename T>
+class TripleBuffer {
+public:
+    T& getBack() {
+        return buffers[back];
+    }
+
+    void publish() {
+        back = middle.exchange(back | FreshBit, std::memory_order_acq_rel) & IndexMask;
+    }
+
+    // true when a new buffer was published since the last fetch
+    bool fetch() {
+        if ((middle.load(std::memory_order_relaxed) & FreshBit) == 0) {
+            return false;
+        }
+
+        front = middle.exchange(front, std::memory_order_acq_rel) & IndexMask;
+
+        return true;
+    }
+
+    const T& getFront() const {
+        return buffers[front];
+    }
+
+private:
+    static const std::uint8_t IndexMask = 0x3;
+    static const std::uint8_t FreshBit = 0x4;
+
+    std::array<T, 3> buffers = {};
+
+    // owned by the writer and the reader respectively
+    std::uint8_t back = 0;
+    std::uint8_t front = 1;
+
+    // index of the buffer in between, plus the FreshBit once the writer published it
+    std::atomic<std::uint8_t> middle {2};
+};
+
+
+struct SimulationInput {
+    bool turnLeft = false;
+    bool turnRight = false;
+    bool forward = false;
+    bool backward = false;
+};
+
+
+struct PlayerState {
+    glm::vec3 position = {0.0f, 0.0f, 10.0f};
+
+    // around the Y axis, in radians
+    float angle = 0.0f;
+
+    glm::vec3 getDirection() const;
+};
+
+
+struct SimulationParams {
+    double tickRate = 60.0;
+
+    // units and radians per second
+    float moveSpeed = 4.5f;
+    float turnSpeed = 1.2f;
+};
+
+
+// Advances the player at a fixed rate on its own thread, so the game logic runs at the same speed
+// whatever the frame rate is. The render thread feeds the input and reads back the state, interpolated
+// between the last two ticks.
+class Simulation {
+public:
+    Simulation(const SimulationParams &params, const PlayerState &initialState);
+
+    ~Simulation();
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    void setInput(const SimulationInput &input);
+
+    // the state at the given time, which lags one tick behind so it can be interpolated
+    PlayerState getState(std::chrono::steady_clock::time_point time);
+
+    std::uint64_t getTickCount() const {
+        return tickCount;
+    }
+
+private:
+    // the last two ticks, as published to the render thread
+    struct Snapshot {
+        PlayerState previous;
+        PlayerState current;
+        std::chrono::steady_clock::time_point currentTime;
+    };
+
+    void step(PlayerState &state, const SimulationInput &input) const;
+
+    void threadMain(PlayerState state);
+
+private:
+    const SimulationParams params;
+    const std::chrono::steady_clock::duration tickDuration;
+
+    TripleBuffer<Snapshot> snapshots;
+
+    // the input buttons, as a bit mask
+    std::atomic<std::uint32_t> input {0};
+
+    std::atomic<std::uint64_t> tickCount {0};
+    std::atomic<bool> quit {false};
+
+    std::thread thread;
+};
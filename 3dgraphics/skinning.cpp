@@ -0,0 +1,158 @@
+
+#include "skinning.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#   define SKINNING_USE_SSE
+#   include <xmmintrin.h>
+#endif
+
+
+void computeBonePalette(const SkinnedMesh &mesh, const std::vector<glm::mat4> &globalTransforms, std::vector<float> &palette) {
+    palette.resize(mesh.bones.size() * 12);
+
+    for (size_t i = 0; i < mesh.bones.size(); i++) {
+        const SkinBone &bone = mesh.bones[i];
+
+        assert(bone.node >= 0 && bone.node < int(globalTransforms.size()));
+
+        const glm::mat4 m = globalTransforms[bone.node] * bone.offset;
+
+        for (int row = 0; row < 3; row++) {
+            for (int col = 0; col < 4; col++) {
+                palette[i * 12 + row * 4 + col] = m[col][row];
+            }
+        }
+    }
+}
+
+
+void skinVerticesScalar(const SkinnedMesh &mesh, const std::vector<float> &palette, glm::vec3 *positions, glm::vec3 *normals) {
+    assert(palette.size() == mesh.bones.size() * 12);
+
+    for (size_t v = 0; v < mesh.vertexCount; v++) {
+        float m[12] = {};
+
+        for (unsigned int k = 0; k < MaxBoneInfluences; k++) {
+            const float weight = mesh.boneWeights[v * MaxBoneInfluences + k];
+
+            if (weight == 0.0f) {
+                continue;
+            }
+
+            const float *bone = &palette[mesh.boneIndices[v * MaxBoneInfluences + k] * 12];
+
+            for (int e = 0; e < 12; e++) {
+                m[e] += weight * bone[e];
+            }
+        }
+
+        const float x = mesh.positionX[v], y = mesh.positionY[v], z = mesh.positionZ[v];
+        const float nx = mesh.normalX[v], ny = mesh.normalY[v], nz = mesh.normalZ[v];
+
+        positions[v] = {
+            m[0] * x + m[1] * y + m[2]  * z + m[3],
+            m[4] * x + m[5] * y + m[6]  * z + m[7],
+            m[8] * x + m[9] * y + m[10] * z + m[11]
+        };
+
+        const glm::vec3 normal = {
+            m[0] * nx + m[1] * ny + m[2]  * nz,
+            m[4] * nx + m[5] * ny + m[6]  * nz,
+            m[8] * nx + m[9] * ny + m[10] * nz
+        };
+
+        const float length = glm::length(normal);
+        normals[v] = length > 0.0f ? normal / length : normal;
+    }
+}
+
+
+void skinVertices(const SkinnedMesh &mesh, const std::vector<float> &palette, glm::vec3 *positions, glm::vec3 *normals) {
+#if defined(SKINNING_USE_SSE)
+    assert(palette.size() == mesh.bones.size() * 12);
+    assert(mesh.positionX.size() % 4 == 0);
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 epsilon = _mm_set1_ps(1e-20f);
+
+    alignas(16) float out[6][4];
+
+    for (size_t v0 = 0; v0 < mesh.vertexCount; v0 += 4) {
+        // the four influence weights of the four vertices, transposed so weights[k] holds influence k of each vertex
+        __m128 weights[4];
+        for (int i = 0; i < 4; i++) {
+            weights[i] = _mm_loadu_ps(&mesh.boneWeights[(v0 + i) * MaxBoneInfluences]);
+        }
+
+        _MM_TRANSPOSE4_PS(weights[0], weights[1], weights[2], weights[3]);
+
+        // blended 3x4 matrices of the four vertices, one register per matrix element
+        __m128 m[12];
+        for (__m128 &e : m) {
+            e = zero;
+        }
+
+        for (unsigned int k = 0; k < MaxBoneInfluences; k++) {
+            if (_mm_movemask_ps(_mm_cmpneq_ps(weights[k], zero)) == 0) {
+                continue;
+            }
+
+            const float *bones[4];
+            for (int i = 0; i < 4; i++) {
+                bones[i] = &palette[mesh.boneIndices[(v0 + i) * MaxBoneInfluences + k] * 12];
+            }
+
+            for (int row = 0; row < 3; row++) {
+                __m128 r0 = _mm_loadu_ps(bones[0] + row * 4);
+                __m128 r1 = _mm_loadu_ps(bones[1] + row * 4);
+                __m128 r2 = _mm_loadu_ps(bones[2] + row * 4);
+                __m128 r3 = _mm_loadu_ps(bones[3] + row * 4);
+
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+                m[row * 4 + 0] = _mm_add_ps(m[row * 4 + 0], _mm_mul_ps(weights[k], r0));
+                m[row * 4 + 1] = _mm_add_ps(m[row * 4 + 1], _mm_mul_ps(weights[k], r1));
+                m[row * 4 + 2] = _mm_add_ps(m[row * 4 + 2], _mm_mul_ps(weights[k], r2));
+                m[row * 4 + 3] = _mm_add_ps(m[row * 4 + 3], _mm_mul_ps(weights[k], r3));
+            }
+        }
+
+        const __m128 x = _mm_loadu_ps(&mesh.positionX[v0]);
+        const __m128 y = _mm_loadu_ps(&mesh.positionY[v0]);
+        const __m128 z = _mm_loadu_ps(&mesh.positionZ[v0]);
+        const __m128 nx = _mm_loadu_ps(&mesh.normalX[v0]);
+        const __m128 ny = _mm_loadu_ps(&mesh.normalY[v0]);
+        const __m128 nz = _mm_loadu_ps(&mesh.normalZ[v0]);
+
+        __m128 normal[3];
+
+        for (int row = 0; row < 3; row++) {
+            const __m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[row * 4 + 0], x), _mm_mul_ps(m[row * 4 + 1], y)), _mm_add_ps(_mm_mul_ps(m[row * 4 + 2], z), m[row * 4 + 3]));
+            _mm_store_ps(out[row], p);
+
+            normal[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[row * 4 + 0], nx), _mm_mul_ps(m[row * 4 + 1], ny)), _mm_mul_ps(m[row * 4 + 2], nz));
+        }
+
+        const __m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normal[0], normal[0]), _mm_mul_ps(normal[1], normal[1])), _mm_mul_ps(normal[2], normal[2]));
+        const __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(length2, epsilon)));
+
+        for (int row = 0; row < 3; row++) {
+            _mm_store_ps(out[3 + row], _mm_mul_ps(normal[row], invLength));
+        }
+
+        const size_t count = std::min<size_t>(4, mesh.vertexCount - v0);
+
+        for (size_t i = 0; i < count; i++) {
+            positions[v0 + i] = {out[0][i], out[1][i], out[2][i]};
+            normals[v0 + i] = {out[3][i], out[4][i], out[5][i]};
+        }
+    }
+#else
+    skinVerticesScalar(mesh, palette, positions, normals);
+#endif
+}
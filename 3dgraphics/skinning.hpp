@@ -0,0 +1,51 @@
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+
+const unsigned int MaxBoneInfluences = 4;
+
+// bone indices are stored as bytes, and the palette must fit in the smallest UBO the GL allows (16KB)
+const unsigned int MaxPaletteBones = 256;
+
+
+struct SkinBone {
+    // index of the bone node in the NodeHierarchy
+    int node = -1;
+
+    // transforms from mesh space to the bone space, in bind pose
+    glm::mat4 offset = glm::mat4(1.0f);
+};
+
+
+struct SkinnedMesh {
+    std::vector<SkinBone> bones;
+
+    size_t vertexCount = 0;
+
+    // MaxBoneInfluences entries per vertex, padded with zero weights. padded to a multiple of 4 vertices
+    std::vector<std::uint8_t> boneIndices;
+    std::vector<float> boneWeights;
+
+    // bind pose, as SoA so the CPU path can skin four vertices at a time. padded like the influences
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> normalX, normalY, normalZ;
+
+    bool empty() const {
+        return bones.empty();
+    }
+};
+
+
+// the bone palette holds, for each bone, the rows of its 3x4 skinning matrix (12 floats per bone).
+// the same layout is used by the CPU path and by the uBoneRows uniform block of gouraud_skinned.vert
+void computeBonePalette(const SkinnedMesh &mesh, const std::vector<glm::mat4> &globalTransforms, std::vector<float> &palette);
+
+// reference implementation
+void skinVerticesScalar(const SkinnedMesh &mesh, const std::vector<float> &palette, glm::vec3 *positions, glm::vec3 *normals);
+
+// blends the bone matrices of four vertices at a time with SSE, and falls back to the scalar path elsewhere
+void skinVertices(const SkinnedMesh &mesh, const std::vector<float> &palette, glm::vec3 *positions, glm::vec3 *normals);
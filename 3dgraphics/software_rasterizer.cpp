@@ -0,0 +1,679 @@
+
+#include "software_rasterizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "thread_pool.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#   define RASTERIZER_USE_SSE
+#   include <emmintrin.h>
+#endif
+
+
+// work of a single task of the vertex and setup passes
+const std::uint32_t VertexBatchSize = 4096;
+const std::uint32_t TriangleBatchSize = 2048;
+
+// vertex coordinates are snapped to 1/16 of a pixel
+const int SubpixelBits = 4;
+const int SubpixelScale = 1 << SubpixelBits;
+
+// the triangles are only clipped against the sides of this many times the view frustum, the rest is left to
+// the scissoring of the tiles. keeps the subpixel coordinates in 32 bits, and most triangles unclipped
+const float GuardBand = 4.0f;
+
+// near, far, left, right, bottom and top
+const int ClipPlaneCount = 6;
+
+
+std::uint32_t packColor(const glm::vec3 &color) {
+    const auto channel = [](const float value) {
+        return std::uint32_t(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+    };
+
+    return channel(color.x) | (channel(color.y) << 8) | (channel(color.z) << 16) | 0xFF000000;
+}
+
+
+static glm::vec4 unpackColor(const std::uint32_t texel) {
+    return glm::vec4{float(texel & 0xFF), float((texel >> 8) & 0xFF), float((texel >> 16) & 0xFF), float(texel >> 24)} / 255.0f;
+}
+
+
+static int floorDiv(const int value, const int divisor) {
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+
+glm::vec4 SoftTexture::sample(const glm::vec2 &texCoord, const float lod) const {
+    // also catches the NaN of a zero footprint
+    const int levelIndex = lod > 0.5f ? int(std::min(lod + 0.5f, float(levels.size() - 1))) : 0;
+    const Level &level = levels[levelIndex];
+
+    const float x = (texCoord.x - std::floor(texCoord.x)) * level.width - 0.5f;
+    const float y = (texCoord.y - std::floor(texCoord.y)) * level.height - 0.5f;
+    const float x0 = std::floor(x), y0 = std::floor(y);
+    const float fx = x - x0, fy = y - y0;
+
+    // the texel centers to the left and below of the first ones wrap around
+    const int ix0 = x0 < 0.0f ? int(level.width) - 1 : int(x0);
+    const int iy0 = y0 < 0.0f ? int(level.height) - 1 : int(y0);
+    const int ix1 = ix0 + 1 == int(level.width) ? 0 : ix0 + 1;
+    const int iy1 = iy0 + 1 == int(level.height) ? 0 : iy0 + 1;
+
+    const std::uint32_t *row0 = level.texels.data() + size_t(iy0) * level.width;
+    const std::uint32_t *row1 = level.texels.data() + size_t(iy1) * level.width;
+
+    const glm::vec4 bottom = glm::mix(unpackColor(row0[ix0]), unpackColor(row0[ix1]), fx);
+    const glm::vec4 top = glm::mix(unpackColor(row1[ix0]), unpackColor(row1[ix1]), fx);
+
+    return glm::mix(bottom, top, fy);
+}
+
+
+SoftTexture createSoftTexture(const unsigned int width, const unsigned int height, const unsigned int channels, const std::uint8_t *pixels) {
+    SoftTexture texture;
+
+    SoftTexture::Level base;
+    base.width = width;
+    base.height = height;
+    base.texels.resize(size_t(width) * height);
+
+    for (size_t i = 0; i < base.texels.size(); i++) {
+        const std::uint8_t *pixel = pixels + i * channels;
+
+        // grayscale images replicate their single channel
+        const std::uint32_t r = pixel[0];
+        const std::uint32_t g = channels >= 3 ? pixel[1] : r;
+        const std::uint32_t b = channels >= 3 ? pixel[2] : r;
+        const std::uint32_t a = channels == 4 ? pixel[3] : channels == 2 ? pixel[1] : 0xFF;
+
+        base.texels[i] = r | (g << 8) | (b << 16) | (a << 24);
+    }
+
+    texture.levels.push_back(std::move(base));
+
+    // box filtered levels, down to a single texel. the odd rows and columns repeat the last one
+    while (texture.levels.back().width > 1 || texture.levels.back().height > 1) {
+        const SoftTexture::Level &previous = texture.levels.back();
+
+        SoftTexture::Level level;
+        level.width = std::max(previous.width / 2, 1u);
+        level.height = std::max(previous.height / 2, 1u);
+        level.texels.resize(size_t(level.width) * level.height);
+
+        for (unsigned int y = 0; y < level.height; y++) {
+            const unsigned int y0 = std::min(2 * y, previous.height - 1), y1 = std::min(2 * y + 1, previous.height - 1);
+
+            for (unsigned int x = 0; x < level.width; x++) {
+                const unsigned int x0 = std::min(2 * x, previous.width - 1), x1 = std::min(2 * x + 1, previous.width - 1);
+
+                std::uint32_t texel = 0;
+
+                for (int shift = 0; shift < 32; shift += 8) {
+                    const auto channel = [&](const unsigned int px, const unsigned int py) {
+                        return (previous.texels[size_t(py) * previous.width + px] >> shift) & 0xFF;
+                    };
+
+                    const std::uint32_t sum = channel(x0, y0) + channel(x1, y0) + channel(x0, y1) + channel(x1, y1);
+
+                    texel |= ((sum + 2) / 4) << shift;
+                }
+
+                level.texels[size_t(y) * level.width + x] = texel;
+            }
+        }
+
+        texture.levels.push_back(std::move(level));
+    }
+
+    return texture;
+}
+
+
+void SoftFramebuffer::resize(const unsigned int width, const unsigned int height) {
+    this->width = width;
+    this->height = height;
+
+    color.resize(size_t(width) * height);
+    depth.resize(size_t(width) * height);
+}
+
+
+SoftwareRasterizer::SoftwareRasterizer(ThreadPool &threadPool, const SoftRasterParams &params) : threadPool(threadPool), params(params) {}
+
+
+SoftRasterStats SoftwareRasterizer::render(const SoftScene &scene, const glm::mat4 &view, const glm::mat4 &proj, const SoftLight &light, SoftFramebuffer &framebuffer) {
+    SoftRasterStats stats;
+
+    width = framebuffer.width;
+    height = framebuffer.height;
+    tilesX = (width + params.tileSize - 1) / params.tileSize;
+    tilesY = (height + params.tileSize - 1) / params.tileSize;
+
+    const size_t tileCount = size_t(tilesX) * tilesY;
+
+    // split the instances in batches of vertices and triangles
+    instanceVertexOffsets.resize(scene.instances.size());
+    vertexBatches.clear();
+    triangleBatches.clear();
+
+    size_t vertexCount = 0;
+
+    for (std::uint32_t i = 0; i < scene.instances.size(); i++) {
+        const SoftMesh &mesh = scene.meshes[scene.instances[i].mesh];
+        const auto meshVertexCount = std::uint32_t(mesh.positions.size());
+        const auto triangleCount = std::uint32_t(mesh.indices.size() / 3);
+
+        instanceVertexOffsets[i] = vertexCount;
+        vertexCount += meshVertexCount;
+        stats.trianglesSubmitted += triangleCount;
+
+        for (std::uint32_t first = 0; first < meshVertexCount; first += VertexBatchSize) {
+            vertexBatches.push_back({i, first, std::min(VertexBatchSize, meshVertexCount - first)});
+        }
+
+        for (std::uint32_t first = 0; first < triangleCount; first += TriangleBatchSize) {
+            triangleBatches.push_back({i, first, std::min(TriangleBatchSize, triangleCount - first)});
+        }
+    }
+
+    vertices.resize(vertexCount);
+
+    const glm::mat4 viewProj = proj * view;
+
+    threadPool.parallelFor(vertexBatches.size(), [&](const size_t batch) {
+        shadeVertices(scene, vertexBatches[batch], viewProj, light);
+    });
+
+    // each batch of triangles has its own bins, so the tiles can take them in submission order
+    jobs.resize(triangleBatches.size());
+
+    threadPool.parallelFor(triangleBatches.size(), [&](const size_t batch) {
+        BinningJob &job = jobs[batch];
+
+        job.triangles.clear();
+        job.tiles.resize(tileCount);
+
+        for (std::vector<std::uint32_t> &tile : job.tiles) {
+            tile.clear();
+        }
+
+        setupTriangles(scene, triangleBatches[batch], job);
+    });
+
+    threadPool.parallelFor(tileCount, [&](const size_t tile) {
+        rasterizeTile(tile, framebuffer);
+    });
+
+    for (const BinningJob &job : jobs) {
+        stats.trianglesRasterized += job.triangles.size();
+
+        for (const std::vector<std::uint32_t> &tile : job.tiles) {
+            stats.binnedTriangles += tile.size();
+        }
+    }
+
+    return stats;
+}
+
+
+void SoftwareRasterizer::shadeVertices(const SoftScene &scene, const Batch &batch, const glm::mat4 &viewProj, const SoftLight &light) {
+    const SoftInstance &instance = scene.instances[batch.instance];
+    const SoftMesh &mesh = scene.meshes[instance.mesh];
+
+    const bool hasMaterial = mesh.material >= 0 && size_t(mesh.material) < scene.materials.size();
+    const SoftMaterial material = hasMaterial ? scene.materials[size_t(mesh.material)] : SoftMaterial{};
+    const bool textured = material.diffuseTexture >= 0 && size_t(material.diffuseTexture) < scene.textures.size();
+
+    // the texture replaces the diffuse color, as in the gouraud shader
+    const glm::vec3 ambient = glm::vec3{light.globalAmbient} + glm::vec3{material.ambient} * glm::vec3{light.ambient};
+    const glm::vec3 diffuse = glm::vec3{light.diffuse} * (textured ? glm::vec3{1.0f} : glm::vec3{material.diffuse});
+
+    const glm::mat4 modelViewProj = viewProj * instance.model;
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3{instance.model}));
+
+    ShadedVertex *output = vertices.data() + instanceVertexOffsets[batch.instance];
+
+    for (std::uint32_t i = batch.first; i < batch.first + batch.count; i++) {
+        ShadedVertex &vertex = output[i];
+
+        vertex.position = modelViewProj * glm::vec4{mesh.positions[i], 1.0f};
+        vertex.texCoord = mesh.texCoords.empty() ? glm::vec2{0.0f} : mesh.texCoords[i];
+
+        // lit once per vertex, and interpolated over the triangles
+        float lambert = 1.0f;
+
+        if (!mesh.normals.empty()) {
+            const glm::vec3 normal = normalMatrix * mesh.normals[i];
+            const float length = glm::length(normal);
+
+            lambert = length > 0.0f ? std::max(glm::dot(light.direction, normal) / length, 0.0f) : 0.0f;
+        }
+
+        vertex.color = ambient + diffuse * lambert;
+    }
+}
+
+
+void SoftwareRasterizer::setupTriangles(const SoftScene &scene, const Batch &batch, BinningJob &job) {
+    const SoftMesh &mesh = scene.meshes[scene.instances[batch.instance].mesh];
+
+    const SoftTexture *texture = nullptr;
+
+    if (mesh.material >= 0 && size_t(mesh.material) < scene.materials.size()) {
+        const int diffuseTexture = scene.materials[size_t(mesh.material)].diffuseTexture;
+
+        if (diffuseTexture >= 0 && size_t(diffuseTexture) < scene.textures.size()) {
+            texture = &scene.textures[size_t(diffuseTexture)];
+        }
+    }
+
+    const ShadedVertex *instanceVertices = vertices.data() + instanceVertexOffsets[batch.instance];
+    const std::uint32_t *indices = mesh.indices.data() + 3 * size_t(batch.first);
+
+    for (std::uint32_t i = 0; i < batch.count; i++, indices += 3) {
+        clipTriangle(instanceVertices[indices[0]], instanceVertices[indices[1]], instanceVertices[indices[2]], texture, job);
+    }
+}
+
+
+// signed distances to the clip planes, positive inside
+static void getClipDistances(const glm::vec4 &position, float *distances) {
+    distances[0] = position.z + position.w;
+    distances[1] = position.w - position.z;
+    distances[2] = GuardBand * position.w + position.x;
+    distances[3] = GuardBand * position.w - position.x;
+    distances[4] = GuardBand * position.w + position.y;
+    distances[5] = GuardBand * position.w - position.y;
+}
+
+
+static unsigned int getOutcode(const glm::vec4 &position) {
+    float distances[ClipPlaneCount];
+    getClipDistances(position, distances);
+
+    unsigned int outcode = 0;
+
+    for (int plane = 0; plane < ClipPlaneCount; plane++) {
+        outcode |= distances[plane] < 0.0f ? 1u << plane : 0u;
+    }
+
+    return outcode;
+}
+
+
+void SoftwareRasterizer::clipTriangle(const ShadedVertex &a, const ShadedVertex &b, const ShadedVertex &c, const SoftTexture *texture, BinningJob &job) {
+    const unsigned int outcodeA = getOutcode(a.position);
+    const unsigned int outcodeB = getOutcode(b.position);
+    const unsigned int outcodeC = getOutcode(c.position);
+
+    if ((outcodeA & outcodeB & outcodeC) != 0) {
+        return;
+    }
+
+    if ((outcodeA | outcodeB | outcodeC) == 0) {
+        addTriangle(a, b, c, texture, job);
+        return;
+    }
+
+    // Sutherland-Hodgman, against the crossed planes only. each plane adds at most one vertex
+    const unsigned int crossed = outcodeA | outcodeB | outcodeC;
+
+    ShadedVertex polygons[2][3 + ClipPlaneCount];
+    int counts[2] = {3, 0};
+    int current = 0;
+
+    polygons[0][0] = a;
+    polygons[0][1] = b;
+    polygons[0][2] = c;
+
+    for (int plane = 0; plane < ClipPlaneCount && counts[current] >= 3; plane++) {
+        if ((crossed & (1u << plane)) == 0) {
+            continue;
+        }
+
+        const ShadedVertex *input = polygons[current];
+        ShadedVertex *output = polygons[1 - current];
+        int &outputCount = counts[1 - current];
+
+        outputCount = 0;
+
+        for (int i = 0; i < counts[current]; i++) {
+            const ShadedVertex &from = input[i];
+            const ShadedVertex &to = input[(i + 1) % counts[current]];
+
+            float fromDistances[ClipPlaneCount], toDistances[ClipPlaneCount];
+            getClipDistances(from.position, fromDistances);
+            getClipDistances(to.position, toDistances);
+
+            const float fromDistance = fromDistances[plane], toDistance = toDistances[plane];
+
+            if (fromDistance >= 0.0f) {
+                output[outputCount++] = from;
+            }
+
+            if ((fromDistance >= 0.0f) != (toDistance >= 0.0f)) {
+                const float t = fromDistance / (fromDistance - toDistance);
+
+                ShadedVertex &vertex = output[outputCount++];
+                vertex.position = glm::mix(from.position, to.position, t);
+                vertex.color = glm::mix(from.color, to.color, t);
+                vertex.texCoord = glm::mix(from.texCoord, to.texCoord, t);
+            }
+        }
+
+        current = 1 - current;
+    }
+
+    for (int i = 1; i + 1 < counts[current]; i++) {
+        addTriangle(polygons[current][0], polygons[current][i], polygons[current][i + 1], texture, job);
+    }
+}
+
+
+void SoftwareRasterizer::addTriangle(const ShadedVertex &a, const ShadedVertex &b, const ShadedVertex &c, const SoftTexture *texture, BinningJob &job) {
+    const ShadedVertex *corners[3] = {&a, &b, &c};
+
+    std::int32_t x[3], y[3];
+    float attributes[3][7];
+
+    for (int i = 0; i < 3; i++) {
+        const glm::vec4 &position = corners[i]->position;
+        const float invW = 1.0f / position.w;
+
+        // the rows go down the screen
+        const float screenX = (position.x * invW * 0.5f + 0.5f) * width;
+        const float screenY = (0.5f - position.y * invW * 0.5f) * height;
+
+        x[i] = std::int32_t(std::floor(screenX * SubpixelScale + 0.5f));
+        y[i] = std::int32_t(std::floor(screenY * SubpixelScale + 0.5f));
+
+        float *attribute = attributes[i];
+        attribute[0] = position.z * invW * 0.5f + 0.5f;
+        attribute[1] = invW;
+        attribute[2] = corners[i]->color.x * invW;
+        attribute[3] = corners[i]->color.y * invW;
+        attribute[4] = corners[i]->color.z * invW;
+        attribute[5] = corners[i]->texCoord.x * invW;
+        attribute[6] = corners[i]->texCoord.y * invW;
+    }
+
+    std::int64_t area = std::int64_t(x[1] - x[0]) * (y[2] - y[0]) - std::int64_t(y[1] - y[0]) * (x[2] - x[0]);
+
+    if (area == 0) {
+        return;
+    }
+
+    // counter clockwise triangles turn clockwise once the rows go down
+    const bool frontFacing = area < 0;
+
+    if (params.cullBackFaces && !frontFacing) {
+        return;
+    }
+
+    int order[3] = {0, 1, 2};
+
+    if (area < 0) {
+        std::swap(order[1], order[2]);
+        area = -area;
+    }
+
+    SetupTriangle triangle;
+
+    for (int i = 0; i < 3; i++) {
+        triangle.x[i] = x[order[i]];
+        triangle.y[i] = y[order[i]];
+    }
+
+    triangle.area = area;
+
+    // the pixels with their centers inside the bounds
+    const std::int32_t minX = std::min({x[0], x[1], x[2]}), maxX = std::max({x[0], x[1], x[2]});
+    const std::int32_t minY = std::min({y[0], y[1], y[2]}), maxY = std::max({y[0], y[1], y[2]});
+
+    triangle.minX = std::max(-floorDiv(SubpixelScale / 2 - minX, SubpixelScale), 0);
+    triangle.minY = std::max(-floorDiv(SubpixelScale / 2 - minY, SubpixelScale), 0);
+    triangle.maxX = std::min(floorDiv(maxX - SubpixelScale / 2, SubpixelScale), int(width) - 1);
+    triangle.maxY = std::min(floorDiv(maxY - SubpixelScale / 2, SubpixelScale), int(height) - 1);
+
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+        return;
+    }
+
+    for (int i = 0; i < 7; i++) {
+        triangle.base[i] = attributes[order[0]][i];
+        triangle.delta1[i] = attributes[order[1]][i] - attributes[order[0]][i];
+        triangle.delta2[i] = attributes[order[2]][i] - attributes[order[0]][i];
+    }
+
+    const float scale = float(SubpixelScale) / float(area);
+
+    triangle.b1dx = float(triangle.y[2] - triangle.y[0]) * scale;
+    triangle.b1dy = float(triangle.x[0] - triangle.x[2]) * scale;
+    triangle.b2dx = float(triangle.y[0] - triangle.y[1]) * scale;
+    triangle.b2dy = float(triangle.x[1] - triangle.x[0]) * scale;
+
+    triangle.texture = texture;
+
+    const auto index = std::uint32_t(job.triangles.size());
+    job.triangles.push_back(triangle);
+
+    for (int ty = triangle.minY / int(params.tileSize); ty <= triangle.maxY / int(params.tileSize); ty++) {
+        for (int tx = triangle.minX / int(params.tileSize); tx <= triangle.maxX / int(params.tileSize); tx++) {
+            job.tiles[size_t(ty) * tilesX + size_t(tx)].push_back(index);
+        }
+    }
+}
+
+
+void SoftwareRasterizer::rasterizeTile(const size_t tile, SoftFramebuffer &framebuffer) const {
+    const int minX = int(tile % tilesX * params.tileSize);
+    const int minY = int(tile / tilesX * params.tileSize);
+    const int maxX = std::min(minX + int(params.tileSize), int(width)) - 1;
+    const int maxY = std::min(minY + int(params.tileSize), int(height)) - 1;
+
+    for (int y = minY; y <= maxY; y++) {
+        const size_t row = size_t(y) * width;
+
+        std::fill(framebuffer.color.begin() + row + minX, framebuffer.color.begin() + row + maxX + 1, params.clearColor);
+        std::fill(framebuffer.depth.begin() + row + minX, framebuffer.depth.begin() + row + maxX + 1, 1.0f);
+    }
+
+    for (const BinningJob &job : jobs) {
+        for (const std::uint32_t index : job.tiles[tile]) {
+            const SetupTriangle &triangle = job.triangles[index];
+
+            rasterizeTriangle(
+                triangle,
+                std::max(triangle.minX, minX), std::max(triangle.minY, minY),
+                std::min(triangle.maxX, maxX), std::min(triangle.maxY, maxY),
+                framebuffer);
+        }
+    }
+}
+
+
+void SoftwareRasterizer::rasterizeTriangle(const SetupTriangle &triangle, const int minX, const int minY, const int maxX, const int maxY, SoftFramebuffer &framebuffer) const {
+    // edge k is opposite to vertex k, and its value is the barycentric weight of that vertex times the area
+    std::int64_t edgeX[3], edgeY[3], edgeRow[3], bias[3];
+
+    const std::int64_t sampleX = std::int64_t(minX) * SubpixelScale + SubpixelScale / 2;
+    const std::int64_t sampleY = std::int64_t(minY) * SubpixelScale + SubpixelScale / 2;
+
+    for (int k = 0; k < 3; k++) {
+        const int a = (k + 1) % 3, b = (k + 2) % 3;
+        const std::int64_t dx = triangle.x[b] - triangle.x[a];
+        const std::int64_t dy = triangle.y[b] - triangle.y[a];
+
+        // top-left rule: a shared edge belongs to exactly one of its triangles, which run it in opposite directions
+        bias[k] = dy > 0 || (dy == 0 && dx > 0) ? 0 : -1;
+
+        edgeX[k] = -dy * SubpixelScale;
+        edgeY[k] = dx * SubpixelScale;
+        edgeRow[k] = dx * (sampleY - triangle.y[a]) - dy * (sampleX - triangle.x[a]) + bias[k];
+    }
+
+    const float invArea = 1.0f / float(triangle.area);
+
+    const float *base = triangle.base;
+    const float *delta1 = triangle.delta1;
+    const float *delta2 = triangle.delta2;
+
+    // screen derivatives of texCoord/w and 1/w, which are linear over the screen
+    const SoftTexture *texture = triangle.texture;
+    const float uDx = delta1[5] * triangle.b1dx + delta2[5] * triangle.b2dx;
+    const float uDy = delta1[5] * triangle.b1dy + delta2[5] * triangle.b2dy;
+    const float vDx = delta1[6] * triangle.b1dx + delta2[6] * triangle.b2dx;
+    const float vDy = delta1[6] * triangle.b1dy + delta2[6] * triangle.b2dy;
+    const float wDx = delta1[1] * triangle.b1dx + delta2[1] * triangle.b2dx;
+    const float wDy = delta1[1] * triangle.b1dy + delta2[1] * triangle.b2dy;
+    const float textureWidth = texture ? float(texture->levels[0].width) : 0.0f;
+    const float textureHeight = texture ? float(texture->levels[0].height) : 0.0f;
+
+    const auto sampleTexture = [&](const float u, const float v, const float invW) {
+        // the texel footprint of the pixel, from the quotient rule over texCoord/w and 1/w
+        const float dudx = (uDx - u * wDx) * invW * textureWidth, dvdx = (vDx - v * wDx) * invW * textureHeight;
+        const float dudy = (uDy - u * wDy) * invW * textureWidth, dvdy = (vDy - v * wDy) * invW * textureHeight;
+        const float footprint = std::max(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy);
+
+        return glm::vec3{texture->sample({u, v}, 0.5f * std::log2(footprint))};
+    };
+
+    for (int y = minY; y <= maxY; y++, edgeRow[0] += edgeY[0], edgeRow[1] += edgeY[1], edgeRow[2] += edgeY[2]) {
+        // the covered pixels of a row are a single span, bounded by each edge
+        std::int64_t first = 0, last = maxX - minX;
+        bool empty = false;
+
+        for (int k = 0; k < 3; k++) {
+            const std::int64_t value = edgeRow[k], step = edgeX[k];
+
+            if (step > 0) {
+                first = value < 0 ? std::max(first, (-value + step - 1) / step) : first;
+            }
+            else if (value < 0) {
+                empty = true;
+            }
+            else if (step < 0) {
+                last = std::min(last, value / -step);
+            }
+        }
+
+        if (empty || first > last) {
+            continue;
+        }
+
+        const float b1First = float(edgeRow[1] - bias[1] + edgeX[1] * first) * invArea;
+        const float b2First = float(edgeRow[2] - bias[2] + edgeX[2] * first) * invArea;
+
+        const size_t row = size_t(y) * width + size_t(minX);
+        std::uint32_t *color = framebuffer.color.data() + row;
+        float *depth = framebuffer.depth.data() + row;
+
+        std::int64_t x = first;
+
+#if defined(RASTERIZER_USE_SSE)
+        // four pixels at a time: depth test, perspective division and the untextured colors
+        const __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 scale = _mm_set1_ps(255.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128i alpha = _mm_set1_epi32(int(0xFF000000));
+
+        const auto interpolate = [&](const int attribute, const __m128 b1, const __m128 b2) {
+            // in the order of the scalar path, so both give the same image
+            return _mm_add_ps(_mm_add_ps(_mm_set1_ps(base[attribute]), _mm_mul_ps(_mm_set1_ps(delta1[attribute]), b1)), _mm_mul_ps(_mm_set1_ps(delta2[attribute]), b2));
+        };
+
+        const auto toChannel = [&](const __m128 value) {
+            return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(value, zero), one), scale), half));
+        };
+
+        alignas(16) float channels[5][4];
+
+        for (; x + 3 <= last; x += 4) {
+            const __m128 offsets = _mm_add_ps(_mm_set1_ps(float(x - first)), lanes);
+            const __m128 b1 = _mm_add_ps(_mm_set1_ps(b1First), _mm_mul_ps(offsets, _mm_set1_ps(triangle.b1dx)));
+            const __m128 b2 = _mm_add_ps(_mm_set1_ps(b2First), _mm_mul_ps(offsets, _mm_set1_ps(triangle.b2dx)));
+
+            const __m128 z = interpolate(0, b1, b2);
+            const __m128 previousDepth = _mm_loadu_ps(depth + x);
+            const __m128 passed = _mm_cmplt_ps(z, previousDepth);
+            const int passedMask = _mm_movemask_ps(passed);
+
+            if (passedMask == 0) {
+                continue;
+            }
+
+            _mm_storeu_ps(depth + x, _mm_or_ps(_mm_and_ps(passed, z), _mm_andnot_ps(passed, previousDepth)));
+
+            const __m128 invW = _mm_div_ps(one, interpolate(1, b1, b2));
+
+            __m128 r = _mm_mul_ps(interpolate(2, b1, b2), invW);
+            __m128 g = _mm_mul_ps(interpolate(3, b1, b2), invW);
+            __m128 b = _mm_mul_ps(interpolate(4, b1, b2), invW);
+
+            // the texture lookups are gathers, done one pixel at a time
+            if (texture) {
+                _mm_store_ps(channels[0], _mm_mul_ps(interpolate(5, b1, b2), invW));
+                _mm_store_ps(channels[1], _mm_mul_ps(interpolate(6, b1, b2), invW));
+                _mm_store_ps(channels[2], invW);
+
+                for (int i = 0; i < 4; i++) {
+                    const glm::vec3 texel = (passedMask & (1 << i)) ? sampleTexture(channels[0][i], channels[1][i], channels[2][i]) : glm::vec3{0.0f};
+
+                    channels[2][i] = texel.x;
+                    channels[3][i] = texel.y;
+                    channels[4][i] = texel.z;
+                }
+
+                r = _mm_mul_ps(r, _mm_load_ps(channels[2]));
+                g = _mm_mul_ps(g, _mm_load_ps(channels[3]));
+                b = _mm_mul_ps(b, _mm_load_ps(channels[4]));
+            }
+
+            const __m128i packed = _mm_or_si128(
+                _mm_or_si128(toChannel(r), _mm_slli_epi32(toChannel(g), 8)),
+                _mm_or_si128(_mm_slli_epi32(toChannel(b), 16), alpha));
+
+            const __m128i mask = _mm_castps_si128(passed);
+            const __m128i previousColor = _mm_loadu_si128(reinterpret_cast<const __m128i*>(color + x));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(color + x), _mm_or_si128(_mm_and_si128(mask, packed), _mm_andnot_si128(mask, previousColor)));
+        }
+#endif
+
+        for (; x <= last; x++) {
+            const float b1 = b1First + float(x - first) * triangle.b1dx;
+            const float b2 = b2First + float(x - first) * triangle.b2dx;
+            const float z = base[0] + delta1[0] * b1 + delta2[0] * b2;
+
+            if (z >= depth[x]) {
+                continue;
+            }
+
+            depth[x] = z;
+
+            const float invW = 1.0f / (base[1] + delta1[1] * b1 + delta2[1] * b2);
+
+            glm::vec3 shaded = glm::vec3{
+                base[2] + delta1[2] * b1 + delta2[2] * b2,
+                base[3] + delta1[3] * b1 + delta2[3] * b2,
+                base[4] + delta1[4] * b1 + delta2[4] * b2
+            } * invW;
+
+            if (texture) {
+                const float u = (base[5] + delta1[5] * b1 + delta2[5] * b2) * invW;
+                const float v = (base[6] + delta1[6] * b1 + delta2[6] * b2) * invW;
+
+                shaded = shaded * sampleTexture(u, v, invW);
+            }
+
+            color[x] = packColor(shaded);
+        }
+    }
+}
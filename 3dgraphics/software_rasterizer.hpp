@@ -0,0 +1,191 @@
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class ThreadPool;
+
+
+// RGBA8 texels, with red in the lowest byte, and the full mip chain. the first row is v = 0, as in the GL textures
+struct SoftTexture {
+    struct Level {
+        unsigned int width = 0;
+        unsigned int height = 0;
+        std::vector<std::uint32_t> texels;
+    };
+
+    std::vector<Level> levels;
+
+    // bilinear filtering of the mip level nearest to lod, with repeat wrapping
+    glm::vec4 sample(const glm::vec2 &texCoord, float lod) const;
+};
+
+
+// builds the mip chain of an image with 1 to 4 channels of 8 bits
+SoftTexture createSoftTexture(unsigned int width, unsigned int height, unsigned int channels, const std::uint8_t *pixels);
+
+
+struct SoftMaterial {
+    glm::vec4 ambient = {1.0f, 1.0f, 1.0f, 1.0f};
+    glm::vec4 diffuse = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    // index in the scene textures, -1 for none
+    int diffuseTexture = -1;
+};
+
+
+// a triangle list. the normals and texture coordinates are optional
+struct SoftMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<std::uint32_t> indices;
+
+    int material = -1;
+};
+
+
+struct SoftInstance {
+    std::uint32_t mesh = 0;
+    glm::mat4 model = glm::mat4(1.0f);
+};
+
+
+// the meshes, materials and node transforms of a scene, without any GPU object
+struct SoftScene {
+    std::vector<SoftMesh> meshes;
+    std::vector<SoftMaterial> materials;
+    std::vector<SoftTexture> textures;
+    std::vector<SoftInstance> instances;
+};
+
+
+// the directional light of the gouraud shader
+struct SoftLight {
+    glm::vec3 direction = glm::normalize(glm::vec3{0.5f, 1.0f, 0.25f});
+    glm::vec4 ambient = {0.6f, 0.6f, 0.6f, 1.0f};
+    glm::vec4 diffuse = {0.8f, 0.8f, 0.8f, 0.8f};
+    glm::vec4 globalAmbient = {0.1f, 0.1f, 0.1f, 1.0f};
+};
+
+
+// RGBA8 colors and depths, with the first row at the top of the image
+struct SoftFramebuffer {
+    unsigned int width = 0;
+    unsigned int height = 0;
+
+    std::vector<std::uint32_t> color;
+    std::vector<float> depth;
+
+    void resize(unsigned int width, unsigned int height);
+};
+
+
+// the framebuffer color of a linear color, clamped to [0, 1]
+std::uint32_t packColor(const glm::vec3 &color);
+
+
+struct SoftRasterParams {
+    // square screen tiles, rasterized in parallel
+    unsigned int tileSize = 64;
+
+    // the GL renderer draws both sides unless the meshlet culling is on
+    bool cullBackFaces = false;
+
+    std::uint32_t clearColor = 0xFF000000;
+};
+
+
+struct SoftRasterStats {
+    // triangles of the instances, and the ones left to rasterize after the culling and the clipping
+    size_t trianglesSubmitted = 0;
+    size_t trianglesRasterized = 0;
+
+    // triangle references over all the tiles
+    size_t binnedTriangles = 0;
+};
+
+
+// Renders a scene with the gouraud shading model into an in-memory framebuffer, for machines without a GPU.
+// The frame goes through three parallel passes over the thread pool: vertex lighting and transform, triangle
+// clipping, setup and binning into screen tiles, and rasterization of each tile on its own. Every tile walks
+// its triangles in submission order, so the output doesn't depend on the thread count. The triangles are
+// snapped to 1/16 of a pixel, and rasterized as spans of the top-left rule with perspective correct attributes.
+class SoftwareRasterizer {
+public:
+    SoftwareRasterizer(ThreadPool &threadPool, const SoftRasterParams &params = {});
+
+    SoftRasterStats render(const SoftScene &scene, const glm::mat4 &view, const glm::mat4 &proj, const SoftLight &light, SoftFramebuffer &framebuffer);
+
+private:
+    // a lit vertex in clip space
+    struct ShadedVertex {
+        glm::vec4 position;
+        glm::vec3 color;
+        glm::vec2 texCoord;
+    };
+
+    // the triangle in subpixels, and its attributes as planes of the barycentric coordinates
+    struct SetupTriangle {
+        std::int32_t x[3];
+        std::int32_t y[3];
+        std::int64_t area;
+
+        // covered pixels, inclusive
+        int minX, minY, maxX, maxY;
+
+        // depth, 1/w, color/w and texCoord/w at the first vertex, and their changes towards the two others
+        float base[7];
+        float delta1[7];
+        float delta2[7];
+
+        // barycentric changes per pixel, for the texture level of detail
+        float b1dx, b1dy, b2dx, b2dy;
+
+        const SoftTexture *texture;
+    };
+
+    // a range of vertices or triangles of an instance, processed by a single task
+    struct Batch {
+        std::uint32_t instance;
+        std::uint32_t first;
+        std::uint32_t count;
+    };
+
+    struct BinningJob {
+        std::vector<SetupTriangle> triangles;
+
+        // indices of triangles overlapping each tile
+        std::vector<std::vector<std::uint32_t>> tiles;
+    };
+
+    void shadeVertices(const SoftScene &scene, const Batch &batch, const glm::mat4 &viewProj, const SoftLight &light);
+
+    void setupTriangles(const SoftScene &scene, const Batch &batch, BinningJob &job);
+
+    void clipTriangle(const ShadedVertex &a, const ShadedVertex &b, const ShadedVertex &c, const SoftTexture *texture, BinningJob &job);
+
+    void addTriangle(const ShadedVertex &a, const ShadedVertex &b, const ShadedVertex &c, const SoftTexture *texture, BinningJob &job);
+
+    void rasterizeTile(size_t tile, SoftFramebuffer &framebuffer) const;
+
+    void rasterizeTriangle(const SetupTriangle &triangle, int minX, int minY, int maxX, int maxY, SoftFramebuffer &framebuffer) const;
+
+private:
+    ThreadPool &threadPool;
+    const SoftRasterParams params;
+
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int tilesX = 0;
+    unsigned int tilesY = 0;
+
+    // kept between frames, so the steady state doesn't allocate
+    std::vector<ShadedVertex> vertices;
+    std::vector<size_t> instanceVertexOffsets;
+    std::vector<Batch> vertexBatches;
+    std::vector<Batch> triangleBatches;
+    std::vector<BinningJob> jobs;
+};
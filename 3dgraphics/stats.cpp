@@ -0,0 +1,628 @@
+
+// imports a scene readable by Assimp as 3dgraphics does, without opening a window, and writes a JSON report: the time
+// each stage of the import takes and the peak memory of the process after it, and the bytes of every mesh and texture
+// once converted for the GL. the glTF scenes the viewer reads without Assimp are read the same way here. meant to find
+// the assets that blow the load time budget.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <glm/glm.hpp>
+#include <il.h>
+#include <ilu.h>
+
+#include "gltf_loader.hpp"
+#include "json.hpp"
+#include "parse_utils.hpp"
+#include "path_utils.hpp"
+#include "texture_resolver.hpp"
+#include "thread_pool.hpp"
+#include "vertex_weld.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#   define STATS_USE_RUSAGE
+#   include <sys/resource.h>
+#elif defined(_WIN32)
+#   define STATS_USE_PSAPI
+#   include <windows.h>
+#   include <psapi.h>
+#endif
+
+
+struct ImportStep {
+    unsigned int flag;
+    const char *name;
+};
+
+
+// the post-processing steps of 3dgraphics, in the order Assimp runs them. they are applied one at a time, so each
+// can be timed. aiProcess_JoinIdenticalVertices only runs with --assimp-weld, weldVertices() does its job otherwise
+const ImportStep ImportSteps[] = {
+    {aiProcess_ValidateDataStructure, "validate data structure"},
+    {aiProcess_Triangulate, "triangulate"},
+    {aiProcess_GenNormals, "generate normals"},
+    {aiProcess_JoinIdenticalVertices, "join identical vertices"},
+    {aiProcess_LimitBoneWeights, "limit bone weights"}
+};
+
+
+// the texture types sampled by 3dgraphics, and their names in the report
+const std::pair<aiTextureType, const char*> TextureTypes[] = {
+    {aiTextureType_DIFFUSE, "diffuse"},
+    {aiTextureType_BASE_COLOR, "base color"},
+    {aiTextureType_METALNESS, "metalness"},
+    {aiTextureType_DIFFUSE_ROUGHNESS, "roughness"},
+    {aiTextureType_NORMALS, "normals"},
+    {aiTextureType_OPACITY, "opacity"}
+};
+
+
+struct Options {
+    std::string sceneFilePath;
+    std::string outputPath;
+
+    // zero for one per hardware thread
+    unsigned int threads = 0;
+
+    bool assimpWeld = false;
+
+    WeldParams weldParams;
+};
+
+
+struct StageStats {
+    std::string name;
+    double milliseconds = 0.0;
+    size_t peakMemory = 0;
+};
+
+
+struct TextureStats {
+    std::string path;
+    unsigned int width = 0;
+    unsigned int height = 0;
+    size_t bytes = 0;
+    double milliseconds = 0.0;
+    bool decoded = false;
+};
+
+
+struct MaterialTexture {
+    const char *type = nullptr;
+    std::string reference;
+
+    // empty when the reference can't be resolved
+    std::string path;
+
+    // the encoded image, for the ones stored in a glTF buffer
+    const std::uint8_t *data = nullptr;
+    size_t size = 0;
+};
+
+
+struct MaterialStats {
+    std::string name;
+    std::vector<MaterialTexture> textures;
+};
+
+
+struct MeshStats {
+    std::string name;
+
+    // -1 for none
+    int material = -1;
+
+    size_t vertices = 0;
+    size_t triangles = 0;
+    size_t bones = 0;
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+    size_t textureBytes = 0;
+};
+
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        if (arg == "--output" && i + 1 < argc) {
+            options.outputPath = argv[++i];
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::stoul(argv[++i]);
+        }
+        else if (arg == "--assimp-weld") {
+            options.assimpWeld = true;
+        }
+        else if (arg == "--weld-epsilon" && i + 3 < argc) {
+            WeldParams &params = options.weldParams;
+
+            if (!parseEpsilon(argv[++i], params.positionEpsilon) || !parseEpsilon(argv[++i], params.normalEpsilon) || !parseEpsilon(argv[++i], params.texCoordEpsilon)) {
+                std::cerr << "Invalid weld epsilon" << std::endl;
+                return false;
+            }
+        }
+        else if (options.sceneFilePath.empty()) {
+            options.sceneFilePath = arg;
+        }
+        else {
+            return false;
+        }
+    }
+
+    return !options.sceneFilePath.empty();
+}
+
+
+// the peak resident memory of the process so far, zero where it can't be queried
+size_t getPeakMemory() {
+#if defined(STATS_USE_RUSAGE)
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+
+#   if defined(__APPLE__)
+    return size_t(usage.ru_maxrss);
+#   else
+    return size_t(usage.ru_maxrss) * 1024;
+#   endif
+#elif defined(STATS_USE_PSAPI)
+    PROCESS_MEMORY_COUNTERS counters {};
+
+    return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? size_t(counters.PeakWorkingSetSize) : 0;
+#else
+    return 0;
+#endif
+}
+
+
+double measure(const std::function<void()> &task) {
+    const auto start = std::chrono::steady_clock::now();
+    task();
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+// decodes the image as the texture repository of 3dgraphics does, to RGB bytes. from the encoded image when given
+TextureStats decodeTexture(const std::string &filePath, const std::uint8_t *encoded, const size_t encodedSize) {
+    TextureStats stats;
+    stats.path = filePath;
+
+    ILuint imageID;
+
+    ilGenImages(1, &imageID);
+    ilBindImage(imageID);
+
+    stats.milliseconds = measure([&]() {
+        const ILboolean loaded = encoded ? ilLoadL(IL_TYPE_UNKNOWN, encoded, static_cast<ILuint>(encodedSize)) : ilLoadImage(filePath.c_str());
+
+        if (! loaded) {
+            const ILenum error = ilGetError();
+            std::cerr << "Image load failed: \"" << filePath << "\" - IL reports error: " << error << " - " << iluErrorString(error) << std::endl;
+
+            return;
+        }
+
+        iluFlipImage();
+
+        if (! ilConvertImage(IL_RGB, IL_UNSIGNED_BYTE)) {
+            const ILenum error = ilGetError();
+            std::cerr << "Image conversion failed: \"" << filePath << "\" - IL reports error: " << error << " - " << iluErrorString(error) << std::endl;
+
+            return;
+        }
+
+        stats.width = ilGetInteger(IL_IMAGE_WIDTH);
+        stats.height = ilGetInteger(IL_IMAGE_HEIGHT);
+        stats.bytes = size_t(stats.width) * stats.height * ilGetInteger(IL_IMAGE_BPP);
+        stats.decoded = true;
+    });
+
+    ilDeleteImages(1, &imageID);
+
+    return stats;
+}
+
+
+MaterialStats resolveMaterial(TextureResolver &textureResolver, const aiMaterial *aimaterial) {
+    MaterialStats stats;
+    stats.name = aimaterial->GetName().C_Str();
+
+    for (const auto &[type, typeName] : TextureTypes) {
+        aiString fileName;
+        aimaterial->GetTexture(type, 0, &fileName);
+
+        if (fileName.length > 0) {
+            stats.textures.push_back({typeName, fileName.C_Str(), textureResolver.resolve(fileName.C_Str())});
+        }
+    }
+
+    return stats;
+}
+
+
+// the images of the material, with the names the texture repository of 3dgraphics gives them
+MaterialStats resolveMaterial(const std::string &filePath, const GltfDocument &document, const GltfMaterial &material) {
+    MaterialStats stats;
+    stats.name = material.name;
+
+    const std::pair<int, const char*> images[] = {
+        {material.baseColorImage, "base color"},
+        {material.metallicRoughnessImage, "metallic roughness"},
+        {material.normalImage, "normals"}
+    };
+
+    for (const auto &[index, typeName] : images) {
+        if (index < 0) {
+            continue;
+        }
+
+        const GltfImage &image = document.images[index];
+
+        if (image.uri.empty()) {
+            const std::string name = "#image" + std::to_string(index);
+            stats.textures.push_back({typeName, name, filePath + name, image.data, image.size});
+        }
+        else {
+            stats.textures.push_back({typeName, image.uri, std::string{parent_path(filePath)} + image.uri});
+        }
+    }
+
+    return stats;
+}
+
+
+// builds the arrays that createMeshVAO() uploads, and counts their bytes
+MeshStats convertMesh(const aiMesh *mesh) {
+    MeshStats stats;
+    stats.name = mesh->mName.C_Str();
+    stats.material = int(mesh->mMaterialIndex);
+    stats.vertices = mesh->mNumVertices;
+    stats.bones = mesh->mNumBones;
+
+    std::vector<glm::vec3> positions {reinterpret_cast<const glm::vec3*>(mesh->mVertices), reinterpret_cast<const glm::vec3*>(mesh->mVertices) + mesh->mNumVertices};
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<unsigned int> indices;
+
+    if (mesh->HasNormals()) {
+        normals.assign(reinterpret_cast<const glm::vec3*>(mesh->mNormals), reinterpret_cast<const glm::vec3*>(mesh->mNormals) + mesh->mNumVertices);
+    }
+
+    if (mesh->mTextureCoords[0]) {
+        texCoords.resize(mesh->mNumVertices);
+
+        for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+            texCoords[i] = {mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y};
+        }
+    }
+
+    indices.reserve(size_t(mesh->mNumFaces) * 3);
+
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+        const aiFace &face = mesh->mFaces[i];
+
+        if (face.mNumIndices == 3) {
+            indices.insert(indices.end(), face.mIndices, face.mIndices + 3);
+        }
+    }
+
+    stats.triangles = indices.size() / 3;
+    stats.vertexBytes = positions.size() * sizeof(glm::vec3) + normals.size() * sizeof(glm::vec3) + texCoords.size() * sizeof(glm::vec2);
+    stats.indexBytes = indices.size() * sizeof(unsigned int);
+
+    return stats;
+}
+
+
+// counts the bytes createMeshVAO() uploads for the primitive. without normals every triangle gets vertices of its
+// own, for the flat normals, and the indices are dropped
+MeshStats convertMesh(const GltfPrimitive &primitive, const size_t index) {
+    MeshStats stats;
+    stats.name = "primitive " + std::to_string(index);
+    stats.material = primitive.material;
+    stats.vertices = primitive.positions.count;
+    stats.triangles = (primitive.indices.empty() ? primitive.positions.count : primitive.indices.count) / 3;
+
+    size_t indexCount = primitive.indices.empty() ? 0 : primitive.indices.count;
+
+    if (primitive.normals.empty()) {
+        stats.vertices = stats.triangles * 3;
+        indexCount = 0;
+    }
+
+    stats.vertexBytes = stats.vertices * (2 * sizeof(glm::vec3) + (primitive.texCoords.empty() ? 0 : sizeof(glm::vec2)));
+    stats.indexBytes = indexCount * sizeof(unsigned int);
+
+    return stats;
+}
+
+
+void writeReport(JsonWriter &json, const Options &options, const std::vector<StageStats> &stages, const std::vector<MaterialStats> &materials, const std::vector<TextureStats> &textures, const std::vector<MeshStats> &meshes) {
+    auto writeMemory = [&](const size_t bytes) {
+        if (bytes > 0) {
+            json.number(double(bytes));
+        }
+        else {
+            json.null();
+        }
+    };
+
+    json.beginObject();
+    json.key("scene").string(options.sceneFilePath);
+
+    double totalMilliseconds = 0.0;
+
+    json.key("stages").beginArray();
+
+    for (const StageStats &stage : stages) {
+        json.beginObject();
+        json.key("name").string(stage.name);
+        json.key("milliseconds").number(stage.milliseconds);
+        json.key("peakMemoryBytes");
+        writeMemory(stage.peakMemory);
+        json.endObject();
+
+        totalMilliseconds += stage.milliseconds;
+    }
+
+    json.endArray();
+
+    json.key("totalMilliseconds").number(totalMilliseconds);
+    json.key("peakMemoryBytes");
+    writeMemory(getPeakMemory());
+
+    json.key("materials").beginArray();
+
+    for (const MaterialStats &material : materials) {
+        json.beginObject();
+        json.key("name").string(material.name);
+        json.key("textures").beginArray();
+
+        for (const MaterialTexture &texture : material.textures) {
+            json.beginObject();
+            json.key("type").string(texture.type);
+            json.key("reference").string(texture.reference);
+            json.key("path");
+
+            if (texture.path.empty()) {
+                json.null();
+            }
+            else {
+                json.string(texture.path);
+            }
+
+            json.endObject();
+        }
+
+        json.endArray();
+        json.endObject();
+    }
+
+    json.endArray();
+
+    size_t textureBytes = 0;
+
+    json.key("textures").beginArray();
+
+    for (const TextureStats &texture : textures) {
+        json.beginObject();
+        json.key("path").string(texture.path);
+        json.key("decoded").boolean(texture.decoded);
+        json.key("width").number(texture.width);
+        json.key("height").number(texture.height);
+        json.key("bytes").number(double(texture.bytes));
+        json.key("milliseconds").number(texture.milliseconds);
+        json.endObject();
+
+        textureBytes += texture.bytes;
+    }
+
+    json.endArray();
+
+    MeshStats totals;
+
+    json.key("meshes").beginArray();
+
+    for (const MeshStats &mesh : meshes) {
+        json.beginObject();
+        json.key("name").string(mesh.name);
+        json.key("material");
+
+        if (mesh.material < 0) {
+            json.null();
+        }
+        else {
+            json.number(mesh.material);
+        }
+
+        json.key("vertices").number(double(mesh.vertices));
+        json.key("triangles").number(double(mesh.triangles));
+        json.key("bones").number(double(mesh.bones));
+        json.key("vertexBytes").number(double(mesh.vertexBytes));
+        json.key("indexBytes").number(double(mesh.indexBytes));
+        json.key("textureBytes").number(double(mesh.textureBytes));
+        json.endObject();
+
+        totals.vertices += mesh.vertices;
+        totals.triangles += mesh.triangles;
+        totals.vertexBytes += mesh.vertexBytes;
+        totals.indexBytes += mesh.indexBytes;
+    }
+
+    json.endArray();
+
+    // each texture counts once, however many meshes share it
+    json.key("totals").beginObject();
+    json.key("vertices").number(double(totals.vertices));
+    json.key("triangles").number(double(totals.triangles));
+    json.key("vertexBytes").number(double(totals.vertexBytes));
+    json.key("indexBytes").number(double(totals.indexBytes));
+    json.key("textureBytes").number(double(textureBytes));
+    json.endObject();
+
+    json.endObject();
+}
+
+
+int main(int argc, char **argv) {
+    Options options;
+
+    if (!parseOptions(argc, argv, options)) {
+        std::cout << "usage: 3dgraphics-stats <scene file> [--output <report.json>] [--threads <count>] [--assimp-weld] [--weld-epsilon <position> <normal> <texcoord>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    ilInit();
+    iluInit();
+
+    // the calling thread takes part in the welding, the pool has the rest
+    ThreadPool threadPool {int(options.threads) - 1};
+
+    std::vector<StageStats> stages;
+
+    auto runStage = [&](const std::string &name, const std::function<void()> &task) {
+        const double milliseconds = measure(task);
+
+        stages.push_back({name, milliseconds, getPeakMemory()});
+    };
+
+    // the static glTF scenes skip Assimp, as in 3dgraphics
+    GltfDocument gltf;
+    bool gltfFastPath = false;
+
+    if (isGltfFile(options.sceneFilePath)) {
+        runStage("read glTF", [&]() {
+            // loadGltf tells on stdout why it falls back to Assimp, where the report may go
+            std::streambuf *output = std::cout.rdbuf(std::cerr.rdbuf());
+            gltfFastPath = loadGltf(options.sceneFilePath, gltf);
+            std::cout.rdbuf(output);
+        });
+    }
+
+    Assimp::Importer importer;
+    const aiScene *scene = nullptr;
+
+    if (! gltfFastPath) {
+        runStage("read", [&]() {
+            scene = importer.ReadFile(options.sceneFilePath, 0);
+        });
+
+        for (const ImportStep &step : ImportSteps) {
+            if (!scene || (step.flag == aiProcess_JoinIdenticalVertices && !options.assimpWeld)) {
+                continue;
+            }
+
+            runStage(step.name, [&]() {
+                scene = importer.ApplyPostProcessing(step.flag);
+            });
+        }
+
+        if (!scene) {
+            std::cerr << importer.GetErrorString() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (! options.assimpWeld) {
+            runStage("weld vertices", [&]() {
+                weldVertices(const_cast<aiScene*>(scene), options.weldParams, &threadPool);
+            });
+        }
+    }
+
+    std::vector<MaterialStats> materials;
+
+    runStage("resolve materials", [&]() {
+        if (gltfFastPath) {
+            for (const GltfMaterial &material : gltf.materials) {
+                materials.push_back(resolveMaterial(options.sceneFilePath, gltf, material));
+            }
+
+            return;
+        }
+
+        TextureResolver textureResolver {parent_path(options.sceneFilePath)};
+
+        for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
+            materials.push_back(resolveMaterial(textureResolver, scene->mMaterials[i]));
+        }
+    });
+
+    // the files shared by several materials are decoded once, as the texture repository caches them
+    std::vector<TextureStats> textures;
+    std::map<std::string, size_t> textureIndices;
+
+    runStage("decode textures", [&]() {
+        for (const MaterialStats &material : materials) {
+            for (const MaterialTexture &texture : material.textures) {
+                if (!texture.path.empty() && textureIndices.count(texture.path) == 0) {
+                    textureIndices[texture.path] = textures.size();
+                    textures.push_back(decodeTexture(texture.path, texture.data, texture.size));
+                }
+            }
+        }
+    });
+
+    std::vector<MeshStats> meshes;
+
+    runStage("convert meshes", [&]() {
+        if (gltfFastPath) {
+            for (size_t i = 0; i < gltf.primitives.size(); i++) {
+                meshes.push_back(convertMesh(gltf.primitives[i], i));
+            }
+
+            return;
+        }
+
+        for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+            meshes.push_back(convertMesh(scene->mMeshes[i]));
+        }
+    });
+
+    for (MeshStats &mesh : meshes) {
+        if (mesh.material < 0 || size_t(mesh.material) >= materials.size()) {
+            continue;
+        }
+
+        std::set<size_t> meshTextures;
+
+        for (const MaterialTexture &texture : materials[mesh.material].textures) {
+            if (! texture.path.empty()) {
+                meshTextures.insert(textureIndices[texture.path]);
+            }
+        }
+
+        for (const size_t texture : meshTextures) {
+            mesh.textureBytes += textures[texture].bytes;
+        }
+    }
+
+    if (options.outputPath.empty()) {
+        JsonWriter json {std::cout};
+        writeReport(json, options, stages, materials, textures, meshes);
+    }
+    else {
+        std::ofstream file {options.outputPath};
+        JsonWriter json {file};
+        writeReport(json, options, stages, materials, textures, meshes);
+
+        if (! file) {
+            std::cerr << "Can't write " << options.outputPath << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
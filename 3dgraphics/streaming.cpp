@@ -0,0 +1,162 @@
+
+#include "streaming.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+
+SceneStreamer::SceneStreamer(const TiledSceneReader &reader, const StreamingParams &params) : reader(reader), params(params) {
+    const size_t chunkCount = reader.getChunks().size();
+
+    states.resize(chunkCount, ChunkState::Unloaded);
+    distances.resize(chunkCount, 0.0f);
+    desired.resize(chunkCount, 0);
+
+    for (unsigned int i = 0; i < std::max(params.ioThreads, 1u); i++) {
+        ioThreads.emplace_back(&SceneStreamer::ioThreadMain, this);
+    }
+}
+
+
+SceneStreamer::~SceneStreamer() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        quit = true;
+    }
+
+    requestsChanged.notify_all();
+
+    for (std::thread &thread : ioThreads) {
+        thread.join();
+    }
+}
+
+
+void SceneStreamer::update(const glm::vec3 &cameraPosition, StreamingEvents &events) {
+    const std::vector<TiledChunk> &chunks = reader.getChunks();
+
+    // rank the chunks in range by their distance to the camera
+    candidates.clear();
+
+    for (std::uint32_t i = 0; i < chunks.size(); i++) {
+        const glm::vec3 closest = glm::clamp(cameraPosition, chunks[i].boxMin, chunks[i].boxMax);
+
+        distances[i] = glm::distance(cameraPosition, closest);
+
+        if (distances[i] <= params.loadRadius && states[i] != ChunkState::Failed) {
+            candidates.push_back(i);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [this](const std::uint32_t a, const std::uint32_t b) {
+        return distances[a] < distances[b];
+    });
+
+    // the working set is made of the nearest chunks that fit in the budget
+    std::fill(desired.begin(), desired.end(), 0);
+
+    size_t desiredBytes = 0;
+
+    for (const std::uint32_t chunk : candidates) {
+        if (desiredBytes + chunks[chunk].getDataSize() > params.memoryBudget) {
+            continue;
+        }
+
+        desired[chunk] = 1;
+        desiredBytes += chunks[chunk].getDataSize();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        for (const std::uint32_t chunk : failed) {
+            std::cout << "Failed to read chunk " << chunk << std::endl;
+            states[chunk] = ChunkState::Failed;
+        }
+
+        failed.clear();
+
+        while (!completed.empty()) {
+            pendingUploads.push_back(std::move(completed.front()));
+            completed.pop_front();
+        }
+
+        // the requests not picked by the I/O threads yet are replaced by the ones of the new working set, nearest first
+        for (const std::uint32_t chunk : requests) {
+            states[chunk] = ChunkState::Unloaded;
+        }
+
+        requests.clear();
+
+        for (const std::uint32_t chunk : candidates) {
+            if (desired[chunk] && states[chunk] == ChunkState::Unloaded) {
+                states[chunk] = ChunkState::Requested;
+                requests.push_back(chunk);
+            }
+        }
+    }
+
+    requestsChanged.notify_all();
+
+    // hand the loaded chunks to the render thread, dropping the ones that left the working set while loading
+    unsigned int uploads = 0;
+
+    while (!pendingUploads.empty() && uploads < params.maxUploadsPerFrame) {
+        auto &[chunk, data] = pendingUploads.front();
+
+        if (desired[chunk]) {
+            states[chunk] = ChunkState::Resident;
+            residentBytes += chunks[chunk].getDataSize();
+            events.loaded.emplace_back(chunk, std::move(data));
+            uploads++;
+        }
+        else {
+            states[chunk] = ChunkState::Unloaded;
+        }
+
+        pendingUploads.pop_front();
+    }
+
+    for (std::uint32_t i = 0; i < chunks.size(); i++) {
+        if (states[i] == ChunkState::Resident && !desired[i]) {
+            states[i] = ChunkState::Unloaded;
+            residentBytes -= chunks[i].getDataSize();
+            events.evicted.push_back(i);
+        }
+    }
+}
+
+
+void SceneStreamer::ioThreadMain() {
+    while (true) {
+        std::uint32_t chunk = 0;
+
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+
+            requestsChanged.wait(lock, [this] {
+                return quit || !requests.empty();
+            });
+
+            if (quit) {
+                return;
+            }
+
+            chunk = requests.front();
+            requests.pop_front();
+        }
+
+        ChunkData data;
+        const bool ok = reader.readChunk(chunk, data);
+
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (ok) {
+            completed.emplace_back(chunk, std::move(data));
+        }
+        else {
+            failed.push_back(chunk);
+        }
+    }
+}
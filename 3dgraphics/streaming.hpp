@@ -0,0 +1,92 @@
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "tiled_scene.hpp"
+
+
+struct StreamingParams {
+    // upper bound for the geometry bytes of the chunks that are resident, or being loaded, once decoded
+    size_t memoryBudget = size_t(512) * 1024 * 1024;
+
+    // chunks farther than this from the camera are never requested
+    float loadRadius = 250.0f;
+
+    // the threads also decode the compressed chunks, one chunk each at a time
+    unsigned int ioThreads = 2;
+
+    // caps the GL uploads done by a single frame, to avoid hitches
+    unsigned int maxUploadsPerFrame = 8;
+};
+
+
+struct StreamingEvents {
+    // chunks that finished loading. the render thread must upload them
+    std::vector<std::pair<std::uint32_t, ChunkData>> loaded;
+
+    // chunks that left the working set. the render thread must release them
+    std::vector<std::uint32_t> evicted;
+};
+
+
+// Pages the chunks of a tiled scene in and out around the camera. The chunk payloads are read on
+// background threads; update() is the only entry point, and must be called from the render thread.
+class SceneStreamer {
+public:
+    SceneStreamer(const TiledSceneReader &reader, const StreamingParams &params);
+
+    ~SceneStreamer();
+
+    SceneStreamer(const SceneStreamer&) = delete;
+    SceneStreamer& operator=(const SceneStreamer&) = delete;
+
+    void update(const glm::vec3 &cameraPosition, StreamingEvents &events);
+
+    bool isResident(const std::uint32_t chunk) const {
+        return states[chunk] == ChunkState::Resident;
+    }
+
+    size_t getResidentBytes() const {
+        return residentBytes;
+    }
+
+private:
+    enum class ChunkState : std::uint8_t {
+        Unloaded,
+        Requested,
+        Resident,
+        Failed
+    };
+
+    void ioThreadMain();
+
+private:
+    const TiledSceneReader &reader;
+    const StreamingParams params;
+
+    // only touched by the render thread
+    std::vector<ChunkState> states;
+    std::vector<std::uint32_t> candidates;
+    std::vector<float> distances;
+    std::vector<std::uint8_t> desired;
+    std::deque<std::pair<std::uint32_t, ChunkData>> pendingUploads;
+    size_t residentBytes = 0;
+
+    // shared with the I/O threads
+    std::mutex mutex;
+    std::condition_variable requestsChanged;
+    std::deque<std::uint32_t> requests;
+    std::deque<std::pair<std::uint32_t, ChunkData>> completed;
+    std::vector<std::uint32_t> failed;
+    bool quit = false;
+
+    std::vector<std::thread> ioThreads;
+};
@@ -0,0 +1,97 @@
+
+#include "texture_resolver.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+
+#include "path_utils.hpp"
+
+
+static std::string toLower(std::string_view str) {
+    std::string result{str};
+
+    std::transform(result.begin(), result.end(), result.begin(), [](const unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+
+    return result;
+}
+
+
+TextureResolver::TextureResolver(const std::string_view sceneParentPath) : sceneParentPath(normalize_path(sceneParentPath)) {
+    if (!this->sceneParentPath.empty() && this->sceneParentPath.back() != '/') {
+        this->sceneParentPath += '/';
+    }
+}
+
+
+const TextureResolver::DirectoryListing& TextureResolver::getListing(const std::string &directory) {
+    if (auto it = directories.find(directory); it != directories.end()) {
+        return it->second;
+    }
+
+    DirectoryListing &listing = directories[directory];
+
+    // missing directories (typically absolute paths from the authoring machine) are cached as empty listings
+    std::error_code error;
+    std::filesystem::directory_iterator it{directory.empty() ? "." : directory, error};
+
+    for (; !error && it != std::filesystem::directory_iterator{}; it.increment(error)) {
+        const std::string fileName = it->path().filename().generic_string();
+
+        listing.files.insert(fileName);
+        listing.lowercaseFiles.emplace(toLower(fileName), fileName);
+    }
+
+    return listing;
+}
+
+
+bool TextureResolver::find(const std::string &directory, const std::string_view fileName, std::string &result) {
+    const DirectoryListing &listing = getListing(directory);
+
+    if (listing.files.count(std::string{fileName})) {
+        result = directory + std::string{fileName};
+        return true;
+    }
+
+    if (auto it = listing.lowercaseFiles.find(toLower(fileName)); it != listing.lowercaseFiles.end()) {
+        result = directory + it->second;
+        return true;
+    }
+
+    return false;
+}
+
+
+const std::string& TextureResolver::resolve(const std::string_view reference) {
+    const std::string key{reference};
+
+    if (auto it = resolvedReferences.find(key); it != resolvedReferences.end()) {
+        return it->second;
+    }
+
+    std::string &result = resolvedReferences[key];
+
+    if (reference.empty()) {
+        return result;
+    }
+
+    const std::string path = normalize_path(reference);
+    const bool absolute = path[0] == '/' || (path.size() > 1 && path[1] == ':');
+
+    const std::string directory = absolute
+        ? std::string{parent_path(path)}
+        : sceneParentPath + std::string{parent_path(path)};
+
+    // absolute paths usually come from the authoring machine, so also look for the file next to the scene
+    if (! find(directory, file_name(path), result)) {
+        if (! find(sceneParentPath, file_name(path), result)) {
+            std::cout << "Texture not found: " << reference << std::endl;
+        }
+    }
+
+    return result;
+}
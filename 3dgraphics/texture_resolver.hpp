@@ -0,0 +1,43 @@
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+
+// Maps the texture references found in a scene file to files on disk. Each directory is listed at most
+// once, and every lookup after that is served from memory, so resolving thousands of references costs
+// a handful of directory reads instead of one or two open() calls per reference.
+class TextureResolver {
+public:
+    // sceneParentPath is the directory of the scene file, where relative references are looked up
+    explicit TextureResolver(std::string_view sceneParentPath);
+
+    // returns the path of the referenced file, or an empty string when it can't be found
+    const std::string& resolve(std::string_view reference);
+
+    size_t getListedDirectoryCount() const {
+        return directories.size();
+    }
+
+private:
+    struct DirectoryListing {
+        std::unordered_set<std::string> files;
+
+        // lowercase file name -> actual file name, for references authored on case insensitive file systems
+        std::unordered_map<std::string, std::string> lowercaseFiles;
+    };
+
+    const DirectoryListing& getListing(const std::string &directory);
+
+    // looks up fileName inside directory. on success, writes the full path to result
+    bool find(const std::string &directory, std::string_view fileName, std::string &result);
+
+private:
+    std::string sceneParentPath;
+
+    std::unordered_map<std::string, DirectoryListing> directories;
+    std::unordered_map<std::string, std::string> resolvedReferences;
+};
@@ -0,0 +1,101 @@
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+
+ThreadPool::ThreadPool(int threadCount) {
+    if (threadCount < 0) {
+        threadCount = int(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+    }
+
+    for (int i = 0; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerMain, this);
+    }
+}
+
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        quit = true;
+    }
+
+    workAvailable.notify_all();
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+
+void ThreadPool::parallelFor(const size_t count, const std::function<void(size_t)> &task) {
+    // not worth waking up the workers
+    if (count <= 1 || workers.empty()) {
+        for (size_t i = 0; i < count; i++) {
+            task(i);
+        }
+
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        this->task = &task;
+        taskCount = count;
+        nextTask = 0;
+        busyWorkers = workers.size();
+        generation++;
+    }
+
+    workAvailable.notify_all();
+
+    runTasks();
+
+    std::unique_lock<std::mutex> lock{mutex};
+
+    workDone.wait(lock, [this] {
+        return busyWorkers == 0;
+    });
+
+    this->task = nullptr;
+}
+
+
+void ThreadPool::runTasks() {
+    for (size_t i = nextTask++; i < taskCount; i = nextTask++) {
+        (*task)(i);
+    }
+}
+
+
+void ThreadPool::workerMain() {
+    std::uint64_t lastGeneration = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+
+            workAvailable.wait(lock, [this, lastGeneration] {
+                return quit || generation != lastGeneration;
+            });
+
+            if (quit) {
+                return;
+            }
+
+            lastGeneration = generation;
+        }
+
+        runTasks();
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            if (--busyWorkers == 0) {
+                workDone.notify_one();
+            }
+        }
+    }
+}
@@ -0,0 +1,52 @@
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// A fixed set of worker threads for data parallel work. parallelFor() is meant to be called from a
+// single thread at a time, which takes part in the work and returns once every index is processed.
+class ThreadPool {
+public:
+    // the worker threads, besides the calling one. negative means one per hardware thread, minus the calling
+    // one, and zero runs every task on the calling thread
+    explicit ThreadPool(int threadCount = -1);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t getThreadCount() const {
+        return workers.size();
+    }
+
+    // calls task(i) for every i in [0, count), from any thread of the pool
+    void parallelFor(size_t count, const std::function<void(size_t)> &task);
+
+private:
+    void runTasks();
+
+    void workerMain();
+
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable workDone;
+
+    // the batch being processed. a new generation wakes the workers up
+    const std::function<void(size_t)> *task = nullptr;
+    size_t taskCount = 0;
+    std::atomic<size_t> nextTask {0};
+    std::uint64_t generation = 0;
+    size_t busyWorkers = 0;
+    bool quit = false;
+};
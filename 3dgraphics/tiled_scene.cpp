@@ -0,0 +1,245 @@
+
+#include "tiled_scene.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include "mesh_codec.hpp"
+
+
+template<typename T>
+static void write(std::ostream &os, const T &value) {
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+
+template<typename T>
+static void writeArray(std::ostream &os, const std::vector<T> &values) {
+    os.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+
+static void writeString(std::ostream &os, const std::string &str) {
+    write(os, static_cast<std::uint32_t>(str.size()));
+    os.write(str.data(), str.size());
+}
+
+
+template<typename T>
+static bool read(std::istream &is, T &value) {
+    return bool(is.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+
+template<typename T>
+static bool readArray(std::istream &is, std::vector<T> &values, const size_t count) {
+    values.resize(count);
+
+    return bool(is.read(reinterpret_cast<char*>(values.data()), count * sizeof(T)));
+}
+
+
+static bool readString(std::istream &is, std::string &str) {
+    std::uint32_t size = 0;
+
+    if (! read(is, size)) {
+        return false;
+    }
+
+    str.resize(size);
+
+    return bool(is.read(str.data(), size));
+}
+
+
+size_t ChunkData::byteSize() const {
+    return positions.size() * sizeof(glm::vec3)
+        + normals.size() * sizeof(glm::vec3)
+        + texCoords.size() * sizeof(glm::vec2)
+        + indices.size() * sizeof(std::uint32_t);
+}
+
+
+size_t TiledChunk::getDataSize() const {
+    return vertexCount * (2 * sizeof(glm::vec3) + sizeof(glm::vec2)) + indexCount * sizeof(std::uint32_t);
+}
+
+
+bool TiledSceneWriter::open(const std::string &filePath, const ChunkEncoding encoding) {
+    this->encoding = encoding;
+
+    os.open(filePath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (! os.is_open()) {
+        return false;
+    }
+
+    // placeholder, patched by close()
+    write(os, TiledSceneHeader{});
+
+    return bool(os);
+}
+
+
+std::uint32_t TiledSceneWriter::addMaterial(const TiledMaterial &material) {
+    materials.push_back(material);
+
+    return static_cast<std::uint32_t>(materials.size() - 1);
+}
+
+
+void TiledSceneWriter::addChunk(const std::uint32_t material, const ChunkData &data) {
+    assert(material < materials.size());
+    assert(data.normals.size() == data.positions.size());
+    assert(data.texCoords.size() == data.positions.size());
+    assert(!data.indices.empty());
+
+    TiledChunk chunk;
+
+    chunk.boxMin = glm::vec3{ std::numeric_limits<float>::max()};
+    chunk.boxMax = glm::vec3{-std::numeric_limits<float>::max()};
+
+    for (const glm::vec3 &p : data.positions) {
+        chunk.boxMin = glm::min(chunk.boxMin, p);
+        chunk.boxMax = glm::max(chunk.boxMax, p);
+    }
+
+    chunk.material = material;
+    chunk.vertexCount = static_cast<std::uint32_t>(data.positions.size());
+    chunk.indexCount = static_cast<std::uint32_t>(data.indices.size());
+    chunk.encoding = encoding;
+    chunk.offset = static_cast<std::uint64_t>(os.tellp());
+
+    if (encoding == ChunkEncoding::Compressed) {
+        stream.clear();
+        encodeVertices(data.positions.data(), data.normals.data(), data.texCoords.data(), data.positions.size(), stream);
+
+        const auto vertexStreamSize = static_cast<std::uint32_t>(stream.size());
+        encodeIndices(data.indices.data(), data.indices.size(), stream);
+
+        write(os, vertexStreamSize);
+        writeArray(os, stream);
+
+        chunk.size = sizeof(vertexStreamSize) + stream.size();
+    }
+    else {
+        writeArray(os, data.positions);
+        writeArray(os, data.normals);
+        writeArray(os, data.texCoords);
+        writeArray(os, data.indices);
+
+        chunk.size = data.byteSize();
+    }
+
+    chunks.push_back(chunk);
+}
+
+
+bool TiledSceneWriter::close() {
+    TiledSceneHeader header;
+
+    header.materialCount = static_cast<std::uint32_t>(materials.size());
+    header.chunkCount = static_cast<std::uint32_t>(chunks.size());
+    header.directoryOffset = static_cast<std::uint64_t>(os.tellp());
+
+    for (const TiledMaterial &material : materials) {
+        write(os, material.ambient);
+        write(os, material.diffuse);
+        write(os, material.specular);
+        writeString(os, material.diffuseTexture);
+    }
+
+    for (const TiledChunk &chunk : chunks) {
+        write(os, chunk);
+    }
+
+    os.seekp(0);
+    write(os, header);
+    os.close();
+
+    return !os.fail();
+}
+
+
+bool TiledSceneReader::open(const std::string &filePath) {
+    std::ifstream is{filePath.c_str(), std::ios::in | std::ios::binary};
+
+    if (! is.is_open()) {
+        return false;
+    }
+
+    TiledSceneHeader header;
+
+    if (!read(is, header) || header.magic != TiledSceneMagic || header.version != TiledSceneVersion) {
+        return false;
+    }
+
+    is.seekg(header.directoryOffset);
+
+    materials.resize(header.materialCount);
+
+    for (TiledMaterial &material : materials) {
+        if (!read(is, material.ambient) || !read(is, material.diffuse) || !read(is, material.specular) || !readString(is, material.diffuseTexture)) {
+            return false;
+        }
+    }
+
+    if (! readArray(is, chunks, header.chunkCount)) {
+        return false;
+    }
+
+    this->filePath = filePath;
+
+    return true;
+}
+
+
+bool TiledSceneReader::readChunk(const std::uint32_t chunkIndex, ChunkData &data) const {
+    assert(chunkIndex < chunks.size());
+
+    const TiledChunk &chunk = chunks[chunkIndex];
+
+    std::ifstream is{filePath.c_str(), std::ios::in | std::ios::binary};
+
+    if (! is.is_open()) {
+        return false;
+    }
+
+    is.seekg(chunk.offset);
+
+    if (chunk.encoding == ChunkEncoding::Compressed) {
+        std::uint32_t vertexStreamSize = 0;
+        std::vector<std::uint8_t> stream;
+
+        if (!read(is, vertexStreamSize) || chunk.size < sizeof(vertexStreamSize) + vertexStreamSize || !readArray(is, stream, chunk.size - sizeof(vertexStreamSize))) {
+            return false;
+        }
+
+        data.positions.resize(chunk.vertexCount);
+        data.normals.resize(chunk.vertexCount);
+        data.texCoords.resize(chunk.vertexCount);
+        data.indices.resize(chunk.indexCount);
+
+        if (!decodeVertices(stream.data(), vertexStreamSize, chunk.vertexCount, data.positions.data(), data.normals.data(), data.texCoords.data()) ||
+            !decodeIndices(stream.data() + vertexStreamSize, stream.size() - vertexStreamSize, data.indices.data(), chunk.indexCount)) {
+            return false;
+        }
+    }
+    else if (!readArray(is, data.positions, chunk.vertexCount) || !readArray(is, data.normals, chunk.vertexCount) ||
+             !readArray(is, data.texCoords, chunk.vertexCount) || !readArray(is, data.indices, chunk.indexCount)) {
+        return false;
+    }
+
+    // a corrupt file must not reach the draws with indices past the vertices
+    return std::all_of(data.indices.begin(), data.indices.end(), [&chunk](const std::uint32_t index) {
+        return index < chunk.vertexCount;
+    });
+}
+
+
+bool isTiledSceneFile(const std::string &filePath) {
+    const std::string extension = ".tscene";
+
+    return filePath.size() > extension.size() && std::equal(extension.rbegin(), extension.rend(), filePath.rbegin());
+}
@@ -0,0 +1,126 @@
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+
+// On-disk layout of a tiled scene (all values little endian):
+//
+//   TiledSceneHeader
+//   chunk payloads, referenced by offset
+//   directory: materials followed by TiledChunk records
+//
+// a raw payload holds the positions, normals, texCoords and indices as they are in memory. a compressed one
+// holds the size of the vertex stream, then the vertex and index streams of mesh_codec.hpp.
+//
+// geometry is in world space, so a chunk can be drawn without any scene graph.
+const std::uint32_t TiledSceneMagic = 0x54474433; // "3DGT"
+const std::uint32_t TiledSceneVersion = 2;
+
+
+enum class ChunkEncoding : std::uint32_t {
+    Raw,
+    Compressed
+};
+
+
+struct TiledSceneHeader {
+    std::uint32_t magic = TiledSceneMagic;
+    std::uint32_t version = TiledSceneVersion;
+    std::uint32_t materialCount = 0;
+    std::uint32_t chunkCount = 0;
+    std::uint64_t directoryOffset = 0;
+};
+
+
+struct TiledMaterial {
+    glm::vec4 ambient = {1.0f, 1.0f, 1.0f, 1.0f};
+    glm::vec4 diffuse = {1.0f, 1.0f, 1.0f, 1.0f};
+    glm::vec4 specular = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    std::string diffuseTexture;
+};
+
+
+struct TiledChunk {
+    glm::vec3 boxMin = {0.0f, 0.0f, 0.0f};
+    glm::vec3 boxMax = {0.0f, 0.0f, 0.0f};
+
+    std::uint32_t material = 0;
+    std::uint32_t vertexCount = 0;
+    std::uint32_t indexCount = 0;
+    ChunkEncoding encoding = ChunkEncoding::Raw;
+
+    // payload location inside the file
+    std::uint64_t offset = 0;
+    std::uint64_t size = 0;
+
+    // the bytes of the geometry once read, the same as the size of the raw payloads
+    size_t getDataSize() const;
+};
+
+
+// the geometry of a single chunk, as stored in the file
+struct ChunkData {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<std::uint32_t> indices;
+
+    size_t byteSize() const;
+};
+
+
+class TiledSceneWriter {
+public:
+    bool open(const std::string &filePath, ChunkEncoding encoding = ChunkEncoding::Compressed);
+
+    std::uint32_t addMaterial(const TiledMaterial &material);
+
+    // writes the chunk payload right away, so only the directory is kept in memory
+    void addChunk(std::uint32_t material, const ChunkData &data);
+
+    // writes the directory and patches the header
+    bool close();
+
+    size_t chunkCount() const {
+        return chunks.size();
+    }
+
+private:
+    std::ofstream os;
+    ChunkEncoding encoding = ChunkEncoding::Compressed;
+    std::vector<std::uint8_t> stream;
+    std::vector<TiledMaterial> materials;
+    std::vector<TiledChunk> chunks;
+};
+
+
+class TiledSceneReader {
+public:
+    bool open(const std::string &filePath);
+
+    const std::vector<TiledMaterial>& getMaterials() const {
+        return materials;
+    }
+
+    const std::vector<TiledChunk>& getChunks() const {
+        return chunks;
+    }
+
+    // reads the payload of a chunk, and decodes it when compressed. each call opens its own stream, so it can be
+    // called from several threads at once, which then decode several chunks in parallel
+    bool readChunk(std::uint32_t chunk, ChunkData &data) const;
+
+private:
+    std::string filePath;
+    std::vector<TiledMaterial> materials;
+    std::vector<TiledChunk> chunks;
+};
+
+
+bool isTiledSceneFile(const std::string &filePath);
@@ -0,0 +1,235 @@
+
+// converts one or more scenes readable by Assimp into a single tiled scene, for out-of-core streaming.
+// inputs are imported one at a time, and chunks are written as soon as they are built, so the
+// converter only holds one input scene in memory.
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cmath>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "parse_utils.hpp"
+#include "path_utils.hpp"
+#include "texture_resolver.hpp"
+#include "tiled_scene.hpp"
+
+
+// each chunk is drawn with 32 bit indices, but smaller chunks stream with finer granularity
+const std::uint32_t MaxChunkVertices = 65536;
+
+
+TiledMaterial convertMaterial(TextureResolver &textureResolver, const aiMaterial *aimaterial) {
+    TiledMaterial material;
+
+    aiColor3D colorAmbient, colorDiffuse, colorSpecular;
+
+    aimaterial->Get(AI_MATKEY_COLOR_AMBIENT, colorAmbient);
+    aimaterial->Get(AI_MATKEY_COLOR_DIFFUSE, colorDiffuse);
+    aimaterial->Get(AI_MATKEY_COLOR_SPECULAR, colorSpecular);
+
+    material.ambient = glm::vec4{colorAmbient.r, colorAmbient.g, colorAmbient.b, 1.0f};
+    material.diffuse = glm::vec4{colorDiffuse.r, colorDiffuse.g, colorDiffuse.b, 1.0f};
+    material.specular = glm::vec4{colorSpecular.r, colorSpecular.g, colorSpecular.b, 1.0f};
+
+    aiString fileName;
+    aimaterial->GetTexture(aiTextureType_DIFFUSE, 0, &fileName);
+
+    if (fileName.length > 0) {
+        material.diffuseTexture = textureResolver.resolve(fileName.C_Str());
+    }
+
+    return material;
+}
+
+
+// splits the (world space) triangles of a mesh by the ground tile their centroid falls in
+void convertMesh(TiledSceneWriter &writer, const std::uint32_t material, const aiMesh *mesh, const float tileSize) {
+    std::unordered_map<std::uint64_t, std::vector<unsigned int>> tileTriangles;
+
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+        const aiFace &face = mesh->mFaces[i];
+
+        if (face.mNumIndices != 3) {
+            continue;
+        }
+
+        const aiVector3D &a = mesh->mVertices[face.mIndices[0]];
+        const aiVector3D &b = mesh->mVertices[face.mIndices[1]];
+        const aiVector3D &c = mesh->mVertices[face.mIndices[2]];
+
+        const auto tileX = static_cast<std::int32_t>(std::floor((a.x + b.x + c.x) / (3.0f * tileSize)));
+        const auto tileZ = static_cast<std::int32_t>(std::floor((a.z + b.z + c.z) / (3.0f * tileSize)));
+
+        const std::uint64_t key = (std::uint64_t(std::uint32_t(tileX)) << 32) | std::uint32_t(tileZ);
+
+        tileTriangles[key].push_back(i);
+    }
+
+    // maps a mesh vertex to its index inside the chunk being built
+    std::vector<std::uint32_t> remap(mesh->mNumVertices, ~0u);
+    std::vector<unsigned int> touched;
+
+    ChunkData chunk;
+
+    auto flush = [&]() {
+        if (! chunk.indices.empty()) {
+            writer.addChunk(material, chunk);
+        }
+
+        for (const unsigned int v : touched) {
+            remap[v] = ~0u;
+        }
+
+        touched.clear();
+        chunk = {};
+    };
+
+    for (const auto &[key, triangles] : tileTriangles) {
+        for (const unsigned int triangle : triangles) {
+            if (chunk.positions.size() + 3 > MaxChunkVertices) {
+                flush();
+            }
+
+            const aiFace &face = mesh->mFaces[triangle];
+
+            for (int k = 0; k < 3; k++) {
+                const unsigned int v = face.mIndices[k];
+
+                if (remap[v] == ~0u) {
+                    remap[v] = static_cast<std::uint32_t>(chunk.positions.size());
+                    touched.push_back(v);
+
+                    const aiVector3D &p = mesh->mVertices[v];
+                    chunk.positions.push_back({p.x, p.y, p.z});
+
+                    if (mesh->HasNormals()) {
+                        const aiVector3D &n = mesh->mNormals[v];
+                        chunk.normals.push_back({n.x, n.y, n.z});
+                    }
+                    else {
+                        chunk.normals.push_back({0.0f, 1.0f, 0.0f});
+                    }
+
+                    if (mesh->mTextureCoords[0]) {
+                        const aiVector3D &tc = mesh->mTextureCoords[0][v];
+                        chunk.texCoords.push_back({tc.x, tc.y});
+                    }
+                    else {
+                        chunk.texCoords.push_back({0.0f, 0.0f});
+                    }
+                }
+
+                chunk.indices.push_back(remap[v]);
+            }
+        }
+
+        flush();
+    }
+}
+
+
+bool convertScene(TiledSceneWriter &writer, const std::string &filePath, const float tileSize) {
+    Assimp::Importer importer;
+
+    // the node hierarchy is baked into the vertices, so the chunks are in world space
+    const auto flags =  aiProcess_Triangulate |
+                        aiProcess_JoinIdenticalVertices |
+                        aiProcess_GenNormals |
+                        aiProcess_PreTransformVertices |
+                        aiProcess_ValidateDataStructure;
+
+    const aiScene *scene = importer.ReadFile(filePath, flags);
+
+    if (!scene) {
+        std::cout << importer.GetErrorString() << std::endl;
+        return false;
+    }
+
+    TextureResolver textureResolver {parent_path(filePath)};
+
+    std::vector<std::uint32_t> materials;
+
+    for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
+        materials.push_back(writer.addMaterial(convertMaterial(textureResolver, scene->mMaterials[i])));
+    }
+
+    if (materials.empty()) {
+        materials.push_back(writer.addMaterial({}));
+    }
+
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+        const aiMesh *mesh = scene->mMeshes[i];
+        const std::uint32_t material = mesh->mMaterialIndex < materials.size() ? materials[mesh->mMaterialIndex] : materials[0];
+
+        convertMesh(writer, material, mesh, tileSize);
+    }
+
+    return true;
+}
+
+
+int main(int argc, char **argv) {
+    float tileSize = 32.0f;
+    ChunkEncoding encoding = ChunkEncoding::Compressed;
+    std::string outputFilePath;
+    std::vector<std::string> inputFilePaths;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        if (arg == "--tile-size" && i + 1 < argc) {
+            const std::string size = argv[++i];
+
+            if (!parseNumber(size, tileSize) || tileSize <= 0.0f) {
+                std::cout << "Invalid tile size " << size << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg == "--no-compression") {
+            encoding = ChunkEncoding::Raw;
+        }
+        else if (outputFilePath.empty()) {
+            outputFilePath = arg;
+        }
+        else {
+            inputFilePaths.push_back(arg);
+        }
+    }
+
+    if (outputFilePath.empty() || inputFilePaths.empty() || tileSize <= 0.0f) {
+        std::cout << "usage: 3dgraphics-tiler <output.tscene> <input-scene>... [--tile-size <units>] [--no-compression]" << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    TiledSceneWriter writer;
+
+    if (! writer.open(outputFilePath, encoding)) {
+        std::cout << "Can't open " << outputFilePath << " for writing" << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    for (const std::string &inputFilePath : inputFilePaths) {
+        std::cout << "Converting " << inputFilePath << std::endl;
+
+        if (! convertScene(writer, inputFilePath, tileSize)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (! writer.close()) {
+        std::cout << "Failed to write " << outputFilePath << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Wrote " << writer.chunkCount() << " chunks to " << outputFilePath << std::endl;
+
+    return EXIT_SUCCESS;
+}
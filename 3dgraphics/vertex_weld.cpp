@@ -0,0 +1,361 @@
+
+#include "vertex_weld.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <vector>
+#include <assimp/scene.h>
+
+#include "thread_pool.hpp"
+
+
+namespace {
+    const std::uint32_t EmptySlot = 0xFFFFFFFF;
+
+    using Cell = std::array<std::int32_t, 3>;
+
+
+    std::uint32_t hashCell(const Cell &cell) {
+        std::uint32_t hash = static_cast<std::uint32_t>(cell[0]) * 73856093u;
+        hash ^= static_cast<std::uint32_t>(cell[1]) * 19349663u;
+        hash ^= static_cast<std::uint32_t>(cell[2]) * 83492791u;
+
+        // spreads the low bits, the table is indexed with them
+        return hash ^ (hash >> 15);
+    }
+
+
+    bool near(const aiVector3D &a, const aiVector3D &b, const float epsilon) {
+        return std::abs(a.x - b.x) <= epsilon && std::abs(a.y - b.y) <= epsilon && std::abs(a.z - b.z) <= epsilon;
+    }
+
+
+    class VertexWelder {
+    public:
+        VertexWelder(aiMesh *mesh, const WeldParams &params) : mesh(mesh), params(params) {
+            cellSize = 2.0 * params.positionEpsilon;
+        }
+
+        void weld();
+
+    private:
+        Cell computeCell(const aiVector3D &position) const;
+
+        bool equal(std::uint32_t a, std::uint32_t b) const;
+
+        // the unique vertex matching v, or EmptySlot
+        std::uint32_t find(const Cell &cell, std::uint32_t v) const;
+
+        void insert(std::uint32_t v);
+
+        void buildInfluences();
+
+        void compact(const std::vector<std::uint32_t> &remap, const std::vector<std::uint32_t> &uniques);
+
+    private:
+        aiMesh *mesh;
+        const WeldParams params;
+        double cellSize;
+
+        std::vector<Cell> cells;
+        std::vector<std::uint32_t> table;
+        std::uint32_t tableMask = 0;
+
+        // the bone weights of every vertex, sorted by bone
+        std::vector<std::uint32_t> influenceOffsets;
+        std::vector<std::pair<std::uint32_t, float>> influences;
+    };
+
+
+    Cell VertexWelder::computeCell(const aiVector3D &position) const {
+        Cell cell;
+
+        for (int i = 0; i < 3; i++) {
+            if (cellSize > 0.0) {
+                const double index = std::floor(position[i] / cellSize);
+
+                cell[i] = static_cast<std::int32_t>(std::clamp(index, -2147483648.0, 2147483647.0));
+            }
+            else {
+                // the bits of the coordinate. adding zero turns -0 into 0, they compare equal
+                const float coordinate = position[i] + 0.0f;
+                std::memcpy(&cell[i], &coordinate, sizeof(coordinate));
+            }
+        }
+
+        return cell;
+    }
+
+
+    bool VertexWelder::equal(const std::uint32_t a, const std::uint32_t b) const {
+        if (!near(mesh->mVertices[a], mesh->mVertices[b], params.positionEpsilon)) {
+            return false;
+        }
+
+        for (const aiVector3D *normals : {mesh->mNormals, mesh->mTangents, mesh->mBitangents}) {
+            if (normals && !near(normals[a], normals[b], params.normalEpsilon)) {
+                return false;
+            }
+        }
+
+        for (unsigned int channel = 0; channel < AI_MAX_NUMBER_OF_TEXTURECOORDS; channel++) {
+            const aiVector3D *texCoords = mesh->mTextureCoords[channel];
+
+            if (texCoords && !near(texCoords[a], texCoords[b], params.texCoordEpsilon)) {
+                return false;
+            }
+        }
+
+        for (unsigned int channel = 0; channel < AI_MAX_NUMBER_OF_COLOR_SETS; channel++) {
+            const aiColor4D *colors = mesh->mColors[channel];
+
+            if (colors && !(colors[a] == colors[b])) {
+                return false;
+            }
+        }
+
+        if (!influenceOffsets.empty()) {
+            const auto beginA = influences.begin() + influenceOffsets[a], endA = influences.begin() + influenceOffsets[a + 1];
+            const auto beginB = influences.begin() + influenceOffsets[b], endB = influences.begin() + influenceOffsets[b + 1];
+
+            if (!std::equal(beginA, endA, beginB, endB)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    std::uint32_t VertexWelder::find(const Cell &cell, const std::uint32_t v) const {
+        for (std::uint32_t slot = hashCell(cell) & tableMask; table[slot] != EmptySlot; slot = (slot + 1) & tableMask) {
+            const std::uint32_t unique = table[slot];
+
+            if (cells[unique] == cell && equal(unique, v)) {
+                return unique;
+            }
+        }
+
+        return EmptySlot;
+    }
+
+
+    void VertexWelder::insert(const std::uint32_t v) {
+        std::uint32_t slot = hashCell(cells[v]) & tableMask;
+
+        while (table[slot] != EmptySlot) {
+            slot = (slot + 1) & tableMask;
+        }
+
+        table[slot] = v;
+    }
+
+
+    void VertexWelder::buildInfluences() {
+        if (mesh->mNumBones == 0) {
+            return;
+        }
+
+        influenceOffsets.assign(mesh->mNumVertices + 1, 0);
+
+        for (unsigned int b = 0; b < mesh->mNumBones; b++) {
+            const aiBone *bone = mesh->mBones[b];
+
+            for (unsigned int w = 0; w < bone->mNumWeights; w++) {
+                influenceOffsets[bone->mWeights[w].mVertexId + 1]++;
+            }
+        }
+
+        std::partial_sum(influenceOffsets.begin(), influenceOffsets.end(), influenceOffsets.begin());
+
+        influences.resize(influenceOffsets.back());
+
+        // the bones are visited in order, so the weights of each vertex end up sorted by bone
+        std::vector<std::uint32_t> cursors {influenceOffsets.begin(), influenceOffsets.end() - 1};
+
+        for (unsigned int b = 0; b < mesh->mNumBones; b++) {
+            const aiBone *bone = mesh->mBones[b];
+
+            for (unsigned int w = 0; w < bone->mNumWeights; w++) {
+                influences[cursors[bone->mWeights[w].mVertexId]++] = {b, bone->mWeights[w].mWeight};
+            }
+        }
+    }
+
+
+    void VertexWelder::weld() {
+        const std::uint32_t vertexCount = mesh->mNumVertices;
+
+        buildInfluences();
+
+        cells.resize(vertexCount);
+
+        for (std::uint32_t v = 0; v < vertexCount; v++) {
+            cells[v] = computeCell(mesh->mVertices[v]);
+        }
+
+        std::uint32_t tableSize = 16;
+
+        while (tableSize < 2 * vertexCount) {
+            tableSize *= 2;
+        }
+
+        table.assign(tableSize, EmptySlot);
+        tableMask = tableSize - 1;
+
+        std::vector<std::uint32_t> remap(vertexCount);
+        std::vector<std::uint32_t> uniques;
+
+        for (std::uint32_t v = 0; v < vertexCount; v++) {
+            std::uint32_t match = find(cells[v], v);
+
+            // a vertex within the epsilon of a cell side can match the ones of the neighbour cell on that side
+            if (match == EmptySlot && cellSize > 0.0) {
+                std::array<int, 3> sides = {0, 0, 0};
+
+                for (int i = 0; i < 3; i++) {
+                    const double offset = mesh->mVertices[v][i] - cells[v][i] * cellSize;
+
+                    sides[i] = offset < params.positionEpsilon ? -1 : cellSize - offset < params.positionEpsilon ? 1 : 0;
+                }
+
+                // every combination of those neighbours, along one, two or three axes
+                for (int axes = 1; match == EmptySlot && axes < 8; axes++) {
+                    Cell cell = cells[v];
+                    bool valid = true;
+
+                    for (int i = 0; i < 3; i++) {
+                        if (axes & (1 << i)) {
+                            valid = valid && sides[i] != 0;
+                            cell[i] += sides[i];
+                        }
+                    }
+
+                    if (valid) {
+                        match = find(cell, v);
+                    }
+                }
+            }
+
+            if (match == EmptySlot) {
+                remap[v] = static_cast<std::uint32_t>(uniques.size());
+                uniques.push_back(v);
+
+                insert(v);
+            }
+            else {
+                remap[v] = remap[match];
+            }
+        }
+
+        if (uniques.size() < vertexCount) {
+            compact(remap, uniques);
+        }
+    }
+
+
+    void VertexWelder::compact(const std::vector<std::uint32_t> &remap, const std::vector<std::uint32_t> &uniques) {
+        // a unique vertex never moves forward, so the arrays can be compacted in place
+        const auto compactArray = [&uniques](auto *values) {
+            if (values) {
+                for (size_t i = 0; i < uniques.size(); i++) {
+                    values[i] = values[uniques[i]];
+                }
+            }
+        };
+
+        compactArray(mesh->mVertices);
+        compactArray(mesh->mNormals);
+        compactArray(mesh->mTangents);
+        compactArray(mesh->mBitangents);
+
+        for (unsigned int channel = 0; channel < AI_MAX_NUMBER_OF_TEXTURECOORDS; channel++) {
+            compactArray(mesh->mTextureCoords[channel]);
+        }
+
+        for (unsigned int channel = 0; channel < AI_MAX_NUMBER_OF_COLOR_SETS; channel++) {
+            compactArray(mesh->mColors[channel]);
+        }
+
+        for (unsigned int f = 0; f < mesh->mNumFaces; f++) {
+            const aiFace &face = mesh->mFaces[f];
+
+            for (unsigned int i = 0; i < face.mNumIndices; i++) {
+                face.mIndices[i] = remap[face.mIndices[i]];
+            }
+        }
+
+        // the merged vertices have the same weights, only the ones of the unique vertices are kept
+        for (unsigned int b = 0; b < mesh->mNumBones; b++) {
+            aiBone *bone = mesh->mBones[b];
+            unsigned int count = 0;
+
+            for (unsigned int w = 0; w < bone->mNumWeights; w++) {
+                const aiVertexWeight weight = bone->mWeights[w];
+
+                if (uniques[remap[weight.mVertexId]] == weight.mVertexId) {
+                    bone->mWeights[count++] = {remap[weight.mVertexId], weight.mWeight};
+                }
+            }
+
+            bone->mNumWeights = count;
+        }
+
+        mesh->mNumVertices = static_cast<unsigned int>(uniques.size());
+    }
+}
+
+
+WeldStats weldVertices(aiMesh *mesh, const WeldParams &params) {
+    WeldStats stats;
+    stats.verticesBefore = mesh->mNumVertices;
+
+    if (mesh->mNumVertices > 0 && mesh->mNumAnimMeshes == 0) {
+        VertexWelder welder {mesh, params};
+        welder.weld();
+    }
+
+    stats.verticesAfter = mesh->mNumVertices;
+
+    return stats;
+}
+
+
+WeldStats weldVertices(aiScene *scene, const WeldParams &params, ThreadPool *threadPool) {
+    std::vector<unsigned int> order(scene->mNumMeshes);
+    std::iota(order.begin(), order.end(), 0u);
+
+    // the workers pull the meshes in order, starting with the largest ones balances them better
+    std::sort(order.begin(), order.end(), [scene](const unsigned int a, const unsigned int b) {
+        return scene->mMeshes[a]->mNumVertices > scene->mMeshes[b]->mNumVertices;
+    });
+
+    std::vector<WeldStats> meshStats(scene->mNumMeshes);
+
+    const auto weldMesh = [&](const size_t i) {
+        meshStats[i] = weldVertices(scene->mMeshes[order[i]], params);
+    };
+
+    if (threadPool) {
+        threadPool->parallelFor(order.size(), weldMesh);
+    }
+    else {
+        for (size_t i = 0; i < order.size(); i++) {
+            weldMesh(i);
+        }
+    }
+
+    WeldStats stats;
+
+    for (const WeldStats &mesh : meshStats) {
+        stats.verticesBefore += mesh.verticesBefore;
+        stats.verticesAfter += mesh.verticesAfter;
+    }
+
+    return stats;
+}
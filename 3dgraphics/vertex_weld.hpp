@@ -0,0 +1,33 @@
+
+#pragma once
+
+#include <cstddef>
+
+struct aiMesh;
+struct aiScene;
+class ThreadPool;
+
+
+struct WeldParams {
+    // largest difference per component for two attributes to be merged. zero only merges the identical ones,
+    // like aiProcess_JoinIdenticalVertices does
+    float positionEpsilon = 0.0f;
+    float normalEpsilon = 0.0f;
+    float texCoordEpsilon = 0.0f;
+};
+
+
+struct WeldStats {
+    size_t verticesBefore = 0;
+    size_t verticesAfter = 0;
+};
+
+
+// Merges the vertices of the mesh whose positions, normals, tangents, texture coordinates, colors and bone
+// weights all match, and remaps the faces and bones to them. The vertices are hashed on a grid of twice
+// the position epsilon, so only the neighbour cells towards the closest sides of a vertex are searched.
+// Meshes with morph targets are left as they are.
+WeldStats weldVertices(aiMesh *mesh, const WeldParams &params);
+
+// welds the meshes of the scene in parallel, the largest first. without a pool, on the calling thread
+WeldStats weldVertices(aiScene *scene, const WeldParams &params, ThreadPool *threadPool = nullptr);